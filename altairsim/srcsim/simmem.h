@@ -19,6 +19,11 @@
  * 31-JUL-2021 allow building machine without frontpanel
  * 29-AUG-2021 new memory configuration sections
  * 14-DEC-2024 added hardware breakpoint support
+ * 16-OCT-2026 track writes into watched memory ranges for video devices
+ * 16-OCT-2026 hardware breakpoints use per address access bitmaps
+ * 16-OCT-2026 record memory writes into the execution trace
+ * 16-OCT-2026 record memory accesses for code coverage
+ * 16-OCT-2026 pass the memory bank to the execution trace
  */
 
 #ifndef SIMMEM_INC
@@ -29,7 +34,14 @@
 #ifdef WANT_ICE
 #include "simice.h"
 #endif
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_COVER
+#include "simcov.h"
+#endif
 
+#include "simdirty.h"
 #include "tarbell_fdc.h"
 
 #if defined(FRONTPANEL) || defined(BUS_8080)
@@ -92,12 +104,21 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && (hb_map[addr] & HB_WRITE))
+		hb_hit(addr, HB_WRITE);
+#endif
+#ifdef WANT_TRACE
+	if (tr_flag)
+		trace_write(0, addr, data);
+#endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_write(0, addr);
 #endif
 
 	if (p_tab[addr >> 8] == MEM_RW) {
 		memory[addr] = data;
+		dirty_mark(addr);
 		mem_wp = 0;
 	}
 }
@@ -107,16 +128,20 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
+	if (hb_flag && hb_map[addr]) {
 		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
+			if (hb_map[addr] & HB_EXEC)
+				hb_hit(addr, HB_EXEC);
 		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
+			if (hb_map[addr] & HB_READ)
+				hb_hit(addr, HB_READ);
 		}
 	}
 #endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_read(0, addr);
+#endif
 
 	if (tarbell_rom_active && tarbell_rom_enabled) {
 		if (addr <= 0x001f) {
@@ -176,8 +201,10 @@ static inline BYTE dma_read(WORD addr)
 
 static inline void dma_write(WORD addr, BYTE data)
 {
-	if (p_tab[addr >> 8] == MEM_RW)
+	if (p_tab[addr >> 8] == MEM_RW) {
 		memory[addr] = data;
+		dirty_mark(addr);
+	}
 }
 
 /*
@@ -199,6 +226,7 @@ static inline BYTE getmem(WORD addr)
 static inline void putmem(WORD addr, BYTE data)
 {
 	memory[addr] = data;
+	dirty_mark(addr);
 }
 
 /*
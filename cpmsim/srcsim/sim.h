@@ -28,13 +28,19 @@
 /*#define WANT_HB*/	/* no hardware breakpoint */
 #endif
 
+#define WANT_TRACE	/* execution trace recorder */
+#define WANT_COVER	/* code coverage recorder */
+#define WANT_REPLAY	/* record/replay of inputs and interrupts */
+/*#define WANT_REVERSE*/	/* no reverse execution in the ICE */
+#define WANT_LOGGER	/* runtime log levels, asynchronous log output */
+#define WANT_JIT	/* translate hot code into x86-64 host code */
+
 #define HAS_DISKS	/* uses disk images */
 /*#define HAS_CONFIG*/	/* has no configuration file */
 
 #define PIPES		/* use named pipes for auxiliary device */
 #define NETWORKING	/* TCP/IP networked serial ports */
-#define NUMSOC	4	/* number of server sockets */
-#define TCPASYNC	/* tcp/ip server can use async I/O */
+#define NUMSOC	4	/* number of network consoles */
 /*#define CNETDEBUG*/	/* client network protocol debugger */
 /*#define SNETDEBUG*/	/* server network protocol debugger */
 
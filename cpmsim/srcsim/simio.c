@@ -58,6 +58,7 @@
  * 08-OCT-2019 (Mike Douglas) added OUT 161 trap to simbdos.c for host file I/O
  * 24-OCT-2019 move RTC to I/O module for usage by any machine
  * 27-MAY-2024 moved io_in & io_out to simcore
+ * 16-OCT-2026 server sockets handled by the non-blocking netcon module
  */
 
 /*
@@ -134,6 +135,9 @@
 
 #include "rtc80.h"
 #include "simbdos.h"
+#ifdef NETWORKING
+#include "unix_netcon.h"
+#endif
 
 #ifdef NETWORKING
 #include <stdio.h>
@@ -193,12 +197,6 @@ static int aux_out;		/* fd for file "auxiliaryout.txt" */
 
 #ifdef NETWORKING
 
-#define TELNET_TIMEOUT 800	/* telnet negotiation timeout in milliseconds */
-
-static int ss[NUMSOC];		/* server socket descriptors */
-static int ssc[NUMSOC];		/* connected server socket descriptors */
-static int ss_port[NUMSOC];	/* TCP/IP port for server sockets */
-static int ss_telnet[NUMSOC];	/* telnet protocol flag for server sockets */
 static int cs;			/* client socket #1 descriptor */
 static int cs_port;		/* TCP/IP port for cs */
 static char cs_host[BUFSIZE];	/* hostname for cs */
@@ -287,10 +285,6 @@ static void int_timer(int sig);
 
 #ifdef NETWORKING
 static void net_server_config(void), net_client_config(void);
-static void init_server_socket(int n), telnet_negotiation(int fd);
-#ifdef TCPASYNC
-static void int_io(int sig);
-#endif
 #endif
 
 /*
@@ -395,9 +389,6 @@ void init_io(void)
 {
 	register int i;
 	struct stat sbuf;
-#if defined(NETWORKING) && defined(TCPASYNC)
-	static struct sigaction newact;
-#endif
 
 #ifdef PIPES
 	/* check if /tmp/.z80pack exists */
@@ -466,70 +457,18 @@ void init_io(void)
 #ifdef NETWORKING
 	net_server_config();
 	net_client_config();
-
-#ifdef TCPASYNC
-	newact.sa_handler = int_io;
-	sigemptyset(&newact.sa_mask);
-	newact.sa_flags = 0;
-	sigaction(SIGIO, &newact, NULL);
-#endif
-
-	for (i = 0; i < NUMSOC; i++)
-		init_server_socket(i);
+	netcon_start();
 #endif /* NETWORKING */
 }
 
 #ifdef NETWORKING
-/*
- * initialize a server socket
- */
-static void init_server_socket(int n)
-{
-	struct sockaddr_in sin;
-	int on = 1;
-#ifdef TCPASYNC
-	int i;
-#endif
-
-	if (ss_port[n] == 0)
-		return;
-	if ((ss[n] = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
-		LOGE(TAG, "can't create server socket");
-		exit(EXIT_FAILURE);
-	}
-	if (setsockopt(ss[n], SOL_SOCKET, SO_REUSEADDR, (void *) &on,
-		       sizeof(on)) == -1) {
-		LOGE(TAG, "can't setsockopt SO_REUSEADDR on server socket");
-		exit(EXIT_FAILURE);
-	}
-#ifdef TCPASYNC
-	fcntl(ss[n], F_SETOWN, getpid());
-	i = fcntl(ss[n], F_GETFL, 0);
-	if (fcntl(ss[n], F_SETFL, i | O_ASYNC) == -1) {
-		LOGE(TAG, "can't fcntl O_ASYNC on server socket");
-		exit(EXIT_FAILURE);
-	}
-#endif
-	memset((void *) &sin, 0, sizeof(sin));
-	sin.sin_family = AF_INET;
-	sin.sin_addr.s_addr = INADDR_ANY;
-	sin.sin_port = htons(ss_port[n]);
-	if (bind(ss[n], (struct sockaddr *) &sin, sizeof(sin)) == -1) {
-		LOGE(TAG, "can't bind server socket");
-		exit(EXIT_FAILURE);
-	}
-	if (listen(ss[n], 0) == -1) {
-		LOGE(TAG, "can't listen on server socket");
-		exit(EXIT_FAILURE);
-	}
-}
-
 /*
  * Read and process network server configuration file
  */
 static void net_server_config(void)
 {
 	register int i;
+	int telnet, port;
 	FILE *fp;
 	char buf[BUFSIZE];
 	char *s;
@@ -545,7 +484,7 @@ static void net_server_config(void)
 			if ((*s == '\n') || (*s == '#'))
 				continue;
 			i = atoi(s);
-			if ((i < 1) || (i > 4)) {
+			if ((i < 1) || (i > NUMSOC)) {
 				LOGW(TAG, "console %d not supported", i);
 				continue;
 			}
@@ -553,15 +492,19 @@ static void net_server_config(void)
 				s++;
 			while ((*s == ' ') || (*s == '\t'))
 				s++;
-			ss_telnet[i - 1] = atoi(s);
+			telnet = atoi(s);
 			while ((*s != ' ') && (*s != '\t'))
 				s++;
 			while ((*s == ' ') || (*s == '\t'))
 				s++;
-			ss_port[i - 1] = atoi(s);
+			port = atoi(s);
+			if (!netcon_add(i - 1, port, telnet > 0)) {
+				LOGW(TAG, "invalid port %d for console %d",
+				     port, i);
+				continue;
+			}
 			LOG(TAG, "console %d listening on port %d, telnet = %s\r\n",
-			    i, ss_port[i - 1],
-			    ((ss_telnet[i - 1] > 0) ? "on" : "off"));
+			    i, port, ((telnet > 0) ? "on" : "off"));
 		}
 		fclose(fp);
 	}
@@ -632,9 +575,7 @@ void exit_io(void)
 #endif
 
 #ifdef NETWORKING
-	for (i = 0; i < NUMSOC; i++)
-		if (ssc[i])
-			close(ssc[i]);
+	netcon_stop();
 	if (cs)
 		close(cs);
 #endif
@@ -697,69 +638,11 @@ static BYTE cons_in(void)
  */
 static BYTE cons1_in(void)
 {
-	BYTE status = 0;
 #ifdef NETWORKING
-	struct pollfd p[1];
-
-#ifndef TCPASYNC
-	socklen_t alen;
-	struct sockaddr_in fsin;
-	int go_away;
-	int on = 1;
-
-	if (ss[0] == 0)
-		return status;
-
-	p[0].fd = ss[0];
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-
-	if (p[0].revents) {
-
-		alen = sizeof(fsin);
-
-		if (ssc[0] != 0) {
-			go_away = accept(ss[0],
-					 (struct sockaddr *) &fsin, &alen);
-			close(go_away);
-			goto ss0_done;
-		}
-
-		if ((ssc[0] = accept(ss[0], (struct sockaddr *) &fsin,
-				     &alen)) == -1) {
-			LOGW(TAG, "can't accept server socket");
-			ssc[0] = 0;
-		}
-
-		if (setsockopt(ssc[0], IPPROTO_TCP, TCP_NODELAY,
-			       (void *) &on, sizeof(on)) == -1) {
-			LOGW(TAG, "can't setsockopt TCP_NODELAY on server socket");
-		}
-
-		if (ss_telnet[0])
-			telnet_negotiation(ssc[0]);
-	}
-ss0_done:
-#endif /* !TCPASYNC */
-
-	if (ssc[0] != 0) {
-		p[0].fd = ssc[0];
-		p[0].events = POLLIN | POLLOUT;
-		p[0].revents = 0;
-		poll(p, 1, 0);
-		if (p[0].revents & POLLHUP) {
-			close(ssc[0]);
-			ssc[0] = 0;
-			return 0;
-		}
-		if (p[0].revents & POLLIN)
-			status |= 1;
-		if (p[0].revents & POLLOUT)
-			status |= 2;
-	}
-#endif /* NETWORKING */
-	return status;
+	return netcon_status(0);
+#else
+	return (BYTE) 0;
+#endif
 }
 
 /*
@@ -769,69 +652,11 @@ ss0_done:
  */
 static BYTE cons2_in(void)
 {
-	BYTE status = 0;
 #ifdef NETWORKING
-	struct pollfd p[1];
-
-#ifndef TCPASYNC
-	socklen_t alen;
-	struct sockaddr_in fsin;
-	int go_away;
-	int on = 1;
-
-	if (ss[1] == 0)
-		return status;
-
-	p[0].fd = ss[1];
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-
-	if (p[0].revents) {
-
-		alen = sizeof(fsin);
-
-		if (ssc[1] != 0) {
-			go_away = accept(ss[1],
-					 (struct sockaddr *) &fsin, &alen);
-			close(go_away);
-			goto ss1_done;
-		}
-
-		if ((ssc[1] = accept(ss[1], (struct sockaddr *) &fsin,
-				     &alen)) == -1) {
-			LOGW(TAG, "can't accept server socket");
-			ssc[1] = 0;
-		}
-
-		if (setsockopt(ssc[1], IPPROTO_TCP, TCP_NODELAY,
-			       (void *) &on, sizeof(on)) == -1) {
-			LOGW(TAG, "can't setsockopt TCP_NODELAY on server socket");
-		}
-
-		if (ss_telnet[1])
-			telnet_negotiation(ssc[1]);
-	}
-ss1_done:
-#endif /* !TCPASYNC */
-
-	if (ssc[1] != 0) {
-		p[0].fd = ssc[1];
-		p[0].events = POLLIN | POLLOUT;
-		p[0].revents = 0;
-		poll(p, 1, 0);
-		if (p[0].revents & POLLHUP) {
-			close(ssc[1]);
-			ssc[1] = 0;
-			return 0;
-		}
-		if (p[0].revents & POLLIN)
-			status |= 1;
-		if (p[0].revents & POLLOUT)
-			status |= 2;
-	}
-#endif /* NETWORKING */
-	return status;
+	return netcon_status(1);
+#else
+	return (BYTE) 0;
+#endif
 }
 
 /*
@@ -841,69 +666,11 @@ ss1_done:
  */
 static BYTE cons3_in(void)
 {
-	BYTE status = 0;
 #ifdef NETWORKING
-	struct pollfd p[1];
-
-#ifndef TCPASYNC
-	socklen_t alen;
-	struct sockaddr_in fsin;
-	int go_away;
-	int on = 1;
-
-	if (ss[2] == 0)
-		return status;
-
-	p[0].fd = ss[2];
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-
-	if (p[0].revents) {
-
-		alen = sizeof(fsin);
-
-		if (ssc[2] != 0) {
-			go_away = accept(ss[2],
-					 (struct sockaddr *) &fsin, &alen);
-			close(go_away);
-			goto ss2_done;
-		}
-
-		if ((ssc[2] = accept(ss[2], (struct sockaddr *) &fsin,
-				     &alen)) == -1) {
-			LOGW(TAG, "can't accept server socket");
-			ssc[2] = 0;
-		}
-
-		if (setsockopt(ssc[2], IPPROTO_TCP, TCP_NODELAY,
-			       (void *) &on, sizeof(on)) == -1) {
-			LOGW(TAG, "can't setsockopt TCP_NODELAY on server socket");
-		}
-
-		if (ss_telnet[2])
-			telnet_negotiation(ssc[2]);
-	}
-ss2_done:
-#endif /* !TCPASYNC */
-
-	if (ssc[2] != 0) {
-		p[0].fd = ssc[2];
-		p[0].events = POLLIN | POLLOUT;
-		p[0].revents = 0;
-		poll(p, 1, 0);
-		if (p[0].revents & POLLHUP) {
-			close(ssc[2]);
-			ssc[2] = 0;
-			return 0;
-		}
-		if (p[0].revents & POLLIN)
-			status |= 1;
-		if (p[0].revents & POLLOUT)
-			status |= 2;
-	}
-#endif /* NETWORKING */
-	return status;
+	return netcon_status(2);
+#else
+	return (BYTE) 0;
+#endif
 }
 
 /*
@@ -913,69 +680,11 @@ ss2_done:
  */
 static BYTE cons4_in(void)
 {
-	BYTE status = 0;
 #ifdef NETWORKING
-	struct pollfd p[1];
-
-#ifndef TCPASYNC
-	socklen_t alen;
-	struct sockaddr_in fsin;
-	int go_away;
-	int on = 1;
-
-	if (ss[3] == 0)
-		return status;
-
-	p[0].fd = ss[3];
-	p[0].events = POLLIN;
-	p[0].revents = 0;
-	poll(p, 1, 0);
-
-	if (p[0].revents) {
-
-		alen = sizeof(fsin);
-
-		if (ssc[3] != 0) {
-			go_away = accept(ss[3],
-					 (struct sockaddr *) &fsin, &alen);
-			close(go_away);
-			goto ss3_done;
-		}
-
-		if ((ssc[3] = accept(ss[3], (struct sockaddr *) &fsin,
-				     &alen)) == -1) {
-			LOGW(TAG, "can't accept server socket");
-			ssc[3] = 0;
-		}
-
-		if (setsockopt(ssc[3], IPPROTO_TCP, TCP_NODELAY,
-			       (void *) &on, sizeof(on)) == -1) {
-			LOGW(TAG, "can't setsockopt TCP_NODELAY on server socket");
-		}
-
-		if (ss_telnet[3])
-			telnet_negotiation(ssc[3]);
-	}
-ss3_done:
-#endif /* !TCPASYNC */
-
-	if (ssc[3] != 0) {
-		p[0].fd = ssc[3];
-		p[0].events = POLLIN | POLLOUT;
-		p[0].revents = 0;
-		poll(p, 1, 0);
-		if (p[0].revents & POLLHUP) {
-			close(ssc[3]);
-			ssc[3] = 0;
-			return 0;
-		}
-		if (p[0].revents & POLLIN)
-			status |= 1;
-		if (p[0].revents & POLLOUT)
-			status |= 2;
-	}
-#endif /* NETWORKING */
-	return status;
+	return netcon_status(3);
+#else
+	return (BYTE) 0;
+#endif
 }
 
 /*
@@ -1124,36 +833,20 @@ static BYTE cond_in(void)
  */
 static BYTE cond1_in(void)
 {
-	char c;
 #ifdef NETWORKING
-	char x;
+	BYTE c = netcon_read(0);
 
-	if (read(ssc[0], &c, 1) != 1) {
-		if ((errno == EAGAIN) || (errno == EINTR)) {
-			close(ssc[0]);
-			ssc[0] = 0;
-			return (BYTE) 0;
-		} else {
-			LOGE(TAG, "can't read console 1");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-			return (BYTE) 0;
-		}
-	}
-	if (ss_telnet[0] && (c == '\r'))
-		if (read(ssc[0], &x, 1) != 1)
-			LOGE(TAG, "can't read console 1");
 #ifdef SNETDEBUG
 	if (sdirection != 1) {
 		printf("\n<- ");
 		sdirection = 1;
 	}
-	printf("%02x ", (BYTE) c);
+	printf("%02x ", c);
 #endif
+	return c;
 #else /* !NETWORKING */
-	c = 0;
+	return (BYTE) 0;
 #endif
-	return (BYTE) c;
 }
 
 /*
@@ -1161,36 +854,20 @@ static BYTE cond1_in(void)
  */
 static BYTE cond2_in(void)
 {
-	char c;
 #ifdef NETWORKING
-	char x;
+	BYTE c = netcon_read(1);
 
-	if (read(ssc[1], &c, 1) != 1) {
-		if ((errno == EAGAIN) || (errno == EINTR)) {
-			close(ssc[1]);
-			ssc[1] = 0;
-			return (BYTE) 0;
-		} else {
-			LOGE(TAG, "can't read console 2");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-			return (BYTE) 0;
-		}
-	}
-	if (ss_telnet[1] && (c == '\r'))
-		if (read(ssc[1], &x, 1) != 1)
-			LOGE(TAG, "can't read console 2");
 #ifdef SNETDEBUG
 	if (sdirection != 1) {
 		printf("\n<- ");
 		sdirection = 1;
 	}
-	printf("%02x ", (BYTE) c);
+	printf("%02x ", c);
 #endif
+	return c;
 #else /* !NETWORKING */
-	c = 0;
+	return (BYTE) 0;
 #endif
-	return (BYTE) c;
 }
 
 /*
@@ -1198,36 +875,20 @@ static BYTE cond2_in(void)
  */
 static BYTE cond3_in(void)
 {
-	char c;
 #ifdef NETWORKING
-	char x;
+	BYTE c = netcon_read(2);
 
-	if (read(ssc[2], &c, 1) != 1) {
-		if ((errno == EAGAIN) || (errno == EINTR)) {
-			close(ssc[2]);
-			ssc[2] = 0;
-			return (BYTE) 0;
-		} else {
-			LOGE(TAG, "can't read console 3");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-			return (BYTE) 0;
-		}
-	}
-	if (ss_telnet[2] && (c == '\r'))
-		if (read(ssc[2], &x, 1) != 1)
-			LOGE(TAG, "can't read console 3");
 #ifdef SNETDEBUG
 	if (sdirection != 1) {
 		printf("\n<- ");
 		sdirection = 1;
 	}
-	printf("%02x ", (BYTE) c);
+	printf("%02x ", c);
 #endif
+	return c;
 #else /* !NETWORKING */
-	c = 0;
+	return (BYTE) 0;
 #endif
-	return (BYTE) c;
 }
 
 /*
@@ -1235,36 +896,20 @@ static BYTE cond3_in(void)
  */
 static BYTE cond4_in(void)
 {
-	char c;
 #ifdef NETWORKING
-	char x;
+	BYTE c = netcon_read(3);
 
-	if (read(ssc[3], &c, 1) != 1) {
-		if ((errno == EAGAIN) || (errno == EINTR)) {
-			close(ssc[3]);
-			ssc[3] = 0;
-			return (BYTE) 0;
-		} else {
-			LOGE(TAG, "can't read console 4");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-			return (BYTE) 0;
-		}
-	}
-	if (ss_telnet[3] && (c == '\r'))
-		if (read(ssc[3], &x, 1) != 1)
-			LOGE(TAG, "can't read console 4");
 #ifdef SNETDEBUG
 	if (sdirection != 1) {
 		printf("\n<- ");
 		sdirection = 1;
 	}
-	printf("%02x ", (BYTE) c);
+	printf("%02x ", c);
 #endif
+	return c;
 #else /* !NETWORKING */
-	c = 0;
+	return (BYTE) 0;
 #endif
-	return (BYTE) c;
 }
 
 /*
@@ -1314,7 +959,7 @@ again:
 
 /*
  *	I/O handler for write console 1 data:
- *	the output is written to the socket
+ *	the output is queued for the socket
  */
 static void cond1_out(BYTE data)
 {
@@ -1326,16 +971,7 @@ static void cond1_out(BYTE data)
 	}
 	printf("%02x ", (BYTE) data);
 #endif
-again:
-	if (write(ssc[0], (char *) &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write console 1");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
-	}
+	netcon_write(0, data);
 #else /* !NETWORKING */
 	UNUSED(data);
 #endif
@@ -1343,7 +979,7 @@ again:
 
 /*
  *	I/O handler for write console 2 data:
- *	the output is written to the socket
+ *	the output is queued for the socket
  */
 static void cond2_out(BYTE data)
 {
@@ -1355,16 +991,7 @@ static void cond2_out(BYTE data)
 	}
 	printf("%02x ", (BYTE) data);
 #endif
-again:
-	if (write(ssc[1], (char *) &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write console 2");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
-	}
+	netcon_write(1, data);
 #else /* !NETWORKING */
 	UNUSED(data);
 #endif
@@ -1372,7 +999,7 @@ again:
 
 /*
  *	I/O handler for write console 3 data:
- *	the output is written to the socket
+ *	the output is queued for the socket
  */
 static void cond3_out(BYTE data)
 {
@@ -1384,16 +1011,7 @@ static void cond3_out(BYTE data)
 	}
 	printf("%02x ", (BYTE) data);
 #endif
-again:
-	if (write(ssc[2], (char *) &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write console 3");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
-	}
+	netcon_write(2, data);
 #else /* !NETWORKING */
 	UNUSED(data);
 #endif
@@ -1401,7 +1019,7 @@ again:
 
 /*
  *	I/O handler for write console 4 data:
- *	the output is written to the socket
+ *	the output is queued for the socket
  */
 static void cond4_out(BYTE data)
 {
@@ -1413,16 +1031,7 @@ static void cond4_out(BYTE data)
 	}
 	printf("%02x ", (BYTE) data);
 #endif
-again:
-	if (write(ssc[3], (char *) &data, 1) != 1) {
-		if (errno == EINTR) {
-			goto again;
-		} else {
-			LOGE(TAG, "can't write console 4");
-			cpu_error = IOERROR;
-			cpu_state = ST_STOPPED;
-		}
-	}
+	netcon_write(3, data);
 #else /* !NETWORKING */
 	UNUSED(data);
 #endif
@@ -2101,101 +1710,3 @@ static void int_timer(int sig)
 	int_int = true;
 	int_data = 0xff;	/* RST 38H for IM 0, 0FFH for IM 2 */
 }
-
-#if defined(NETWORKING) && defined(TCPASYNC)
-/*
- *	SIGIO interrupt handler
- */
-static void int_io(int sig)
-{
-	register int i;
-	struct sockaddr_in fsin;
-	socklen_t alen;
-	struct pollfd p[NUMSOC];
-	int go_away;
-	int on = 1;
-
-	UNUSED(sig);
-
-	for (i = 0; i < NUMSOC; i++) {
-		p[i].fd = ss[i];
-		p[i].events = POLLIN;
-		p[i].revents = 0;
-	}
-
-	poll(p, NUMSOC, 0);
-
-	for (i = 0; i < NUMSOC; i++) {
-		if ((ss[i] != 0) && (p[i].revents)) {
-			alen = sizeof(fsin);
-
-			if (ssc[i] != 0) {
-				go_away = accept(ss[i],
-						 (struct sockaddr *) &fsin,
-						 &alen);
-				close(go_away);
-				return;
-			}
-
-			if ((ssc[i] = accept(ss[i], (struct sockaddr *) &fsin,
-					     &alen)) == -1) {
-				LOGW(TAG, "can't accept on server socket");
-				ssc[i] = 0;
-			}
-
-			if (setsockopt(ssc[i], IPPROTO_TCP, TCP_NODELAY,
-				       (void *) &on, sizeof(on)) == -1) {
-				LOGW(TAG, "can't setsockopt TCP_NODELAY on server socket");
-			}
-
-			if (ss_telnet[i])
-				telnet_negotiation(ssc[i]);
-		}
-	}
-}
-#endif /* NETWORKING && TCPASYNC */
-
-#ifdef NETWORKING
-/*
- *	do the telnet option negotiation
- */
-void telnet_negotiation(int fd)
-{
-	static unsigned char will_echo[3] = {255, 251, 1};
-	static unsigned char char_mode[3] = {255, 251, 3};
-	struct pollfd p[1];
-	BYTE c[3];
-
-	/* send the telnet options we need */
-	if (write(fd, &char_mode, 3) != 3)
-		LOGE(TAG, "can't send char_mode telnet option");
-	if (write(fd, &will_echo, 3) != 3)
-		LOGE(TAG, "can't send will_echo telnet option");
-
-	/* and reject all others offered */
-	p[0].fd = fd;
-	p[0].events = POLLIN;
-	while (true) {
-		/* wait for input */
-		p[0].revents = 0;
-		poll(p, 1, TELNET_TIMEOUT);
-
-		/* done if no more input */
-		if (! p[0].revents)
-			break;
-
-		/* else read the option */
-		if (read(fd, &c, 3) != 3)
-			LOGE(TAG, "can't read telnet option");
-		LOGD(TAG, "telnet: %d %d %d", c[0], c[1], c[2]);
-		if (c[2] == 1 || c[2] == 3)
-			continue;	/* ignore answers to our requests */
-		if (c[1] == 251)	/* and reject other options */
-			c[1] = 254;
-		else if (c[1] == 253)
-			c[1] = 252;
-		if (write(fd, &c, 3) != 3)
-			LOGE(TAG, "can't write telnet option");
-	}
-}
-#endif /* NETWORKING */
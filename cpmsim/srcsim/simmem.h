@@ -29,6 +29,12 @@
  * 09-APR-2018 modified MMU write protect port as used by Alan Cox for FUZIX
  * 04-NOV-2019 add functions for direct memory access
  * 14-DEC-2024 added hardware breakpoint support
+ * 16-OCT-2026 hardware breakpoints use per address access bitmaps
+ * 16-OCT-2026 record memory writes into the execution trace
+ * 16-OCT-2026 record memory accesses for code coverage
+ * 16-OCT-2026 memory writes drop translated code
+ * 16-OCT-2026 memory mapping for chained translated code
+ * 16-OCT-2026 pass the memory bank to the execution trace
  */
 
 #ifndef SIMMEM_INC
@@ -39,6 +45,15 @@
 #ifdef WANT_ICE
 #include "simice.h"
 #endif
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_COVER
+#include "simcov.h"
+#endif
+#ifdef WANT_JIT
+#include "simjit.h"
+#endif
 
 #ifdef BUS_8080
 #include "simglb.h"
@@ -52,6 +67,10 @@ extern void init_memory(void);
 extern BYTE *memory[MAXSEG];
 extern int selbnk, maxbnk, segsize, wp_common;
 
+#define MEM_BANK(addr)	(((addr) >= segsize) ? 0 : selbnk) /* bank of addr */
+#define JIT_BANK(addr)	MEM_BANK(addr)	/* bank of code */
+#define JIT_MAP		((segsize << 8) | selbnk) /* memory mapping */
+
 /*
  * memory access for the CPU cores
  */
@@ -62,8 +81,16 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && (hb_map[addr] & HB_WRITE))
+		hb_hit(addr, HB_WRITE);
+#endif
+#ifdef WANT_TRACE
+	if (tr_flag)
+		trace_write((addr >= segsize) ? 0 : selbnk, addr, data);
+#endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_write((addr >= segsize) ? 0 : selbnk, addr);
 #endif
 
 	if ((addr >= segsize) && (wp_common != 0)) {
@@ -83,6 +110,9 @@ static inline void memwrt(WORD addr, BYTE data)
 		else
 			*(memory[selbnk] + addr) = data;
 	}
+#ifdef WANT_JIT
+	jit_write(addr);
+#endif
 }
 
 static inline BYTE memrdr(WORD addr)
@@ -90,16 +120,20 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
+	if (hb_flag && hb_map[addr]) {
 		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
+			if (hb_map[addr] & HB_EXEC)
+				hb_hit(addr, HB_EXEC);
 		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
+			if (hb_map[addr] & HB_READ)
+				hb_hit(addr, HB_READ);
 		}
 	}
 #endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_read((addr >= segsize) ? 0 : selbnk, addr);
+#endif
 
 	if (selbnk == 0) {
 		data = *(memory[0] + addr);
@@ -136,6 +170,9 @@ static inline void dma_write(WORD addr, BYTE data)
 		else
 			*(memory[selbnk] + addr) = data;
 	}
+#ifdef WANT_JIT
+	jit_write(addr);
+#endif
 }
 
 static inline BYTE dma_read(WORD addr)
@@ -162,6 +199,9 @@ static inline void putmem(WORD addr, BYTE data)
 		else
 			*(memory[selbnk] + addr) = data;
 	}
+#ifdef WANT_JIT
+	jit_write(addr);
+#endif
 }
 
 static inline BYTE getmem(WORD addr)
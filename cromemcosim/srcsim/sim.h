@@ -53,14 +53,22 @@
 /*#define WANT_HB*/	/* no hardware breakpoint */
 #endif
 
+#define WANT_TRACE	/* execution trace recorder */
+#define WANT_COVER	/* code coverage recorder */
+#define WANT_REPLAY	/* record/replay of inputs and interrupts */
+/*#define WANT_REVERSE*/	/* no reverse execution in the ICE */
+#define WANT_LOGGER	/* runtime log levels, asynchronous log output */
+
 #define HAS_DAZZLER	/* has simulated I/O for Cromemco Dazzler */
 #define HAS_D7A	        /* has simulated I/O for Cromemco D+7A */
 #define HAS_DISKS	/* uses disk images */
 #define HAS_CONFIG	/* has configuration files somewhere */
 #define HAS_BANKED_ROM	/* has banked RDOS ROM */
+#define HAS_DMA_BLOCK	/* memory has block functions for DMA */
 
 #define HAS_NETSERVER		/* uses civet webserver to present a web based frontend */
 #define NS_DEF_PORT 8080	/* default port number for civet webserver */
+#define WANT_METRICS		/* live counters for the /metrics endpoint */
 #define HAS_MODEM		/* has simulated 'AT' style modem over TCP/IP (telnet) */
 #define HAS_HAL			/* implements a hardware abstraction layer (HAL) for TU-ART devices */
 
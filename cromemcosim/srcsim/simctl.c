@@ -28,6 +28,7 @@
  * 17-JUN-2021 allow building machine without frontpanel
  * 29-APR-2024 added CPU execution statistics
  * 04-JAN-2025 add SDL2 support
+ * 16-OCT-2026 SDL2: front panel frame rate paced by simsdl
  */
 
 #include <stdio.h>
@@ -87,7 +88,8 @@ static win_funcs_t fp_win_funcs = {
 	fp_openWindow,
 	fp_quit,
 	fp_procEvent,
-	fp_draw
+	fp_draw,
+	0	/* set from fp_fps */
 };
 #endif
 #endif /* FRONTPANEL */
@@ -118,6 +120,7 @@ void mon(void)
 			exit(EXIT_FAILURE);
 		}
 #ifdef WANT_SDL
+		fp_win_funcs.fps = (int) fp_fps;
 		fp_win_id = simsdl_create(&fp_win_funcs);
 #endif
 
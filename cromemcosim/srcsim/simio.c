@@ -32,6 +32,7 @@
  * 17-JUN-2021 allow building machine without frontpanel
  * 29-JUL-2021 add boot config for machine without frontpanel
  * 27-MAY-2024 moved io_in & io_out to simcore
+ * 16-OCT-2026 bank switching invalidates watched video memory
  */
 
 #include <pthread.h>
@@ -471,6 +472,8 @@ static void mmu_out(BYTE data)
 		return;
 	}
 
+	if (selbnk != sel)
+		dirty_touch();
 	selbnk = sel;
 }
 
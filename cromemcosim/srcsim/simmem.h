@@ -18,17 +18,32 @@
  * 30-AUG-2021 new memory configuration sections
  * 02-SEP-2021 implement banked ROM
  * 14-DEC-2024 added hardware breakpoint support
+ * 16-OCT-2026 track writes into watched memory ranges for video devices
+ * 16-OCT-2026 hardware breakpoints use per address access bitmaps
+ * 16-OCT-2026 record memory writes into the execution trace
+ * 16-OCT-2026 record memory accesses for code coverage
+ * 16-OCT-2026 added block functions for the Z80-DMA
+ * 16-OCT-2026 pass the memory bank to the execution trace
  */
 
 #ifndef SIMMEM_INC
 #define SIMMEM_INC
 
+#include <string.h>
+
 #include "sim.h"
 #include "simdefs.h"
 #ifdef WANT_ICE
 #include "simice.h"
 #endif
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_COVER
+#include "simcov.h"
+#endif
 
+#include "simdirty.h"
 #include "cromemco-fdc.h"
 
 #if defined(FRONTPANEL) || defined(BUS_8080)
@@ -70,6 +85,8 @@ extern BYTE *memory[MAXSEG];
 extern int selbnk, bankio, num_banks;
 extern bool common;
 
+#define MEM_BANK(addr)	selbnk		/* bank of addr */
+
 extern int p_tab[MAXPAGES];		/* 256 pages of 256 bytes */
 
 /* return page to RAM pool */
@@ -110,8 +127,16 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && (hb_map[addr] & HB_WRITE))
+		hb_hit(addr, HB_WRITE);
+#endif
+#ifdef WANT_TRACE
+	if (tr_flag)
+		trace_write(selbnk, addr, data);
+#endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_write(selbnk, addr);
 #endif
 
 	if (fdc_rom_active && (addr >> 13) == 0x6) { /* Covers C000 to DFFF */
@@ -128,6 +153,7 @@ static inline void memwrt(WORD addr, BYTE data)
 					*(memory[i] + addr) = data;
 			}
 		}
+		dirty_mark(addr);
 	}
 }
 
@@ -136,16 +162,20 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
+	if (hb_flag && hb_map[addr]) {
 		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
+			if (hb_map[addr] & HB_EXEC)
+				hb_hit(addr, HB_EXEC);
 		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
+			if (hb_map[addr] & HB_READ)
+				hb_hit(addr, HB_READ);
 		}
 	}
 #endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_read(selbnk, addr);
+#endif
 
 	if (fdc_rom_active && (addr >> 13) == 0x6) { /* Covers C000 to DFFF */
 		data = *(fdc_banked_rom + addr - 0xC000);
@@ -196,6 +226,51 @@ static inline void dma_write(WORD addr, BYTE data)
 		return;
 	} else if (selbnk || p_tab[addr >> 8] == MEM_RW) {
 		*(memory[selbnk] + addr) = data;
+		dirty_mark(addr);
+	}
+}
+
+/*
+ * block transfers for the Z80-DMA, the range must not wrap around,
+ * the memory is checked in pages
+ */
+static inline void dma_read_block(WORD addr, BYTE *buf, unsigned len)
+{
+	register unsigned n;
+
+	while (len > 0) {
+		n = 256 - (addr & 0xff);
+		if (n > len)
+			n = len;
+		if (fdc_rom_active && (addr >> 13) == 0x6)
+			memcpy(buf, fdc_banked_rom + addr - 0xC000, n);
+		else if (selbnk || p_tab[addr >> 8] != MEM_NONE)
+			memcpy(buf, memory[selbnk] + addr, n);
+		else
+			memset(buf, 0xff, n);
+		addr += n;
+		buf += n;
+		len -= n;
+	}
+}
+
+static inline void dma_write_block(WORD addr, const BYTE *buf, unsigned len)
+{
+	register unsigned n;
+
+	while (len > 0) {
+		n = 256 - (addr & 0xff);
+		if (n > len)
+			n = len;
+		if (fdc_rom_active && (addr >> 13) == 0x6)
+			;
+		else if (selbnk || p_tab[addr >> 8] == MEM_RW) {
+			memcpy(memory[selbnk] + addr, buf, n);
+			dirty_mark_block(addr, n);
+		}
+		addr += n;
+		buf += n;
+		len -= n;
 	}
 }
 
@@ -219,6 +294,7 @@ static inline void putmem(WORD addr, BYTE data)
 		*(fdc_banked_rom + addr - 0xC000) = data;
 	} else {
 		*(memory[selbnk] + addr) = data;
+		dirty_mark(addr);
 	}
 }
 
@@ -46,6 +46,7 @@ extern void	fp_procEvents(void);
 extern void	fp_draw(void);
 #endif
 extern void	fp_framerate(float f);
+extern void	fp_getStats(int *fps, int *sps);
 extern void	fp_sampleData(void);
 extern void	fp_sampleDataWarp(int clockwarp);
 extern void	fp_sampleLightGroup(int groupnum, int clockwarp);
@@ -257,6 +257,17 @@ void fp_framerate(float v)
 	framerate_set(v);
 }
 
+/* frames drawn and data samples taken in the last second */
+void fp_getStats(int *fps, int *sps)
+{
+	if (panel == NULL) {
+		*fps = *sps = 0;
+		return;
+	}
+	*fps = panel->frames_per_second;
+	*sps = panel->samples_per_second;
+}
+
 int fp_init(const char *cfg_fname)
 {
 	return fp_init2(NULL, cfg_fname, 800);
@@ -53,6 +53,12 @@
 /*#define WANT_HB*/	/* no hardware breakpoint */
 #endif
 
+#define WANT_TRACE	/* execution trace recorder */
+#define WANT_COVER	/* code coverage recorder */
+#define WANT_REPLAY	/* record/replay of inputs and interrupts */
+/*#define WANT_REVERSE*/	/* no reverse execution in the ICE */
+#define WANT_LOGGER	/* runtime log levels, asynchronous log output */
+
 #define UNIX_TERMINAL	/* uses a UNIX terminal emulation */
 #define HAS_DAZZLER	/* has simulated I/O for Cromemeco Dazzler */
 #define HAS_CYCLOPS	/* has simulated I/O for Cromemeco 88 CCC/ACC Cyclops Camera */
@@ -67,6 +73,7 @@
 
 #define HAS_NETSERVER		/* uses civet webserver to present a web based frontend */
 #define NS_DEF_PORT 8080	/* default port number for civet webserver */
+#define WANT_METRICS		/* live counters for the /metrics endpoint */
 #define HAS_MODEM		/* has simulated 'AT' style modem over TCP/IP (telnet) */
 #define HAS_APU			/* has simulated AM9511 floating point maths coprocessor */
 #define HAS_HAL			/* implements a hardware abstraction layer (HAL) for SIO ports */
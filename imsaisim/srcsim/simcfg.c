@@ -35,6 +35,7 @@
  * 05-AUG-2021 add boot config for machine without frontpanel
  * 29-AUG-2021 new memory configuration sections
  * 03-JAN-2025 changed colors configuration to RGB-triple
+ * 16-OCT-2026 AM9511 clock for exact timing
  */
 
 #include <stdlib.h>
@@ -75,6 +76,9 @@ static const char *TAG = "config";
 int  fp_size = 800;		/* default frontpanel size */
 BYTE fp_port = 0;		/* default fp input port value */
 int  ns_port = NS_DEF_PORT;	/* default port to run web server on */
+#ifdef HAS_APU
+int  am9511_clock = 0;		/* AM9511 clock in MHz, 0 = no busy time */
+#endif
 
 void config(void)
 {
@@ -330,6 +334,15 @@ void config(void)
 					break;
 				}
 #endif
+#ifdef HAS_APU
+			} else if (!strcmp(t1, "am9511_clock")) {
+				am9511_clock = atoi(t2);
+				if (am9511_clock < 0) {
+					LOGW(TAG, "invalid value for %s: %s",
+					     t1, t2);
+					am9511_clock = 0;
+				}
+#endif
 #ifdef HAS_NOISEMAKER
 			} else if (!strcmp(t1, "noisemaker_sample_rate")) {
 				noisemaker_sample_rate = strtol(t2, NULL, 0);
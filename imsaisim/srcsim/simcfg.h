@@ -33,6 +33,7 @@
  * 20-JUL-2021 log banked memory
  * 05-AUG-2021 add boot config for machine without frontpanel
  * 29-AUG-2021 new memory configuration sections
+ * 16-OCT-2026 AM9511 clock for exact timing
  */
 
 #ifndef SIMCFG_INC
@@ -44,6 +45,9 @@
 extern int  fp_size;
 extern BYTE fp_port;
 extern int  ns_port;
+#ifdef HAS_APU
+extern int  am9511_clock;
+#endif
 
 extern void config(void);
 
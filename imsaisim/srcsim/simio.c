@@ -38,6 +38,8 @@
  * 05-AUG-2021 add boot config for machine without frontpanel
  * 07-AUG-2021 add APU emulation
  * 27-MAY-2024 moved io_in & io_out to simcore
+ * 16-OCT-2026 bank switching invalidates watched video memory
+ * 16-OCT-2026 optional AM9511 busy time
  */
 
 #include <unistd.h>
@@ -128,6 +130,7 @@ unix_connector_t ucons[NUMUSOC]; /* socket connections for SIO's */
 static BYTE hwctl_lock = 0xff;	/* lock status hardware control port */
 #ifdef HAS_APU
 static void *am9511 = NULL;	/* am9511 instantiation */
+static Tstates_t am9511_ready;	/* T-states when the am9511 is done */
 #endif
 
 /*
@@ -374,6 +377,7 @@ void reset_io(void)
 	imsai_fif_reset();
 #ifdef HAS_APU
 	am_reset(am9511);
+	am9511_ready = 0;
 #endif
 }
 
@@ -600,6 +604,8 @@ static void mmu_out(BYTE data)
 		cpu_state = ST_STOPPED;
 	}
 
+	if (selbnk != data)
+		dirty_touch();
 	selbnk = data;
 }
 
@@ -614,10 +620,16 @@ static BYTE apu_data_in(void)
 
 /*
  *	read am9511 status port
+ *	with am9511_clock set the chip is busy for the clock cycles
+ *	of the last command, the result is there at once nevertheless
  */
 static BYTE apu_status_in(void)
 {
-	return am_status(am9511);
+	BYTE status = am_status(am9511);
+
+	if (T < am9511_ready)
+		status |= AM_BUSY;
+	return status;
 }
 
 /*
@@ -634,5 +646,10 @@ static void apu_data_out(BYTE data)
 static void apu_status_out(BYTE status)
 {
 	am_command(am9511, status);
+
+	if (am9511_clock > 0)
+		am9511_ready = T + (Tstates_t) am_cycles(am9511) *
+			       (f_value > 0 ? f_value : CPU_SPEED) /
+			       am9511_clock;
 }
 #endif
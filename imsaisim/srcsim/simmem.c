@@ -17,6 +17,7 @@
  * 18-OCT-2019 add MMU and memory banks
  * 20-JUL-2021 log banked memory
  * 29-AUG-2021 new memory configuration sections
+ * 16-OCT-2026 group swapping invalidates watched video memory
  */
 
 #include <stdlib.h>
@@ -80,6 +81,8 @@ void groupswap(void)
 {
 	LOGD(TAG, "MPU-B Banked ROM/RAM group select %02X", groupsel);
 
+	dirty_touch();
+
 	if (groupsel & _GROUP0) {
 		rdrvec[0] = &memory[0x0000];
 		rdrvec[1] = &memory[0x0100];
@@ -22,6 +22,11 @@
  * 20-JUL-2021 log banked memory
  * 29-AUG-2021 new memory configuration sections
  * 14-DEC-2024 added hardware breakpoint support
+ * 16-OCT-2026 track writes into watched memory ranges for video devices
+ * 16-OCT-2026 hardware breakpoints use per address access bitmaps
+ * 16-OCT-2026 record memory writes into the execution trace
+ * 16-OCT-2026 record memory accesses for code coverage
+ * 16-OCT-2026 pass the memory bank to the execution trace
  */
 
 #ifndef SIMMEM_INC
@@ -32,6 +37,14 @@
 #ifdef WANT_ICE
 #include "simice.h"
 #endif
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_COVER
+#include "simcov.h"
+#endif
+
+#include "simdirty.h"
 
 #if defined(FRONTPANEL) || defined(BUS_8080)
 #include "simglb.h"
@@ -73,6 +86,8 @@ extern int p_tab[MAXPAGES];
 extern int _p_tab[MAXPAGES];
 extern int selbnk, num_banks;
 
+#define MEM_BANK(addr)	(((addr) >= SEGSIZ) ? 0 : selbnk) /* bank of addr */
+
 extern void ctrl_port_out(BYTE data);
 extern BYTE ctrl_port_in(void);
 
@@ -131,8 +146,16 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && (hb_map[addr] & HB_WRITE))
+		hb_hit(addr, HB_WRITE);
+#endif
+#ifdef WANT_TRACE
+	if (tr_flag)
+		trace_write((addr >= SEGSIZ) ? 0 : selbnk, addr, data);
+#endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_write((addr >= SEGSIZ) ? 0 : selbnk, addr);
 #endif
 
 	if ((selbnk == 0) || (addr >= SEGSIZ)) {
@@ -141,7 +164,7 @@ static inline void memwrt(WORD addr, BYTE data)
 	} else {
 		*(banks[selbnk] + addr) = data;
 	}
-
+	dirty_mark(addr);
 }
 
 static inline BYTE memrdr(WORD addr)
@@ -149,16 +172,20 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
+	if (hb_flag && hb_map[addr]) {
 		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
+			if (hb_map[addr] & HB_EXEC)
+				hb_hit(addr, HB_EXEC);
 		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
+			if (hb_map[addr] & HB_READ)
+				hb_hit(addr, HB_READ);
 		}
 	}
 #endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_read((addr >= SEGSIZ) ? 0 : selbnk, addr);
+#endif
 
 	if ((selbnk == 0) || (addr >= SEGSIZ)) {
 		if (p_tab[addr >> 8] != MEM_NONE) {
@@ -237,6 +264,7 @@ static inline void dma_write(WORD addr, BYTE data)
 	} else {
 		*(banks[selbnk] + addr) = data;
 	}
+	dirty_mark(addr);
 }
 
 /*
@@ -261,6 +289,7 @@ static inline void putmem(WORD addr, BYTE data)
 	} else {
 		*(banks[selbnk] + addr) = data;
 	}
+	dirty_mark(addr);
 }
 
 /*
@@ -274,6 +303,7 @@ static inline void fp_write(WORD addr, BYTE data)
 	} else {
 		*(banks[selbnk] + addr) = data;
 	}
+	dirty_mark(addr);
 }
 
 #endif /* !SIMMEM_INC */
@@ -37,6 +37,12 @@
 /*#define WANT_HB*/	/* no hardware breakpoint */
 #endif
 
+#define WANT_TRACE	/* execution trace recorder */
+#define WANT_COVER	/* code coverage recorder */
+#define WANT_REPLAY	/* record/replay of inputs and interrupts */
+/*#define WANT_REVERSE*/	/* no reverse execution in the ICE */
+#define WANT_LOGGER	/* runtime log levels, asynchronous log output */
+
 #define HAS_DISKS	/* uses disk images */
 #define HAS_CONFIG	/* has configuration files somewhere */
 
@@ -10,6 +10,7 @@
  * 03-JUN-2024 first version
  * 07-JUN-2024 rewrite of the monitor ports and the timing thread
  * 04-JAN-2025 add SDL2 support
+ * 16-OCT-2026 SDL2: front panel frame rate paced by simsdl
  */
 
 #include <stdio.h>
@@ -56,7 +57,8 @@ static win_funcs_t fp_win_funcs = {
 	fp_openWindow,
 	fp_quit,
 	fp_procEvent,
-	fp_draw
+	fp_draw,
+	0	/* set from fp_fps */
 };
 #endif
 #endif /* FRONTPANEL */
@@ -85,6 +87,7 @@ void mon(void)
 			exit(EXIT_FAILURE);
 		}
 #ifdef WANT_SDL
+		fp_win_funcs.fps = (int) fp_fps;
 		fp_win_id = simsdl_create(&fp_win_funcs);
 #endif
 
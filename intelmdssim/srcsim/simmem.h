@@ -10,6 +10,10 @@
  * History:
  * 03-JUN-2024 first version
  * 14-DEC-2024 added hardware breakpoint support
+ * 16-OCT-2026 hardware breakpoints use per address access bitmaps
+ * 16-OCT-2026 record memory writes into the execution trace
+ * 16-OCT-2026 record memory accesses for code coverage
+ * 16-OCT-2026 pass the memory bank to the execution trace
  */
 
 #ifndef SIMMEM_INC
@@ -20,6 +24,12 @@
 #ifdef WANT_ICE
 #include "simice.h"
 #endif
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_COVER
+#include "simcov.h"
+#endif
 #include "simctl.h"
 
 #ifdef BUS_8080
@@ -45,8 +55,16 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && (hb_map[addr] & HB_WRITE))
+		hb_hit(addr, HB_WRITE);
+#endif
+#ifdef WANT_TRACE
+	if (tr_flag)
+		trace_write(0, addr, data);
+#endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_write(0, addr);
 #endif
 
 	if (!mon_enabled || addr < 65536 - MON_SIZE)
@@ -58,16 +76,20 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
+	if (hb_flag && hb_map[addr]) {
 		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
+			if (hb_map[addr] & HB_EXEC)
+				hb_hit(addr, HB_EXEC);
 		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
+			if (hb_map[addr] & HB_READ)
+				hb_hit(addr, HB_READ);
 		}
 	}
 #endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_read(0, addr);
+#endif
 
 	if (boot_switch && addr < BOOT_SIZE)
 		data = boot_rom[addr];
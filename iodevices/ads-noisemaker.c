@@ -35,6 +35,11 @@
  *  the very common PortAudio platform, which is available for most systems,
  *  including Linux, MacOS and Windows.
  *
+ *  The wave file given with noisemaker_soundfile is rendered in emulated
+ *  time from the T-states of the PSG register writes and written while
+ *  the machine runs, it needs no audio device and doesn't depend on the
+ *  speed of the host.
+ *
  *  Noisemaker application with Dazzler:
  *  
  *  Use the 62 Hz vertical blank signal to sync the playback of tunes or
@@ -52,6 +57,8 @@
  *
  *  History:
  *  10-OCT-2024  Initial release
+ *  16-OCT-2026  Render the audio in blocks with a polyphase FIR
+ *  16-OCT-2026  Stream the wave file, rendered in emulated time
  */
 
 #include <stdlib.h>
@@ -104,7 +111,7 @@ static void ads_noisemaker_callback(BYTE *data) {
 #endif
 
 #define DEFAULT_SAMPLE_RATE	44100		/* default SDL audio sample rate in Hz */
-#define DEFAULT_RECORDING_LIMIT 10000000	/* size of wave buffer for file output & debug purposes */
+#define DEFAULT_RECORDING_LIMIT 10000000	/* max. frames written to the wave file */
 #define SAMPLE_BUFFER_SIZE	64		/* audio buffer size per channel, defines audio delay */
 
 /* parameters configurable in system.conf */
@@ -118,7 +125,11 @@ enum {
   TONE_CHANNELS = 3,
   DECIMATE_FACTOR = 8,
   FIR_SIZE = 192,
-  DC_FILTER_SIZE = 1024
+  FIR_PHASE_SIZE = FIR_SIZE / DECIMATE_FACTOR,
+  DC_FILTER_SIZE = 1024,
+  RENDER_FRAMES = 256,
+  PHASE_LENGTH = FIR_PHASE_SIZE - 1 + RENDER_FRAMES,
+  DECIMATE_BLOCK = 8
 };
 
 struct tone_channel {
@@ -155,8 +166,10 @@ struct ayumi {
   double step;
   double x;
   struct interpolator interpolator;
-  double fir[FIR_SIZE * 2];
-  int fir_index;
+  /* oversampled signal split into the DECIMATE_FACTOR phases of the
+     decimation, each phase starts with the FIR_PHASE_SIZE - 1 samples
+     of the last block still needed */
+  float phase[DECIMATE_FACTOR * PHASE_LENGTH];
   struct dc_filter dc;
   int dc_index;
   double sample;
@@ -170,8 +183,7 @@ void ayumi_set_mixer(struct ayumi* ay, int index, int t_off, int n_off, int e_on
 void ayumi_set_volume(struct ayumi* ay, int index, int volume);
 void ayumi_set_envelope(struct ayumi* ay, int period);
 void ayumi_set_envelope_shape(struct ayumi* ay, int shape);
-void ayumi_process(struct ayumi* ay);
-void ayumi_remove_dc(struct ayumi* ay);
+void ayumi_render(struct ayumi* ay, float* out, int frames);
 
 static const double AY_dac_table[] = {
   0.0, 0.0,
@@ -212,6 +224,7 @@ static const double YM_dac_table[] = {
 };
 
 static void reset_segment(struct ayumi* ay);
+static void fir_init(void);
 
 static int update_tone(struct ayumi* ay, int index) {
   struct tone_channel* ch = &ay->channels[index];
@@ -300,12 +313,13 @@ static void update_mixer(struct ayumi* ay) {
   int out;
   int noise = update_noise(ay);
   int envelope = update_envelope(ay);
-  ay->sample = 0;
+  double sample = 0;
   for (i = 0; i < TONE_CHANNELS; i += 1) {
     out = (update_tone(ay, i) | ay->channels[i].t_off) & (noise | ay->channels[i].n_off);
     out *= ay->channels[i].e_on ? envelope : ay->channels[i].volume * 2 + 1;
-    ay->sample += ay->dac_table[out];
+    sample += ay->dac_table[out];
   }
+  ay->sample = sample;
 }
 
 int ayumi_configure(struct ayumi* ay, int is_ym, double clock_rate, int sr) {
@@ -314,6 +328,7 @@ int ayumi_configure(struct ayumi* ay, int is_ym, double clock_rate, int sr) {
   ay->step = clock_rate / (sr * 8 * DECIMATE_FACTOR);
   ay->dac_table = is_ym ? YM_dac_table : AY_dac_table;
   ay->noise = 1;
+  fir_init();
   ayumi_set_envelope(ay, 1);
   for (i = 0; i < TONE_CHANNELS; i += 1) {
     ayumi_set_tone(ay, i, 1);
@@ -353,131 +368,176 @@ void ayumi_set_envelope_shape(struct ayumi* ay, int shape) {
   reset_segment(ay);
 }
 
-static double decimate(double* x) {
-  double y = -0.0000046183113992051936 * (x[1] + x[191]) +
-    -0.00001117761640887225 * (x[2] + x[190]) +
-    -0.000018610264502005432 * (x[3] + x[189]) +
-    -0.000025134586135631012 * (x[4] + x[188]) +
-    -0.000028494281690666197 * (x[5] + x[187]) +
-    -0.000026396828793275159 * (x[6] + x[186]) +
-    -0.000017094212558802156 * (x[7] + x[185]) +
-    0.000023798193576966866 * (x[9] + x[183]) +
-    0.000051281160242202183 * (x[10] + x[182]) +
-    0.00007762197826243427 * (x[11] + x[181]) +
-    0.000096759426664120416 * (x[12] + x[180]) +
-    0.00010240229300393402 * (x[13] + x[179]) +
-    0.000089344614218077106 * (x[14] + x[178]) +
-    0.000054875700118949183 * (x[15] + x[177]) +
-    -0.000069839082210680165 * (x[17] + x[175]) +
-    -0.0001447966132360757 * (x[18] + x[174]) +
-    -0.00021158452917708308 * (x[19] + x[173]) +
-    -0.00025535069106550544 * (x[20] + x[172]) +
-    -0.00026228714374322104 * (x[21] + x[171]) +
-    -0.00022258805927027799 * (x[22] + x[170]) +
-    -0.00013323230495695704 * (x[23] + x[169]) +
-    0.00016182578767055206 * (x[25] + x[167]) +
-    0.00032846175385096581 * (x[26] + x[166]) +
-    0.00047045611576184863 * (x[27] + x[165]) +
-    0.00055713851457530944 * (x[28] + x[164]) +
-    0.00056212565121518726 * (x[29] + x[163]) +
-    0.00046901918553962478 * (x[30] + x[162]) +
-    0.00027624866838952986 * (x[31] + x[161]) +
-    -0.00032564179486838622 * (x[33] + x[159]) +
-    -0.00065182310286710388 * (x[34] + x[158]) +
-    -0.00092127787309319298 * (x[35] + x[157]) +
-    -0.0010772534348943575 * (x[36] + x[156]) +
-    -0.0010737727700273478 * (x[37] + x[155]) +
-    -0.00088556645390392634 * (x[38] + x[154]) +
-    -0.00051581896090765534 * (x[39] + x[153]) +
-    0.00059548767193795277 * (x[41] + x[151]) +
-    0.0011803558710661009 * (x[42] + x[150]) +
-    0.0016527320270369871 * (x[43] + x[149]) +
-    0.0019152679330965555 * (x[44] + x[148]) +
-    0.0018927324805381538 * (x[45] + x[147]) +
-    0.0015481870327877937 * (x[46] + x[146]) +
-    0.00089470695834941306 * (x[47] + x[145]) +
-    -0.0010178225878206125 * (x[49] + x[143]) +
-    -0.0020037400552054292 * (x[50] + x[142]) +
-    -0.0027874356824117317 * (x[51] + x[141]) +
-    -0.003210329988021943 * (x[52] + x[140]) +
-    -0.0031540624117984395 * (x[53] + x[139]) +
-    -0.0025657163651900345 * (x[54] + x[138]) +
-    -0.0014750752642111449 * (x[55] + x[137]) +
-    0.0016624165446378462 * (x[57] + x[135]) +
-    0.0032591192839069179 * (x[58] + x[134]) +
-    0.0045165685815867747 * (x[59] + x[133]) +
-    0.0051838984346123896 * (x[60] + x[132]) +
-    0.0050774264697459933 * (x[61] + x[131]) +
-    0.0041192521414141585 * (x[62] + x[130]) +
-    0.0023628575417966491 * (x[63] + x[129]) +
-    -0.0026543507866759182 * (x[65] + x[127]) +
-    -0.0051990251084333425 * (x[66] + x[126]) +
-    -0.0072020238234656924 * (x[67] + x[125]) +
-    -0.0082672928192007358 * (x[68] + x[124]) +
-    -0.0081033739572956287 * (x[69] + x[123]) +
-    -0.006583111539570221 * (x[70] + x[122]) +
-    -0.0037839040415292386 * (x[71] + x[121]) +
-    0.0042781252851152507 * (x[73] + x[119]) +
-    0.0084176358598320178 * (x[74] + x[118]) +
-    0.01172566057463055 * (x[75] + x[117]) +
-    0.013550476647788672 * (x[76] + x[116]) +
-    0.013388189369997496 * (x[77] + x[115]) +
-    0.010979501242341259 * (x[78] + x[114]) +
-    0.006381274941685413 * (x[79] + x[113]) +
-    -0.007421229604153888 * (x[81] + x[111]) +
-    -0.01486456304340213 * (x[82] + x[110]) +
-    -0.021143584622178104 * (x[83] + x[109]) +
-    -0.02504275058758609 * (x[84] + x[108]) +
-    -0.025473530942547201 * (x[85] + x[107]) +
-    -0.021627310017882196 * (x[86] + x[106]) +
-    -0.013104323383225543 * (x[87] + x[105]) +
-    0.017065133989980476 * (x[89] + x[103]) +
-    0.036978919264451952 * (x[90] + x[102]) +
-    0.05823318062093958 * (x[91] + x[101]) +
-    0.079072012081405949 * (x[92] + x[100]) +
-    0.097675998716952317 * (x[93] + x[99]) +
-    0.11236045936950932 * (x[94] + x[98]) +
-    0.12176343577287731 * (x[95] + x[97]) +
-    0.125 * x[96];
-  memcpy(&x[FIR_SIZE - DECIMATE_FACTOR], x, DECIMATE_FACTOR * sizeof(double));
-  return y;
-}
-
-void ayumi_process(struct ayumi* ay) {
-  int i;
-  double y1;
-  double* c = ay->interpolator.c;
-  double* y = ay->interpolator.y;
-  double* fir = &ay->fir[FIR_SIZE - ay->fir_index * DECIMATE_FACTOR];
-  ay->fir_index = (ay->fir_index + 1) % (FIR_SIZE / DECIMATE_FACTOR - 1);
-  for (i = DECIMATE_FACTOR - 1; i >= 0; i -= 1) {
-    ay->x += ay->step;
-    if (ay->x >= 1) {
-      ay->x -= 1;
-      y[0] = y[1];
-      y[1] = y[2];
-      y[2] = y[3];
-      update_mixer(ay);
-      y[3] = ay->sample;
-      y1 = y[2] - y[0];
-      c[0] = 0.5 * y[1] + 0.25 * (y[0] + y[2]);
-      c[1] = 0.5 * y1;
-      c[2] = 0.25 * (y[3] - y[1] - y1);
+/* coefficients h[0] ... h[FIR_SIZE / 2] of the symmetric decimation
+   FIR, h[FIR_SIZE - i] = h[i] */
+static const double fir_half[FIR_SIZE / 2 + 1] = {
+  0.0, -0.0000046183113992051936,
+  -0.00001117761640887225, -0.000018610264502005432,
+  -0.000025134586135631012, -0.000028494281690666197,
+  -0.000026396828793275159, -0.000017094212558802156,
+  0.0, 0.000023798193576966866,
+  0.000051281160242202183, 0.00007762197826243427,
+  0.000096759426664120416, 0.00010240229300393402,
+  0.000089344614218077106, 0.000054875700118949183,
+  0.0, -0.000069839082210680165,
+  -0.0001447966132360757, -0.00021158452917708308,
+  -0.00025535069106550544, -0.00026228714374322104,
+  -0.00022258805927027799, -0.00013323230495695704,
+  0.0, 0.00016182578767055206,
+  0.00032846175385096581, 0.00047045611576184863,
+  0.00055713851457530944, 0.00056212565121518726,
+  0.00046901918553962478, 0.00027624866838952986,
+  0.0, -0.00032564179486838622,
+  -0.00065182310286710388, -0.00092127787309319298,
+  -0.0010772534348943575, -0.0010737727700273478,
+  -0.00088556645390392634, -0.00051581896090765534,
+  0.0, 0.00059548767193795277,
+  0.0011803558710661009, 0.0016527320270369871,
+  0.0019152679330965555, 0.0018927324805381538,
+  0.0015481870327877937, 0.00089470695834941306,
+  0.0, -0.0010178225878206125,
+  -0.0020037400552054292, -0.0027874356824117317,
+  -0.003210329988021943, -0.0031540624117984395,
+  -0.0025657163651900345, -0.0014750752642111449,
+  0.0, 0.0016624165446378462,
+  0.0032591192839069179, 0.0045165685815867747,
+  0.0051838984346123896, 0.0050774264697459933,
+  0.0041192521414141585, 0.0023628575417966491,
+  0.0, -0.0026543507866759182,
+  -0.0051990251084333425, -0.0072020238234656924,
+  -0.0082672928192007358, -0.0081033739572956287,
+  -0.006583111539570221, -0.0037839040415292386,
+  0.0, 0.0042781252851152507,
+  0.0084176358598320178, 0.01172566057463055,
+  0.013550476647788672, 0.013388189369997496,
+  0.010979501242341259, 0.006381274941685413,
+  0.0, -0.007421229604153888,
+  -0.01486456304340213, -0.021143584622178104,
+  -0.02504275058758609, -0.025473530942547201,
+  -0.021627310017882196, -0.013104323383225543,
+  0.0, 0.017065133989980476,
+  0.036978919264451952, 0.05823318062093958,
+  0.079072012081405949, 0.097675998716952317,
+  0.11236045936950932, 0.12176343577287731,
+  0.125
+};
+
+/* the FIR in polyphase form, sample r * PHASE_LENGTH + q of the phases
+   is sample DECIMATE_FACTOR * q + r of the window of the first output
+   sample, the symmetric taps with the same weight are paired */
+struct fir_tap {
+  float h;
+  int x1;
+  int x2;
+};
+
+static struct fir_tap fir_taps[FIR_SIZE / 2];
+static int fir_ntaps;
+
+static void fir_init(void) {
+  int i, k1, k2;
+  struct fir_tap* tap;
+  if (fir_ntaps) {
+    return;
+  }
+  for (i = 1; i <= FIR_SIZE / 2; i += 1) {
+    if (fir_half[i] == 0) {
+      continue;
     }
-    fir[i] = (c[2] * ay->x + c[1]) * ay->x + c[0];
+    k1 = FIR_SIZE - 1 - i;
+    k2 = i - 1;
+    tap = &fir_taps[fir_ntaps++];
+    /* the center tap is its own pair */
+    tap->h = (float) (k1 == k2 ? fir_half[i] / 2 : fir_half[i]);
+    tap->x1 = (k1 % DECIMATE_FACTOR) * PHASE_LENGTH + k1 / DECIMATE_FACTOR;
+    tap->x2 = (k2 % DECIMATE_FACTOR) * PHASE_LENGTH + k2 / DECIMATE_FACTOR;
   }
-  ay->sample = decimate(fir);
 }
 
-static double dc_filter(struct dc_filter* dc, int index, double x) {
-  dc->sum += -dc->delay[index] + x;
-  dc->delay[index] = x; 
-  return x - dc->sum / DC_FILTER_SIZE;
+/* run the PSG and the interpolator for DECIMATE_FACTOR samples of
+   each output sample, the samples are sorted into the phases, the
+   state of the interpolator is kept in local variables meanwhile */
+static void oversample(struct ayumi* ay, int frames) {
+  int n, r;
+  double x = ay->x;
+  double y0 = ay->interpolator.y[0], y1 = ay->interpolator.y[1];
+  double y2 = ay->interpolator.y[2], y3 = ay->interpolator.y[3];
+  double c0 = ay->interpolator.c[0], c1 = ay->interpolator.c[1];
+  double c2 = ay->interpolator.c[2];
+  float* phase;
+  for (n = FIR_PHASE_SIZE - 1; n < FIR_PHASE_SIZE - 1 + frames; n += 1) {
+    phase = &ay->phase[n];
+    for (r = 0; r < DECIMATE_FACTOR; r += 1) {
+      x += ay->step;
+      if (x >= 1) {
+        x -= 1;
+        y0 = y1;
+        y1 = y2;
+        y2 = y3;
+        update_mixer(ay);
+        y3 = ay->sample;
+        c0 = 0.5 * y1 + 0.25 * (y0 + y2);
+        c1 = 0.5 * (y2 - y0);
+        c2 = 0.25 * (y3 - y1 - (y2 - y0));
+      }
+      phase[r * PHASE_LENGTH] = (float) ((c2 * x + c1) * x + c0);
+    }
+  }
+  ay->x = x;
+  ay->interpolator.y[0] = y0;
+  ay->interpolator.y[1] = y1;
+  ay->interpolator.y[2] = y2;
+  ay->interpolator.y[3] = y3;
+  ay->interpolator.c[0] = c0;
+  ay->interpolator.c[1] = c1;
+  ay->interpolator.c[2] = c2;
 }
 
-void ayumi_remove_dc(struct ayumi* ay) {
-  ay->sample = dc_filter(&ay->dc, ay->dc_index, ay->sample);
-  ay->dc_index = (ay->dc_index + 1) & (DC_FILTER_SIZE - 1);
+/* decimate the oversampled signal, DECIMATE_BLOCK output samples are
+   computed together, so that the compiler keeps them in SIMD registers */
+static void decimate(struct ayumi* ay, float* out, int frames) {
+  int n, k, r;
+  float acc[DECIMATE_BLOCK];
+  const float* x;
+  const struct fir_tap* tap;
+  for (n = 0; n < frames; n += DECIMATE_BLOCK) {
+    x = &ay->phase[n];
+    for (k = 0; k < DECIMATE_BLOCK; k += 1) {
+      acc[k] = 0;
+    }
+    for (tap = fir_taps; tap < fir_taps + fir_ntaps; tap += 1) {
+      for (k = 0; k < DECIMATE_BLOCK; k += 1) {
+        acc[k] += tap->h * (x[tap->x1 + k] + x[tap->x2 + k]);
+      }
+    }
+    for (k = 0; k < DECIMATE_BLOCK && n + k < frames; k += 1) {
+      out[n + k] = acc[k];
+    }
+  }
+  for (r = 0; r < DECIMATE_FACTOR; r += 1) {
+    memmove(&ay->phase[r * PHASE_LENGTH], &ay->phase[r * PHASE_LENGTH + frames],
+      (FIR_PHASE_SIZE - 1) * sizeof(float));
+  }
+}
+
+static void remove_dc(struct ayumi* ay, float* out, int frames) {
+  int n;
+  double x;
+  struct dc_filter* dc = &ay->dc;
+  for (n = 0; n < frames; n += 1) {
+    x = out[n];
+    dc->sum += -dc->delay[ay->dc_index] + x;
+    dc->delay[ay->dc_index] = x;
+    out[n] = (float) (x - dc->sum / DC_FILTER_SIZE);
+    ay->dc_index = (ay->dc_index + 1) & (DC_FILTER_SIZE - 1);
+  }
+}
+
+/* render max. RENDER_FRAMES output samples */
+void ayumi_render(struct ayumi* ay, float* out, int frames) {
+  oversample(ay, frames);
+  decimate(ay, out, frames);
+  remove_dc(ay, out, frames);
 }
 
 /*
@@ -556,23 +616,57 @@ void psg_out(struct ayumi* ay, int register_select, BYTE data)
 
 /* ---------------End AY-3-8910 -------------- */
 
-typedef struct {
-    int16_t channel_1;
-    int16_t channel_2;
-} SampleData;
-
 struct ads_noisemaker {
     struct ayumi psg1;			/* PSG 1 (left channel) */
     struct ayumi psg2;			/* PSG 2 (right channel) */
-    SampleData *buffer;			/* recorded data for WAV output */
-    int index;                          /* index into recorded data */
-    long size;				/* buffer size in samples  */
+};
+
+/*
+    The capture has its own pair of PSGs, which get the same register
+    writes as the real time PSGs, and is rendered in the emulated time:
+    before a register write is applied, the frames up to the T-state
+    counter of the CPU are rendered and appended to the wave file. So
+    the recording doesn't depend on the host, it works without audio
+    device and is the same for every run of the same program.
+*/
+struct capture {
+    struct ads_noisemaker board;	/* PSGs rendered in emulated time */
+    FILE *fp;				/* wave file */
+    Tstates_t start;			/* T-states at the start */
+    uint64_t clock;			/* CPU clock in Hz */
+    uint64_t frames;			/* frames written */
+    uint64_t limit;			/* max. frames, 0 = no limit */
 };
 
 static struct ads_noisemaker sound_board;
+static struct capture capture;
 static int psg_register_select_1 = 0;
 static int psg_register_select_2 = 0;
 
+/* convert a sample into 16 bit PCM, clipping it at full scale */
+static inline int16_t pcm16(float sample)
+{
+    if (sample >= 1.0f)
+	return 32767;
+    if (sample <= -1.0f)
+	return -32767;
+    return (int16_t) (sample * 32767);
+}
+
+#if defined(WANT_SDL) || defined(WANT_PORTAUDIO)
+
+/*
+    render max. RENDER_FRAMES frames of both PSGs into left and right
+*/
+static void render(struct ads_noisemaker *board, float *left, float *right,
+		   int frames)
+{
+    ayumi_render(&board->psg1, left, frames);
+    ayumi_render(&board->psg2, right, frames);
+}
+
+#endif
+
 #ifdef WANT_SDL
 
 static SDL_AudioDeviceID device_id;
@@ -581,32 +675,21 @@ void sdl_audio_callback(void *userdata, uint8_t *stream, int len)
 {
     /* cast data passed through stream to our structure. */
     struct ads_noisemaker *board = (struct ads_noisemaker *)userdata;
-    struct ayumi *ay1 = &(board->psg1);
-    struct ayumi *ay2 = &(board->psg2);
     int16_t *out = (int16_t *) stream;
-    int i;
+    float left[RENDER_FRAMES], right[RENDER_FRAMES];
+    int i, n, frames = len / 4;
 
-    if (len == 0) return;
-
-    i = 0;
-    while(i<len) {
-        /* process PSG data */
-        ayumi_process(ay1);
-        ayumi_process(ay2);
-        ayumi_remove_dc(ay1);
-        ayumi_remove_dc(ay2);
+    while (frames > 0) {
+	/* process PSG data */
+	n = (frames > RENDER_FRAMES) ? RENDER_FRAMES : frames;
+	render(board, left, right, n);
 
 	/* stream audio data */
-        *out++ = (int16_t)(ay1->sample * 32767);           /* channel 1 */
-        *out++ = (int16_t)(ay2->sample * 32767);           /* channel 2 */
-        i += 4;
-  
-  	/* save into wave buffer */
-        if (board->index < board->size) {
-            board->buffer[board->index].channel_1 = (int16_t)(ay1->sample * 32767);
-            board->buffer[board->index].channel_2 = (int16_t)(ay2->sample * 32767);
-            board->index++;
-        }
+	for (i = 0; i < n; i++) {
+	    *out++ = pcm16(left[i]);           /* channel 1 */
+	    *out++ = pcm16(right[i]);          /* channel 2 */
+	}
+	frames -= n;
     }
 }
 
@@ -660,10 +743,9 @@ static int paCallback( const void *inputBuffer, void *outputBuffer,
 {
     /* cast data passed through stream to our structure. */
     struct ads_noisemaker *board = (struct ads_noisemaker *)userData;
-    struct ayumi *ay1 = &(board->psg1);
-    struct ayumi *ay2 = &(board->psg2);
     float *out = (float*)outputBuffer;
-    unsigned int i;
+    float left[RENDER_FRAMES], right[RENDER_FRAMES];
+    unsigned int i, n;
 
     /* prevent unused variable warning. */
     (void) inputBuffer;
@@ -671,21 +753,17 @@ static int paCallback( const void *inputBuffer, void *outputBuffer,
     (void) statusFlags;
     
     /* process buffer */
-    for( i=0; i<framesPerBuffer; i++ )
+    while (framesPerBuffer > 0)
     {
-        ayumi_process(ay1);
-        ayumi_process(ay2);
-        ayumi_remove_dc(ay1);
-        ayumi_remove_dc(ay2);
-
-        *out++ = (float) ay1->sample;           /* channel 1 */
-        *out++ = (float) ay2->sample;           /* channel 2 */
-  
-        if (board->index < board->size) {
-            board->buffer[board->index].channel_1 = (int16_t)(ay1->sample * 32767);
-            board->buffer[board->index].channel_2 = (int16_t)(ay2->sample * 32767);
-            board->index++;
+        n = (framesPerBuffer > RENDER_FRAMES) ? RENDER_FRAMES : framesPerBuffer;
+        render(board, left, right, n);
+
+        for( i=0; i<n; i++ )
+        {
+            *out++ = left[i];           /* channel 1 */
+            *out++ = right[i];          /* channel 2 */
         }
+        framesPerBuffer -= n;
     }
 
     return 0;
@@ -720,9 +798,7 @@ static int portaudio_init(void) {
     	fprintf(stderr, "\nPortAudio: Could not start stream\n");
     	goto error;
     }
-        
-    sound_board.index = 0;
-        
+
     return 0;
 
 error:
@@ -755,26 +831,181 @@ static void portaudio_shutdown(void)
 
 /* -------------- End PortAudio ---------------- */
 
+/* ---------- wave file capture in emulated time ---------- */
+
+#define WAVE_MAX_FRAMES ((0xffffffffUL - 36) / 4)	/* 4 GB RIFF limit */
+
+#pragma pack(1)
+
+struct wave_header {
+    char chunk_id[4];
+    uint32_t chunk_size;
+    char format[4];
+    char subchunk1_id[4];
+    uint32_t subchunk1_size;
+    uint16_t audio_format;
+    uint16_t num_channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+    char subchunk2_id[4];
+    uint32_t subchunk2_size;
+};
+
+#pragma pack()
+
+/*
+    write the header of a 16 bit stereo wave file with data_size bytes
+    of sample data at the start of the file
+*/
+static int wave_header(FILE *fp, uint32_t data_size)
+{
+    struct wave_header header;
+
+    memcpy(header.chunk_id, "RIFF", 4);
+    header.chunk_size = data_size + 36;
+    memcpy(header.format, "WAVE", 4);
+    memcpy(header.subchunk1_id, "fmt ", 4);
+    header.subchunk1_size = 16;
+    header.audio_format = 1;
+    header.num_channels = 2;
+    header.sample_rate = noisemaker_sample_rate;
+    header.byte_rate = noisemaker_sample_rate * 4;
+    header.block_align = 4;
+    header.bits_per_sample = 16;
+    memcpy(header.subchunk2_id, "data", 4);
+    header.subchunk2_size = data_size;
+
+    if (fseek(fp, 0L, SEEK_SET) != 0 ||
+	fwrite(&header, sizeof(header), 1, fp) != 1)
+	return -1;
+    return 0;
+}
+
+/*
+    render the capture PSGs up to the current T-state counter of the
+    CPU and append the frames to the wave file, called before every
+    PSG register write and at the end
+*/
+static void capture_sync(void)
+{
+    struct capture *c = &capture;
+    float left[RENDER_FRAMES], right[RENDER_FRAMES];
+    int16_t pcm[2 * RENDER_FRAMES];
+    uint64_t due;
+    int i, n;
+
+    /* T goes back with reverse execution, what is written stays */
+    if (T <= c->start)
+	return;
+    due = (T - c->start) * (uint64_t) noisemaker_sample_rate / c->clock;
+    if (due > c->limit)
+	due = c->limit;
+
+    while (c->frames < due) {
+	n = (due - c->frames > RENDER_FRAMES) ?
+		RENDER_FRAMES : (int) (due - c->frames);
+	ayumi_render(&c->board.psg1, left, n);
+	ayumi_render(&c->board.psg2, right, n);
+	for (i = 0; i < n; i++) {
+	    pcm[2 * i] = pcm16(left[i]);
+	    pcm[2 * i + 1] = pcm16(right[i]);
+	}
+	if (fwrite(pcm, 4, n, c->fp) != (size_t) n) {
+	    LOGE(TAG, "can't write sound file %s", noisemaker_soundfile);
+	    fclose(c->fp);
+	    c->fp = NULL;
+	    return;
+	}
+	c->frames += n;
+    }
+}
+
+/* prepare both AY-3-8910 PSGs of a board */
+static void board_init(struct ads_noisemaker *board)
+{
+    struct ayumi* ay1 = &(board->psg1);
+    struct ayumi* ay2 = &(board->psg2);
+
+    ayumi_configure(ay1, 0, 2000000, noisemaker_sample_rate);
+    ayumi_configure(ay2, 0, 2000000, noisemaker_sample_rate);
+    ayumi_set_mixer(ay1, 0, 0, 1, 0);
+    ayumi_set_volume(ay1, 0, 0xf);
+    ayumi_set_mixer(ay2, 0, 0, 1, 0);
+    ayumi_set_volume(ay2, 0, 0xf);
+}
+
+static void capture_init(void)
+{
+    struct capture *c = &capture;
+    int mhz;
+
+    if ((c->fp = fopen(noisemaker_soundfile, "wb")) == NULL) {
+	LOGE(TAG, "can't create sound file %s", noisemaker_soundfile);
+	return;
+    }
+    if (wave_header(c->fp, 0) < 0) {
+	LOGE(TAG, "can't write sound file %s", noisemaker_soundfile);
+	fclose(c->fp);
+	c->fp = NULL;
+	return;
+    }
+
+    /* without a speed limit the time base is the default CPU speed */
+    mhz = (f_value > 0) ? f_value : CPU_SPEED;
+    if (mhz <= 0)
+	mhz = 2;
+    c->clock = mhz * 1000000ULL;
+    c->start = T;
+    c->frames = 0;
+    c->limit = WAVE_MAX_FRAMES;
+    if (noisemaker_recording_limit > 0 &&
+	(uint64_t) noisemaker_recording_limit < c->limit)
+	c->limit = noisemaker_recording_limit;
+
+    board_init(&c->board);
+}
+
+static void capture_off(void)
+{
+    struct capture *c = &capture;
+
+    if (c->fp == NULL)
+	return;
+
+    capture_sync();
+    if (c->fp == NULL)
+	return;
+    if (wave_header(c->fp, c->frames * 4) < 0)
+	LOGE(TAG, "can't write sound file %s", noisemaker_soundfile);
+    fclose(c->fp);
+    c->fp = NULL;
+}
+
 void ads_noisemaker_init(void) {
 
     inPort[0] = 0xFF;
 
-    struct ayumi* ay1 = &(sound_board.psg1);
-    struct ayumi* ay2 = &(sound_board.psg2);
-
 #ifdef HAS_NETSERVER
     if (n_flag) {
         net_device_service(DEV_NMKR, ads_noisemaker_callback);
     }
 #endif
 
+    /* prepare both AY-3-8910 PSGs */
+    board_init(&sound_board);
+
+    if (noisemaker_soundfile)
+	capture_init();
+
+    /* without audio device only the capture is rendered */
 #ifdef WANT_SDL
     if ((device_id = sdl_audio_init())) {
     	    LOG(TAG, "ADS Noisemaker: SDL audio initialized & ready to use\r\n");
     }
     else {
     	    LOG(TAG, "ADS Noisemaker: Could not initialize SDL audio\r\n");
-    	    return;
     }
 #endif
 
@@ -785,108 +1016,23 @@ void ads_noisemaker_init(void) {
     }
     else {
     	    LOG(TAG, "ADS Noisemaker: Could not initialize PortAudio\r\n");
-    	    return;
     };
 #endif
-    
-    sound_board.size = 0;
-    if (noisemaker_recording_limit > 0) {
-	if ((sound_board.buffer = malloc(noisemaker_recording_limit * sizeof(SampleData))) == NULL) {
-		LOG(TAG, "ADS Noisemaker: Could not allocate enough memory for recording, reduce recording limit\n");
-	};
-	sound_board.size = noisemaker_recording_limit;
-    };
-    sound_board.index = 0;
-
-    /* prepare both AY-3-8910 PSGs */
-    ayumi_configure(ay1, 0, 2000000, noisemaker_sample_rate);
-    ayumi_configure(ay2, 0, 2000000, noisemaker_sample_rate);
-    ayumi_set_mixer(ay1, 0, 0, 1, 0);
-    ayumi_set_volume(ay1, 0, 0xf);
-    ayumi_set_mixer(ay2, 0, 0, 1, 0);
-    ayumi_set_volume(ay2, 0, 0xf);
 }
 
 void ads_noisemaker_off(void)
 {
-    /* ---------- export as wave file ---------- */
-
-    int16_t buf[2048];
-    int i, buf_index, data_size;
-
-#pragma pack(1)
-    
-	struct {
-		char chunk_id[4];
-		uint32_t chunk_size;
-		char format[4];
-		char subchunk1_id[4];
-		uint32_t subchunk1_size;
-		uint16_t audio_format;
-		uint16_t num_channels;
-		uint32_t sample_rate;
-		uint32_t byte_rate;
-		uint16_t block_align;
-		uint16_t bits_per_sample;
-		char subchunk2_id[4];
-		uint32_t subchunk2_size;
-	} header;
-
-#pragma pack()
-    
-    if (noisemaker_soundfile && sound_board.buffer) {
-
-	/* open wave file */
-	FILE *fp = fopen(noisemaker_soundfile, "wb");
-	if (!fp) {
-	    printf("Couldn't open file %s\n", noisemaker_soundfile);
-	    return;
-	}
-	else {
-		data_size = sound_board.index * 4;
-		
-		/* setup wave header */
-		memcpy(header.chunk_id, "RIFF", 4);
-		header.chunk_size = data_size + 40;
-		memcpy(header.format, "WAVE", 4);
-		memcpy(header.subchunk1_id, "fmt ", 4);
-		header.subchunk1_size = 16;
-		header.audio_format = 1;
-		header.num_channels = 2;
-		header.sample_rate = noisemaker_sample_rate;
-		header.byte_rate = noisemaker_sample_rate * 4;
-		header.block_align = 4;
-		header.bits_per_sample = 16;
-		memcpy(header.subchunk2_id, "data", 4);
-		header.subchunk2_size = data_size;
-		
-		/* write wave header */
-		fwrite(&header, sizeof(header), 1, fp);
-		
-		/* write sample data */
-		buf_index = 0;
-		for (i=0; i<sound_board.index; i++) {
-			buf[buf_index++] = sound_board.buffer[i].channel_1;
-			buf[buf_index++] = sound_board.buffer[i].channel_2;
-			if (buf_index == 1024) {
-		        	buf_index = 0;
-		        	fwrite(buf, 1024, 2, fp);
-			}
-		}
-		if (buf_index > 0) fwrite(buf, buf_index, 2, fp);
-	
-	    	fclose(fp);
-	}
-    }
+    /* ---------- finish the wave file ---------- */
 
-    free(sound_board.buffer);
+    capture_off();
 
 #ifdef WANT_PORTAUDIO
     portaudio_shutdown();
 #endif
 
 #ifdef WANT_SDL
-    sdl_audio_off(device_id);
+    if (device_id)
+	sdl_audio_off(device_id);
 #endif
 }
 
@@ -915,12 +1061,20 @@ static void ads_noisemaker_out(BYTE port, BYTE data)
             break;
     case 1:     /* output data first PSG */
             psg_out(ay1, psg_register_select_1, data);
+            if (capture.fp) {
+                capture_sync();
+                psg_out(&capture.board.psg1, psg_register_select_1, data);
+            }
             break;
     case 2:     /* select PSG register of second PSG */
             psg_register_select_2 = data & 0xf;
             break;
     case 3:     /* output data second PSG */
             psg_out(ay2, psg_register_select_2, data);
+            if (capture.fp) {
+                capture_sync();
+                psg_out(&capture.board.psg2, psg_register_select_2, data);
+            }
             break;
     default:    /* ignore all other ports */
             ;
@@ -4,12 +4,17 @@
  * or even algorithm accurate. It should be a somewhat reasonable
  * stand-in, which should allow us to run base-line comparisons with
  * the real device.
+ *
+ * The number of clock cycles a command takes on the chip is
+ * available with am_cycles(), so that the host can keep the chip
+ * busy for that time.
  */
 
 
 #include <stdio.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "am9511.h"
 #include "floatcnv.h"
@@ -33,6 +38,12 @@
  * Points to next location to use.
  *
  * AM9511 status and operator latch
+ *
+ * The float result of the last float command is kept in native form
+ * in the cache, so that the next command which uses it doesn't have
+ * to convert it back. While dirty, the four bytes of the result are
+ * not written to the stack yet. This is done when the CPU reads the
+ * stack, or a command works on the bytes.
  */
 
 struct am_context {
@@ -41,6 +52,11 @@ struct am_context {
     void *fptmp;
     unsigned char status;
     unsigned char op_latch;
+    unsigned int cycles;	/* clock cycles of the last command */
+    float cache;		/* native value of the cached float */
+    unsigned char cache_am[4];	/* cached float in AM9511 format */
+    int cache_pos;		/* stack position of cached float, -1 none */
+    int cache_dirty;		/* cached float not written to stack */
 #ifndef NDEBUG
     unsigned char last_latch;
 #endif
@@ -70,10 +86,160 @@ struct am_context {
 #define dec_sp(n) ctx->sp = sp_add(-(n))
 
 
+#ifdef z80
+
+/* Convert AM9511 float to native float
+ */
+static float am_na(struct am_context *ctx, const unsigned char *v) {
+    float x;
+
+    am_fp((void *)v, ctx->fptmp);
+    fp_na(ctx->fptmp, &x);
+    return x;
+}
+
+
+/* Convert native float to AM9511 float
+ */
+static void na_am(struct am_context *ctx, float x, unsigned char *v) {
+    na_fp(&x, ctx->fptmp);
+    fp_am(ctx->fptmp, v);
+}
+
+#else
+
+/* On the host the conversion between AM9511 and IEEE float only
+ * has to map the byte with sign and exponent, the 23 bits of the
+ * mantissa are the same. It gives the same results as going through
+ * the fp format with am_fp()/fp_ie() and ie_fp()/fp_am().
+ *
+ * am_ie[] has sign and exponent of the IEEE float for the exponent
+ * byte of the AM9511 float. ie_am[] has the exponent byte of the
+ * AM9511 float for the upper 9 bits of the IEEE float, -1 if it is
+ * zero, not normalized, not a number or out of range, which all is
+ * converted to zero.
+ */
+static uint32 am_ie[256];
+static int16 ie_am[512];
+
+
+/* Build the conversion tables
+ */
+static void am_tables(void) {
+    int i, e;
+
+    if (ie_am[0] != 0)
+	return;
+    for (i = 0; i < 256; ++i) {
+	e = i & 0x3f;
+	if (i & 0x40)
+	    e -= 64;
+	am_ie[i] = ((uint32)(i & 0x80) << 24) | ((uint32)(e + 126) << 23);
+    }
+    for (i = 0; i < 512; ++i) {
+	e = (i & 0xff) - 127;
+	if (e < -64 || e > 63 || (i & 0xff) == 0)
+	    ie_am[i] = -1;
+	else
+	    ie_am[i] = ((e + 1) & 0x7f) | ((i & 0x100) >> 1);
+    }
+}
+
+
+/* Convert AM9511 float to native float
+ */
+static float am_na(struct am_context *ctx, const unsigned char *v) {
+    uint32 n;
+    float x;
+
+    UNUSED(ctx);
+    if ((v[2] & 0x80) == 0)
+	return 0.0;
+    n = am_ie[v[3]] | ((uint32)(v[2] & 0x7f) << 16) |
+	((uint32)v[1] << 8) | v[0];
+    memcpy(&x, &n, sizeof(x));
+    return x;
+}
+
+
+/* Convert native float to AM9511 float
+ */
+static void na_am(struct am_context *ctx, float x, unsigned char *v) {
+    uint32 n;
+    int e;
+
+    UNUSED(ctx);
+    memcpy(&n, &x, sizeof(n));
+    e = ie_am[n >> 23];
+    if (e < 0) {
+	v[0] = v[1] = v[2] = v[3] = 0;
+	return;
+    }
+    v[0] = n;
+    v[1] = n >> 8;
+    v[2] = (n >> 16) | 0x80;
+    v[3] = e;
+}
+
+#endif
+
+
+/* Write the cached float to the stack, if it isn't yet
+ */
+static void am_flush(struct am_context *ctx) {
+    int i;
+
+    if (ctx->cache_dirty) {
+	for (i = 0; i < 4; ++i)
+	    ctx->stack[(ctx->cache_pos + i) & 0xf] = ctx->cache_am[i];
+	ctx->cache_dirty = 0;
+    }
+}
+
+
+/* Write and drop the cached float, before a command works on
+ * the bytes of the stack
+ */
+static void am_forget(struct am_context *ctx) {
+    am_flush(ctx);
+    ctx->cache_pos = -1;
+}
+
+
+/* Get the float at stack position pos
+ */
+static float am_get(struct am_context *ctx, int pos) {
+    unsigned char v[4];
+    int i;
+
+    if (pos == ctx->cache_pos)
+	return ctx->cache;
+    for (i = 0; i < 4; ++i)
+	v[i] = ctx->stack[(pos + i) & 0xf];
+    return am_na(ctx, v);
+}
+
+
+/* Put float x to stack position pos. It is kept in the cache, and
+ * written to the stack when needed. The value cached is the one the
+ * stack bytes stand for, zero if x is out of range.
+ */
+static void am_put(struct am_context *ctx, int pos, float x) {
+    if (pos != ctx->cache_pos)
+	am_flush(ctx);
+    na_am(ctx, x, ctx->cache_am);
+    ctx->cache = (ctx->cache_am[2] & 0x80) ? x : 0.0;
+    ctx->cache_pos = pos;
+    ctx->cache_dirty = 1;
+}
+
+
 /* Push byte to am9511 stack
  */
 void am_push(void *amp, unsigned char v) {
     struct am_context *ctx = (struct am_context *)amp;
+    if (ctx->cache_pos >= 0 && ((ctx->sp - ctx->cache_pos) & 0xf) < 4)
+	am_forget(ctx);
     *stpos(0) = v;
     inc_sp(1);
 }
@@ -83,6 +249,7 @@ void am_push(void *amp, unsigned char v) {
  */
 unsigned char am_pop(void *amp) {
     struct am_context *ctx = (struct am_context *)amp;
+    am_flush(ctx);
     dec_sp(1);
     return *stpos(0);
 }
@@ -108,6 +275,15 @@ unsigned char am_status(void *amp) {
  * negative.
  */
 static void sz(struct am_context *ctx) {
+    if (!IS_FIXED && ctx->cache_dirty && ctx->cache_pos == sp_add(-4)) {
+	/* float result still in the cache */
+	if ((ctx->cache_am[2] & 0x80) == 0)
+	    ctx->status |= AM_ZERO;
+	if (ctx->cache_am[3] & 0x80)
+	    ctx->status |= AM_SIGN;
+	return;
+    }
+    am_flush(ctx);
     if (IS_SINGLE) {
 	if ((*stpos(-1) | *stpos(-2)) == 0)
 	    ctx->status |= AM_ZERO;
@@ -201,8 +377,14 @@ static void chsf(struct am_context *ctx) {
      * (if not zero). And, as with the AM9511 chip, CHSF
      * is even faster than CHSS.
      */
-    if (*stpos(-2) & 0x80)
-        *stpos(-1) ^= 0x80;
+    if (ctx->cache_pos == sp_add(-4)) {
+	if (ctx->cache != 0.0)
+	    am_put(ctx, ctx->cache_pos, -ctx->cache);
+    } else {
+	am_forget(ctx);
+	if (*stpos(-2) & 0x80)
+	    *stpos(-1) ^= 0x80;
+    }
     sz(ctx);
 }
 
@@ -224,14 +406,8 @@ static void chs(struct am_context *ctx) {
 /* Push float to stack, set SIGN and ZERO
  */
 static void push_float(struct am_context *ctx, float x) {
-    unsigned char v[4];
-
-    na_fp(&x, ctx->fptmp);
-    fp_am(ctx->fptmp, v);
-    am_push(ctx, v[0]);
-    am_push(ctx, v[1]);
-    am_push(ctx, v[2]);
-    am_push(ctx, v[3]);
+    am_put(ctx, ctx->sp, x);
+    inc_sp(4);
     ctx->op_latch = AM_FLOAT;
     sz(ctx);
 }
@@ -283,12 +459,9 @@ static void fltd(struct am_context *ctx) {
  */
 static void fixs(struct am_context *ctx) {
     float x;
-    unsigned char *s;
     int n;
 
-    s = stpos(-4);
-    am_fp(s, ctx->fptmp);
-    fp_na(ctx->fptmp, &x);
+    x = am_get(ctx, sp_add(-4));
     if ((x < -32768.0) || (x > 32767.0)) {
 	ctx->status |= AM_ERR_OVF;
 	sz(ctx);
@@ -308,13 +481,10 @@ static void fixs(struct am_context *ctx) {
  */
 static void fixd(struct am_context *ctx) {
     float x;
-    unsigned char *s;
     int32 n;
     float xl, xh;
 
-    s = stpos(-4);
-    am_fp(s, ctx->fptmp);
-    fp_na(ctx->fptmp, &x);
+    x = am_get(ctx, sp_add(-4));
     n = -2147483648;
     xl = (float)n;
     n = 2147483647;
@@ -440,6 +610,10 @@ static void divi(struct am_context *ctx) {
 static int fov(struct am_context *ctx, double r) {
     int e;
 
+    /* 2^-65 <= |r| < 2^63 is in range, without frexp() */
+    if (fabs(r) >= 2.710505431213761085018632002174854278564453125e-20 &&
+	fabs(r) < 9223372036854775808.0)
+	return 0;
     frexp(r, &e);
     if (e > 63) {
 	ctx->status |= AM_ERR_OVF;
@@ -452,6 +626,25 @@ static int fov(struct am_context *ctx, double r) {
 }
 
 
+/* Biased exponent of a float, without calling frexp()
+ */
+static int fexp(float r) {
+#ifdef z80
+    int e;
+
+    if (r == 0.0)
+	return 0;
+    frexp(r, &e);
+    return e + 126;
+#else
+    uint32 n;
+
+    memcpy(&n, &r, sizeof(n));
+    return (n >> 23) & 0xff;
+#endif
+}
+
+
 /* basicf - basic FADD/FSUB/FMUL/FDIV
  *
  * The guide says that overflow and underflow are detected on the
@@ -460,18 +653,12 @@ static int fov(struct am_context *ctx, double r) {
  * should be implemented via bit operations, not arithmetic.
  */
 static void basicf(struct am_context *ctx) {
-    unsigned char *ap, *bp;
     float a, b, r;
     double m;
     int e;
  
-    ap = stpos(-4);
-    am_fp(ap, ctx->fptmp);
-    fp_na(ctx->fptmp, &a);
-
-    bp = stpos(-8);
-    am_fp(bp, ctx->fptmp);
-    fp_na(ctx->fptmp, &b);
+    a = am_get(ctx, sp_add(-4));
+    b = am_get(ctx, sp_add(-8));
 
     switch (ctx->op_latch & AM_OP) {
     case AM_FADD:
@@ -493,20 +680,23 @@ static void basicf(struct am_context *ctx) {
     }
 
     /* We do not use fov() because we want to bias exponent by 128
-     * on OVF/UND per the guide.
+     * on OVF/UND per the guide. frexp() is only needed if the result
+     * is out of range, 2^-65 <= |r| < 2^63 is 62 <= e <= 189 in float.
      */
-    m = frexp(r, &e);
-    if (e > 63) {
-	ctx->status |= AM_ERR_OVF;
-	e -= 128;
-	r = ldexp(m, e);
-    } else if (e < -64) {
-	ctx->status |= AM_ERR_UND;
-	e += 128;
-	r = ldexp(m, e);
+    e = fexp(r);
+    if (e > 189 || (e < 62 && r != 0.0)) {
+	m = frexp(r, &e);
+	if (e > 63) {
+	    ctx->status |= AM_ERR_OVF;
+	    e -= 128;
+	    r = ldexp(m, e);
+	} else if (e < -64) {
+	    ctx->status |= AM_ERR_UND;
+	    e += 128;
+	    r = ldexp(m, e);
+	}
     }
-    na_fp(&r, ctx->fptmp);
-    fp_am(ctx->fptmp, bp);
+    am_put(ctx, sp_add(-8), r);
     dec_sp(4);
     ctx->op_latch = AM_FLOAT;
     sz(ctx);
@@ -521,13 +711,10 @@ static void basicf(struct am_context *ctx) {
  * here.
  */
 static void ffunc(struct am_context *ctx) {
-    unsigned char *ap;
     float a;
     double x;
 
-    ap = stpos(-4);
-    am_fp(ap, ctx->fptmp);
-    fp_na(ctx->fptmp, &a);
+    a = am_get(ctx, sp_add(-4));
 
     x = a;
     switch (ctx->op_latch & AM_OP) {
@@ -592,8 +779,7 @@ static void ffunc(struct am_context *ctx) {
     if (fov(ctx, x))
 	goto err;
     a = x;
-    na_fp(&a, ctx->fptmp);
-    fp_am(ctx->fptmp, ap);
+    am_put(ctx, sp_add(-4), a);
 err:
     ctx->op_latch = AM_FLOAT;
     sz(ctx);
@@ -606,19 +792,14 @@ err:
  */
 static void pwr(struct am_context *ctx) {
     /* B^A = EXP( A * LN(B) ) */
-    unsigned char *ap, *bp;
     float a, b;
     double x;
 
     /* A */
-    ap = stpos(-4);
-    am_fp(ap, ctx->fptmp);
-    fp_na(ctx->fptmp, &a);
+    a = am_get(ctx, sp_add(-4));
 
     /* B */
-    bp = stpos(-8);
-    am_fp(bp, ctx->fptmp);
-    fp_na(ctx->fptmp, &b);
+    b = am_get(ctx, sp_add(-8));
 
     /* LN(B) */
     if (b < 0.0) {
@@ -643,8 +824,7 @@ static void pwr(struct am_context *ctx) {
 
     /* replace B with result */
     b = x;
-    na_fp(&b, ctx->fptmp);
-    fp_am(ctx->fptmp, bp);
+    am_put(ctx, sp_add(-8), b);
 
     /* roll stack */
     dec_sp(4);
@@ -653,6 +833,47 @@ err:
 }
 
 
+/* Clock cycles of the commands, from the data sheet of the AM9511A.
+ * The time of many commands depends on the data, the average of the
+ * minimum and maximum given is used. The first column is for 32 bit
+ * integer and float, the second for 16 bit integer.
+ */
+static const unsigned short am_times[32][2] = {
+    {    4,    4 }, /* NOP */
+    {  826,  826 }, /* SQRT */
+    { 4302, 4302 }, /* SIN */
+    { 4359, 4359 }, /* COS */
+    { 5390, 5390 }, /* TAN */
+    { 7084, 7084 }, /* ASIN */
+    { 7294, 7294 }, /* ACOS */
+    { 5764, 5764 }, /* ATAN */
+    { 5803, 5803 }, /* LOG */
+    { 5627, 5627 }, /* LN */
+    { 4336, 4336 }, /* EXP */
+    {10161, 10161 }, /* PWR */
+    {   21,   17 }, /* DADD SADD */
+    {   39,   31 }, /* DSUB SSUB */
+    {  202,   89 }, /* DMUL SMUL */
+    {  203,   89 }, /* DDIV SDIV */
+    {  211,  211 }, /* FADD */
+    {  220,  220 }, /* FSUB */
+    {  157,  157 }, /* FMUL */
+    {  169,  169 }, /* FDIV */
+    {   27,   23 }, /* CHSD CHSS */
+    {   18,   18 }, /* CHSF */
+    {  200,   89 }, /* DMUU SMUU */
+    {   20,   16 }, /* PTOD PTOF PTOS */
+    {   12,   10 }, /* POPD POPF POPS */
+    {   26,   18 }, /* XCHD XCHF XCHS */
+    {   16,   16 }, /* PUPI */
+    {    4,    4 },
+    {  238,  238 }, /* FLTD */
+    {  142,  142 }, /* FLTS */
+    {  223,  223 }, /* FIXD */
+    {  154,  154 }  /* FIXS */
+};
+
+
 /* Issue am9511 command. Does not return until command
  * is complete.
  */
@@ -666,6 +887,26 @@ void am_command(void *amp, unsigned char op) {
 #endif
 
     ctx->status = AM_BUSY;
+    ctx->cycles = am_times[op & AM_OP][IS_SINGLE];
+
+    /* commands working on the bytes of the stack need the cached
+     * float written back
+     */
+    switch (op & AM_OP) {
+    case AM_CHS:
+    case AM_POP:
+    case AM_PTO:
+    case AM_XCH:
+    case AM_ADD:
+    case AM_SUB:
+    case AM_MUL:
+    case AM_MUU:
+    case AM_DIV:
+	am_forget(ctx);
+	break;
+    default:
+	break;
+    }
 
     switch (ctx->op_latch & AM_OP) {
 
@@ -765,6 +1006,14 @@ void am_command(void *amp, unsigned char op) {
 }
 
 
+/* Clock cycles the last command takes on the chip
+ */
+unsigned int am_cycles(void *amp) {
+    struct am_context *ctx = (struct am_context *)amp;
+    return ctx->cycles;
+}
+
+
 /* Reset the am9511 emulator
  */
 void am_reset(void *amp) {
@@ -775,6 +1024,9 @@ void am_reset(void *amp) {
     ctx->status = 0;
     ctx->op_latch = 0;
     ctx->last_latch = 0;
+    ctx->cycles = 0;
+    ctx->cache_pos = -1;
+    ctx->cache_dirty = 0;
     for (i = 0; i < 16; ++i)
 	ctx->stack[i] = 0;
 }
@@ -787,6 +1039,9 @@ void *am_create(int status, int data) {
     void *fpp;
     UNUSED(status);
     UNUSED(data);
+#ifndef z80
+    am_tables();
+#endif
     fpp = malloc(apu_fp_size());
     if (fpp == NULL)
 	return NULL;
@@ -823,6 +1078,8 @@ void am_dump(void *amp, unsigned char op) {
         "FLTD", "FLTS", "FIXD", "FIXS"
     };
 
+    am_flush(ctx);
+
     printf("AM9511 STATUS: %02x ", ctx->status);
         if (t & AM_BUSY)  printf("BUSY ");
         if (t & AM_SIGN)  printf("SIGN ");
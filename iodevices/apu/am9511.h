@@ -77,6 +77,7 @@ unsigned char am_pop(void *);
 unsigned char am_status(void *);
 void          am_command(void *, unsigned char);
 void          am_reset(void *);
+unsigned int  am_cycles(void *);
 
 #ifdef NDEBUG
 #define am_dump(x)
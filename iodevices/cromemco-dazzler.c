@@ -27,10 +27,14 @@
  * 04-NOV-2019 remove fake DMA bus request
  * 04-JAN-2025 add SDL2 support
  * 06-JUN-2025 added support for more accurate timing, interlaced video, odd-even-line flag and window resize
+ * 16-OCT-2026 web frontend only scans display memory written since last update
+ * 16-OCT-2026 SDL2: decode fields into a streaming texture scaled by the renderer
+ * 16-OCT-2026 SDL2: frame rate paced by simsdl
 */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #ifdef WANT_SDL
 #include <SDL.h>
 #else
@@ -38,7 +42,6 @@
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/extensions/Xrender.h>
-#include <string.h>
 #endif
 
 #include "sim.h"
@@ -46,6 +49,7 @@
 #include "simglb.h"
 #include "simcfg.h"
 #include "simmem.h"
+#include "simdirty.h"
 #include "simport.h"
 #include "simcore.h"
 #ifdef WANT_SDL
@@ -55,7 +59,6 @@
 #ifdef HAS_DAZZLER
 
 #ifdef HAS_NETSERVER
-#include <string.h>
 #include "netsrv.h"
 #endif
 
@@ -85,6 +88,12 @@ static int dazzler_win_id = -1;
 static SDL_Window *window;
 static SDL_Surface *surface;
 static SDL_Renderer *renderer;
+static SDL_Texture *texture;
+#define TWIDTH	128		/* texture width, one texel per x4 mode pixel */
+static uint8_t *pixels;		/* locked texture */
+static int pitch;
+static uint32_t pal[2][16];	/* texel values for color and grayscale */
+static uint32_t mono[2];	/* texel values for x4 mode */
 static uint8_t colors[16][3] = {
 	{ 0x00, 0x00, 0x00 },
 	{ 0x80, 0x00, 0x00 },
@@ -224,6 +233,14 @@ static void open_display(void)
 	renderer = SDL_CreateRenderer(window, -1, (SDL_RENDERER_ACCELERATED |
 						   SDL_RENDERER_PRESENTVSYNC));
 	surface = SDL_GetWindowSurface(window);
+	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB888,
+				    SDL_TEXTUREACCESS_STREAMING, TWIDTH, WSIZE);
+	for (i = 0; i < 16; i++) {
+		pal[0][i] = (colors[i][0] << 16) | (colors[i][1] << 8) |
+			    colors[i][2];
+		pal[1][i] = (grays[i][0] << 16) | (grays[i][1] << 8) |
+			    grays[i][2];
+	}
 #else /* !WANT_SDL */
 	XSizeHints *size_hints = XAllocSizeHints();
 	Atom wm_delete_window;
@@ -367,6 +384,7 @@ static void open_display(void)
 static void close_display(void)
 {
 #ifdef WANT_SDL
+	SDL_DestroyTexture(texture);
 	SDL_DestroyRenderer(renderer);
 	renderer = NULL;
 	SDL_DestroyWindow(window);
@@ -456,25 +474,40 @@ static void process_event(SDL_Event *event)
 	}
 }
 
-static inline void set_fg_color(int i)
-{
-	SDL_SetRenderDrawColor(renderer,
-			       colors[i][0], colors[i][1], colors[i][2],
-			       SDL_ALPHA_OPAQUE);
-}
-
-static inline void set_fg_gray(int i)
-{
-	SDL_SetRenderDrawColor(renderer,
-			       grays[i][0], grays[i][1], grays[i][2],
-			       SDL_ALPHA_OPAQUE);
-}
-
-static inline void fill_rect(int x, int y, int w, int h)
+/*
+ * decode one scanline from the line buffer into the locked texture,
+ * every mode spans the texture width, so a pixel is 1, 2 or 4 texels
+ */
+static inline void draw_line(int scanline, int num_bytes, int subrow)
 {
-	SDL_Rect r = {x, y, w, h};
-
-	SDL_RenderFillRect(renderer, &r);
+	register int b, k, w;
+	register BYTE d, m;
+	uint32_t *p = (uint32_t *) (pixels + scanline * pitch);
+	const uint32_t *lut = pal[(format & 0x10) ? 0 : 1];
+	uint32_t c0, c1;
+
+	if (format & 0x40) {	/* x4 mode, 4 pixels per byte */
+		w = TWIDTH / (num_bytes * 4);
+		for (b = 0; b < num_bytes; b++, p += 4 * w) {
+			d = line_buffer[b];
+			if (subrow == 0)	/* first 3 scanline subrow */
+				m = (d & 0x03) | ((d >> 2) & 0x0c);
+			else			/* second 3 scanline subrow */
+				m = ((d >> 2) & 0x03) | ((d >> 4) & 0x0c);
+			for (k = 0; k < 4 * w; k++)
+				p[k] = mono[(m >> (k / w)) & 1];
+		}
+	} else {		/* nibble mode, 2 pixels per byte */
+		w = TWIDTH / (num_bytes * 2);
+		for (b = 0; b < num_bytes; b++, p += 2 * w) {
+			c0 = lut[line_buffer[b] & 0x0f];
+			c1 = lut[line_buffer[b] >> 4];
+			for (k = 0; k < w; k++) {
+				p[k] = c0;
+				p[w + k] = c1;
+			}
+		}
+	}
 }
 
 #else /* !WANT_SDL */
@@ -650,9 +683,12 @@ static Tstates_t dazzler_busmaster(BYTE bus_ack)
 
 static void draw_field(int field)
 {
-	int bytepos, num_bytes, num_dma, num_lines, current_line, psize, offset, start, step, dma_cycle;
+	int bytepos, num_bytes, num_dma, num_lines, current_line, offset, start, step, dma_cycle;
 	BYTE i;
-	int hires_subrow, vpos;
+	int hires_subrow;
+#ifndef WANT_SDL
+	int psize, vpos;
+#endif
 
 	Tstates_t T_end_of_row;
 
@@ -672,10 +708,15 @@ static void draw_field(int field)
 	/* select foreground color for hires mode */
 	if (format & 0x40) {
 		i = format & 0x0f;
+#ifdef WANT_SDL
+		mono[0] = 0;
+		mono[1] = pal[(format & 0x10) ? 0 : 1][i];
+#else
 		if (format & 0x10) 
 			set_fg_color(i);
 		else
 			set_fg_gray(i);
+#endif
 	}
 
 	/* now draw the frame */
@@ -685,9 +726,11 @@ static void draw_field(int field)
 		num_bytes = format & 0x20 ? 32 : 16;			/* bytes per DMA cycle */
 		num_dma = format & 0x20 ? 64 : 32;			/* DMA cycles per frame */
 		num_lines = 384 / num_dma;				/* scanlines per DMA cycle */
+#ifndef WANT_SDL
 		if (format & 0x40) psize = 192 / num_dma * pscale;	/* hires monochrome (x4 mode) */
 		else psize = 384 / num_dma * pscale;			/* color/grayscale (nibble) mode */
 		vpos = scanline * pscale;
+#endif
 
 		if (current_line == 0) {
 			hires_subrow = 0;
@@ -713,6 +756,9 @@ static void draw_field(int field)
 			start_bus_request(BUS_DMA_CONTINUOUS, &dazzler_busmaster);
 		}
 
+#ifdef WANT_SDL
+		draw_line(scanline, num_bytes, hires_subrow);
+#else
 		for (bytepos=0; bytepos<num_bytes; bytepos++) {
 
 			if (format & 0x40) {	/* x4 mode */
@@ -762,6 +808,7 @@ static void draw_field(int field)
 				fill_rect((bytepos * 2 + 1) * psize, vpos, psize, pscale);
 			}
 		}
+#endif
 
 		current_line += step;
 			
@@ -802,6 +849,10 @@ static void draw_field(int field)
 
 #ifdef HAS_NETSERVER
 static uint8_t dblbuf[2048];
+static int ws_dirty = -1;		/* dirty tracking id for display memory */
+static int ws_addr = -1;		/* display memory tracked */
+static BYTE dirty[(2048 >> DIRTY_SHIFT) + 1];	/* lines written */
+static bool ws_full;			/* send everything on next update */
 
 static struct {
 	uint16_t format;
@@ -813,6 +864,7 @@ static struct {
 static void ws_clear(void)
 {
 	memset(dblbuf, 0, 2048);
+	ws_full = true;
 
 	msg.format = 0;
 	msg.addr = 0xFFFF;
@@ -829,7 +881,26 @@ static void ws_refresh(void)
 	bool cont;
 	uint8_t val;
 
+	/* track display memory, the DMA address might have been changed */
+	if (ws_dirty < 0)
+		ws_dirty = dirty_alloc();
+	if (ws_addr != dma_addr || ws_dirty < 0) {
+		ws_addr = dma_addr;
+		dirty_range(ws_dirty, ws_addr, 2048);
+		ws_full = true;
+	}
+	if (!dirty_collect(ws_dirty, dirty) && !ws_full &&
+	    format == formatBuf)
+		return;
+	if (format != formatBuf)
+		ws_full = true;
+
 	for (i = 0; i < len; i++) {
+		/* skip lines not written since the last update */
+		if (!ws_full && !dirty[i >> DIRTY_SHIFT]) {
+			i |= (1 << DIRTY_SHIFT) - 1;
+			continue;
+		}
 		addr = i;
 		n = 0;
 		la_count = 0;
@@ -873,6 +944,7 @@ static void ws_refresh(void)
 			     msg.len, msg.format, la_count);
 		}
 	}
+	ws_full = false;
 }
 #endif /* HAS_NETSERVER */
 
@@ -883,6 +955,7 @@ static void update_display(bool tick)
 	UNUSED(tick);
 	
 	int width, height;
+	SDL_Rect dst;
 	
 	Tstates_t T_end;
 
@@ -909,13 +982,22 @@ static void update_display(bool tick)
 		}
 	}
 
+	/* texture is scaled into the canvas by the renderer */
+	dst.x = dst.y = 0;
+	dst.w = dst.h = WSIZE * pscale;
+
 	/* draw one frame dependent on graphics format */
-	set_fg_color(0);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
 	SDL_RenderClear(renderer);
 	if (state) {		/* draw frame if on */
 		if (dazzler_interlaced)
 			field = (field == ODD) ? EVEN : ODD;
+		SDL_LockTexture(texture, NULL, (void **) &pixels, &pitch);
+		if (field != FULL)	/* scanlines of other field are black */
+			memset(pixels, 0, pitch * WSIZE);
 	       	draw_field(field);
+		SDL_UnlockTexture(texture);
+		SDL_RenderCopy(renderer, texture, NULL, &dst);
 		SDL_RenderPresent(renderer);
 
 		/* frame done, set frame flag for 4 ms vertical blank */
@@ -931,7 +1013,8 @@ static win_funcs_t dazzler_funcs = {
 	open_display,
 	close_display,
 	process_event,
-	update_display
+	update_display,
+	62
 };
 #endif
 
@@ -1053,6 +1136,7 @@ static void *update_thread(void *arg)
 				} else {
 					if (msg.format) {
 						memset(dblbuf, 0, 2048);
+						ws_full = true;
 						msg.format = 0;
 					}
 				}
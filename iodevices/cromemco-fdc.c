@@ -37,6 +37,7 @@
  * 29-JUL-2021 add boot config for machine without frontpanel
  * 02-SEP-2021 implement banked ROM
  * 15-MAY-2024 make disk manager standard
+ * 16-OCT-2026 count sectors for the metrics of the web frontend
  */
 
 #include <unistd.h>
@@ -457,6 +458,9 @@ BYTE cromemco_fdc_data_in(void)
 				close(fd);
 				return (BYTE) 0;
 			}
+#ifdef WANT_METRICS
+			disk_rd_sec++;
+#endif
 			close(fd);
 		}
 		/* last byte? */
@@ -593,9 +597,12 @@ void cromemco_fdc_data_out(BYTE data)
 			state = FDC_IDLE;		/* done */
 			fdc_flags |= 1;			/* set EOJ */
 			fdc_flags &= ~128;		/* reset DRQ */
-			if (write(fd, buf, secsz) == secsz)
+			if (write(fd, buf, secsz) == secsz) {
 				fdc_stat = 0;
-			else
+#ifdef WANT_METRICS
+				disk_wr_sec++;
+#endif
+			} else
 				fdc_stat = 0x20;	/* write fault */
 			close(fd);
 		}
@@ -687,9 +694,12 @@ void cromemco_fdc_data_out(BYTE data)
 				return;
 			} else {
 				secs++;
-				if (write(fd, buf, bcnt) == bcnt)
+				if (write(fd, buf, bcnt) == bcnt) {
 					fdc_stat = 0;
-				else
+#ifdef WANT_METRICS
+					disk_wr_sec++;
+#endif
+				} else
 					fdc_stat = 0x20; /* write fault */
 				wrtstat = 1;
 			}
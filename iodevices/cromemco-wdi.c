@@ -7,14 +7,19 @@
  *
  * History:
  * 23-JUL-2022	1.0	Initial Release
+ * 16-OCT-2026	1.1	Count sectors for the metrics
+ * 16-OCT-2026	1.2	Host I/O on a thread with track read-ahead
+ * 16-OCT-2026	1.3	Use the common Z80-DMA emulation
  *
  */
 
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -29,6 +34,7 @@
 #include "netsrv.h"
 #endif
 #include "cromemco-wdi.h"
+#include "zilog-dma.h"
 
 #define LOG_LOCAL_LEVEL LOG_ERROR
 #include "log.h"
@@ -39,9 +45,49 @@ static const char *TAG = "wdi";
 #define WDI_BLOCK_SIZE	512
 
 #define WDI_MAX_BUFFER	(WDI_BLOCK_SIZE + 8)
+#define WDI_TRACK_SIZE	(WDI_SECTORS * WDI_BLOCK_SIZE)
+
+#define WDI_QUEUE	32	/* max. number of queued host I/O jobs */
 
 static BYTE buffer[WDI_MAX_BUFFER];
 
+/*
+ * The host I/O is done by a thread, so that the CPU doesn't stop
+ * for the latency of the host file system. After a seek the whole
+ * track under the head is read ahead into a track buffer of the unit,
+ * the DMA transfers of the following sector reads are served from it.
+ * Sector writes update the track buffer and are queued for the thread,
+ * the CPU doesn't wait for them. The thread does the jobs in order,
+ * so a track read always sees the sectors written before.
+ */
+typedef enum job_op { JOB_READ_TRACK, JOB_WRITE } job_op_t;
+
+static struct {
+	job_op_t op;
+	int unit;
+	off_t pos;
+	BYTE data[WDI_BLOCK_SIZE];
+} jobs[WDI_QUEUE];
+
+static int job_head, job_tail, job_count;
+
+typedef enum trk_state { TRK_EMPTY, TRK_PENDING, TRK_READY, TRK_ERROR } trk_state_t;
+
+static struct {
+	trk_state_t state;
+	BYTE head;
+	WORD cyl;
+	BYTE data[WDI_TRACK_SIZE];
+} track[WDI_UNITS];
+
+static BYTE write_error[WDI_UNITS];	/* failed write, reported as fault */
+
+static pthread_t thread;
+static bool io_quit;
+static pthread_mutex_t io_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t io_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t io_done = PTHREAD_COND_INITIALIZER;
+
 static const char *images[WDI_UNITS] =
 	{ "hd0.hdd", "hd1.hdd", "hd2.hdd" }; //, "hd3.hdd" };
 
@@ -61,12 +107,6 @@ static struct {
 /* Index interval in T ticks per minute @ 4MHz */
 #define INDEX_INT	(1000000 * 60 * 4)
 
-typedef enum wreg { WR_BASE, WR0, WR1, WR2, WR3, WR4, WR5, WR6 } wreg_t;
-
-typedef enum rreg { RR_BASE, RR0, RR1, RR2, RR3, RR4, RR5, RR6 } rreg_t;
-
-typedef enum dma_dev { MREQ, IORQ } dma_dev_t;
-
 static struct {
 	struct {
 		BYTE cmd_A;
@@ -104,58 +144,7 @@ static struct {
 
 		BYTE bus_addr;
 	} pio1;
-	struct {
-		wreg_t wr_state;
-		rreg_t rr_state;
-		struct {
-			BYTE base;
-			BYTE dest;
-			BYTE mode;
-			WORD a_start;
-			WORD len;
-			WORD a_addr_counter;
-			WORD byte_counter;
-		} wr0;
-		struct {
-			BYTE base;
-			BYTE a_timing;
-
-			dma_dev_t a_device;
-			BYTE a_fixed;
-		} wr1;
-		struct {
-			BYTE base;
-			BYTE b_timing;
-
-			dma_dev_t b_device;
-			BYTE b_fixed;
-		} wr2;
-		struct {
-			BYTE base;
-			BYTE mask;
-			BYTE match;
-		} wr3;
-		struct {
-			BYTE base;
-			WORD b_start;
-			WORD b_addr_counter;
-			BYTE intr_control;
-			BYTE pulse_control;
-			BYTE intr_vector;
-		} wr4;
-		struct {
-			BYTE base;
-		} wr5;
-		struct {
-			BYTE base;
-			BYTE mask;
-		} wr6;
-		struct {
-			BYTE status;
-		} rr0;
-		BYTE force_ready;
-		BYTE enable_dma;
-	} dma;
+	z80dma_t dma;
 	struct {
 		BYTE mode0;
 		BYTE mode1;
@@ -208,10 +197,22 @@ static struct {
 	int unit;	/* current selected hard disk unit*/
 } wdi;
 
+static void *io_thread(void *arg);
+
 void wdi_exit(void)
 {
 	int unit;
 
+	/* let the thread finish the queued jobs */
+	if (thread != 0) {
+		pthread_mutex_lock(&io_mutex);
+		io_quit = true;
+		pthread_cond_signal(&io_work);
+		pthread_mutex_unlock(&io_mutex);
+		pthread_join(thread, NULL);
+		thread = 0;
+	}
+
 	for (unit = 0; unit < WDI_UNITS; unit++) {
 		if (wdi.hd[unit].fd) {
 			fsync(wdi.hd[unit].fd);
@@ -219,6 +220,8 @@ void wdi_exit(void)
 			wdi.hd[unit].fd = 0;
 		}
 		wdi.hd[unit].online = 0;
+		track[unit].state = TRK_EMPTY;
+		write_error[unit] = 0;
 	}
 }
 
@@ -240,8 +243,8 @@ void wdi_init(void)
 	wdi.pio1.mode_A = 1;
 	wdi.pio1.mode_B = 1;
 
-	wdi.dma.wr_state = WR_BASE;
-	wdi.dma.rr_state = RR_BASE;
+	wdi.dma.name = "WDI";
+	z80dma_reset(&wdi.dma);
 
 	wdi.ctc.now0 = 0;
 	wdi.ctc.now1 = 0;
@@ -305,6 +308,8 @@ again:
 		struct stat s;
 
 		fstat(fd, &s);
+		if (!(s.st_mode & S_IWUSR))
+			wdi.hd[unit].status.write_prot = 1;
 
 		wdi.hd[unit].type = -1;
 
@@ -335,6 +340,14 @@ again:
 	LOG(TAG, "\r\n");
 
 	wdi.unit = 0;
+
+	if (thread == 0) {
+		io_quit = false;
+		if (pthread_create(&thread, NULL, io_thread, NULL)) {
+			LOGE(TAG, "can't create I/O thread");
+			exit(EXIT_FAILURE);
+		}
+	}
 }
 
 #ifdef HAS_NETSERVER
@@ -364,26 +377,127 @@ static off_t wdi_pos(BYTE *buf)
 	return p;
 }
 
+/*
+ *	thread for the host I/O, does the queued jobs in order
+ */
+static void *io_thread(void *arg)
+{
+	int unit, fd;
+	off_t pos;
+	ssize_t n;
+
+	UNUSED(arg);
+
+	pthread_mutex_lock(&io_mutex);
+	for (;;) {
+		while (job_count == 0 && !io_quit)
+			pthread_cond_wait(&io_work, &io_mutex);
+		if (job_count == 0)
+			break;
+
+		/* the job stays in the queue until it is done */
+		unit = jobs[job_tail].unit;
+		fd = wdi.hd[unit].fd;
+		pos = jobs[job_tail].pos;
+		pthread_mutex_unlock(&io_mutex);
+
+		if (jobs[job_tail].op == JOB_WRITE)
+			n = pwrite(fd, jobs[job_tail].data, WDI_BLOCK_SIZE, pos);
+		else
+			n = pread(fd, track[unit].data, WDI_TRACK_SIZE, pos);
+
+		pthread_mutex_lock(&io_mutex);
+		if (jobs[job_tail].op == JOB_WRITE) {
+			if (n != WDI_BLOCK_SIZE)
+				write_error[unit] = 1;
+		} else
+			track[unit].state = (n == WDI_TRACK_SIZE) ? TRK_READY : TRK_ERROR;
+		job_tail = (job_tail + 1) % WDI_QUEUE;
+		job_count--;
+		pthread_cond_broadcast(&io_done);
+	}
+	pthread_mutex_unlock(&io_mutex);
+
+	return NULL;
+}
+
+/*
+ *	queue a job for the I/O thread, io_mutex must be locked
+ */
+static void io_queue(job_op_t op, int unit, off_t pos, const BYTE *data)
+{
+	while (job_count == WDI_QUEUE)
+		pthread_cond_wait(&io_done, &io_mutex);
+
+	jobs[job_head].op = op;
+	jobs[job_head].unit = unit;
+	jobs[job_head].pos = pos;
+	if (data != NULL)
+		memcpy(jobs[job_head].data, data, WDI_BLOCK_SIZE);
+	job_head = (job_head + 1) % WDI_QUEUE;
+	job_count++;
+	pthread_cond_signal(&io_work);
+}
+
+/*
+ *	start reading the track under the head of the current unit
+ *	into its track buffer, io_mutex must be locked
+ */
+static void track_read(void)
+{
+	BYTE hdr[4];
+	int unit = wdi.unit;
+
+	/* the thread may still fill the buffer */
+	while (track[unit].state == TRK_PENDING)
+		pthread_cond_wait(&io_done, &io_mutex);
+
+	if (track[unit].state == TRK_READY
+	    && track[unit].head == wdi.hd[unit].status.hav
+	    && track[unit].cyl == wdi.hd[unit].status.cav)
+		return;
+
+	track[unit].head = hdr[0] = wdi.hd[unit].status.hav;
+	track[unit].cyl = wdi.hd[unit].status.cav;
+	hdr[1] = wdi.hd[unit].status.cav & 0xff;
+	hdr[2] = wdi.hd[unit].status.cav >> 8;
+	hdr[3] = 0;
+	track[unit].state = TRK_PENDING;
+	io_queue(JOB_READ_TRACK, unit, wdi_pos(hdr), NULL);
+}
+
+/*
+ *	read ahead the track after a seek, while the CPU continues
+ */
+static void track_prefetch(void)
+{
+	if (!wdi.hd[wdi.unit].online)
+		return;
+
+	pthread_mutex_lock(&io_mutex);
+	track_read();
+	pthread_mutex_unlock(&io_mutex);
+}
+
 static Tstates_t wdi_dma_write(BYTE bus_ack)
 {
-	int i;
+	int sec;
 
 	if (!bus_ack)
 		return 0;
 
 	LOGI(TAG, "WRITE: head: %d, cyl: %x", wdi.hd[wdi.unit].status.hav,
 	     wdi.hd[wdi.unit].status.cav);
-	LOGI(TAG, "            start: %04x, addr: %04x, len: %d", wdi.dma.wr4.b_start,
-	     wdi.dma.wr4.b_addr_counter, wdi.dma.wr0.len);
+	LOGI(TAG, "            start: %04x, addr: %04x, len: %d", wdi.dma.start[DMA_PORT_B],
+	     wdi.dma.addr[DMA_PORT_B], wdi.dma.length);
 
-	if (wdi.dma.wr0.len >= WDI_MAX_BUFFER) {
+	if (wdi.dma.length >= WDI_MAX_BUFFER) {
 		wdi.hd[wdi.unit]._fault = 0; /* SET FAULT */
-		LOGE(TAG, "DMA length: %d > buffer: %d", wdi.dma.wr0.len, WDI_MAX_BUFFER);
+		LOGE(TAG, "DMA length: %d > buffer: %d", wdi.dma.length, WDI_MAX_BUFFER);
 		return 0;
 	}
 
-	for (i = 0; i <= wdi.dma.wr0.len; i++)
-		buffer[i] = dma_read(wdi.dma.wr4.b_addr_counter++);
+	z80dma_mem_read(&wdi.dma, DMA_PORT_B, buffer, wdi.dma.length + 1);
 
 	LOGI(TAG, "            SYNC: %02x, HEAD: %02x, CYL: %02x%02x, SEC: %02x",
 	     buffer[0], buffer[1], buffer[3], buffer[2], buffer[4]);
@@ -402,39 +516,53 @@ static Tstates_t wdi_dma_write(BYTE bus_ack)
 		wdi.hd[wdi.unit]._fault = 0; /* SET FAULT */
 		return 0;
 	}
-
-	struct stat s;
-
-	fstat(wdi.hd[wdi.unit].fd, &s);
-	if (s.st_mode & S_IWUSR)
-		wdi.hd[wdi.unit].status.write_prot = 0;
-	else
-		wdi.hd[wdi.unit].status.write_prot = 1;
+	if (wdi.hd[wdi.unit].status.write_prot) {
+		LOGE(TAG, "DISK WRITE ERROR UNIT [%d] - WRITE PROTECTED", wdi.unit);
+		wdi.hd[wdi.unit]._fault = 0; /* write fault */
+		return 0;
+	}
 
 	off_t pos = wdi_pos(&buffer[1]);
 
-	if (lseek(wdi.hd[wdi.unit].fd, pos, SEEK_SET) == -1L) {
+	pthread_mutex_lock(&io_mutex);
+
+	if (write_error[wdi.unit]) {
+		LOGE(TAG, "DISK WRITE ERROR UNIT [%d] - HOST I/O FAILED", wdi.unit);
+		write_error[wdi.unit] = 0;
 		wdi.hd[wdi.unit]._fault = 0; /* write fault */
+		pthread_mutex_unlock(&io_mutex);
 		return 0;
 	}
 
-	/* write the sector */
-	if (write(wdi.hd[wdi.unit].fd, &buffer[5], WDI_BLOCK_SIZE) == WDI_BLOCK_SIZE)
-		wdi.hd[wdi.unit]._fault = 1;
-	else
-		wdi.hd[wdi.unit]._fault = 0; /* write fault */
+	/* keep the track buffer up to date */
+	while (track[wdi.unit].state == TRK_PENDING)
+		pthread_cond_wait(&io_done, &io_mutex);
+	if (track[wdi.unit].state == TRK_READY
+	    && track[wdi.unit].head == buffer[1]
+	    && track[wdi.unit].cyl == cyl) {
+		if ((sec = buffer[4]) < WDI_SECTORS)
+			memcpy(&track[wdi.unit].data[sec * WDI_BLOCK_SIZE],
+			       &buffer[5], WDI_BLOCK_SIZE);
+		else
+			track[wdi.unit].state = TRK_EMPTY;
+	}
 
-	// if (fsync(wdi.hd[wdi.unit].fd) == -1) {
-	// 	LOGW(TAG, "WRITE: SYNC FAILED - %s [%d]", strerror(errno), errno);
-	// };
+	/* queue the sector write */
+	io_queue(JOB_WRITE, wdi.unit, pos, &buffer[5]);
+
+	pthread_mutex_unlock(&io_mutex);
+
+	wdi.hd[wdi.unit]._fault = 1;
+#ifdef WANT_METRICS
+	disk_wr_sec++;
+#endif
 
-	return wdi.dma.wr0.len * 3; /* 3 t-states per byte of DMA */
+	return wdi.dma.length * 3; /* 3 t-states per byte of DMA */
 }
 
 static Tstates_t wdi_dma_read(BYTE bus_ack)
 {
-	register int v;
-	int i;
+	int sec;
 
 	if (!bus_ack)
 		return 0;
@@ -442,49 +570,53 @@ static Tstates_t wdi_dma_read(BYTE bus_ack)
 	buffer[0] = wdi.hd[wdi.unit].status.hav;
 	buffer[1] = wdi.hd[wdi.unit].status.cav & 0xff;
 	buffer[2] = wdi.hd[wdi.unit].status.cav >> 8;
-	buffer[3] = wdi.hd[wdi.unit].sector;
+	buffer[3] = sec = wdi.hd[wdi.unit].sector;
 
 	LOGI(TAG, "READ %s: head: %d, cyl: %d, sec: %d",
-	     (wdi.dma.wr0.len == 4) ? "HEADER" : "DATA",
+	     (wdi.dma.length == 4) ? "HEADER" : "DATA",
 	     wdi.hd[wdi.unit].status.hav, wdi.hd[wdi.unit].status.cav,
 	     wdi.hd[wdi.unit].sector);
-	LOGI(TAG, "           start: %04x, addr: %04x, len: %d", wdi.dma.wr4.b_start,
-	     wdi.dma.wr4.b_addr_counter, wdi.dma.wr0.len);
+	LOGI(TAG, "           start: %04x, addr: %04x, len: %d", wdi.dma.start[DMA_PORT_B],
+	     wdi.dma.addr[DMA_PORT_B], wdi.dma.length);
 
 	wdi.hd[wdi.unit].sector++;
 	wdi.hd[wdi.unit].sector %= WDI_SECTORS;
 
-	struct stat s;
-
-	fstat(wdi.hd[wdi.unit].fd, &s);
-	if (s.st_mode & S_IWUSR)
-		wdi.hd[wdi.unit].status.write_prot = 0;
-	else
-		wdi.hd[wdi.unit].status.write_prot = 1;
-
-	off_t pos = wdi_pos(buffer);
-
-	if (lseek(wdi.hd[wdi.unit].fd, pos, SEEK_SET) == -1L) {
-		wdi.hd[wdi.unit]._fault = 0; /* read fault */
+	if (wdi.dma.length > WDI_MAX_BUFFER) {
+		wdi.hd[wdi.unit]._fault = 0; /* SET FAULT */
+		LOGE(TAG, "DMA length: %d > buffer: %d", wdi.dma.length, WDI_MAX_BUFFER);
 		return 0;
 	}
 
-	/* read the sector */
-	if (read(wdi.hd[wdi.unit].fd, &buffer[4], WDI_BLOCK_SIZE) == WDI_BLOCK_SIZE)
-		wdi.hd[wdi.unit]._fault = 1;
-	else {
-		wdi.hd[wdi.unit]._fault = 0; /* read fault */
-		return 0;
+	/* reading only the header doesn't need the disk */
+	if (wdi.dma.length > 4) {
+		pthread_mutex_lock(&io_mutex);
+
+		/* normally the track was read ahead after the seek */
+		track_read();
+		while (track[wdi.unit].state == TRK_PENDING)
+			pthread_cond_wait(&io_done, &io_mutex);
+
+		/* read the sector */
+		if (track[wdi.unit].state == TRK_READY) {
+			memcpy(&buffer[4], &track[wdi.unit].data[sec * WDI_BLOCK_SIZE],
+			       WDI_BLOCK_SIZE);
+			pthread_mutex_unlock(&io_mutex);
+#ifdef WANT_METRICS
+			disk_rd_sec++;
+#endif
+		} else {
+			track[wdi.unit].state = TRK_EMPTY;
+			pthread_mutex_unlock(&io_mutex);
+			wdi.hd[wdi.unit]._fault = 0; /* read fault */
+			return 0;
+		}
 	}
+	wdi.hd[wdi.unit]._fault = 1;
 
-	for (i = 0; i < wdi.dma.wr0.len; i++) {
-		v = buffer[i];
-
-		dma_write(wdi.dma.wr4.b_addr_counter, v);
-		wdi.dma.wr4.b_addr_counter++;
-	}
+	z80dma_mem_write(&wdi.dma, DMA_PORT_B, buffer, wdi.dma.length);
 
-	return wdi.dma.wr0.len * 3;  /* 3 t-states per byte of DMA */
+	return wdi.dma.length * 3;  /* 3 t-states per byte of DMA */
 }
 
 BYTE cromemco_wdi_pio0a_data_in(void)
@@ -584,12 +716,8 @@ BYTE cromemco_wdi_pio1b_cmd_in(void)
 
 BYTE cromemco_wdi_dma0_in(void)
 {
-	/* DMA READ STATUS NOT YET COMPLETE */
-	LOGE(TAG, "E8 IN: [%d]", wdi.dma.rr_state);
-	if (wdi.dma.rr_state == RR_BASE)
-		return wdi.dma.rr0.status;
-	else
-		return (BYTE) 0xff;
+	LOGD(TAG, "E8 IN:");
+	return z80dma_in(&wdi.dma);
 }
 
 BYTE cromemco_wdi_dma1_in(void)
@@ -702,6 +830,7 @@ static void command_bus_strobe(void)
 		wdi.hd[wdi.unit].status.rezeroing = 0;
 		wdi.hd[wdi.unit].status.on_cyl = 1;
 		wdi.hd[wdi.unit].status.unit_rdy = 1;
+		track_prefetch();
 	}
 	/* Only seek if online */
 	if (wdi.hd[wdi.unit].status.seeking && wdi.hd[wdi.unit].online) {
@@ -714,6 +843,7 @@ static void command_bus_strobe(void)
 		wdi.hd[wdi.unit].status.seeking = 0;
 		wdi.hd[wdi.unit].status.on_cyl = 1;
 		wdi.hd[wdi.unit].status.unit_rdy = 1;
+		track_prefetch();
 	}
 
 	switch (bus) {
@@ -960,199 +1090,10 @@ void cromemco_wdi_pio1b_cmd_out(BYTE data)
 	}
 }
 
-static Tstates_t wdi_dma_mem_to_mem(BYTE bus_ack)
-{
-	register int v;
-	int i;
-
-	if (!bus_ack)
-		return 0;
-
-	for (i = 0; i <= wdi.dma.wr0.len; i++) {
-		v = dma_read(wdi.dma.wr0.a_addr_counter++);
-		dma_write(wdi.dma.wr4.b_addr_counter++, v);
-	}
-	return wdi.dma.wr0.len * 6; /* 6 t-states (3 read + 3 write) for each byte */
-}
-
 void cromemco_wdi_dma0_out(BYTE data)
 {
-	const char *cmd;
-
-	cmd = "";
-
 	LOGD(TAG, "E8 OUT: %02x", data);
-
-	switch (wdi.dma.wr_state) {
-	case WR_BASE:
-		if (data & 0x80) { /* WR4 - WR6 */
-			if ((data & 0x03) == 1) { /* WR4 */
-				wdi.dma.wr4.base = data;
-				if (wdi.dma.wr4.base & 0x1C)
-					wdi.dma.wr_state = WR4;
-			} else if ((data & 0x03) == 2) { /* WR5 */
-				wdi.dma.wr5.base = data;
-				LOGD(TAG, "WR5 = %02x", data);
-			} else if ((data & 0x03) == 3) { /* WR6 */
-				wdi.dma.wr6.base = data;
-
-				switch (data) {
-				case 0x83:
-					cmd = "DISABLE DMA";
-					wdi.dma.enable_dma = 0;
-					break;
-				case 0x87:
-					cmd = "ENABLE DMA";
-					wdi.dma.enable_dma = 1;
-
-					if (wdi.dma.force_ready
-					    && wdi.dma.wr0.dest
-					    && (wdi.dma.wr0.mode == 3) /* TRANSFER/SEARCH */
-					    && (wdi.dma.wr1.a_device == MREQ)) {
-						LOGD(TAG, "DMA: MEMORY-TO-MEMORY from: "
-						     "%04x to: %04x length: %04x",
-						     wdi.dma.wr0.a_addr_counter,
-						     wdi.dma.wr4.b_addr_counter,
-						     wdi.dma.wr0.len);
-
-						start_bus_request(BUS_DMA_CONTINUOUS,
-								  &wdi_dma_mem_to_mem);
-					} else if (!wdi.dma.force_ready
-						   && !wdi.dma.wr0.dest
-						   && (wdi.dma.wr0.mode == 2) /* SEARCH */
-						   && (wdi.dma.wr1.a_device == MREQ)) {
-						LOGD(TAG, "DMA: R/W-TO/FROM-DISK addr: "
-						     "%04x length: %04x",
-						     wdi.dma.wr4.b_addr_counter,
-						     wdi.dma.wr0.len);
-						LOGD(TAG, "UNIT: %d, HEAD: %d, CYL: %d",
-						     wdi.hd[wdi.unit].status.uav,
-						     wdi.hd[wdi.unit].status.hav,
-						     wdi.hd[wdi.unit].status.cav);
-					} else {
-						LOGE(TAG, "DMA FUNCTION NOT IMPLEMENTED");
-						LOGE(TAG, "FORCE_READY = %02x",
-						     wdi.dma.force_ready);
-						LOGE(TAG, "DEVICE = %02x", wdi.dma.wr1.a_device);
-						LOGE(TAG, "MODE = %02x", wdi.dma.wr0.mode);
-						LOGE(TAG, "DEST = %02x", wdi.dma.wr0.dest);
-					}
-					break;
-				case 0xB3:
-					cmd = "FORCE READY";
-					wdi.dma.force_ready = 1;
-					break;
-				case 0xC3:
-					cmd = "RESET";
-					wdi.dma.enable_dma = 0;
-					wdi.dma.force_ready = 0;
-					wdi.dma.wr1.a_timing = 0;
-					wdi.dma.wr2.b_timing = 0;
-					break;
-				case 0xCF:
-					cmd = "LOAD";
-					wdi.dma.wr0.a_addr_counter = wdi.dma.wr0.a_start;
-					wdi.dma.wr4.b_addr_counter = wdi.dma.wr4.b_start;
-					wdi.dma.wr0.byte_counter = 0;
-					wdi.dma.force_ready = 0;
-					break;
-				default:
-					cmd = "NOT IMPLEMENTED";
-					break;
-				}
-				LOGD(TAG, "DMA WR6 = %02x - %s", data, cmd);
-			} else {
-				LOGE(TAG, "DMA WR [%02x] NOT IMPLEMENTED", data);
-			}
-		} else { /* WR0 - WR3 */
-			if (data & 0x03) { /* WR0 */
-				wdi.dma.wr0.base = data;
-				wdi.dma.wr0.dest = data & 0x04;
-				wdi.dma.wr0.mode = data & 0x03;
-
-				LOGD(TAG, "DMA WR0: source %c, mode %d",
-				     wdi.dma.wr0.dest ? 'A' : 'B', wdi.dma.wr0.mode);
-
-				if (wdi.dma.wr0.base & 0x78)
-					wdi.dma.wr_state = WR0;
-			} else { /* WR1 - WR3 */
-				if ((data & 0x07) == 4) { /* WR1 */
-					wdi.dma.wr1.base = data;
-					wdi.dma.wr1.a_device = (dma_dev_t) ((data & 0x08) >> 3);
-					wdi.dma.wr1.a_fixed = (data & 0x30) >> 4;
-					if (wdi.dma.wr1.base & 0x40)
-						wdi.dma.wr_state = WR1;
-					LOGD(TAG, "DMA WR1: Port A: inc. mode %d, dev %c",
-					     wdi.dma.wr1.a_device,
-					     wdi.dma.wr1.a_device ? 'I' : 'M');
-				} else if ((data & 0x07) == 0) { /* WR2 */
-					wdi.dma.wr2.base = data;
-					wdi.dma.wr2.b_device = (dma_dev_t) ((data & 0x08) >> 3);
-					wdi.dma.wr2.b_fixed = (data & 0x30) >> 4;
-					if (wdi.dma.wr2.base & 0x40)
-						wdi.dma.wr_state = WR2;
-					LOGD(TAG, "DMA WR2: Port B: inc. mode %d, dev %c",
-					     wdi.dma.wr1.a_device,
-					     wdi.dma.wr1.a_device ? 'I' : 'M');
-				} else {
-					LOGE(TAG, "WR [%02x] NOT IMPLEMENTED", data);
-				}
-			}
-		}
-		break;
-	case WR0:
-		if (wdi.dma.wr0.base & 0x08) {
-			wdi.dma.wr0.a_start = (wdi.dma.wr0.a_start & 0xff00) | data;
-			wdi.dma.wr0.base &= ~0x08;
-		} else if (wdi.dma.wr0.base & 0x10) {
-			wdi.dma.wr0.a_start = (wdi.dma.wr0.a_start & 0xff) | (data << 8);
-			wdi.dma.wr0.base &= ~0x10;
-		} else if (wdi.dma.wr0.base & 0x20) {
-			wdi.dma.wr0.len = (wdi.dma.wr0.len & 0xff00) | data;
-			wdi.dma.wr0.base &= ~0x20;
-		} else if (wdi.dma.wr0.base & 0x40) {
-			wdi.dma.wr0.len = (wdi.dma.wr0.len & 0xff) | (data << 8);
-			wdi.dma.wr0.base &= ~0x40;
-		}
-
-		if (!(wdi.dma.wr0.base & 0x78)) {
-			wdi.dma.wr_state = WR_BASE;
-			LOGD(TAG, "DMA WR0 [%02x] A start: %04x len: %02x",
-			     wdi.dma.wr0.base, wdi.dma.wr0.a_start, wdi.dma.wr0.len);
-		}
-		break;
-	case WR1:
-		wdi.dma.wr1.a_timing = data;
-		wdi.dma.wr_state = WR_BASE;
-		LOGD(TAG, "DMA WR1 [%02x] A timing: %02x", wdi.dma.wr1.base, wdi.dma.wr1.a_timing);
-		break;
-	case WR2:
-		wdi.dma.wr2.b_timing = data;
-		wdi.dma.wr_state = WR_BASE;
-		LOGD(TAG, "DMA WR2 [%02x] B timing: %02x", wdi.dma.wr2.base, wdi.dma.wr2.b_timing);
-		break;
-	case WR4:
-		if (wdi.dma.wr4.base & 0x04) {
-			wdi.dma.wr4.b_start = (wdi.dma.wr4.b_start & 0xff00) | data;
-			wdi.dma.wr4.base &= ~0x04;
-		} else if (wdi.dma.wr4.base & 0x08) {
-			wdi.dma.wr4.b_start = (wdi.dma.wr4.b_start & 0xff) | (data << 8);
-			wdi.dma.wr4.base &= ~0x08;
-		} else if (wdi.dma.wr4.base & 0x10) {
-			wdi.dma.wr4.intr_control = data;
-			wdi.dma.wr4.base &= ~0x10;
-		}
-
-		if (!(wdi.dma.wr4.base & 0x1C)) {
-			wdi.dma.wr_state = WR_BASE;
-			LOGD(TAG, "DMA WR4 [%02x] B start: %04x int: %02x",
-			     wdi.dma.wr4.base, wdi.dma.wr4.b_start, wdi.dma.wr4.intr_control);
-		}
-		break;
-	default:
-		LOGE(TAG, "DMA WR STATE [%d] NOT IMPLEMENTED", wdi.dma.wr_state);
-		break;
-	}
+	z80dma_out(&wdi.dma, data);
 }
 
 void cromemco_wdi_dma1_out(BYTE data)
@@ -29,6 +29,7 @@
  * 18-NOV-2019 initialize command string address array
  * 14-May-2024 remove large disk from disks[] for disk manager, show it as HDD
  * 15-MAY-2024 make disk manager standard
+ * 16-OCT-2026 count sectors for the metrics of the web frontend
  */
 
 #include <unistd.h>
@@ -246,7 +247,6 @@ static void disk_io(int addr)
 	LOGD(TAG, "sector: %02x", getmem(addr + DD_SECTOR));
 	LOGD(TAG, "DMA low: %02x", getmem(addr + DD_DMAL));
 	LOGD(TAG, "DMA high: %02x", getmem(addr + DD_DMAH));
-	LOGD(TAG, "");
 
 	i = dma_read(addr + DD_UNIT);
 	unit = i & 0xf;
@@ -394,6 +394,9 @@ do_format:
 			dma_write(addr + DD_RESULT, 0x93);
 			goto done;
 		}
+#ifdef WANT_METRICS
+		disk_wr_sec++;
+#endif
 		dma_write(addr + DD_RESULT, 1);
 		break;
 
@@ -415,6 +418,9 @@ do_format:
 			dma_write(addr + DD_RESULT, 0x93);
 			goto done;
 		}
+#ifdef WANT_METRICS
+		disk_rd_sec++;
+#endif
 		for (i = 0; i < SEC_SZ; i++)
 			dma_write(dma_addr + i, blksec[i]);
 		dma_write(addr + DD_RESULT, 1);
@@ -436,6 +442,9 @@ do_format:
 				dma_write(addr + DD_RESULT, 0x93);
 				goto done;
 			}
+#ifdef WANT_METRICS
+			disk_wr_sec++;
+#endif
 		}
 		dma_write(addr + DD_RESULT, 1);
 		break;
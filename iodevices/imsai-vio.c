@@ -21,10 +21,14 @@
  * 14-JUL-2018 integrate webfrontend
  * 05-NOV-2019 use correct memory access function
  * 04-JAN-2025 add SDL2 support
+ * 16-OCT-2026 only redraw character cells written since the last frame
+ * 16-OCT-2026 draw characters from a pre-rasterized glyph atlas
+ * 16-OCT-2026 SDL2: frame rate paced by simsdl, only present changed frames
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #ifdef WANT_SDL
 #include <SDL.h>
 #else
@@ -37,13 +41,13 @@
 #include "simdefs.h"
 #include "simglb.h"
 #include "simmem.h"
+#include "simdirty.h"
 #include "simport.h"
 #ifdef WANT_SDL
 #include "simsdl.h"
 #endif
 
 #ifdef HAS_NETSERVER
-#include <string.h>
 #include "netsrv.h"
 #endif
 
@@ -58,6 +62,11 @@ static const char *TAG = "VIO";
 
 #define XOFF		10		/* use some offset inside the window */
 #define YOFF		15		/* for the drawing area */
+#define GW		14		/* max. glyph width */
+#define GH		(20 * 2)	/* max. glyph height with scanlines */
+#define PIX_BLACK	0		/* scanline gap */
+#define PIX_BG		1		/* background */
+#define PIX_FG		2		/* foreground */
 #ifdef WANT_SDL
 #define KEYBUF_LEN	20
 #endif
@@ -76,7 +85,8 @@ static SDL_Renderer *renderer;
 static SDL_Texture *texture;
 static uint8_t *pixels;
 static int pitch;
-static uint8_t color[3];
+static int yorg;			/* first line of locked texture area */
+static bool present;			/* texture changed, present it */
 static char keybuf[KEYBUF_LEN];		/* typeahead buffer */
 static int keyn, keyin, keyout;
 static SDL_mutex *keybuf_mutex;
@@ -89,6 +99,7 @@ static XWindowAttributes wa;
 static Pixmap pixmap;
 static Colormap colormap;
 static XColor black, bg, fg;
+static Pixmap atlas;			/* rasterized character set */
 static char black_color[] = "#000000";	/* black */
 static XEvent event;
 static KeySym key;
@@ -101,6 +112,10 @@ static int mode;		/* video mode written to command port memory */
 static int modebuf;			/* and double buffer for it */
 static int vmode, res;			/* video mode, resolution */
 static bool inv;			/* inverse */
+static int vio_dirty = -1;		/* dirty tracking id for the frame buffer */
+static BYTE dirty[(2048 >> DIRTY_SHIFT) + 1];	/* lines written */
+static BYTE shadow[2048];		/* characters currently displayed */
+static bool full;			/* redraw everything on next refresh */
 #if !defined(WANT_SDL) || defined(HAS_NETSERVER)
 static bool kbd_status;			/* keyboard status */
 static int kbd_data;			/* keyboard data */
@@ -158,6 +173,7 @@ static void open_display(void)
 	colormap = DefaultColormap(display, 0);
 	gc = XCreateGC(display, window, 0, NULL);
 	pixmap = XCreatePixmap(display, rootwindow, xsize, ysize, wa.depth);
+	atlas = XCreatePixmap(display, rootwindow, 16 * GW, 16 * GH, wa.depth);
 
 	XParseColor(display, colormap, black_color, &black);
 	XAllocColor(display, colormap, &black);
@@ -184,6 +200,7 @@ static void close_display(void)
 	SDL_DestroyWindow(window);
 #else
 	XLockDisplay(display);
+	XFreePixmap(display, atlas);
 	XFreePixmap(display, pixmap);
 	XFreeGC(display, gc);
 	XUnlockDisplay(display);
@@ -227,148 +244,116 @@ void imsai_vio_off(void)
 #endif /* !WANT_SDL */
 }
 
+/*
+ * The character set is rasterized into a glyph atlas whenever the
+ * video mode changes, so that a character is drawn with one copy per
+ * glyph scanline (SDL) or with a single blit (X11).
+ */
+static int gw, gh;			/* glyph size in current mode */
 #ifdef WANT_SDL
+static uint32_t atlas[256][GH][GW];	/* rasterized character set */
+#endif
 
-static inline void set_fg_color(void)
+/* get pixel x, y of scaled glyph c dependent on video mode */
+static int glyph_pixel(int c, int x, int y)
 {
-	color[0] = fg_color[0];
-	color[1] = fg_color[1];
-	color[2] = fg_color[2];
-}
+	char bit;
+	bool cinv;
 
-static inline void set_bg_color(void)
-{
-	color[0] = bg_color[0];
-	color[1] = bg_color[1];
-	color[2] = bg_color[2];
-}
+	if (y % slf)
+		return PIX_BLACK;
+	x /= xscale;
+	y = y / slf / yscale;
 
-static inline void draw_point(int x, int y)
-{
-	uint8_t *p = pixels + y * pitch + x * 4;
+	switch (vmode) {
+	case 1:	/* characters 80-FF from bits 0-6, bit 7 = inverse video */
+		bit = charset[(c << 1) & 0xff][y][x];
+		cinv = (c & 128) ? true : false;
+		break;
+	case 2:	/* characters 00-7F from bits 0-6, bit 7 = inverse video */
+		bit = charset[c & 0x7f][y][x];
+		cinv = (c & 128) ? true : false;
+		break;
+	default: /* characters 00-FF, inverse video from command word */
+		bit = charset[c][y][x];
+		cinv = false;
+		break;
+	}
 
-	p[3] = color[0];
-	p[2] = color[1];
-	p[1] = color[2];
-	p[0] = SDL_ALPHA_OPAQUE;
+	return ((bit == 1) == (cinv == inv)) ? PIX_FG : PIX_BG;
 }
 
-#else /* !WANT_SDL */
+#ifdef WANT_SDL
 
-static inline void set_fg_color(void)
+static inline uint32_t rgba(const uint8_t *c)
 {
-	XSetForeground(display, gc, fg.pixel);
+	return ((uint32_t) c[0] << 24) | ((uint32_t) c[1] << 16) |
+	       ((uint32_t) c[2] << 8) | SDL_ALPHA_OPAQUE;
 }
 
-static inline void set_bg_color(void)
+/* rasterize the character set for the current video mode */
+static void build_atlas(void)
 {
-	XSetForeground(display, gc, bg.pixel);
+	register int c, x, y;
+	uint32_t pix[3];
+
+	pix[PIX_BLACK] = SDL_ALPHA_OPAQUE;
+	pix[PIX_BG] = rgba(bg_color);
+	pix[PIX_FG] = rgba(fg_color);
+
+	gw = 7 * xscale;
+	gh = 10 * yscale * slf;
+	for (c = 0; c < 256; c++)
+		for (y = 0; y < gh; y++)
+			for (x = 0; x < gw; x++)
+				atlas[c][y][x] = pix[glyph_pixel(c, x, y)];
 }
 
-static inline void draw_point(int x, int y)
+/* draw character c at sx, sy into the locked texture area */
+static inline void draw_glyph(BYTE c)
 {
-	XDrawPoint(display, pixmap, gc, x, y);
+	register int y;
+	uint8_t *p = pixels + (sy - yorg) * pitch + sx * 4;
+
+	for (y = 0; y < gh; y++, p += pitch)
+		memcpy(p, atlas[c][y], gw * 4);
 }
 
-#endif /* !WANT_SDL */
+#else /* !WANT_SDL */
 
-/* display characters 80-FF from bits 0-6, bit 7 = inverse video */
-static void dc1(BYTE c)
+/* rasterize the character set for the current video mode */
+static void build_atlas(void)
 {
-	register int x, y;
-	bool cinv = (c & 128) ? true : false;
-
-	for (x = 0; x < 7; x++) {
-		for (y = 0; y < 10; y++) {
-			if (charset[(c << 1) & 0xff][y][x] == 1) {
-				if (cinv == inv)
-					set_fg_color();
-				else
-					set_bg_color();
-			} else {
-				if (cinv == inv)
-					set_bg_color();
-				else
-					set_fg_color();
-			}
-			draw_point(sx + (x * xscale), sy + (y * yscale * slf));
-			if (res & 1)
-				draw_point(sx + (x * xscale) + 1,
-					   sy + (y * yscale * slf));
-			if (res & 2)
-				draw_point(sx + (x * xscale),
-					   sy + (y * yscale * slf) + (1 * slf));
-			if ((res & 3) == 3)
-				draw_point(sx + (x * xscale) + 1,
-					   sy + (y * yscale * slf) + (1 * slf));
-		}
-	}
+	register int c, x, y;
+	unsigned long pix[3];
+	XImage *img;
+
+	pix[PIX_BLACK] = black.pixel;
+	pix[PIX_BG] = bg.pixel;
+	pix[PIX_FG] = fg.pixel;
+
+	gw = 7 * xscale;
+	gh = 10 * yscale * slf;
+	img = XGetImage(display, atlas, 0, 0, 16 * GW, 16 * GH, AllPlanes,
+			ZPixmap);
+	for (c = 0; c < 256; c++)
+		for (y = 0; y < gh; y++)
+			for (x = 0; x < gw; x++)
+				XPutPixel(img, (c & 15) * GW + x,
+					  (c >> 4) * GH + y,
+					  pix[glyph_pixel(c, x, y)]);
+	XPutImage(display, atlas, gc, img, 0, 0, 0, 0, 16 * GW, 16 * GH);
+	XDestroyImage(img);
 }
 
-/* display characters 00-7F from bits 0-6, bit 7 = inverse video */
-static void dc2(BYTE c)
+/* draw character c at sx, sy into the pixmap */
+static inline void draw_glyph(BYTE c)
 {
-	register int x, y;
-	bool cinv = (c & 128) ? true : false;
-
-	for (x = 0; x < 7; x++) {
-		for (y = 0; y < 10; y++) {
-			if (charset[c & 0x7f][y][x] == 1) {
-				if (cinv == inv)
-					set_fg_color();
-				else
-					set_bg_color();
-			} else {
-				if (cinv == inv)
-					set_bg_color();
-				else
-					set_fg_color();
-			}
-			draw_point(sx + (x * xscale), sy + (y * yscale * slf));
-			if (res & 1)
-				draw_point(sx + (x * xscale) + 1,
-					   sy + (y * yscale * slf));
-			if (res & 2)
-				draw_point(sx + (x * xscale),
-					   sy + (y * yscale * slf) + (1 * slf));
-			if ((res & 3) == 3)
-				draw_point(sx + (x * xscale) + 1,
-					   sy + (y * yscale * slf) + (1 * slf));
-		}
-	}
+	XCopyArea(display, atlas, pixmap, gc, (c & 15) * GW, (c >> 4) * GH,
+		  gw, gh, sx, sy);
 }
 
-/* display characters 00-FF from bits 0-7, inverse video from command word */
-static void dc3(BYTE c)
-{
-	register int x, y;
-
-	for (x = 0; x < 7; x++) {
-		for (y = 0; y < 10; y++) {
-			if (charset[c][y][x] == 1) {
-				if (!inv)
-					set_fg_color();
-				else
-					set_bg_color();
-			} else {
-				if (!inv)
-					set_bg_color();
-				else
-					set_fg_color();
-			}
-			draw_point(sx + (x * xscale), sy + (y * yscale * slf));
-			if (res & 1)
-				draw_point(sx + (x * xscale) + 1,
-					   sy + (y * yscale * slf));
-			if (res & 2)
-				draw_point(sx + (x * xscale),
-					   sy + (y * yscale * slf) + (1 * slf));
-			if ((res & 3) == 3)
-				draw_point(sx + (x * xscale) + 1,
-					   sy + (y * yscale * slf) + (1 * slf));
-		}
-	}
-}
+#endif /* !WANT_SDL */
 
 #ifdef WANT_SDL
 
@@ -407,6 +392,9 @@ static void process_event(SDL_Event *event)
 			case SDL_WINDOWEVENT_FOCUS_LOST:
 				SDL_StopTextInput();
 				break;
+			case SDL_WINDOWEVENT_EXPOSED:
+				present = true;
+				break;
 			default:
 				break;
 			}
@@ -484,6 +472,11 @@ static void refresh(void)
 	static int cols, rows;
 	static BYTE c;
 	register int x, y;
+	int addr, h;
+	bool all;
+#ifdef WANT_SDL
+	SDL_Rect rect;
+#endif
 
 	sx = XOFF;
 	sy = YOFF;
@@ -491,6 +484,7 @@ static void refresh(void)
 	mode = getmem(0xf7ff);
 	if (mode != modebuf) {
 		modebuf = mode;
+		full = true;
 
 		vmode = (mode >> 2) & 3;
 		res = mode & 3;
@@ -511,10 +505,12 @@ static void refresh(void)
 			rows = 24;
 			yscale = 1;
 		}
+
+		if (vmode != 0)
+			build_atlas();
 	}
 
-	switch (vmode) {
-	case 0:	/* Video mode 0: video off, screen blanked */
+	if (vmode == 0) { /* Video mode 0: video off, screen blanked */
 #if !defined(WANT_SDL) || defined(HAS_NETSERVER)
 		event_handler();
 #endif
@@ -525,53 +521,58 @@ static void refresh(void)
 		XSetForeground(display, gc, black.pixel);
 		XFillRectangle(display, pixmap, gc, 0, 0, xsize, ysize);
 #endif
-		break;
-
-	case 1: /* Video mode 1: display character codes 80-FF */
-		for (y = 0; y < rows; y++) {
-			sx = XOFF;
-#if !defined(WANT_SDL) || defined(HAS_NETSERVER)
-			event_handler();
+		full = true;
+#ifdef WANT_SDL
+		present = true;
 #endif
-			for (x = 0; x < cols; x++) {
-				c = getmem(0xf000 + (y * cols) + x);
-				dc1(c);
-				sx += (res & 1) ? 14 : 7;
-			}
-			sy += (res & 2) ? 20 * slf : 10 * slf;
-		}
-		break;
+		return;
+	}
 
-	case 2:	/* Video mode 2: display character codes 00-7F */
-		for (y = 0; y < rows; y++) {
-			sx = XOFF;
+	/* only rows with writes into them since the last frame are drawn */
+	if (!dirty_collect(vio_dirty, dirty) && !full && vio_dirty >= 0) {
 #if !defined(WANT_SDL) || defined(HAS_NETSERVER)
-			event_handler();
+		event_handler();
+#endif
+		return;
+	}
+	if (vio_dirty < 0)
+		full = true;
+#ifdef WANT_SDL
+	present = true;
 #endif
-			for (x = 0; x < cols; x++) {
-				c = getmem(0xf000 + (y * cols) + x);
-				dc2(c);
-				sx += (res & 1) ? 14 : 7;
-			}
-			sy += (res & 2) ? 20 * slf : 10 * slf;
-		}
-		break;
 
-	case 3:	/* Video mode 3: display character codes 00-FF */
-		for (y = 0; y < rows; y++) {
-			sx = XOFF;
+	h = (res & 2) ? 20 * slf : 10 * slf;
+	for (y = 0; y < rows; y++, sy += h) {
+		sx = XOFF;
 #if !defined(WANT_SDL) || defined(HAS_NETSERVER)
-			event_handler();
+		event_handler();
+#endif
+		addr = y * cols;
+		if (!full && !dirty_check(dirty, 0xf000, 0xf000 + addr, cols))
+			continue;
+		all = full;
+#ifdef WANT_SDL
+		/* locked texture contents are undefined, draw whole row */
+		rect.x = 0;
+		rect.y = yorg = sy;
+		rect.w = xsize;
+		rect.h = h;
+		SDL_LockTexture(texture, &rect, (void **) &pixels, &pitch);
+		all = true;
 #endif
-			for (x = 0; x < cols; x++) {
-				c = getmem(0xf000 + (y * cols) + x);
-				dc3(c);
-				sx += (res & 1) ? 14 : 7;
+		for (x = 0; x < cols; x++, addr++) {
+			c = getmem(0xf000 + addr);
+			if (all || c != shadow[addr]) {
+				shadow[addr] = c;
+				draw_glyph(c);
 			}
-			sy += (res & 2) ? 20 * slf : 10 * slf;
+			sx += (res & 1) ? 14 : 7;
 		}
-		break;
+#ifdef WANT_SDL
+		SDL_UnlockTexture(texture);
+#endif
 	}
+	full = false;
 }
 
 #ifdef HAS_NETSERVER
@@ -613,10 +614,16 @@ static void ws_refresh(void)
 		msg.addr = 0xf7ff;
 		net_device_send(DEV_VIO, (char *) &msg, 4);
 		LOGD(__func__, "MODE change");
+		full = true;
 	}
 
 	event_handler();
 
+	if (!dirty_collect(vio_dirty, dirty) && !full && vio_dirty >= 0)
+		return;
+	if (vio_dirty < 0)
+		full = true;
+
 	int len = rows * cols;
 	int addr;
 	int i, n, x;
@@ -624,6 +631,11 @@ static void ws_refresh(void)
 	uint8_t val;
 
 	for (i = 0; i < len; i++) {
+		/* skip lines not written since the last update */
+		if (!full && !dirty[i >> DIRTY_SHIFT]) {
+			i |= (1 << DIRTY_SHIFT) - 1;
+			continue;
+		}
 		addr = i;
 		n = 0;
 		cont = true;
@@ -661,6 +673,7 @@ static void ws_refresh(void)
 			     msg.addr, msg.addr + msg.len);
 		}
 	}
+	full = false;
 }
 #endif /* HAS_NETSERVER */
 
@@ -670,19 +683,21 @@ static void update_display(bool tick)
 {
 	UNUSED(tick);
 
-	/* update display window */
-	SDL_LockTexture(texture, NULL, (void **) &pixels, &pitch);
+	/* update display window, if anything was drawn */
 	refresh();
-	SDL_UnlockTexture(texture);
-	SDL_RenderCopy(renderer, texture, NULL, NULL);
-	SDL_RenderPresent(renderer);
+	if (present) {
+		present = false;
+		SDL_RenderCopy(renderer, texture, NULL, NULL);
+		SDL_RenderPresent(renderer);
+	}
 }
 
 static win_funcs_t vio_funcs = {
 	open_display,
 	close_display,
 	process_event,
-	update_display
+	update_display,
+	30
 };
 #endif /* !WANT_SDL */
 
@@ -752,6 +767,9 @@ void imsai_vio_init(void)
 
 	state = true;
 	modebuf = -1;
+	if (vio_dirty < 0)
+		vio_dirty = dirty_alloc();
+	dirty_range(vio_dirty, 0xf000, 2048);
 	putmem(0xf7ff, 0x00);
 
 #if defined(WANT_SDL) && defined(HAS_NETSERVER)
@@ -15,10 +15,14 @@
  * 15-JUL-2018 use logging
  * 04-NOV-2019 eliminate usage of mem_base()
  * 03-JAN-2025 use SDL2 instead of X11
+ * 16-OCT-2026 only redraw character cells written since the last frame
+ * 16-OCT-2026 draw characters from a pre-rasterized glyph atlas
+ * 16-OCT-2026 SDL2: frame rate paced by simsdl, only present changed frames
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #ifdef WANT_SDL
 #include <SDL.h>
 #else
@@ -32,6 +36,7 @@
 #include "simdefs.h"
 #include "simglb.h"
 #include "simmem.h"
+#include "simdirty.h"
 #include "simport.h"
 #ifdef WANT_SDL
 #include "simsdl.h"
@@ -47,6 +52,8 @@ static const char *TAG = "VDM";
 
 #define XOFF		10		/* use some offset inside the window */
 #define YOFF		15		/* for the drawing area */
+#define GW		9		/* glyph width */
+#define GH		(13 * 2)	/* max. glyph height with scanlines */
 #ifdef WANT_SDL
 #define KEYBUF_LEN	20		/* typeahead buffer size */
 #endif
@@ -64,7 +71,8 @@ static SDL_Renderer *renderer;
 static SDL_Texture *texture;
 static uint8_t *pixels;
 static int pitch;
-static uint8_t color[3];
+static int yorg;			/* first line of locked texture area */
+static bool present;			/* texture changed, present it */
 static char keybuf[KEYBUF_LEN];		/* typeahead buffer */
 static int keyn, keyin, keyout;
 static SDL_mutex *keybuf_mutex;
@@ -77,6 +85,7 @@ static XWindowAttributes wa;
 static Pixmap pixmap;
 static Colormap colormap;
 static XColor black, bg, fg;
+static Pixmap atlas;			/* rasterized character set */
 static char black_color[] = "#000000";	/* black */
 static XEvent event;
 static KeySym key;
@@ -92,12 +101,18 @@ static int kbd_data;			/* keyboard data */
 #endif
 static int first;			/* first displayed screen position */
 static int beg;				/* beginning display line address */
+static int modebuf = -1;		/* mode of the displayed frame */
+static int vdm_dirty = -1;		/* dirty tracking id for the frame buffer */
+static BYTE dirty[(1024 >> DIRTY_SHIFT) + 1];	/* lines written */
+static BYTE shadow[16][64];		/* characters currently displayed */
 
 #ifndef WANT_SDL
 /* UNIX stuff */
 static pthread_t thread;
 #endif
 
+static void build_atlas(void);
+
 /* create the SDL2 or X11 window for VDM display */
 static void open_display(void)
 {
@@ -115,6 +130,7 @@ static void open_display(void)
 				    SDL_TEXTUREACCESS_STREAMING, xsize, ysize);
 
 	keybuf_mutex = SDL_CreateMutex();
+	build_atlas();
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
 	SDL_RenderClear(renderer);
 	SDL_RenderPresent(renderer);
@@ -147,6 +163,7 @@ static void open_display(void)
 	colormap = DefaultColormap(display, 0);
 	gc = XCreateGC(display, window, 0, NULL);
 	pixmap = XCreatePixmap(display, rootwindow, xsize, ysize, wa.depth);
+	atlas = XCreatePixmap(display, rootwindow, 16 * GW, 16 * GH, wa.depth);
 
 	XParseColor(display, colormap, black_color, &black);
 	XAllocColor(display, colormap, &black);
@@ -160,6 +177,7 @@ static void open_display(void)
 	XMapWindow(display, window);
 	XSetForeground(display, gc, black.pixel);
 	XFillRectangle(display, pixmap, gc, 0, 0, xsize, ysize);
+	build_atlas();
 	XSync(display, True);
 	XUnlockDisplay(display);
 #endif /* !WANT_SDL */
@@ -175,6 +193,7 @@ static void close_display(void)
 	SDL_DestroyWindow(window);
 #else
 	XLockDisplay(display);
+	XFreePixmap(display, atlas);
 	XFreePixmap(display, pixmap);
 	XFreeGC(display, gc);
 	XUnlockDisplay(display);
@@ -242,6 +261,9 @@ static void process_event(SDL_Event *event)
 			case SDL_WINDOWEVENT_FOCUS_LOST:
 				SDL_StopTextInput();
 				break;
+			case SDL_WINDOWEVENT_EXPOSED:
+				present = true;
+				break;
 			default:
 				break;
 			}
@@ -264,30 +286,6 @@ static void process_event(SDL_Event *event)
 	}
 }
 
-static inline void set_fg_color(void)
-{
-	color[0] = fg_color[0];
-	color[1] = fg_color[1];
-	color[2] = fg_color[2];
-}
-
-static inline void set_bg_color(void)
-{
-	color[0] = bg_color[0];
-	color[1] = bg_color[1];
-	color[2] = bg_color[2];
-}
-
-static inline void draw_point(int x, int y)
-{
-	uint8_t *p = pixels + y * pitch + x * 4;
-
-	p[3] = color[0];
-	p[2] = color[1];
-	p[1] = color[2];
-	p[0] = SDL_ALPHA_OPAQUE;
-}
-
 #else /* !WANT_SDL */
 
 /*
@@ -313,53 +311,122 @@ static inline void event_handler(void)
 	}
 }
 
-static inline void set_fg_color(void)
+#endif /* !WANT_SDL */
+
+/*
+ * The character set is rasterized once into a glyph atlas with 256
+ * entries, the upper half inverse, so that a character is drawn with
+ * one copy per glyph scanline (SDL) or with a single blit (X11).
+ */
+static int gh;				/* glyph height with scanlines */
+#ifdef WANT_SDL
+static uint32_t atlas[256][GH][GW];	/* rasterized character set */
+#endif
+
+/* get pixel x, y of glyph c, 0 = scanline gap, 1 = bg, 2 = fg */
+static int glyph_pixel(int c, int x, int y)
+{
+	bool inv = (c & 128) ? true : false;
+
+	if (y % slf)
+		return 0;
+
+	return ((charset[c & 0x7f][y / slf][x] == 1) != inv) ? 2 : 1;
+}
+
+#ifdef WANT_SDL
+
+static inline uint32_t rgba(const uint8_t *c)
 {
-	XSetForeground(display, gc, fg.pixel);
+	return ((uint32_t) c[0] << 24) | ((uint32_t) c[1] << 16) |
+	       ((uint32_t) c[2] << 8) | SDL_ALPHA_OPAQUE;
 }
 
-static inline void set_bg_color(void)
+/* rasterize the character set */
+static void build_atlas(void)
 {
-	XSetForeground(display, gc, bg.pixel);
+	register int c, x, y;
+	uint32_t pix[3];
+
+	pix[0] = SDL_ALPHA_OPAQUE;
+	pix[1] = rgba(bg_color);
+	pix[2] = rgba(fg_color);
+
+	gh = 13 * slf;
+	for (c = 0; c < 256; c++)
+		for (y = 0; y < gh; y++)
+			for (x = 0; x < GW; x++)
+				atlas[c][y][x] = pix[glyph_pixel(c, x, y)];
 }
 
-static inline void draw_point(int x, int y)
+/* draw character c at sx, sy into the locked texture area */
+static inline void draw_glyph(BYTE c)
 {
-	XDrawPoint(display, pixmap, gc, x, y);
+	register int y;
+	uint8_t *p = pixels + (sy - yorg) * pitch + sx * 4;
+
+	for (y = 0; y < gh; y++, p += pitch)
+		memcpy(p, atlas[c][y], GW * 4);
 }
 
-#endif /* !WANT_SDL */
+#else /* !WANT_SDL */
 
-/* display characters, bit 7 = inverse video */
-static void dc(BYTE c)
+/* rasterize the character set */
+static void build_atlas(void)
 {
-	register int x, y;
-	bool inv = (c & 128) ? true : false;
+	register int c, x, y;
+	unsigned long pix[3];
+	XImage *img;
+
+	pix[0] = black.pixel;
+	pix[1] = bg.pixel;
+	pix[2] = fg.pixel;
+
+	gh = 13 * slf;
+	img = XGetImage(display, atlas, 0, 0, 16 * GW, 16 * GH, AllPlanes,
+			ZPixmap);
+	for (c = 0; c < 256; c++)
+		for (y = 0; y < gh; y++)
+			for (x = 0; x < GW; x++)
+				XPutPixel(img, (c & 15) * GW + x,
+					  (c >> 4) * GH + y,
+					  pix[glyph_pixel(c, x, y)]);
+	XPutImage(display, atlas, gc, img, 0, 0, 0, 0, 16 * GW, 16 * GH);
+	XDestroyImage(img);
+}
 
-	for (x = 0; x < 9; x++) {
-		for (y = 0; y < 13; y++) {
-			if (charset[c & 0x7f][y][x] == 1) {
-				if (!inv)
-					set_fg_color();
-				else
-					set_bg_color();
-			} else {
-				if (!inv)
-					set_bg_color();
-				else
-					set_fg_color();
-			}
-			draw_point(sx + x, sy + (y * slf));
-		}
-	}
+/* draw character c at sx, sy into the pixmap */
+static inline void draw_glyph(BYTE c)
+{
+	XCopyArea(display, atlas, pixmap, gc, (c & 15) * GW, (c >> 4) * GH,
+		  GW, gh, sx, sy);
 }
 
+#endif /* !WANT_SDL */
+
 /* refresh the display buffer */
 static void refresh(void)
 {
 	register int x, y;
 	static int addr;
 	static BYTE c;
+	bool full, all;
+#ifdef WANT_SDL
+	SDL_Rect rect;
+#endif
+
+	/* only rows with writes into them since the last frame are drawn */
+	full = (mode != modebuf || vdm_dirty < 0);
+	if (!dirty_collect(vdm_dirty, dirty) && !full) {
+#ifndef WANT_SDL
+		event_handler();
+#endif
+		return;
+	}
+	modebuf = mode;
+#ifdef WANT_SDL
+	present = true;
+#endif
 
 	sy = YOFF;
 	addr = 0xcc00 + beg * 64;
@@ -369,13 +436,30 @@ static void refresh(void)
 #ifndef WANT_SDL
 		event_handler();
 #endif
-		for (x = 0; x < 64; x++) {
-			if (y >= first) {
-				c = getmem(addr + x);
-				dc(c);
-			} else
-				dc(' ');
-			sx += 9;
+		if (full || (y >= first &&
+			     dirty_check(dirty, 0xcc00, addr, 64))) {
+			all = full;
+#ifdef WANT_SDL
+			/* locked texture is undefined, draw whole row */
+			rect.x = 0;
+			rect.y = yorg = sy;
+			rect.w = xsize;
+			rect.h = 13 * slf;
+			SDL_LockTexture(texture, &rect, (void **) &pixels,
+					&pitch);
+			all = true;
+#endif
+			for (x = 0; x < 64; x++) {
+				c = (y >= first) ? getmem(addr + x) : ' ';
+				if (all || c != shadow[y][x]) {
+					shadow[y][x] = c;
+					draw_glyph(c);
+				}
+				sx += 9;
+			}
+#ifdef WANT_SDL
+			SDL_UnlockTexture(texture);
+#endif
 		}
 		sy += 13 * slf;
 		addr += 64;
@@ -392,12 +476,13 @@ static void update_display(bool tick)
 	UNUSED(tick);
 
 	if (state) {
-		/* update display window */
-		SDL_LockTexture(texture, NULL, (void **) &pixels, &pitch);
+		/* update display window, if anything was drawn */
 		refresh();
-		SDL_UnlockTexture(texture);
-		SDL_RenderCopy(renderer, texture, NULL, NULL);
-		SDL_RenderPresent(renderer);
+		if (present) {
+			present = false;
+			SDL_RenderCopy(renderer, texture, NULL, NULL);
+			SDL_RenderPresent(renderer);
+		}
 	}
 }
 
@@ -405,7 +490,8 @@ static win_funcs_t proctec_funcs = {
 	open_display,
 	close_display,
 	process_event,
-	update_display
+	update_display,
+	30
 };
 
 #else /* !WANT_SDL */
@@ -457,11 +543,19 @@ void proctec_vdm_ctl_out(BYTE data)
 
 	state = true;
 
+	if (vdm_dirty < 0) {
+		vdm_dirty = dirty_alloc();
+		dirty_range(vdm_dirty, 0xcc00, 1024);
+	}
+
 #ifdef WANT_SDL
-	if (proctec_win_id < 0)
+	if (proctec_win_id < 0) {
+		modebuf = -1;
 		proctec_win_id = simsdl_create(&proctec_funcs);
+	}
 #else
 	if (display == 0) {
+		modebuf = -1;
 		open_display();
 
 		if (pthread_create(&thread, NULL, update_display, (void *) NULL)) {
@@ -0,0 +1,587 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Common I/O devices used by various simulated machines
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ *
+ * This module implements a non-blocking connection manager for
+ * TCP/IP (telnet) consoles.
+ *
+ * All socket I/O, including accepting connections and the telnet
+ * option negotiation, is done by a separate thread. The CPU thread
+ * only exchanges data with per session ring buffers, so neither
+ * a connection setup nor a stalled client can block the emulation.
+ *
+ * Several consoles may be configured with the same TCP/IP port,
+ * a new connection then is attached to the first free console
+ * of this group.
+ *
+ * History:
+ * 16-OCT-2026 first version, replaces the SIGIO console accept code
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "sim.h"
+#include "simdefs.h"
+
+#include "libtelnet.h"
+#include "unix_netcon.h"
+
+/* #define LOG_LOCAL_LEVEL LOG_DEBUG */
+#include "log.h"
+static const char *TAG = "netcon";
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0	/* SO_NOSIGPIPE is set on the socket instead */
+#ifndef SO_NOSIGPIPE
+#define NETCON_IGNPIPE	/* neither, SIGPIPE is ignored */
+#endif
+#endif
+
+/* encoded output, worst case every byte is an IAC which gets doubled */
+#define NETCON_TXSIZE	(NETCON_BUFSIZE * 2 + 64)
+#define NETCON_TXRSV	64	/* reserved for telnet negotiation */
+
+typedef struct netcon_ring {
+	BYTE data[NETCON_BUFSIZE];
+	unsigned int head;	/* next position to write */
+	unsigned int tail;	/* next position to read */
+} netcon_ring_t;
+
+#define RING_CNT(r)	((r)->head - (r)->tail)
+#define RING_FREE(r)	(NETCON_BUFSIZE - RING_CNT(r))
+#define RING_IDX(n)	((n) & (NETCON_BUFSIZE - 1))
+
+typedef struct netcon {
+	int port;		/* TCP/IP port, 0 = console not configured */
+	bool telnet;		/* telnet protocol flag */
+	int lsn;		/* index of the listening socket */
+	int fd;			/* connected socket descriptor, 0 = none */
+	telnet_t *tn;		/* telnet state of the session */
+	bool cr;		/* last received character was a CR */
+	bool error;		/* telnet protocol error, close session */
+	netcon_ring_t rx;	/* network -> CPU */
+	netcon_ring_t tx;	/* CPU -> network */
+	BYTE txbuf[NETCON_TXSIZE]; /* encoded data not yet sent */
+	size_t txlen;
+} netcon_t;
+
+typedef struct netcon_lsn {
+	int port;		/* TCP/IP port */
+	int fd;			/* listening socket descriptor */
+} netcon_lsn_t;
+
+static netcon_t cons[NETCON_MAX];
+static netcon_lsn_t lsns[NETCON_MAX];
+static int nlsns;
+
+static pthread_t thread;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static int wake[2] = { -1, -1 };	/* pipe to wake up the thread */
+static volatile bool quit;
+
+/* telnet options we offer, everything else gets rejected */
+static const telnet_telopt_t telopts[] = {
+	{ TELNET_TELOPT_ECHO, TELNET_WILL, TELNET_DONT },
+	{ TELNET_TELOPT_SGA,  TELNET_WILL, TELNET_DO   },
+	{ -1, 0, 0 }
+};
+
+/*
+ *	wake up the network thread, called from the CPU thread
+ */
+static void netcon_wake(void)
+{
+	BYTE c = 0;
+
+	if (write(wake[1], &c, 1) != 1 && errno != EAGAIN)
+		LOGW(TAG, "can't wake network thread");
+}
+
+/*
+ *	store received data in the input buffer of a console,
+ *	with telnet CR LF and CR NUL are reduced to CR
+ */
+static void netcon_receive(netcon_t *c, const BYTE *buf, size_t len)
+{
+	size_t i;
+
+	pthread_mutex_lock(&mutex);
+	for (i = 0; i < len; i++) {
+		if (c->telnet && c->cr) {
+			c->cr = false;
+			if (buf[i] == '\n' || buf[i] == '\0')
+				continue;
+		}
+		c->cr = (buf[i] == '\r');
+		if (RING_FREE(&c->rx) == 0) {
+			LOGW(TAG, "input buffer overrun on port %d", c->port);
+			break;
+		}
+		c->rx.data[RING_IDX(c->rx.head++)] = buf[i];
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+/*
+ *	libtelnet event handler, runs in the network thread
+ */
+static void netcon_telnet_hdlr(telnet_t *tn, telnet_event_t *ev,
+			       void *user_data)
+{
+	netcon_t *c = (netcon_t *) user_data;
+
+	UNUSED(tn);
+
+	switch (ev->type) {
+	case TELNET_EV_DATA:
+		netcon_receive(c, (const BYTE *) ev->data.buffer,
+			       ev->data.size);
+		break;
+	case TELNET_EV_SEND:
+		if (c->txlen + ev->data.size > NETCON_TXSIZE) {
+			LOGW(TAG, "telnet output overrun on port %d", c->port);
+			break;
+		}
+		memcpy(c->txbuf + c->txlen, ev->data.buffer, ev->data.size);
+		c->txlen += ev->data.size;
+		break;
+	case TELNET_EV_WILL:
+	case TELNET_EV_WONT:
+	case TELNET_EV_DO:
+	case TELNET_EV_DONT:
+		LOGD(TAG, "telnet: %d %d", ev->type, ev->neg.telopt);
+		break;
+	case TELNET_EV_ERROR:
+		LOGW(TAG, "telnet: %s", ev->error.msg);
+		c->error = true;
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ *	accept a connection on a listening socket and attach it
+ *	to the first free console configured for this port
+ */
+static void netcon_accept(int l)
+{
+	struct sockaddr_in fsin;
+	socklen_t alen = sizeof(fsin);
+	netcon_t *c;
+	int fd, i, on = 1;
+
+	if ((fd = accept(lsns[l].fd, (struct sockaddr *) &fsin, &alen)) == -1) {
+		if (errno != EAGAIN && errno != EINTR)
+			LOGW(TAG, "can't accept on server socket");
+		return;
+	}
+
+	for (i = 0, c = NULL; i < NETCON_MAX; i++)
+		if (cons[i].port && cons[i].lsn == l && cons[i].fd == 0) {
+			c = &cons[i];
+			break;
+		}
+	if (c == NULL) {
+		LOGI(TAG, "no free console on port %d, connection refused",
+		     lsns[l].port);
+		close(fd);
+		return;
+	}
+
+	if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) == -1)
+		LOGW(TAG, "can't fcntl O_NONBLOCK on server socket");
+	if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void *) &on,
+		       sizeof(on)) == -1)
+		LOGW(TAG, "can't setsockopt TCP_NODELAY on server socket");
+#ifdef SO_NOSIGPIPE
+	/* no MSG_NOSIGNAL, don't get killed by a client which went away */
+	if (setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, (void *) &on,
+		       sizeof(on)) == -1)
+		LOGW(TAG, "can't setsockopt SO_NOSIGPIPE on server socket");
+#endif
+
+	/* the CPU doesn't look at the buffers until fd is set */
+	c->rx.head = c->rx.tail = 0;
+	c->tx.head = c->tx.tail = 0;
+	c->txlen = 0;
+	c->cr = false;
+	c->error = false;
+
+	/* the option negotiation is completed asynchronously */
+	if (c->telnet) {
+		if ((c->tn = telnet_init(telopts, netcon_telnet_hdlr, 0,
+					 c)) == NULL) {
+			LOGE(TAG, "can't initialize telnet session");
+			close(fd);
+			return;
+		}
+		telnet_negotiate(c->tn, TELNET_WILL, TELNET_TELOPT_SGA);
+		telnet_negotiate(c->tn, TELNET_WILL, TELNET_TELOPT_ECHO);
+	}
+
+	pthread_mutex_lock(&mutex);
+	c->fd = fd;
+	pthread_mutex_unlock(&mutex);
+
+	LOGI(TAG, "console %d connected on port %d", i + 1, c->port);
+}
+
+/*
+ *	close the connection of a console
+ */
+static void netcon_close(netcon_t *c)
+{
+	int fd;
+
+	pthread_mutex_lock(&mutex);
+	fd = c->fd;
+	c->fd = 0;
+	pthread_mutex_unlock(&mutex);
+
+	if (c->tn != NULL) {
+		telnet_free(c->tn);
+		c->tn = NULL;
+	}
+	close(fd);
+
+	LOGI(TAG, "console %d disconnected", (int) (c - cons) + 1);
+}
+
+/*
+ *	move queued output into the transmit buffer and send as much
+ *	as the socket accepts, returns false if the connection failed
+ */
+static bool netcon_flush(netcon_t *c)
+{
+	BYTE buf[NETCON_BUFSIZE];
+	unsigned int i, n;
+	ssize_t r;
+
+	pthread_mutex_lock(&mutex);
+	n = RING_CNT(&c->tx);
+	if (c->txlen + NETCON_TXRSV >= NETCON_TXSIZE)
+		n = 0;
+	else if (n > (NETCON_TXSIZE - NETCON_TXRSV - c->txlen) / 2)
+		n = (NETCON_TXSIZE - NETCON_TXRSV - c->txlen) / 2;
+	for (i = 0; i < n; i++)
+		buf[i] = c->tx.data[RING_IDX(c->tx.tail++)];
+	pthread_mutex_unlock(&mutex);
+
+	if (n > 0) {
+		if (c->tn != NULL)
+			telnet_send(c->tn, (const char *) buf, n);
+		else {
+			memcpy(c->txbuf + c->txlen, buf, n);
+			c->txlen += n;
+		}
+	}
+
+	if (c->txlen == 0)
+		return true;
+
+	r = send(c->fd, c->txbuf, c->txlen, MSG_NOSIGNAL);
+	if (r < 0)
+		return (errno == EAGAIN || errno == EWOULDBLOCK ||
+			errno == EINTR);
+	c->txlen -= r;
+	if (c->txlen > 0)
+		memmove(c->txbuf, c->txbuf + r, c->txlen);
+	return true;
+}
+
+/*
+ *	read from a connected socket into the input buffer,
+ *	returns false if the connection was closed
+ */
+static bool netcon_input(netcon_t *c)
+{
+	BYTE buf[NETCON_BUFSIZE];
+	size_t n;
+	ssize_t r;
+
+	/* telnet decoding never expands the data */
+	pthread_mutex_lock(&mutex);
+	n = RING_FREE(&c->rx);
+	pthread_mutex_unlock(&mutex);
+	if (n == 0)
+		return true;
+
+	r = recv(c->fd, buf, n, 0);
+	if (r == 0)
+		return false;
+	if (r < 0)
+		return (errno == EAGAIN || errno == EWOULDBLOCK ||
+			errno == EINTR);
+
+	if (c->tn != NULL) {
+		telnet_recv(c->tn, (const char *) buf, r);
+		return !c->error;
+	}
+	netcon_receive(c, buf, r);
+	return true;
+}
+
+/*
+ *	network thread, multiplexes all listening and connected sockets
+ */
+static void *netcon_thread(void *arg)
+{
+	struct pollfd p[1 + NETCON_MAX * 2];
+	netcon_t *pc[1 + NETCON_MAX * 2];
+	BYTE drain[64];
+	netcon_t *c;
+	int i, n;
+
+	UNUSED(arg);
+
+	while (!quit) {
+		n = 0;
+		p[n].fd = wake[0];
+		p[n].events = POLLIN;
+		pc[n++] = NULL;
+		for (i = 0; i < nlsns; i++) {
+			p[n].fd = lsns[i].fd;
+			p[n].events = POLLIN;
+			pc[n++] = NULL;
+		}
+		for (i = 0; i < NETCON_MAX; i++) {
+			c = &cons[i];
+			if (c->fd == 0)
+				continue;
+			if (!netcon_flush(c)) {
+				netcon_close(c);
+				continue;
+			}
+			p[n].fd = c->fd;
+			pthread_mutex_lock(&mutex);
+			p[n].events = (RING_FREE(&c->rx) > 0) ? POLLIN : 0;
+			if (c->txlen > 0 || RING_CNT(&c->tx) > 0)
+				p[n].events |= POLLOUT;
+			pthread_mutex_unlock(&mutex);
+			pc[n++] = c;
+		}
+		for (i = 0; i < n; i++)
+			p[i].revents = 0;
+
+		if (poll(p, n, -1) == -1) {
+			if (errno != EINTR)
+				LOGW(TAG, "poll failed");
+			continue;
+		}
+
+		if (p[0].revents & POLLIN)
+			while (read(wake[0], drain, sizeof(drain)) > 0)
+				;
+		for (i = 1; i <= nlsns; i++)
+			if (p[i].revents & POLLIN)
+				netcon_accept(i - 1);
+		for (; i < n; i++) {
+			c = pc[i];
+			if (p[i].revents & POLLIN) {
+				if (!netcon_input(c)) {
+					netcon_close(c);
+					continue;
+				}
+			} else if (p[i].revents & (POLLHUP | POLLERR)) {
+				netcon_close(c);
+				continue;
+			}
+			if ((p[i].revents & POLLOUT) && !netcon_flush(c))
+				netcon_close(c);
+		}
+	}
+
+	pthread_exit(NULL);
+}
+
+/*
+ *	configure a network console (0 based) for a TCP/IP port,
+ *	consoles sharing a port are assigned to connections in order
+ */
+bool netcon_add(int con, int port, bool telnet)
+{
+	int i;
+
+	if (con < 0 || con >= NETCON_MAX || port <= 0 || port > 65535)
+		return false;
+
+	for (i = 0; i < nlsns; i++)
+		if (lsns[i].port == port)
+			break;
+	if (i == nlsns)
+		lsns[nlsns++].port = port;
+
+	cons[con].port = port;
+	cons[con].telnet = telnet;
+	cons[con].lsn = i;
+	return true;
+}
+
+/*
+ *	create the listening sockets and start the network thread
+ */
+void netcon_start(void)
+{
+	struct sockaddr_in sin;
+	int i, on = 1;
+
+	if (nlsns == 0)
+		return;
+
+#ifdef NETCON_IGNPIPE
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	for (i = 0; i < nlsns; i++) {
+		if ((lsns[i].fd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
+			LOGE(TAG, "can't create server socket");
+			exit(EXIT_FAILURE);
+		}
+		if (setsockopt(lsns[i].fd, SOL_SOCKET, SO_REUSEADDR,
+			       (void *) &on, sizeof(on)) == -1) {
+			LOGE(TAG, "can't setsockopt SO_REUSEADDR on server socket");
+			exit(EXIT_FAILURE);
+		}
+		if (fcntl(lsns[i].fd, F_SETFL,
+			  fcntl(lsns[i].fd, F_GETFL, 0) | O_NONBLOCK) == -1) {
+			LOGE(TAG, "can't fcntl O_NONBLOCK on server socket");
+			exit(EXIT_FAILURE);
+		}
+		memset((void *) &sin, 0, sizeof(sin));
+		sin.sin_family = AF_INET;
+		sin.sin_addr.s_addr = INADDR_ANY;
+		sin.sin_port = htons(lsns[i].port);
+		if (bind(lsns[i].fd, (struct sockaddr *) &sin,
+			 sizeof(sin)) == -1) {
+			LOGE(TAG, "can't bind server socket");
+			exit(EXIT_FAILURE);
+		}
+		if (listen(lsns[i].fd, NETCON_MAX) == -1) {
+			LOGE(TAG, "can't listen on server socket");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (pipe(wake) == -1) {
+		LOGE(TAG, "can't create pipe");
+		exit(EXIT_FAILURE);
+	}
+	fcntl(wake[0], F_SETFL, fcntl(wake[0], F_GETFL, 0) | O_NONBLOCK);
+	fcntl(wake[1], F_SETFL, fcntl(wake[1], F_GETFL, 0) | O_NONBLOCK);
+
+	quit = false;
+	if (pthread_create(&thread, NULL, netcon_thread, NULL)) {
+		LOGE(TAG, "can't create thread");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ *	stop the network thread and close all sockets
+ */
+void netcon_stop(void)
+{
+	int i;
+
+	if (thread == 0)
+		return;
+
+	quit = true;
+	netcon_wake();
+	pthread_join(thread, NULL);
+	thread = 0;
+
+	for (i = 0; i < NETCON_MAX; i++)
+		if (cons[i].fd != 0) {
+			netcon_flush(&cons[i]);
+			netcon_close(&cons[i]);
+		}
+	for (i = 0; i < nlsns; i++)
+		close(lsns[i].fd);
+	close(wake[0]);
+	close(wake[1]);
+}
+
+/*
+ *	console status for the CPU:
+ *	bit 0 = 1: input available
+ *	bit 1 = 1: output writable
+ */
+BYTE netcon_status(int con)
+{
+	netcon_t *c = &cons[con];
+	BYTE status = 0;
+
+	pthread_mutex_lock(&mutex);
+	if (c->fd != 0) {
+		if (RING_CNT(&c->rx) > 0)
+			status |= NETCON_RX_RDY;
+		if (RING_FREE(&c->tx) > 0)
+			status |= NETCON_TX_RDY;
+	}
+	pthread_mutex_unlock(&mutex);
+
+	return status;
+}
+
+/*
+ *	read a character from a console, 0 if nothing available
+ */
+BYTE netcon_read(int con)
+{
+	netcon_t *c = &cons[con];
+	BYTE data = 0;
+	bool full = false;
+
+	pthread_mutex_lock(&mutex);
+	if (c->fd != 0 && RING_CNT(&c->rx) > 0) {
+		full = (RING_FREE(&c->rx) == 0);
+		data = c->rx.data[RING_IDX(c->rx.tail++)];
+	}
+	pthread_mutex_unlock(&mutex);
+
+	/* input was stopped because the buffer was full, resume */
+	if (full)
+		netcon_wake();
+
+	return data;
+}
+
+/*
+ *	write a character to a console, the character is lost if
+ *	the console isn't connected or the output buffer is full
+ */
+void netcon_write(int con, BYTE data)
+{
+	netcon_t *c = &cons[con];
+	bool empty = false;
+
+	pthread_mutex_lock(&mutex);
+	if (c->fd != 0) {
+		if (RING_FREE(&c->tx) > 0) {
+			empty = (RING_CNT(&c->tx) == 0);
+			c->tx.data[RING_IDX(c->tx.head++)] = data;
+		} else
+			LOGD(TAG, "output buffer full on port %d", c->port);
+	}
+	pthread_mutex_unlock(&mutex);
+
+	if (empty)
+		netcon_wake();
+}
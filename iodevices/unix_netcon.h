@@ -0,0 +1,36 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Common I/O devices used by various simulated machines
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ *
+ * This module implements a non-blocking connection manager for
+ * TCP/IP (telnet) consoles.
+ *
+ * History:
+ * 16-OCT-2026 first version, replaces the SIGIO console accept code
+ */
+
+#ifndef UNIX_NETCON_INC
+#define UNIX_NETCON_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#define NETCON_MAX	16	/* max. number of network consoles */
+#define NETCON_BUFSIZE	4096	/* size of the per session I/O buffers */
+
+/* bits returned by netcon_status() */
+#define NETCON_RX_RDY	0x01	/* input available */
+#define NETCON_TX_RDY	0x02	/* output buffer not full */
+
+extern bool netcon_add(int con, int port, bool telnet);
+extern void netcon_start(void);
+extern void netcon_stop(void);
+
+extern BYTE netcon_status(int con);
+extern BYTE netcon_read(int con);
+extern void netcon_write(int con, BYTE data);
+
+#endif /* !UNIX_NETCON_INC */
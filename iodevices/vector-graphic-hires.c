@@ -11,6 +11,9 @@
  *
  * History:
  * 11-OCT-2024 first version
+ * 16-OCT-2026 only redraw frames with writes into video memory
+ * 16-OCT-2026 SDL2: decode frames into a streaming texture scaled by the renderer
+ * 16-OCT-2026 SDL2: frame rate paced by simsdl
  */
  
 #include <stdint.h>
@@ -32,6 +35,7 @@
 #include "simglb.h"
 #include "simcfg.h"
 #include "simmem.h"
+#include "simdirty.h"
 #include "simport.h"
 #ifdef WANT_SDL
 #include "simsdl.h"
@@ -69,6 +73,10 @@ static bool window_resized = false;
 static int hires_win_id = -1;
 static SDL_Window *window;
 static SDL_Renderer *renderer;
+static SDL_Texture *texture;
+#define TWIDTH	256		/* texture size, one texel per bilevel pixel */
+#define THEIGHT	240
+static uint32_t pal[2][16];	/* texel values for bilevel and halftone */
 static uint8_t colors[2][3] = {
 	{ 0x00, 0x00, 0x00 },
 	{ 0xFF, 0xFF, 0xFF }
@@ -112,6 +120,9 @@ static char background[] =  "#000000";
 #endif
 
 static int state;
+static int hires_dirty = -1;		/* dirty tracking id for video memory */
+static BYTE dirty[(8192 >> DIRTY_SHIFT) + 1];	/* lines written */
+static bool full;			/* redraw everything on next frame */
 
 /* UNIX stuff */
 static pthread_t thread;
@@ -146,6 +157,15 @@ static void open_display(void)
 				  window_width, window_height, SDL_WINDOW_RESIZABLE);
 	renderer = SDL_CreateRenderer(window, -1, (SDL_RENDERER_ACCELERATED |
 						   SDL_RENDERER_PRESENTVSYNC));
+	texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB888,
+				    SDL_TEXTUREACCESS_STREAMING,
+				    TWIDTH, THEIGHT);
+	for (i = 0; i < 16; i++) {
+		pal[0][i] = (colors[i & 1][0] << 16) |
+			    (colors[i & 1][1] << 8) | colors[i & 1][2];
+		pal[1][i] = (grays[i][0] << 16) | (grays[i][1] << 8) |
+			    grays[i][2];
+	}
 #else /* !WANT_SDL */
 	Window rootwindow;
 	XSizeHints *size_hints = XAllocSizeHints();
@@ -248,6 +268,7 @@ static void open_display(void)
 static void close_display(void)
 {
 #ifdef WANT_SDL
+	SDL_DestroyTexture(texture);
 	SDL_DestroyRenderer(renderer);
 	renderer = NULL;
 	SDL_DestroyWindow(window);
@@ -275,30 +296,60 @@ static void process_event(SDL_Event *event)
 			(event->window.event == SDL_WINDOWEVENT_RESTORED)) {
 			window_resized = true;
 		}
+		if (event->window.event == SDL_WINDOWEVENT_EXPOSED)
+			full = true;
 		break;
 	default:;
 	}
 }
 
-static inline void set_fg_color(int i)
+/*
+	Decode a full frame into the streaming texture, the renderer scales
+	it into the canvas. Bilevel mode has 256x240 pixels with two
+	scanlines from the 4 pixels of each byte, halftone mode has 128x120
+	pixels with two 4 bit pixels per byte, drawn as 2x2 texels.
+*/
+static void draw_frame(void)
 {
-	SDL_SetRenderDrawColor(renderer,
-			       colors[i][0], colors[i][1], colors[i][2],
-			       SDL_ALPHA_OPAQUE);
-}
+	static const BYTE bits[2][4] = {
+		{ 0x80, 0x40, 0x08, 0x04 },	/* first subrow */
+		{ 0x20, 0x10, 0x02, 0x01 }	/* second subrow */
+	};
+	register int x, k;
+	int y;
+	WORD addr = vector_graphic_hires_address;
+	uint8_t *pixels;
+	uint32_t *p, *q;
+	int pitch;
+	BYTE data;
 
-static inline void set_fg_gray(int i)
-{
-	SDL_SetRenderDrawColor(renderer,
-			       grays[i][0], grays[i][1], grays[i][2],
-			       SDL_ALPHA_OPAQUE);
-}
+	SDL_LockTexture(texture, NULL, (void **) &pixels, &pitch);
 
-static inline void fill_rect(int x, int y, int w, int h)
-{
-	SDL_Rect r = {x, y, w, h};
+	if (vector_graphic_hires_mode == BILEVEL) {
+		for (y = 0; y < THEIGHT; y++) {
+			p = (uint32_t *) (pixels + y * pitch);
+			for (x = 0; x < 64; x++, p += 4) {
+				data = dma_read(addr + x);
+				for (k = 0; k < 4; k++)
+					p[k] = pal[0][(data & bits[y & 1][k])
+						      != 0];
+			}
+			if (y & 1)
+				addr += 64;
+		}
+	} else {		/* nibble mode */
+		for (y = 0; y < THEIGHT; y += 2, addr += 64) {
+			p = (uint32_t *) (pixels + y * pitch);
+			q = (uint32_t *) (pixels + (y + 1) * pitch);
+			for (x = 0; x < 64; x++, p += 4, q += 4) {
+				data = dma_read(addr + x);
+				p[0] = p[1] = q[0] = q[1] = pal[1][data >> 4];
+				p[2] = p[3] = q[2] = q[3] = pal[1][data & 0x0f];
+			}
+		}
+	}
 
-	SDL_RenderFillRect(renderer, &r);
+	SDL_UnlockTexture(texture);
 }
 
 #else /* !WANT_SDL */
@@ -318,8 +369,6 @@ static inline void fill_rect(int x, int y, int w, int h)
 	XFillRectangle(display, pixmap, gc, x, y, w, h);
 }
 
-#endif /* !WANT_SDL */
-
 /*
 	Draw scanlines for a full frame
 
@@ -417,6 +466,8 @@ static void draw_frame()
 	}
 }
 
+#endif /* !WANT_SDL */
+
 #ifdef HAS_NETSERVER
 static uint8_t dblbuf[8192];
 
@@ -429,6 +480,7 @@ static struct {
 static void ws_clear(void)
 {
 	memset(dblbuf, 0, 8192);
+	full = true;
 
 	msg.addr = 0xFFFF;
 	msg.len = 0;
@@ -439,12 +491,23 @@ static void ws_clear(void)
 static void ws_refresh(void)
 {
 	int len = 8192;
+	int base = vector_graphic_hires_address;
 	int addr;
 	int i, n, x, la_count;
 	bool cont;
 	uint8_t val;
 
+	if (!dirty_collect(hires_dirty, dirty) && !full && hires_dirty >= 0)
+		return;
+	if (hires_dirty < 0)
+		full = true;
+
 	for (i = 0; i < len; i++) {
+		/* skip lines not written since the last update */
+		if (!full && !dirty_check(dirty, base, base + i, 1)) {
+			i = ((base + i) | ((1 << DIRTY_SHIFT) - 1)) - base;
+			continue;
+		}
 		addr = i;
 		n = 0;
 		la_count = 0;
@@ -489,6 +552,7 @@ static void ws_refresh(void)
 #endif
 		}
 	}
+	full = false;
 }
 #endif /* HAS_NETSERVER */
 
@@ -496,12 +560,10 @@ static void ws_refresh(void)
 /* function for updating the display */
 static void update_display(bool tick)
 {
-	uint64_t t,tleft;
+	SDL_Rect dst = {0, 0, canvas_width, canvas_height};
 
 	UNUSED(tick);
 
-	t = get_clock_us();
-
 	/* handling window resize event */
 	if (window_resized) {
 		window_resized = false;
@@ -511,30 +573,34 @@ static void update_display(bool tick)
 		window_width = (window_height * 16) / 15;
 		SDL_SetWindowSize(window, window_width, window_height);
 	       	SDL_RenderSetScale(renderer, (double)window_width / canvas_width, (double)window_height / canvas_height);
+		full = true;
 	}
 
+	/* nothing to do if video memory wasn't written since last frame */
+	if (state && !dirty_collect(hires_dirty, dirty) && !full &&
+	    hires_dirty >= 0)
+		return;
+
 	/* draw one frame dependent on graphics format */
-	set_fg_color(0);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
 	SDL_RenderClear(renderer);
 	if (state) {		/* draw frame if on */
+		full = false;
 		draw_frame();
+		SDL_RenderCopy(renderer, texture, NULL, &dst);
 		SDL_RenderPresent(renderer);
-
-		/* sleep rest to 16666 us so that we get 60 fps */
-		tleft = 16666L - (long) (get_clock_us() - t);
-		if (tleft > 0)
-			sleep_for_us(tleft);
-
-		t = get_clock_us();
-	} else
+	} else {
 		SDL_RenderPresent(renderer);
+		full = true;
+	}
 }
 
 static win_funcs_t hires_funcs = {
 	open_display,
 	close_display,
 	process_event,
-	update_display
+	update_display,
+	60
 };
 #endif /* WANT SDL */
 
@@ -598,6 +664,9 @@ static void *update_thread(void *arg)
 #endif
 #ifndef WANT_SDL
 				process_event();
+				if (dirty_collect(hires_dirty, dirty) ||
+				    hires_dirty < 0)
+					full = true;
 				if (window_resized) {
 					XGetWindowAttributes(display, window, &wa);
 					window_width = wa.width;
@@ -626,11 +695,16 @@ static void *update_thread(void *arg)
 						XResizeWindow(display, window, window_width, window_height);
 					}
 					window_resized = false;
+					full = true;
 				}
 				XLockDisplay(display);
-				set_fg_color(0);
-				fill_rect(0, 0, window_width, window_height);
-	        		draw_frame();
+				if (full) {
+					/* only draw if video memory was written */
+					set_fg_color(0);
+					fill_rect(0, 0, window_width, window_height);
+					draw_frame();
+					full = false;
+				}
 				if (has_xrender_extension) {
 				        XRenderComposite(display, PictOpSrc, canvas_pic, 0, window_pic,
 				                         0, 0, 0, 0, 0, 0, window_width, window_height);
@@ -665,6 +739,11 @@ static void *update_thread(void *arg)
 
 void vector_graphic_hires_init()
 {
+		if (hires_dirty < 0)
+			hires_dirty = dirty_alloc();
+		dirty_range(hires_dirty, vector_graphic_hires_address, 8192);
+		full = true;
+
 #ifdef HAS_NETSERVER
 		if (!n_flag) {
 #endif
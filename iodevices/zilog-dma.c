@@ -0,0 +1,609 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Common I/O devices used by various simulated machines
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ *
+ * Emulation of the Zilog Z80-DMA controller
+ */
+
+/*
+ *	A machine attaches a Z80-DMA by calling z80dma_out() and
+ *	z80dma_in() from the handlers of its port, and z80dma_ready()
+ *	when the device connected to the RDY line changes it.
+ *	Devices which move their data through the DMA themselves,
+ *	use z80dma_mem_read() and z80dma_mem_write() to access the
+ *	memory with the address counter of a port.
+ *
+ *	Transfers, searches and search/transfers run in byte, burst and
+ *	continuous mode as DMA bus master of the CPU, which adds the
+ *	T-states of the read and write cycles. Memory to memory transfers
+ *	are done in blocks, if the machine provides dma_read_block() and
+ *	dma_write_block() with HAS_DMA_BLOCK. Interrupts of the DMA are
+ *	not generated.
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simmem.h"
+#include "simcore.h"
+
+#include "zilog-dma.h"
+
+#include "log.h"
+static const char *TAG = "DMA";
+
+#define BLOCK_SIZE	1024	/* bytes moved at once by block transfers */
+
+static z80dma_t *active;	/* DMA which is the bus master */
+
+static void dma_start(z80dma_t *dma);
+static void dma_stop(z80dma_t *dma);
+static Tstates_t dma_bus_master_func(BYTE bus_ack);
+
+/*
+ *	Reset the DMA as after power on
+ */
+void z80dma_reset(z80dma_t *dma)
+{
+	dma_stop(dma);
+	memset(dma->wr, 0, sizeof(dma->wr));
+	dma->reg = 0;
+	dma->follow = 0;
+	dma->cycle[DMA_PORT_A] = dma->cycle[DMA_PORT_B] = 0;
+	dma->count = 0;
+	dma->status = DMA_ST_NO_INT | DMA_ST_NO_MATCH | DMA_ST_NO_EOB;
+	dma->read_mask = 0x7f;
+	dma->read_reg = 0;
+	dma->enabled = false;
+	dma->force_ready = false;
+}
+
+/*
+ *	T-states of a read or write cycle of a port
+ */
+static inline int port_cycle(z80dma_t *dma, int p)
+{
+	if (dma->cycle[p])
+		return dma->cycle[p];
+	return (dma->wr[1 + p] & 0x08) ? 4 : 3;
+}
+
+static inline bool port_io(z80dma_t *dma, int p)
+{
+	return dma->wr[1 + p] & 0x08;
+}
+
+static inline int port_incr(z80dma_t *dma, int p)
+{
+	switch (dma->wr[1 + p] & 0x30) {
+	case 0x00:
+		return -1;
+	case 0x10:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/*
+ *	advance the address counter of a port
+ */
+static inline void port_step(z80dma_t *dma, int p)
+{
+	dma->addr[p] += port_incr(dma, p);
+}
+
+static inline BYTE port_read(z80dma_t *dma, int p)
+{
+	if (port_io(dma, p))
+		return io_in(dma->addr[p] & 0xff, dma->addr[p] >> 8);
+	else
+		return dma_read(dma->addr[p]);
+}
+
+static inline void port_write(z80dma_t *dma, int p, BYTE data)
+{
+	if (port_io(dma, p))
+		io_out(dma->addr[p] & 0xff, dma->addr[p] >> 8, data);
+	else
+		dma_write(dma->addr[p], data);
+}
+
+/*
+ *	number of bytes of the block, the Z80-DMA
+ *	transfers one byte more than the block length
+ */
+static inline unsigned block_size(z80dma_t *dma)
+{
+	return (unsigned) dma->length + 1;
+}
+
+#ifdef HAS_DMA_BLOCK
+/*
+ *	memory to memory transfer with incrementing addresses in blocks,
+ *	returns the number of bytes done, 0 if the block transfer would
+ *	give another result than a transfer of single bytes
+ */
+static unsigned dma_block(z80dma_t *dma, int src, int dst, unsigned n)
+{
+	BYTE buf[BLOCK_SIZE];
+	unsigned s = dma->addr[src], d = dma->addr[dst];
+
+	if (n > BLOCK_SIZE)
+		n = BLOCK_SIZE;
+	if (n > 65536 - s)
+		n = 65536 - s;
+	if (n > 65536 - d)
+		n = 65536 - d;
+
+	/* copying forward into an overlapping destination repeats bytes */
+	if (d > s && d < s + n)
+		return 0;
+
+	dma_read_block(dma->addr[src], buf, n);
+	dma_write_block(dma->addr[dst], buf, n);
+	dma->addr[src] += n;
+	dma->addr[dst] += n;
+	return n;
+}
+#endif
+
+/*
+ *	run the operation for max. n bytes,
+ *	returns the T-states used
+ */
+static Tstates_t dma_run(z80dma_t *dma, unsigned n)
+{
+	int op = dma->wr[0] & 0x03;
+	int src = (dma->wr[0] & 0x04) ? DMA_PORT_A : DMA_PORT_B;
+	int dst = src ^ 1;
+	unsigned size = block_size(dma);
+	Tstates_t t = 0;
+	BYTE data;
+#ifdef HAS_DMA_BLOCK
+	unsigned k;
+#endif
+
+	if (n > size - dma->count)
+		n = size - dma->count;
+
+#ifdef HAS_DMA_BLOCK
+	if (op == DMA_OP_TRANSFER && !port_io(dma, src) && !port_io(dma, dst)
+	    && port_incr(dma, src) == 1 && port_incr(dma, dst) == 1) {
+		while (n > 0 && (k = dma_block(dma, src, dst, n)) > 0) {
+			dma->count += k;
+			n -= k;
+			t += (Tstates_t) k * (port_cycle(dma, src) +
+					      port_cycle(dma, dst));
+		}
+		if (dma->count)
+			dma->status |= DMA_ST_DONE;
+	}
+#endif
+
+	while (n-- > 0) {
+		data = port_read(dma, src);
+		t += port_cycle(dma, src);
+		if (op & DMA_OP_TRANSFER) {
+			port_write(dma, dst, data);
+			t += port_cycle(dma, dst);
+		}
+		port_step(dma, src);
+		port_step(dma, dst);
+		dma->count++;
+		dma->status |= DMA_ST_DONE;
+
+		/* bits set in the mask byte are not compared */
+		if ((op & DMA_OP_SEARCH)
+		    && ((data ^ dma->match) & ~dma->mask) == 0) {
+			dma->status &= ~DMA_ST_NO_MATCH;
+			if (dma->wr[3] & 0x04)	/* stop on match */
+				break;
+		}
+	}
+
+	if (dma->count >= size)
+		dma->status &= ~DMA_ST_NO_EOB;
+
+	return t;
+}
+
+/*
+ *	check if the operation ended
+ */
+static bool dma_ended(z80dma_t *dma)
+{
+	if (dma->count >= block_size(dma))
+		return true;
+	if ((dma->wr[0] & DMA_OP_SEARCH) && (dma->wr[3] & 0x04)
+	    && !(dma->status & DMA_ST_NO_MATCH))
+		return true;
+	return false;
+}
+
+/*
+ *	end of an operation, with auto restart the counters are loaded
+ *	again and the DMA continues when the device is ready again
+ */
+static void dma_end(z80dma_t *dma)
+{
+	dma_stop(dma);
+	if (dma->wr[5] & 0x20) {
+		dma->addr[DMA_PORT_A] = dma->start[DMA_PORT_A];
+		dma->addr[DMA_PORT_B] = dma->start[DMA_PORT_B];
+		dma->count = 0;
+	} else
+		dma->enabled = false;
+	if (dma->done != NULL)
+		(*dma->done)(dma);
+}
+
+/*
+ *	request the bus from the CPU, if the DMA can run
+ */
+static void dma_start(z80dma_t *dma)
+{
+	BusDMA_t mode;
+
+	if (!dma->enabled || !(dma->force_ready || dma->ready)
+	    || !(dma->wr[0] & 0x03) || dma_ended(dma))
+		return;
+
+	switch (dma->wr[4] & 0x60) {
+	case 0x00:
+		mode = BUS_DMA_BYTE;
+		break;
+	case 0x40:
+		mode = BUS_DMA_BURST;
+		break;
+	default:
+		mode = BUS_DMA_CONTINUOUS;
+		break;
+	}
+
+	LOGD(TAG, "%s: op %d, A %04x, B %04x, length %04x, mode %d",
+	     dma->name, dma->wr[0] & 0x03, dma->addr[DMA_PORT_A],
+	     dma->addr[DMA_PORT_B], dma->length, mode);
+
+	active = dma;
+	start_bus_request(mode, &dma_bus_master_func);
+}
+
+/*
+ *	release the bus
+ */
+static void dma_stop(z80dma_t *dma)
+{
+	if (active == dma) {
+		if (dma_bus_master == &dma_bus_master_func)
+			end_bus_request();
+		active = NULL;
+	}
+}
+
+/*
+ *	bus master function called by the CPU
+ */
+static Tstates_t dma_bus_master_func(BYTE bus_ack)
+{
+	z80dma_t *dma = active;
+	Tstates_t t;
+
+	if (dma == NULL) {
+		end_bus_request();
+		return 0;
+	}
+
+	/* in byte and burst mode the bus is released in between,
+	   request it again as long as the device is ready */
+	if (!bus_ack) {
+		if (dma->enabled && (dma->force_ready || dma->ready))
+			start_bus_request(bus_mode, &dma_bus_master_func);
+		return 0;
+	}
+
+	t = dma_run(dma, (bus_mode == BUS_DMA_BYTE) ? 1 : UINT_MAX);
+
+	if (dma_ended(dma))
+		dma_end(dma);
+
+	return t;
+}
+
+/*
+ *	parameter byte of the register in dma->reg
+ */
+static void dma_param(z80dma_t *dma, BYTE data)
+{
+	unsigned bit = dma->follow & -dma->follow;
+
+	dma->follow &= ~bit;
+
+	switch (dma->reg) {
+	case 0:
+		if (bit == 0x08)
+			dma->start[DMA_PORT_A] = (dma->start[DMA_PORT_A] & 0xff00) | data;
+		else if (bit == 0x10)
+			dma->start[DMA_PORT_A] = (dma->start[DMA_PORT_A] & 0xff) | (data << 8);
+		else if (bit == 0x20)
+			dma->length = (dma->length & 0xff00) | data;
+		else
+			dma->length = (dma->length & 0xff) | (data << 8);
+		break;
+	case 1:
+	case 2:
+		/* cycle length 4, 3 or 2, 3 is not valid */
+		if ((data & 0x03) == 0x03)
+			dma->cycle[dma->reg - 1] = 0;
+		else
+			dma->cycle[dma->reg - 1] = 4 - (data & 0x03);
+		break;
+	case 3:
+		if (bit == 0x08)
+			dma->mask = data;
+		else
+			dma->match = data;
+		break;
+	case 4:
+		if (bit == 0x04)
+			dma->start[DMA_PORT_B] = (dma->start[DMA_PORT_B] & 0xff00) | data;
+		else if (bit == 0x08)
+			dma->start[DMA_PORT_B] = (dma->start[DMA_PORT_B] & 0xff) | (data << 8);
+		else if (bit == 0x10) {
+			dma->int_ctrl = data;
+			/* pulse control and interrupt vector follow */
+			dma->follow |= (data & 0x18) << 5;
+		} else if (bit == 0x100)
+			dma->pulse = data;
+		else
+			dma->vector = data;
+		break;
+	case 6:
+		dma->read_mask = data & 0x7f;
+		dma->read_reg = 0;
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ *	command in WR6
+ */
+static void dma_command(z80dma_t *dma, BYTE data)
+{
+	switch (data) {
+	case 0xc3:	/* reset */
+		dma_stop(dma);
+		dma->enabled = false;
+		dma->force_ready = false;
+		dma->cycle[DMA_PORT_A] = dma->cycle[DMA_PORT_B] = 0;
+		dma->wr[3] &= ~0x20;
+		dma->wr[5] &= ~0x20;
+		break;
+	case 0xc7:	/* reset port A timing */
+		dma->cycle[DMA_PORT_A] = 0;
+		break;
+	case 0xcb:	/* reset port B timing */
+		dma->cycle[DMA_PORT_B] = 0;
+		break;
+	case 0xcf:	/* load */
+		dma->addr[DMA_PORT_A] = dma->start[DMA_PORT_A];
+		dma->addr[DMA_PORT_B] = dma->start[DMA_PORT_B];
+		dma->count = 0;
+		dma->force_ready = false;
+		break;
+	case 0xd3:	/* continue */
+		dma->count = 0;
+		break;
+	case 0xaf:	/* disable interrupts */
+	case 0xab:	/* enable interrupts */
+	case 0xa3:	/* reset and disable interrupts */
+	case 0xb7:	/* enable after RETI */
+		break;
+	case 0xbf:	/* read status byte */
+		dma->read_reg = -1;
+		break;
+	case 0x8b:	/* reinitialize status byte */
+		dma->status |= DMA_ST_NO_MATCH | DMA_ST_NO_EOB;
+		break;
+	case 0xa7:	/* initiate read sequence */
+		dma->read_reg = 0;
+		break;
+	case 0xb3:	/* force ready */
+		dma->force_ready = true;
+		dma_start(dma);
+		break;
+	case 0x87:	/* enable DMA */
+		dma->enabled = true;
+		dma_start(dma);
+		break;
+	case 0x83:	/* disable DMA */
+		dma_stop(dma);
+		dma->enabled = false;
+		break;
+	case 0xbb:	/* read mask follows */
+		dma->reg = 6;
+		dma->follow = 0x01;
+		break;
+	default:
+		LOGW(TAG, "%s: command %02x not implemented", dma->name, data);
+		break;
+	}
+}
+
+/*
+ *	Write a control byte
+ */
+void z80dma_out(z80dma_t *dma, BYTE data)
+{
+	if (dma->follow) {
+		dma_param(dma, data);
+		return;
+	}
+
+	if (!(data & 0x80)) {
+		if (data & 0x03) {			/* WR0 */
+			dma->reg = 0;
+			dma->follow = data & 0x78;
+		} else if ((data & 0x07) == 0x04) {	/* WR1 */
+			dma->reg = 1;
+			dma->follow = data & 0x40;
+		} else if ((data & 0x07) == 0x00) {	/* WR2 */
+			dma->reg = 2;
+			dma->follow = data & 0x40;
+		} else {
+			LOGW(TAG, "%s: invalid control byte %02x",
+			     dma->name, data);
+			return;
+		}
+	} else {
+		switch (data & 0x03) {
+		case 0:					/* WR3 */
+			dma->reg = 3;
+			dma->follow = data & 0x18;
+			if (data & 0x40)
+				dma->enabled = true;
+			break;
+		case 1:					/* WR4 */
+			dma->reg = 4;
+			dma->follow = data & 0x1c;
+			break;
+		case 2:					/* WR5 */
+			if ((data & 0xc7) != 0x82) {
+				LOGW(TAG, "%s: invalid control byte %02x",
+				     dma->name, data);
+				return;
+			}
+			dma->reg = 5;
+			break;
+		default:				/* WR6 */
+			dma->wr[6] = data;
+			dma_command(dma, data);
+			return;
+		}
+	}
+	dma->wr[dma->reg] = data;
+
+	if (dma->reg == 3 && (data & 0x40))
+		dma_start(dma);
+}
+
+/*
+ *	Read the status byte or the next register of the read sequence
+ */
+BYTE z80dma_in(z80dma_t *dma)
+{
+	BYTE val;
+	int i;
+
+	if (dma->read_reg < 0 || dma->read_mask == 0) {
+		if (dma->read_reg < 0)
+			dma->read_reg = 0;
+		return dma->status | ((dma->force_ready || dma->ready) ?
+				      DMA_ST_READY : 0);
+	}
+
+	for (i = 0; i < 7; i++, dma->read_reg = (dma->read_reg + 1) % 7)
+		if (dma->read_mask & (1 << dma->read_reg))
+			break;
+
+	switch (dma->read_reg) {
+	case 0:
+		val = dma->status | ((dma->force_ready || dma->ready) ?
+				     DMA_ST_READY : 0);
+		break;
+	case 1:
+		val = dma->count & 0xff;
+		break;
+	case 2:
+		val = (dma->count >> 8) & 0xff;
+		break;
+	case 3:
+		val = dma->addr[DMA_PORT_A] & 0xff;
+		break;
+	case 4:
+		val = dma->addr[DMA_PORT_A] >> 8;
+		break;
+	case 5:
+		val = dma->addr[DMA_PORT_B] & 0xff;
+		break;
+	default:
+		val = dma->addr[DMA_PORT_B] >> 8;
+		break;
+	}
+	dma->read_reg = (dma->read_reg + 1) % 7;
+	return val;
+}
+
+/*
+ *	Set the RDY line of the device connected to the DMA
+ */
+void z80dma_ready(z80dma_t *dma, bool ready)
+{
+	dma->ready = ready;
+	if (ready)
+		dma_start(dma);
+}
+
+/*
+ *	Read len bytes from the memory at the address counter of
+ *	port p, for devices which move their data themselves
+ */
+void z80dma_mem_read(z80dma_t *dma, int p, BYTE *buf, unsigned len)
+{
+#ifdef HAS_DMA_BLOCK
+	unsigned n;
+
+	if (port_incr(dma, p) == 1) {
+		while (len > 0) {
+			n = 65536 - dma->addr[p];
+			if (n > len)
+				n = len;
+			dma_read_block(dma->addr[p], buf, n);
+			dma->addr[p] += n;
+			buf += n;
+			len -= n;
+		}
+		return;
+	}
+#endif
+	while (len-- > 0) {
+		*buf++ = dma_read(dma->addr[p]);
+		port_step(dma, p);
+	}
+}
+
+/*
+ *	Write len bytes into the memory at the address counter of
+ *	port p, for devices which move their data themselves
+ */
+void z80dma_mem_write(z80dma_t *dma, int p, const BYTE *buf, unsigned len)
+{
+#ifdef HAS_DMA_BLOCK
+	unsigned n;
+
+	if (port_incr(dma, p) == 1) {
+		while (len > 0) {
+			n = 65536 - dma->addr[p];
+			if (n > len)
+				n = len;
+			dma_write_block(dma->addr[p], buf, n);
+			dma->addr[p] += n;
+			buf += n;
+			len -= n;
+		}
+		return;
+	}
+#endif
+	while (len-- > 0) {
+		dma_write(dma->addr[p], *buf++);
+		port_step(dma, p);
+	}
+}
@@ -0,0 +1,71 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Common I/O devices used by various simulated machines
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ *
+ * Emulation of the Zilog Z80-DMA controller
+ */
+
+#ifndef ZILOG_DMA_INC
+#define ZILOG_DMA_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#define DMA_PORT_A	0
+#define DMA_PORT_B	1
+
+/* operations in WR0 */
+#define DMA_OP_TRANSFER	1
+#define DMA_OP_SEARCH	2
+#define DMA_OP_SRCH_TRF	3
+
+/* bits of the status byte RR0, match and end of block are active low */
+#define DMA_ST_DONE	0x01	/* DMA operation has occurred */
+#define DMA_ST_READY	0x02	/* RDY line is active */
+#define DMA_ST_NO_INT	0x08	/* no interrupt pending */
+#define DMA_ST_NO_MATCH	0x10	/* no match found */
+#define DMA_ST_NO_EOB	0x20	/* end of block not reached */
+
+typedef struct z80dma {
+	const char *name;	/* device name for log messages */
+
+	BYTE wr[7];		/* base bytes of WR0 - WR6 */
+	int reg;		/* register which gets parameter bytes */
+	unsigned follow;	/* parameter bytes still expected */
+
+	WORD start[2];		/* starting address of port A and B */
+	BYTE cycle[2];		/* T-states of a cycle, 0 = standard timing */
+	WORD length;		/* block length */
+	BYTE mask;		/* mask byte for searches */
+	BYTE match;		/* match byte for searches */
+	BYTE int_ctrl;		/* interrupt control byte */
+	BYTE pulse;		/* pulse control byte */
+	BYTE vector;		/* interrupt vector */
+
+	WORD addr[2];		/* address counter of port A and B */
+	unsigned count;		/* byte counter */
+	BYTE status;		/* status byte RR0 */
+
+	BYTE read_mask;		/* registers in the read sequence */
+	int read_reg;		/* next register of the read sequence */
+
+	bool enabled;		/* DMA is enabled */
+	bool force_ready;	/* RDY is forced by command */
+	bool ready;		/* RDY line of the device */
+
+	/* called after an operation ended, may be NULL */
+	void (*done)(struct z80dma *dma);
+} z80dma_t;
+
+extern void z80dma_reset(z80dma_t *dma);
+extern void z80dma_out(z80dma_t *dma, BYTE data);
+extern BYTE z80dma_in(z80dma_t *dma);
+extern void z80dma_ready(z80dma_t *dma, bool ready);
+extern void z80dma_mem_read(z80dma_t *dma, int p, BYTE *buf, unsigned len);
+extern void z80dma_mem_write(z80dma_t *dma, int p, const BYTE *buf,
+			     unsigned len);
+
+#endif /* !ZILOG_DMA_INC */
@@ -12,6 +12,12 @@
  *	       computers by treating 0xe000-0xefff as ROM.
  * 04-NOV-2019 (Udo Munk) add functions for direct memory access
  * 14-DEC-2024 (Thomas Eberhardt) added hardware breakpoint support
+ * 16-OCT-2026 record memory writes of devices into the history
+ * 16-OCT-2026 record memory accesses for code coverage
+ * 16-OCT-2026 hardware breakpoints use per address access bitmaps
+ * 16-OCT-2026 record memory writes into the execution trace
+ * 16-OCT-2026 mark the pages written for the history
+ * 16-OCT-2026 pass the memory bank to the execution trace
  */
 
 #ifndef SIMMEM_INC
@@ -22,6 +28,16 @@
 #ifdef WANT_ICE
 #include "simice.h"
 #endif
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_COVER
+#include "simcov.h"
+#endif
+#ifdef WANT_REVERSE
+#include "simreplay.h"
+#include "simrev.h"
+#endif
 
 #ifdef BUS_8080
 #include "simglb.h"
@@ -43,12 +59,23 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && (hb_map[addr] & HB_WRITE))
+		hb_hit(addr, HB_WRITE);
+#endif
+#ifdef WANT_TRACE
+	if (tr_flag)
+		trace_write(0, addr, data);
+#endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_write(0, addr);
 #endif
 
 	if ((addr & 0xf000) != 0xe000)
 		memory[addr] = data;
+#ifdef WANT_REVERSE
+	rev_mark(addr);
+#endif
 }
 
 static inline BYTE memrdr(WORD addr)
@@ -56,16 +83,20 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
+	if (hb_flag && hb_map[addr]) {
 		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
+			if (hb_map[addr] & HB_EXEC)
+				hb_hit(addr, HB_EXEC);
 		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
+			if (hb_map[addr] & HB_READ)
+				hb_hit(addr, HB_READ);
 		}
 	}
 #endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_read(0, addr);
+#endif
 
 	data = memory[addr];
 
@@ -82,8 +113,15 @@ static inline BYTE memrdr(WORD addr)
  */
 static inline void dma_write(WORD addr, BYTE data)
 {
+#ifdef WANT_REVERSE
+	if (rr_hist && rr_mode == RR_RECORD)
+		rr_dma(addr, data);
+#endif
 	if ((addr & 0xf000) != 0xe000)
 		memory[addr] = data;
+#ifdef WANT_REVERSE
+	rev_mark(addr);
+#endif
 }
 
 static inline BYTE dma_read(WORD addr)
@@ -97,6 +135,9 @@ static inline BYTE dma_read(WORD addr)
 static inline void putmem(WORD addr, BYTE data)
 {
 	memory[addr] = data;
+#ifdef WANT_REVERSE
+	rev_mark(addr);
+#endif
 }
 
 static inline BYTE getmem(WORD addr)
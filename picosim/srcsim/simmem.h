@@ -11,6 +11,7 @@
  * 29-JUN-2024 implemented banked memory
  * 14-DEC-2024 added hardware breakpoint support
  * 12-MAR-2025 added more memory banks for RP2350
+ * 16-OCT-2026 hardware breakpoints use per address access bitmaps
  */
 
 #ifndef SIMMEM_INC
@@ -52,8 +53,8 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && (hb_map[addr] & HB_WRITE))
+		hb_hit(addr, HB_WRITE);
 #endif
 
 	if ((selbnk == 0) || (addr >= SEGSIZ)) {
@@ -69,13 +70,13 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
+	if (hb_flag && hb_map[addr]) {
 		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
+			if (hb_map[addr] & HB_EXEC)
+				hb_hit(addr, HB_EXEC);
 		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
+			if (hb_map[addr] & HB_READ)
+				hb_hit(addr, HB_READ);
 		}
 	}
 #endif
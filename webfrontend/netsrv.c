@@ -5,6 +5,8 @@
  *
  * History:
  * 12-JUL-2018	1.0	Initial Release
+ * 16-OCT-2026	1.1	Add /metrics endpoint
+ * 16-OCT-2026	1.2	Add /log endpoint for the log levels
  */
 
 /**
@@ -45,6 +47,9 @@
 #include "cromemco-tu-art.h"
 #endif
 #include "diskmanager.h"
+#if defined(WANT_METRICS) && defined(FRONTPANEL)
+#include "frontpanel.h"
+#endif
 
 #ifdef HAS_NETSERVER
 
@@ -69,13 +74,16 @@ static struct {
 	int queue;
 	ws_client_t ws_client;
 	void (*cbfunc)(BYTE *);
+#ifdef WANT_METRICS
+	uint64_t tx_bytes, rx_bytes;	/* websocket data sent and received */
+#endif
 } dev[MAX_WS_CLIENTS];
 
 static net_device_t net_device_a[_DEV_MAX] = {
 	DEV_TTY, DEV_TTY2, DEV_TTY3,
 	DEV_LPT, DEV_VIO, DEV_CPA,
 	DEV_DZLR, DEV_88ACC, DEV_D7AIO, DEV_PTR,
-	DEV_HIRES
+	DEV_NMKR, DEV_HIRES
 };
 
 static const char *dev_name[] = {
@@ -89,6 +97,7 @@ static const char *dev_name[] = {
 	"ACC",
 	"D7AIO",
 	"PTR",
+	"NMKR",
 	"HIRES"
 };
 
@@ -136,10 +145,14 @@ void net_device_send(net_device_t device, char *msg, int len)
 		break;
 	}
 
-	if (dev[device].queue >= 0)
+	if (dev[device].queue >= 0) {
 		mg_websocket_write(dev[device].ws_client.conn,
 				   op_code,
 				   msg, len);
+#ifdef WANT_METRICS
+		dev[device].tx_bytes += len;
+#endif
+	}
 }
 
 /**
@@ -458,6 +471,173 @@ static int SystemHandler(HttpdConnection_t *conn, void *unused)
 	return 1;
 }
 
+#ifdef WANT_METRICS
+/*
+ * print the HELP and TYPE lines of a metric
+ */
+static void metric_head(HttpdConnection_t *conn, const char *name,
+			const char *type, const char *help)
+{
+	httpdPrintf(conn, "# HELP z80pack_%s %s\n", name, help);
+	httpdPrintf(conn, "# TYPE z80pack_%s %s\n", name, type);
+}
+
+/*
+ * live counters of the machine in the Prometheus text format
+ */
+static int MetricsHandler(HttpdConnection_t *conn, void *unused)
+{
+	request_t *req = get_request(conn);
+	int i;
+#ifdef FRONTPANEL
+	int fps, sps;
+#endif
+
+	UNUSED(unused);
+
+	if (req->method != HTTP_GET) {
+		httpdStartResponse(conn, 405);  //http error code 'Method Not Allowed'
+		httpdEndHeaders(conn);
+		return 1;
+	}
+
+	httpdStartResponse(conn, 200);
+	httpdHeader(conn, "Content-Type", "text/plain; version=0.0.4");
+	httpdEndHeaders(conn);
+
+	metric_head(conn, "cpu_clock_hz", "gauge",
+		    "Measured clock frequency of the emulated CPU.");
+	httpdPrintf(conn, "z80pack_cpu_clock_hz %" PRIu64 "\n", cpu_freq);
+	metric_head(conn, "cpu_tstates_total", "counter",
+		    "T-states executed by the CPU.");
+	httpdPrintf(conn, "z80pack_cpu_tstates_total %" PRIu64 "\n", T);
+	metric_head(conn, "cpu_instructions_total", "counter",
+		    "Instructions executed by the CPU.");
+	httpdPrintf(conn, "z80pack_cpu_instructions_total %" PRIu64 "\n",
+		    cpu_inst);
+	metric_head(conn, "cpu_seconds_total", "counter",
+		    "Time spent running the CPU.");
+	httpdPrintf(conn, "z80pack_cpu_seconds_total %.6f\n",
+		    cpu_time / 1000000.0);
+	metric_head(conn, "io_seconds_total", "counter",
+		    "Time spent in I/O device functions.");
+	httpdPrintf(conn, "z80pack_io_seconds_total %.6f\n",
+		    total_io_time / 1000000.0);
+	metric_head(conn, "wait_seconds_total", "counter",
+		    "Time spent waiting for interrupts in HALT.");
+	httpdPrintf(conn, "z80pack_wait_seconds_total %.6f\n",
+		    total_wait_time / 1000000.0);
+
+	metric_head(conn, "port_accesses_total", "counter",
+		    "Accesses to I/O ports with a device.");
+	for (i = 0; i < 256; i++) {
+		if (port_stats[i].in)
+			httpdPrintf(conn, "z80pack_port_accesses_total"
+				    "{port=\"0x%02x\",dir=\"in\"} %" PRIu64 "\n",
+				    i, port_stats[i].in);
+		if (port_stats[i].out)
+			httpdPrintf(conn, "z80pack_port_accesses_total"
+				    "{port=\"0x%02x\",dir=\"out\"} %" PRIu64 "\n",
+				    i, port_stats[i].out);
+	}
+	metric_head(conn, "port_seconds_total", "counter",
+		    "Time spent in the device functions of I/O ports.");
+	for (i = 0; i < 256; i++) {
+		if (port_stats[i].in)
+			httpdPrintf(conn, "z80pack_port_seconds_total"
+				    "{port=\"0x%02x\",dir=\"in\"} %.6f\n",
+				    i, port_stats[i].in_us / 1000000.0);
+		if (port_stats[i].out)
+			httpdPrintf(conn, "z80pack_port_seconds_total"
+				    "{port=\"0x%02x\",dir=\"out\"} %.6f\n",
+				    i, port_stats[i].out_us / 1000000.0);
+	}
+
+	metric_head(conn, "disk_sectors_total", "counter",
+		    "Disk sectors read and written.");
+	httpdPrintf(conn, "z80pack_disk_sectors_total{op=\"read\"} %" PRIu64
+		    "\n", disk_rd_sec);
+	httpdPrintf(conn, "z80pack_disk_sectors_total{op=\"write\"} %" PRIu64
+		    "\n", disk_wr_sec);
+
+	metric_head(conn, "websocket_bytes_total", "counter",
+		    "Data sent and received on the device websockets.");
+	for (i = 0; i < _DEV_MAX; i++) {
+		if (dev[i].tx_bytes)
+			httpdPrintf(conn, "z80pack_websocket_bytes_total"
+				    "{device=\"%s\",dir=\"tx\"} %" PRIu64 "\n",
+				    dev_name[i], dev[i].tx_bytes);
+		if (dev[i].rx_bytes)
+			httpdPrintf(conn, "z80pack_websocket_bytes_total"
+				    "{device=\"%s\",dir=\"rx\"} %" PRIu64 "\n",
+				    dev_name[i], dev[i].rx_bytes);
+	}
+
+#ifdef FRONTPANEL
+	if (F_flag) {
+		fp_getStats(&fps, &sps);
+		metric_head(conn, "panel_frames_per_second", "gauge",
+			    "Frames drawn by the front panel.");
+		httpdPrintf(conn, "z80pack_panel_frames_per_second %d\n", fps);
+		metric_head(conn, "panel_samples_per_second", "gauge",
+			    "Data samples taken by the front panel.");
+		httpdPrintf(conn, "z80pack_panel_samples_per_second %d\n",
+			    sps);
+	}
+#endif
+
+	return 1;
+}
+#endif /* WANT_METRICS */
+
+#ifdef WANT_LOGGER
+/*
+ * GET the log levels of the tags as JSON,
+ * PUT or POST /log?tag=level,... to set them
+ */
+static int LogHandler(HttpdConnection_t *conn, void *unused)
+{
+	request_t *req = get_request(conn);
+	char spec[LENCMD];
+	const char *tag;
+	int i, level;
+
+	UNUSED(unused);
+
+	switch (req->method) {
+	case HTTP_GET:
+		httpdStartResponse(conn, 200);
+		httpdHeader(conn, "Content-Type", "application/json");
+		httpdEndHeaders(conn);
+
+		httpdPrintf(conn, "{ \"rate\": %u, \"levels\": {",
+			    log_get_rate());
+		for (i = 0; log_get_tag(i, &tag, &level); i++)
+			httpdPrintf(conn, "%s \"%s\": \"%s\"", i ? "," : "",
+				    tag, log_level_name(level));
+		httpdPrintf(conn, " } }");
+		break;
+	case HTTP_PUT:
+	case HTTP_POST:
+		if (req->args[0] == NULL
+		    || mg_url_decode(req->args[0], strlen(req->args[0]),
+				     spec, LENCMD, 0) < 0
+		    || !log_config(spec))
+			httpdStartResponse(conn, 400);  //http error code 'Bad Request'
+		else
+			httpdStartResponse(conn, 200);
+		httpdEndHeaders(conn);
+		break;
+	default:
+		httpdStartResponse(conn, 405);  //http error code 'Method Not Allowed'
+		httpdEndHeaders(conn);
+		break;
+	}
+
+	return 1;
+}
+#endif /* WANT_LOGGER */
+
 int DirectoryHandler(HttpdConnection_t *conn, void *path)
 {
 	request_t *req = get_request(conn);
@@ -646,6 +826,10 @@ static int WebsocketDataHandler(HttpdConnection_t *conn,
 
 	UNUSED(conn);
 
+#ifdef WANT_METRICS
+	dev[d].rx_bytes += len;
+#endif
+
 #ifdef DEBUG
 	fprintf(stdout, "Websocket [%d] got %z bytes of ", (int) device, len);
 	switch (((unsigned char) bits) & 0x0F) {
@@ -854,6 +1038,12 @@ int start_net_services(int port)
 	mg_set_request_handler(ctx, "/conf", 	ConfigHandler,	(void *) "conf");
 	mg_set_request_handler(ctx, "/library", LibraryHandler, 0);
 	mg_set_request_handler(ctx, "/disks", 	DiskHandler, 	0);
+#ifdef WANT_METRICS
+	mg_set_request_handler(ctx, "/metrics",	MetricsHandler,	0);
+#endif
+#ifdef WANT_LOGGER
+	mg_set_request_handler(ctx, "/log",	LogHandler,	0);
+#endif
 
 	mg_set_websocket_handler(ctx, "/tty",
 				 WebSocketConnectHandler,
@@ -0,0 +1,407 @@
+/*
+ *	Z80/8080-Macro-Assembler
+ *	Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	batch module, runs many independent assemblies in one invocation,
+ *	either from a manifest file with the arguments of one assembly per
+ *	line, or for the requests of clients on a Unix domain socket
+ *
+ *	the op-code and operand tables are built once before the jobs are
+ *	started, each job is assembled in a forked process, which gets its
+ *	own copy of the assembler state, up to -j jobs run concurrently
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _POSIX_C_SOURCE
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#endif
+
+#include "z80asm.h"
+#include "z80abat.h"
+#include "z80aopc.h"
+
+#define BAT_MAXLINE	1024	/* max. line length of a job */
+#define BAT_MAXARGS	128	/* max. number of arguments of a job */
+#define BAT_MAXJOBS	64	/* max. number of concurrent jobs */
+#define BAT_MAXREQS	64	/* max. number of requests being read */
+#define BAT_TIMEOUT	10	/* max. seconds for sending a request */
+#define BAT_IDLE	1000	/* ms between reaping finished jobs */
+
+#ifdef _POSIX_C_SOURCE
+
+typedef struct job {
+	pid_t job_pid;			/* process id, 0 if slot is free */
+	FILE *job_out;			/* collected output, or NULL */
+	unsigned long job_line;		/* line # in manifest */
+} job_t;
+
+typedef struct req {
+	int req_fd;			/* client connection, -1 if slot free */
+	int req_len;			/* length of line read so far */
+	time_t req_time;		/* time of the connection */
+	char req_line[BAT_MAXLINE];	/* request line */
+} req_t;
+
+static void bat_options(int argc, char *argv[]);
+static int bat_split(char *line, char **av);
+static void bat_start(char *line, unsigned long n, FILE *out, int fd);
+static void bat_wait(int block);
+static void bat_manifest(void);
+static int bat_read(req_t *r);
+static void NORETURN bat_server(void);
+
+static char *manfn;			/* manifest filename, option -B */
+static char *sockfn;			/* socket filename, option -S */
+static int maxjobs;			/* max. concurrent jobs, option -j */
+static char **gargs;			/* options for all jobs */
+static int ngargs;			/* number of options for all jobs */
+static job_t jobs[BAT_MAXJOBS];		/* running jobs */
+static int running;			/* number of running jobs */
+static int failed;			/* number of failed jobs */
+static int srvfd = -1;			/* server socket */
+static req_t reqs[BAT_MAXREQS];		/* requests being read */
+static char progname[] = "z80asm";	/* program name of jobs */
+
+#endif /* _POSIX_C_SOURCE */
+
+/*
+ *	returns TRUE, if one of the options selects the batch mode
+ */
+int bat_mode(int argc, char *argv[])
+{
+	while (--argc > 0 && (*++argv)[0] == '-')
+		if ((*argv)[1] == 'B' || (*argv)[1] == 'S')
+			return TRUE;
+	return FALSE;
+}
+
+#ifdef _POSIX_C_SOURCE
+
+/*
+ *	batch mode main function
+ *	returns the exit status of the assembler
+ */
+int bat_main(int argc, char *argv[])
+{
+	bat_options(argc, argv);
+	instrset(INSTR_8080);
+	instrset(INSTR_Z80);
+	if (sockfn != NULL)
+		bat_server();
+	bat_manifest();
+	printf("%d job(s) failed\n", failed);
+	return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ *	process batch options, the other options are passed to all jobs
+ */
+static void bat_options(int argc, char *argv[])
+{
+	register char *s;
+
+	maxjobs = 1;
+	if ((gargs = (char **) malloc(sizeof(char *) * argc)) == NULL)
+		fatal(F_OUTMEM, "batch options");
+	while (--argc > 0 && (s = *++argv)[0] == '-')
+		switch (s[1]) {
+		case 'B':
+		case 'S':
+			if (s[2] == '\0') {
+				printf("name missing in option -%c\n", s[1]);
+				fatal(F_USAGE, RELEASE);
+			}
+			if (s[1] == 'B')
+				manfn = s + 2;
+			else
+				sockfn = s + 2;
+			break;
+		case 'j':
+			if (s[2] == '\0') {
+				puts("number missing in option -j");
+				fatal(F_USAGE, RELEASE);
+			}
+			maxjobs = atoi(s + 2);
+			if (maxjobs < 1 || maxjobs > BAT_MAXJOBS)
+				fatal(F_JOBS, s + 2);
+			break;
+		default:
+			gargs[ngargs++] = s;
+			break;
+		}
+	if (argc > 0) {
+		puts("no input file allowed in batch mode");
+		fatal(F_USAGE, RELEASE);
+	}
+	if (manfn != NULL && sockfn != NULL) {
+		puts("options -B and -S can't be used together");
+		fatal(F_USAGE, RELEASE);
+	}
+}
+
+/*
+ *	split the arguments of a job in line into av behind the program
+ *	name and the options for all jobs
+ *	returns the number of arguments in av
+ */
+static int bat_split(char *line, char **av)
+{
+	register char *p;
+	register int n;
+
+	av[0] = progname;
+	for (n = 1; n <= ngargs; n++)
+		av[n] = gargs[n - 1];
+	p = strtok(line, " \t\r\n");
+	while (p != NULL && n < BAT_MAXARGS - 1) {
+		av[n++] = p;
+		p = strtok(NULL, " \t\r\n");
+	}
+	av[n] = NULL;
+	return n;
+}
+
+/*
+ *	start the job with the arguments in line, the output of the job
+ *	is written into out, or else into the file descriptor fd
+ */
+static void bat_start(char *line, unsigned long n, FILE *out, int fd)
+{
+	register int i;
+	register pid_t pid;
+	char *av[BAT_MAXARGS];
+	int ac;
+
+	while (running >= maxjobs)
+		bat_wait(TRUE);
+	ac = bat_split(line, av);
+	fflush(stdout);
+	if ((pid = fork()) < 0)
+		fatal(F_FORK, line);
+	if (pid == 0) {
+		if (srvfd >= 0)
+			close(srvfd);
+		for (i = 0; i < BAT_MAXREQS; i++)
+			if (reqs[i].req_fd >= 0 && reqs[i].req_fd != fd)
+				close(reqs[i].req_fd);
+		if (out != NULL)
+			fd = fileno(out);
+		if (dup2(fd, STDOUT_FILENO) < 0)
+			_exit(EXIT_FAILURE);
+		exit(assemble(ac, av) > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+	for (i = 0; jobs[i].job_pid != 0; i++)
+		;
+	jobs[i].job_pid = pid;
+	jobs[i].job_out = out;
+	jobs[i].job_line = n;
+	running++;
+}
+
+/*
+ *	wait for a job to finish, if block is FALSE only finished jobs
+ *	are collected, the output of a manifest job is copied to stdout
+ */
+static void bat_wait(int block)
+{
+	register int i, c;
+	register pid_t pid;
+	int status;
+
+	while (running > 0) {
+		if ((pid = waitpid(-1, &status, block ? 0 : WNOHANG)) <= 0)
+			return;
+		for (i = 0; i < BAT_MAXJOBS && jobs[i].job_pid != pid; i++)
+			;
+		if (i == BAT_MAXJOBS)
+			continue;
+		if (jobs[i].job_out != NULL) {
+			rewind(jobs[i].job_out);
+			while ((c = getc(jobs[i].job_out)) != EOF)
+				putchar(c);
+			fclose(jobs[i].job_out);
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			failed++;
+			if (manfn != NULL)
+				printf("Job in line %lu of %s failed\n",
+				       jobs[i].job_line, manfn);
+		}
+		jobs[i].job_pid = 0;
+		running--;
+		if (block)
+			return;
+	}
+}
+
+/*
+ *	run the jobs in the manifest file, empty lines and lines
+ *	starting with # are ignored, the file is read completely
+ *	before the first job starts, because the jobs share its
+ *	file offset and move it when they exit
+ */
+static void bat_manifest(void)
+{
+	register char *p;
+	register unsigned long i;
+	register FILE *out;
+	FILE *fp;
+	char line[BAT_MAXLINE];
+	char **lines;
+	unsigned long n, nalloc;
+
+	if ((fp = fopen(manfn, "r")) == NULL)
+		fatal(F_FOPEN, manfn);
+	lines = NULL;
+	n = nalloc = 0;
+	while (fgets(line, BAT_MAXLINE, fp) != NULL) {
+		if (n == nalloc) {
+			nalloc = nalloc ? nalloc * 2 : 64;
+			lines = (char **) realloc(lines,
+						  sizeof(char *) * nalloc);
+			if (lines == NULL)
+				fatal(F_OUTMEM, "batch jobs");
+		}
+		lines[n++] = strsave(line);
+	}
+	fclose(fp);
+	for (i = 0; i < n; i++) {
+		for (p = lines[i]; *p == ' ' || *p == '\t'; p++)
+			;
+		if (*p == '\0' || *p == '\n' || *p == '\r' || *p == '#')
+			continue;
+		if ((out = tmpfile()) == NULL)
+			fatal(F_FORK, "can't create output file");
+		bat_start(p, i + 1, out, -1);
+	}
+	while (running > 0)
+		bat_wait(TRUE);
+}
+
+/*
+ *	read what the client of request r has sent so far
+ *	returns TRUE, if the request line is complete
+ */
+static int bat_read(req_t *r)
+{
+	register int n;
+	register char *p;
+
+	n = read(r->req_fd, r->req_line + r->req_len,
+		 BAT_MAXLINE - 1 - r->req_len);
+	if (n > 0) {
+		p = r->req_line + r->req_len;
+		r->req_len += n;
+		r->req_line[r->req_len] = '\0';
+		if ((p = strchr(p, '\n')) == NULL
+		    && r->req_len < BAT_MAXLINE - 1)
+			return FALSE;
+		if (p != NULL)
+			*p = '\0';
+	} else {
+		if (n < 0)
+			r->req_len = 0;
+		r->req_line[r->req_len] = '\0';
+	}
+	return TRUE;
+}
+
+/*
+ *	accept requests on the Unix domain socket sockfn, a request is
+ *	one line with the arguments of a job, the output of the job is
+ *	sent back and the connection is closed when the job is done
+ *
+ *	the request lines of all clients are read while waiting with
+ *	poll(), so that a slow client doesn't hold up the others, and
+ *	finished jobs are reaped also while no requests come in
+ */
+static void NORETURN bat_server(void)
+{
+	register int i, n;
+	struct sockaddr_un sa;
+	struct pollfd pfds[BAT_MAXREQS + 1];
+	req_t *r;
+	int cfd;
+	time_t now;
+
+	if (strlen(sockfn) >= sizeof(sa.sun_path))
+		fatal(F_SERVER, sockfn);
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strcpy(sa.sun_path, sockfn);
+	unlink(sockfn);
+	if ((srvfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+	    || bind(srvfd, (struct sockaddr *) &sa, sizeof(sa)) < 0
+	    || listen(srvfd, BAT_MAXJOBS) < 0)
+		fatal(F_SERVER, sockfn);
+	for (i = 0; i < BAT_MAXREQS; i++)
+		reqs[i].req_fd = -1;
+	printf("Serving on %s\n", sockfn);
+	for (;;) {
+		bat_wait(FALSE);
+		for (n = 0; n < BAT_MAXREQS && reqs[n].req_fd >= 0; n++)
+			;
+		pfds[0].fd = n < BAT_MAXREQS ? srvfd : -1;
+		pfds[0].events = POLLIN;
+		pfds[0].revents = 0;
+		for (i = 0; i < BAT_MAXREQS; i++) {
+			pfds[i + 1].fd = reqs[i].req_fd;
+			pfds[i + 1].events = POLLIN;
+			pfds[i + 1].revents = 0;
+		}
+		if (poll(pfds, BAT_MAXREQS + 1, BAT_IDLE) < 0)
+			continue;
+		now = time(NULL);
+		for (i = 0; i < BAT_MAXREQS; i++) {
+			r = &reqs[i];
+			if (r->req_fd < 0)
+				continue;
+			if (pfds[i + 1].revents != 0) {
+				if (!bat_read(r))
+					continue;
+				bat_wait(FALSE);
+				if (r->req_len > 0 && r->req_line[0] != '\0')
+					bat_start(r->req_line, 0, NULL,
+						  r->req_fd);
+			} else if (now - r->req_time < BAT_TIMEOUT)
+				continue;
+			close(r->req_fd);
+			r->req_fd = -1;
+		}
+		if (pfds[0].revents == 0)
+			continue;
+		if ((cfd = accept(srvfd, NULL, NULL)) < 0)
+			continue;
+		r = &reqs[n];
+		r->req_fd = cfd;
+		r->req_len = 0;
+		r->req_time = now;
+	}
+}
+
+#else /* !_POSIX_C_SOURCE */
+
+/*
+ *	batch mode needs fork(), so it is only available on POSIX systems
+ */
+int bat_main(int argc, char *argv[])
+{
+	UNUSED(argc);
+	UNUSED(argv);
+
+	puts("batch mode not available on this system");
+	fatal(F_USAGE, RELEASE);
+}
+
+#endif /* !_POSIX_C_SOURCE */
@@ -0,0 +1,12 @@
+/*
+ *	Z80/8080-Macro-Assembler
+ *	Copyright (C) 2026 by the z80pack contributors
+ */
+
+#ifndef Z80ABAT_INC
+#define Z80ABAT_INC
+
+extern int bat_mode(int argc, char *argv[]);
+extern int bat_main(int argc, char *argv[]);
+
+#endif /* !Z80ABAT_INC */
@@ -0,0 +1,155 @@
+/*
+ *	Z80/8080-Macro-Assembler
+ *	Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	keyword lookup module, builds perfect hash tables for fixed sets
+ *	of keywords (op-codes, operands, operators), so that a lookup
+ *	needs one hash calculation and a single string compare
+ *
+ *	the keywords are distributed into buckets by their hash value,
+ *	starting with the largest bucket a displacement is searched for
+ *	each bucket, which puts all its keywords into free slots
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "z80asm.h"
+#include "z80akwd.h"
+
+#define KWD_MAXDISP	256	/* number of displacements tried */
+#define KWD_MAXSLOTS	65536U	/* give up, if this doesn't work */
+
+#define KWD_NAME(p)	(*(const char *const *) (p))
+#define KWD_SLOT(kp, h, d) \
+	(((h) + (d) * (((h) >> 16) | 1)) & (kp)->kwd_mask)
+
+static unsigned long kwd_hash(const char *s);
+static int kwd_place(kwd_t *kp, const void **ents, int n,
+		     const unsigned long *hash, const unsigned *bkt,
+		     const unsigned *cnt);
+
+/*
+ *	calculate the hash value of the string s (FNV-1a with a final
+ *	mixing step, the upper half is used for the slot step width)
+ */
+static unsigned long kwd_hash(const char *s)
+{
+	register unsigned long h;
+
+	for (h = 2166136261UL; *s != '\0'; s++)
+		h = ((h ^ (BYTE) *s) * 16777619UL) & 0xffffffffUL;
+	h ^= h >> 16;
+	h = (h * 0x85ebca6bUL) & 0xffffffffUL;
+	h ^= h >> 13;
+	return h;
+}
+
+/*
+ *	try to place the n entries in ents into the slots of kp
+ *	returns FALSE, if there is a bucket without a usable displacement
+ */
+static int kwd_place(kwd_t *kp, const void **ents, int n,
+		     const unsigned long *hash, const unsigned *bkt,
+		     const unsigned *cnt)
+{
+	register int i, j;
+	register unsigned long s;
+	unsigned b, d;
+	int k, placed;
+
+	/* place buckets in order of decreasing size */
+	for (k = n; k > 0; k--)
+		for (b = 0; b < kp->kwd_nbkts; b++) {
+			if (cnt[b] != (unsigned) k)
+				continue;
+			for (d = 0; d < KWD_MAXDISP; d++) {
+				placed = 0;
+				for (i = 0; i < n; i++) {
+					if (bkt[i] != b)
+						continue;
+					s = KWD_SLOT(kp, hash[i], d);
+					if (kp->kwd_slots[s] != NULL)
+						break;
+					kp->kwd_slots[s] = ents[i];
+					placed++;
+				}
+				if (i == n)
+					break;
+				/* collision, take back this try */
+				for (j = 0; placed > 0; j++)
+					if (bkt[j] == b) {
+						s = KWD_SLOT(kp, hash[j], d);
+						kp->kwd_slots[s] = NULL;
+						placed--;
+					}
+			}
+			if (d == KWD_MAXDISP)
+				return FALSE;
+			kp->kwd_disp[b] = (BYTE) d;
+		}
+	return TRUE;
+}
+
+/*
+ *	build the lookup table kp for the n entries in ents
+ */
+void kwd_build(kwd_t *kp, const void **ents, int n)
+{
+	register int i;
+	unsigned long *hash;
+	unsigned *bkt, *cnt;
+	unsigned nslots;
+
+	kp->kwd_nbkts = n / 2 + 1;
+	hash = (unsigned long *) malloc(sizeof(unsigned long) * (n + 1));
+	bkt = (unsigned *) malloc(sizeof(unsigned) * (n + 1));
+	cnt = (unsigned *) calloc(kp->kwd_nbkts, sizeof(unsigned));
+	if (hash == NULL || bkt == NULL || cnt == NULL)
+		fatal(F_OUTMEM, "keyword table");
+	for (i = 0; i < n; i++) {
+		hash[i] = kwd_hash(KWD_NAME(ents[i]));
+		bkt[i] = (unsigned) (hash[i] % kp->kwd_nbkts);
+		cnt[bkt[i]]++;
+	}
+	kp->kwd_slots = NULL;
+	kp->kwd_disp = NULL;
+	/* start with a table at most half full, grow if that fails */
+	for (nslots = 16; nslots < 2 * (unsigned) n; nslots <<= 1)
+		;
+	do {
+		if (nslots > KWD_MAXSLOTS)
+			fatal(F_INTERN, "can't build keyword table");
+		free(kp->kwd_slots);
+		free(kp->kwd_disp);
+		kp->kwd_slots = (const void **) calloc(nslots,
+						       sizeof(const void *));
+		kp->kwd_disp = (BYTE *) calloc(kp->kwd_nbkts, sizeof(BYTE));
+		if (kp->kwd_slots == NULL || kp->kwd_disp == NULL)
+			fatal(F_OUTMEM, "keyword table");
+		kp->kwd_mask = nslots - 1;
+		nslots <<= 1;
+	} while (!kwd_place(kp, ents, n, hash, bkt, cnt));
+	free(cnt);
+	free(bkt);
+	free(hash);
+}
+
+/*
+ *	search keyword s in lookup table kp
+ *	returns pointer to the entry, or NULL if not found
+ */
+const void *kwd_find(const kwd_t *kp, const char *s)
+{
+	register unsigned long h;
+	register const void *p;
+
+	h = kwd_hash(s);
+	p = kp->kwd_slots[KWD_SLOT(kp, h, kp->kwd_disp[h % kp->kwd_nbkts])];
+	if (p != NULL && strcmp(s, KWD_NAME(p)) == 0)
+		return p;
+	return NULL;
+}
@@ -0,0 +1,25 @@
+/*
+ *	Z80/8080-Macro-Assembler
+ *	Copyright (C) 2026 by the z80pack contributors
+ */
+
+#ifndef Z80AKWD_INC
+#define Z80AKWD_INC
+
+#include "z80asm.h"
+
+/*
+ *	structure type keyword lookup table
+ *	the entries are structures with the keyword name as first member
+ */
+typedef struct kwd {
+	const void **kwd_slots;	/* entries, NULL for empty slot */
+	BYTE *kwd_disp;		/* displacement per bucket */
+	unsigned kwd_mask;	/* number of slots - 1 */
+	unsigned kwd_nbkts;	/* number of buckets */
+} kwd_t;
+
+extern void kwd_build(kwd_t *kp, const void **ents, int n);
+extern const void *kwd_find(const kwd_t *kp, const char *s);
+
+#endif /* !Z80AKWD_INC */
@@ -5,6 +5,10 @@
 
 /*
  *	processing of all macro PSEUDO ops
+ *
+ *	macro body lines are compiled when they are added to the macro,
+ *	into literal text with slots for the dummies, so that expansion
+ *	only has to concatenate the text with the parameter values
  */
 
 #include <stddef.h>
@@ -23,10 +27,10 @@
 #define LBRACK		'<'			/* left angle bracket */
 #define RBRACK		'>'			/* right angle bracket */
 
-#define NO_LITERAL	0			/* mac_subst lit_flag values */
+#define NO_LITERAL	0			/* lit_flag values */
 #define LIT_BEFORE	1
 
-#define NO_CONCAT	0			/* mac_subst cat_flag values */
+#define NO_CONCAT	0			/* cat_flag values */
 #define CAT_BEFORE	1
 #define CAT_AFTER	2
 
@@ -35,8 +39,15 @@ typedef struct dum {				/* macro dummy */
 	struct dum *dum_next;			/* next dummy in list */
 } dum_t;
 
+typedef struct seg {				/* compiled line segment */
+	int seg_len;				/* length of literal text */
+	int seg_dum;				/* index of following dummy,
+						   -1 for the last segment */
+} seg_t;
+
 typedef struct line {				/* macro source line */
-	char *line_text;			/* source line */
+	char *line_text;			/* literal text of all segments */
+	seg_t *line_segs;			/* segments of the line */
 	struct line *line_next;			/* next line in list */
 } line_t;
 
@@ -53,6 +64,7 @@ typedef struct mac {				/* macro */
 	WORD mac_nrept;				/* REPT count */
 	char *mac_irp;				/* IRP, IRPC character list */
 	dum_t *mac_dums, *mac_dums_last;	/* macro dummies */
+	int mac_ndums;				/* number of dummies */
 	line_t *mac_lines, *mac_lines_last;	/* macro body */
 	struct mac *mac_prev, *mac_next;	/* prev./next macro in list */
 } mac_t;
@@ -71,7 +83,8 @@ typedef struct loc {				/* expansion local label */
 
 typedef struct expn {				/* macro expansion */
 	mac_t *expn_mac;			/* macro being expanded */
-	parm_t *expn_parms, *expn_parms_last;	/* macro parameters */
+	parm_t *expn_parms;			/* macro parameters, array in
+						   order of the dummies */
 	loc_t *expn_locs, *expn_locs_last;	/* local labels */
 	line_t *expn_line;			/* current expansion line */
 	int expn_cond_state[COND_STATE_SIZE];	/* cond state before expn */
@@ -80,6 +93,8 @@ typedef struct expn {				/* macro expansion */
 	struct expn *expn_next;			/* next expansion in list */
 } expn_t;
 
+static void mac_compile(mac_t *m, line_t *l, char *s);
+
 static mac_t *mac_table;		/* MACRO table */
 static mac_t *mac_curr;			/* current macro */
 static mac_t **mac_array;		/* sorted table for iterator */
@@ -92,6 +107,7 @@ static int mac_count;			/* number of macros defined */
 static expn_t *mac_expn;		/* macro expansion stack */
 static WORD mac_loc_cnt;		/* counter for LOCAL labels */
 static char tmp[MAXLINE + 1];		/* temporary buffer */
+static const char dblcom[] = { COMMENT, COMMENT, '\0' };
 
 /*
  *	return current macro definition nesting level
@@ -228,6 +244,7 @@ static mac_t *mac_new(const char *name, start_func_t *start, rept_func_t *rept)
 	m->mac_nrept = 0;
 	m->mac_irp = NULL;
 	m->mac_dums_last = m->mac_dums = NULL;
+	m->mac_ndums = 0;
 	m->mac_lines_last = m->mac_lines = NULL;
 	m->mac_next = m->mac_prev = NULL;
 	return m;
@@ -251,6 +268,7 @@ static void mac_delete(mac_t *m)
 	for (l = m->mac_lines; l != NULL; l = l1) {
 		l1 = l->line_next;
 		free(l->line_text);
+		free(l->line_segs);
 		free(l);
 	}
 	if (m->mac_irp != NULL)
@@ -302,6 +320,21 @@ static void mac_add_dum(mac_t *m, char *name)
 	else
 		m->mac_dums_last->dum_next = d;
 	m->mac_dums_last = d;
+	m->mac_ndums++;
+}
+
+/*
+ *	return index of dummy name in macro m, or -1 if not a dummy
+ */
+static int mac_dum_index(mac_t *m, const char *name)
+{
+	register dum_t *d;
+	register int i;
+
+	for (d = m->mac_dums, i = 0; d != NULL; d = d->dum_next, i++)
+		if (strcmp(d->dum_name, name) == 0)
+			return i;
+	return -1;
 }
 
 /*
@@ -355,6 +388,7 @@ static void mac_start_expn(mac_t *m, char *operand)
 	register parm_t *p;
 	register dum_t *d;
 	expn_t *e1;
+	int i;
 
 	if (mac_exp_nest == MACNEST) {
 		/* abort macro expansion */
@@ -372,19 +406,18 @@ static void mac_start_expn(mac_t *m, char *operand)
 	if ((e = (expn_t *) malloc(sizeof(expn_t))) == NULL)
 		fatal(F_OUTMEM, "macro expansion");
 	e->expn_mac = m;
-	e->expn_parms_last = e->expn_parms = NULL;
-	for (d = m->mac_dums; d != NULL; d = d->dum_next) {
-		p = (parm_t *) malloc(sizeof(parm_t));
+	e->expn_parms = NULL;
+	if (m->mac_ndums > 0) {
+		p = (parm_t *) malloc(sizeof(parm_t) * m->mac_ndums);
 		if (p == NULL)
 			fatal(F_OUTMEM, "macro parameter");
-		p->parm_name = d->dum_name;
-		p->parm_val = NULL;
-		p->parm_next = NULL;
-		if (e->expn_parms == NULL)
-			e->expn_parms = p;
-		else
-			e->expn_parms_last->parm_next = p;
-		e->expn_parms_last = p;
+		e->expn_parms = p;
+		for (d = m->mac_dums, i = 0; d != NULL;
+		     d = d->dum_next, i++, p++) {
+			p->parm_name = d->dum_name;
+			p->parm_val = NULL;
+			p->parm_next = (i < m->mac_ndums - 1) ? p + 1 : NULL;
+		}
 	}
 	e->expn_locs_last = e->expn_locs = NULL;
 	e->expn_line = m->mac_lines;
@@ -408,16 +441,14 @@ static void mac_end_expn(void)
 	register loc_t *l;
 	register expn_t *e;
 	mac_t *m;
-	parm_t *p1;
 	loc_t *l1;
 
 	e = mac_expn;
-	for (p = e->expn_parms; p != NULL; p = p1) {
-		p1 = p->parm_next;
+	for (p = e->expn_parms; p != NULL; p = p->parm_next)
 		if (p->parm_val != NULL)
 			free(p->parm_val);
-		free(p);
-	}
+	if (e->expn_parms != NULL)
+		free(e->expn_parms);
 	for (l = e->expn_locs; l != NULL; l = l1) {
 		l1 = l->loc_next;
 		free(l->loc_name);
@@ -473,9 +504,9 @@ void mac_add_line(opc_t *op, char *line)
 
 	if ((l = (line_t *) malloc(sizeof(line_t))) == NULL)
 		fatal(F_OUTMEM, "macro body line");
-	l->line_text = strsave(line);
-	l->line_next = NULL;
 	m = mac_curr;
+	mac_compile(m, l, line);
+	l->line_next = NULL;
 	if (m->mac_lines == NULL)
 		m->mac_lines = l;
 	else
@@ -496,19 +527,6 @@ void mac_add_line(opc_t *op, char *line)
 	}
 }
 
-/*
- *	get value of dummy s, NULL if not found
- */
-static const char *mac_get_dummy(expn_t *e, char *s)
-{
-	register parm_t *p;
-
-	for (p = e->expn_parms; p != NULL; p = p->parm_next)
-		if (strcmp(p->parm_name, s) == 0)
-			return p->parm_val == NULL ? "" : p->parm_val;
-	return NULL;
-}
-
 /*
  *	get value of local label s, NULL if not found
  */
@@ -523,11 +541,193 @@ static const char *mac_get_local(expn_t *e, char *s)
 }
 
 /*
- *	substitute dummies or locals with actual values in source line s
+ *	compile source line s of macro m into l
+ *	splits the line into literal text and the dummies in it,
+ *	with the same rules mac_subst() uses for local labels
+ */
+static void mac_compile(mac_t *m, line_t *l, char *s)
+{
+	register char *t;
+	register int i;
+	register int cat_flag;
+	char *s1, *t1, *run, c;
+	int lit_flag, nsegs;
+	char buf[MAXLINE + 1], name[MAXLINE + 1];
+	seg_t segs[MAXLINE + 1];
+
+	t = run = buf;
+	nsegs = 0;
+	if (*s == LINCOM || (*s == LINOPT && !IS_SYM(*(s + 1)))) {
+		strcpy(t, s);
+		t += strlen(t);
+		s += strlen(s);
+	}
+	cat_flag = NO_CONCAT;
+	lit_flag = NO_LITERAL;
+	while (*s != '\0') {
+		if (IS_FSYM(*s)) {
+			/* gather symbol */
+			s1 = s;
+			t1 = name;
+			*t1++ = TO_UPP(*s);
+			s++;
+			while (IS_SYM(*s)) {
+				*t1++ = TO_UPP(*s);
+				s++;
+			}
+			*t1 = '\0';
+			i = mac_dum_index(m, name);
+			/* don't substitute dummy if leading LITERAL */
+			if (i < 0 || lit_flag == LIT_BEFORE) {
+				/* remove leading LITERAL if dummy */
+				if (i >= 0 && lit_flag == LIT_BEFORE)
+					t--;
+				while (s1 < s)
+					*t++ = *s1++;
+				cat_flag = NO_CONCAT;
+				lit_flag = NO_LITERAL;
+				continue;
+			}
+			/* remove leading CONCAT */
+			if (cat_flag == CAT_BEFORE)
+				t--;
+			/* end segment with dummy */
+			segs[nsegs].seg_len = t - run;
+			segs[nsegs++].seg_dum = i;
+			run = t;
+			/* skip trailing CONCAT */
+			if (*s == CONCAT) {
+				cat_flag = CAT_AFTER;
+				s++;
+			} else
+				cat_flag = NO_CONCAT;
+			lit_flag = NO_LITERAL;
+		} else if (*s == STRDEL || *s == STRDEL2) {
+			*t++ = c = *s++;
+			cat_flag = NO_CONCAT;
+			while (TRUE) {
+				if (*s == '\0') {
+					/* undelimited, don't complain here,
+					   could be EX AF,AF' */
+					break;
+				} else if (*s == c) {
+					cat_flag = NO_CONCAT;
+					*t++ = *s++;
+					if (*s != c) /* double delim? */
+						break;
+					else {
+						*t++ = *s++;
+						continue;
+					}
+				} else if (!IS_FSYM(*s)) {
+					if (*s == CONCAT)
+						cat_flag = CAT_BEFORE;
+					else
+						cat_flag = NO_CONCAT;
+					*t++ = *s++;
+					continue;
+				}
+				/* gather symbol */
+				t1 = t;
+				*t++ = *s++;
+				while (IS_SYM(*s))
+					*t++ = *s++;
+				/* subst. poss. dummy if CONCAT before/after */
+				if (cat_flag != NO_CONCAT || *s == CONCAT) {
+					*t = '\0';
+					/* not a dummy? */
+					if ((i = mac_dum_index(m, t1)) < 0) {
+						cat_flag = NO_CONCAT;
+						continue;
+					}
+					t = t1;
+					/* remove leading CONCAT */
+					if (cat_flag == CAT_BEFORE)
+						t--;
+					/* end segment with dummy */
+					segs[nsegs].seg_len = t - run;
+					segs[nsegs++].seg_dum = i;
+					run = t;
+					/* skip trailing CONCAT */
+					if (*s == CONCAT) {
+						cat_flag = CAT_AFTER;
+						s++;
+					} else
+						cat_flag = NO_CONCAT;
+				}
+			}
+			lit_flag = NO_LITERAL;
+		} else if (*s == COMMENT) {
+			/* don't copy double COMMENT comments */
+			if (*(s + 1) != COMMENT) {
+				strcpy(t, s);
+				t += strlen(t);
+			}
+			break;
+		} else {
+			cat_flag = NO_CONCAT;
+			lit_flag = NO_LITERAL;
+			if (*s == CONCAT)
+				cat_flag = CAT_BEFORE;
+			else if (*s == LITERAL)
+				lit_flag = LIT_BEFORE;
+			*t++ = *s++;
+		}
+	}
+	segs[nsegs].seg_len = t - run;
+	segs[nsegs++].seg_dum = -1;
+	*t = '\0';
+	l->line_text = strsave(buf);
+	if ((l->line_segs = (seg_t *) malloc(sizeof(seg_t) * nsegs)) == NULL)
+		fatal(F_OUTMEM, "macro body line");
+	memcpy(l->line_segs, segs, sizeof(seg_t) * nsegs);
+}
+
+/*
+ *	expand compiled line l with the parameter values of expansion e
+ *	returns the result in t
+ */
+static void mac_fill(char *t, line_t *l, expn_t *e)
+{
+	register const char *s, *v;
+	register seg_t *sp;
+	register int n;
+	int m;
+
+	s = l->line_text;
+	m = MAXLINE;
+	for (sp = l->line_segs; ; sp++) {
+		if ((n = sp->seg_len) > m) {
+			asmerr(E_MACOVF);
+			break;
+		}
+		memcpy(t, s, n);
+		t += n;
+		s += n;
+		m -= n;
+		if (sp->seg_dum < 0)
+			break;
+		if ((v = e->expn_parms[sp->seg_dum].parm_val) == NULL)
+			continue;
+		if ((n = strlen(v)) > m) {
+			/* copy as much as fits */
+			memcpy(t, v, m);
+			t += m;
+			asmerr(E_MACOVF);
+			break;
+		}
+		memcpy(t, v, n);
+		t += n;
+		m -= n;
+	}
+	*t = '\0';
+}
+
+/*
+ *	substitute locals with actual values in source line s
  *	returns the result in t
  */
-static void mac_subst(char *t, char *s, expn_t *e,
-		      const char *(*getf)(expn_t *e, char *s))
+static void mac_subst(char *t, char *s, expn_t *e)
 {
 	register const char *v;
 	register int m;
@@ -554,7 +754,7 @@ static void mac_subst(char *t, char *s, expn_t *e,
 				s++;
 			}
 			*t = '\0';
-			v = (*getf)(e, t1);
+			v = mac_get_local(e, t1);
 			/* don't substitute dummy if leading LITERAL */
 			if (v == NULL || lit_flag == LIT_BEFORE) {
 				t = s;
@@ -624,7 +824,7 @@ static void mac_subst(char *t, char *s, expn_t *e,
 				/* subst. poss. dummy if CONCAT before/after */
 				if (cat_flag != NO_CONCAT || *s == CONCAT) {
 					*t = '\0';
-					v = (*getf)(e, t1);
+					v = mac_get_local(e, t1);
 					/* not a dummy? */
 					if (v == NULL) {
 						cat_flag = NO_CONCAT;
@@ -683,10 +883,14 @@ char *mac_expand(char *line)
 	e = mac_expn;
 	if (e->expn_line == NULL && !mac_rept_expn())
 		return NULL;
-	/* first substitute dummies with parameter values */
-	mac_subst(tmp, e->expn_line->line_text, e, mac_get_dummy);
-	/* next substitute local labels with ??xxxx */
-	mac_subst(line, tmp, e, mac_get_local);
+	/* first fill in parameter values */
+	mac_fill(line, e->expn_line, e);
+	/* next substitute local labels with ??xxxx, without locals this
+	   only removes double COMMENT comments of parameter values */
+	if (e->expn_locs != NULL || strstr(line, dblcom) != NULL) {
+		strcpy(tmp, line);
+		mac_subst(line, tmp, e);
+	}
 	e->expn_line = e->expn_line->line_next;
 	return line;
 }
@@ -12,10 +12,21 @@
 #include <string.h>
 
 #include "z80asm.h"
+#include "z80akwd.h"
+#include "z80aobj.h"
 #include "z80atab.h"
 #include "z80anum.h"
 
-static int expr(WORD *resultp);
+/*
+ *	structure type value with its relocation
+ */
+typedef struct val {
+	WORD v;			/* value */
+	reloc_t r;		/* relocation of value */
+} val_t;
+
+static int expr(val_t *resultp);
+static int rel_opr(BYTE opr_type, val_t *lp, const val_t *rp);
 
 BYTE ctype[256];		/* table for character classification */
 
@@ -59,7 +70,6 @@ typedef struct opr {
 
 /*
  *	table with operators
- *	must be sorted in ascending order!
  */
 static opr_t oprtab[] = {
 	{ "AND",	T_AND		},
@@ -81,12 +91,18 @@ static opr_t oprtab[] = {
 	{ "XOR",	T_XOR		}
 };
 static int no_operators = sizeof(oprtab) / sizeof(opr_t);
+static kwd_t oprkwd;			/* operators lookup table */
 
 static BYTE tok_type;			/* token type and flags */
 static WORD tok_val;			/* token value for T_VAL type */
+static int tok_seg;			/* token segment for T_VAL type */
+static const char *tok_ext;		/* external symbol for T_VAL type */
 static char tok_sym[MAXLINE + 1];	/* buffer for symbol/number */
 static char *scan_pos;			/* current scanning position */
 static int radix;			/* current radix */
+static reloc_t last_rel;		/* relocation of last eval() result */
+static int rel_pend;			/* relocatable result not yet used */
+static int eval_err;			/* last eval() failed */
 
 void init_ctype(void)
 {
@@ -116,27 +132,23 @@ void init_ctype(void)
 }
 
 /*
- *	do binary search for operator s in sorted table oprtab
+ *	search operator s in lookup table oprkwd, built on first use
  *	returns symbol for operator or T_UNDSYM if not found
  */
 static BYTE search_opr(char *s)
 {
-	register opr_t *low, *mid;
-	register opr_t *high;
-	int cond;
-
-	low = &oprtab[0];
-	high = &oprtab[no_operators - 1];
-	while (low <= high) {
-		mid = low + (high - low) / 2;
-		if ((cond = strcmp(s, mid->opr_name)) < 0)
-			high = mid - 1;
-		else if (cond > 0)
-			low = mid + 1;
-		else
-			return mid->opr_type;
+	register const opr_t *p;
+	register int i;
+	const void *ents[sizeof(oprtab) / sizeof(opr_t)];
+
+	if (oprkwd.kwd_slots == NULL) {
+		for (i = 0; i < no_operators; i++)
+			ents[i] = &oprtab[i];
+		kwd_build(&oprkwd, ents, no_operators);
 	}
-	return T_UNDSYM;
+	if ((p = (const opr_t *) kwd_find(&oprkwd, s)) == NULL)
+		return T_UNDSYM;
+	return p->opr_type;
 }
 
 /*
@@ -169,6 +181,8 @@ static int get_token(void)
 
 	s = scan_pos;
 	tok_val = 0;
+	tok_seg = SEG_ABS;
+	tok_ext = NULL;
 	while (IS_SPC(*s))				/* skip white space */
 		s++;
 	if (*s == '\0') {				/* nothing there? */
@@ -238,6 +252,7 @@ static int get_token(void)
 		if (*p1 == '$' && *(p1 + 1) == '\0') {	/* location counter */
 			tok_type = T_VAL;
 			tok_val = get_pc();
+			tok_seg = get_seg();
 		} else {				/* symbol / word opr */
 			n = get_symlen();
 			if ((p2 - p1) > n)		/* trim for lookup */
@@ -245,6 +260,9 @@ static int get_token(void)
 			if ((sp = get_sym(tok_sym)) != NULL) { /* a symbol */
 				tok_type = T_VAL;
 				tok_val = sp->sym_val;
+				tok_seg = sp->sym_seg;
+				if (tok_seg == SEG_EXT)
+					tok_ext = sp->sym_name;
 			} else				/* look for word opr */
 				tok_type = search_opr(p1);
 		}
@@ -351,19 +369,26 @@ static int get_token(void)
  *	inspired by the previous expression parser by Didier Derny.
  */
 
-static int factor(WORD *resultp)
+static int factor(val_t *resultp)
 {
 	register int err, erru;
 	register char *s;
 	BYTE opr_type;
-	WORD value;
+	val_t value;
 
+	resultp->r.rel_seg = SEG_ABS;
+	resultp->r.rel_kind = R_WORD;
+	resultp->r.rel_ext = NULL;
 	switch (tok_type) {
 	case T_VAL:
-		value = tok_val;
+		value.v = tok_val;
+		value.r.rel_seg = tok_seg;
+		value.r.rel_ext = tok_ext;
 		if ((err = get_token()) != E_OK)
 			return err;
-		*resultp = value;
+		resultp->v = resultp->r.rel_off = value.v;
+		resultp->r.rel_seg = value.r.rel_seg;
+		resultp->r.rel_ext = value.r.rel_ext;
 		return E_OK;
 	case T_UNDSYM:
 		if ((err = get_token()) != E_OK)
@@ -377,9 +402,9 @@ static int factor(WORD *resultp)
 		if (*s == '\0' || (((*s == STRDEL && *(s + 1) == STRDEL)
 				    || (*s == STRDEL2 && *(s + 1) == STRDEL2))
 				   && *(s + 2) == '\0'))
-			*resultp = -1;
+			resultp->v = -1;
 		else
-			*resultp = 0;
+			resultp->v = 0;
 		/* short circuit parsing to end of expression */
 		while (*s != '\0')
 			s++;
@@ -388,9 +413,9 @@ static int factor(WORD *resultp)
 		return E_OK;
 	case T_TYPE:
 		if (get_token() != E_OK || factor(&value) != E_OK)
-			*resultp = 0;
+			resultp->v = 0;
 		else
-			*resultp = 0x20; /* local defined absolute */
+			resultp->v = 0x20; /* local defined absolute */
 		return E_OK;
 	case T_ADD:
 	case T_SUB:
@@ -401,21 +426,29 @@ static int factor(WORD *resultp)
 		if ((err = get_token()) != E_OK
 		    || (err = factor(&value)) != E_OK)
 			return err;
+		*resultp = value;
+		if (value.r.rel_seg != SEG_ABS && opr_type != T_ADD) {
+			/* only HIGH and LOW of a word can be relocated */
+			if ((opr_type != T_HIGH && opr_type != T_LOW)
+			    || value.r.rel_kind != R_WORD)
+				return E_RELEXP;
+			resultp->r.rel_kind = (opr_type == T_HIGH) ? R_HIGH
+								   : R_LOW;
+		}
 		switch (opr_type) {
 		case T_ADD:
-			*resultp = value;
 			break;
 		case T_SUB:
-			*resultp = -value;
+			resultp->v = -value.v;
 			break;
 		case T_NOT:
-			*resultp = ~value;
+			resultp->v = ~value.v;
 			break;
 		case T_HIGH:
-			*resultp = value >> 8;
+			resultp->v = value.v >> 8;
 			break;
 		case T_LOW:
-			*resultp = value & 0xff;
+			resultp->v = value.v & 0xff;
 			break;
 		default:
 			break;
@@ -442,11 +475,11 @@ static int factor(WORD *resultp)
 	}
 }
 
-static int mul_term(WORD *resultp)
+static int mul_term(val_t *resultp)
 {
 	register int err, erru;
 	register BYTE opr_type;
-	WORD value;
+	val_t value;
 
 	if ((erru = factor(resultp)) > E_UNDSYM)
 		return erru;
@@ -463,36 +496,38 @@ static int mul_term(WORD *resultp)
 		}
 		switch (opr_type) {
 		case T_MUL:
-			*resultp *= value;
+			resultp->v *= value.v;
 			break;
 		case T_DIV:
-			if (value == 0)		/* don't crash on div by 0 */
+			if (value.v == 0)	/* don't crash on div by 0 */
 				return E_DIVBY0;
-			*resultp /= value;
+			resultp->v /= value.v;
 			break;
 		case T_MOD:
-			if (value == 0)		/* don't crash on mod by 0 */
+			if (value.v == 0)	/* don't crash on mod by 0 */
 				return E_DIVBY0;
-			*resultp %= value;
+			resultp->v %= value.v;
 			break;
 		case T_SHR:
-			*resultp >>= value;
+			resultp->v >>= value.v;
 			break;
 		case T_SHL:
-			*resultp <<= value;
+			resultp->v <<= value.v;
 			break;
 		default:
 			break;
 		}
+		if ((err = rel_opr(opr_type, resultp, &value)) != E_OK)
+			return err;
 	}
 	return erru;
 }
 
-static int add_term(WORD *resultp)
+static int add_term(val_t *resultp)
 {
 	register int err, erru;
 	register BYTE opr_type;
-	WORD value;
+	val_t value;
 
 	if ((erru = mul_term(resultp)) > E_UNDSYM)
 		return erru;
@@ -508,23 +543,25 @@ static int add_term(WORD *resultp)
 		}
 		switch (opr_type) {
 		case T_ADD:
-			*resultp += value;
+			resultp->v += value.v;
 			break;
 		case T_SUB:
-			*resultp -= value;
+			resultp->v -= value.v;
 			break;
 		default:
 			break;
 		}
+		if ((err = rel_opr(opr_type, resultp, &value)) != E_OK)
+			return err;
 	}
 	return erru;
 }
 
-static int cmp_term(WORD *resultp)
+static int cmp_term(val_t *resultp)
 {
 	register int err, erru;
 	register BYTE opr_type;
-	WORD value;
+	val_t value;
 
 	if ((erru = add_term(resultp)) > E_UNDSYM)
 		return erru;
@@ -542,35 +579,37 @@ static int cmp_term(WORD *resultp)
 		}
 		switch (opr_type) {
 		case T_EQ:
-			*resultp = (*resultp == value) ? -1 : 0;
+			resultp->v = (resultp->v == value.v) ? -1 : 0;
 			break;
 		case T_NE:
-			*resultp = (*resultp != value) ? -1 : 0;
+			resultp->v = (resultp->v != value.v) ? -1 : 0;
 			break;
 		case T_LT:
-			*resultp = (*resultp < value) ? -1 : 0;
+			resultp->v = (resultp->v < value.v) ? -1 : 0;
 			break;
 		case T_LE:
-			*resultp = (*resultp <= value) ? -1 : 0;
+			resultp->v = (resultp->v <= value.v) ? -1 : 0;
 			break;
 		case T_GT:
-			*resultp = (*resultp > value) ? -1 : 0;
+			resultp->v = (resultp->v > value.v) ? -1 : 0;
 			break;
 		case T_GE:
-			*resultp = (*resultp >= value) ? -1 : 0;
+			resultp->v = (resultp->v >= value.v) ? -1 : 0;
 			break;
 		default:
 			break;
 		}
+		if ((err = rel_opr(opr_type, resultp, &value)) != E_OK)
+			return err;
 	}
 	return erru;
 }
 
-static int expr(WORD *resultp)
+static int expr(val_t *resultp)
 {
 	register int err, erru;
 	register BYTE opr_type;
-	WORD value;
+	val_t value;
 
 	if ((erru = cmp_term(resultp)) > E_UNDSYM)
 		return erru;
@@ -586,35 +625,88 @@ static int expr(WORD *resultp)
 		}
 		switch (opr_type) {
 		case T_AND:
-			*resultp &= value;
+			resultp->v &= value.v;
 			break;
 		case T_XOR:
-			*resultp ^= value;
+			resultp->v ^= value.v;
 			break;
 		case T_OR:
-			*resultp |= value;
+			resultp->v |= value.v;
 			break;
 		default:
 			break;
 		}
+		if ((err = rel_opr(opr_type, resultp, &value)) != E_OK)
+			return err;
 	}
 	return erru;
 }
 
+/*
+ *	determine relocation of the result of binary operator opr_type
+ *	with operands *lp and *rp, the result value is already in *lp
+ *	only a relocatable value plus/minus an absolute one, and the
+ *	difference or comparison of two values of the same segment
+ *	are allowed
+ *	returns E_OK, or E_RELEXP if the result can't be relocated
+ */
+static int rel_opr(BYTE opr_type, val_t *lp, const val_t *rp)
+{
+	if (lp->r.rel_seg == SEG_ABS && rp->r.rel_seg == SEG_ABS)
+		return E_OK;
+	if (lp->r.rel_kind != R_WORD || rp->r.rel_kind != R_WORD)
+		return E_RELEXP;
+	switch (opr_type) {
+	case T_ADD:
+		if (lp->r.rel_seg == SEG_ABS)
+			lp->r = rp->r;
+		else if (rp->r.rel_seg != SEG_ABS)
+			return E_RELEXP;
+		lp->r.rel_off = lp->v;
+		return E_OK;
+	case T_SUB:
+		if (rp->r.rel_seg == SEG_ABS) {
+			lp->r.rel_off = lp->v;
+			return E_OK;
+		}
+		/* fall through */
+	case T_EQ:
+	case T_NE:
+	case T_LT:
+	case T_LE:
+	case T_GT:
+	case T_GE:
+		if (lp->r.rel_seg == rp->r.rel_seg
+		    && lp->r.rel_seg != SEG_EXT) {
+			lp->r.rel_seg = SEG_ABS;
+			return E_OK;
+		}
+		return E_RELEXP;
+	default:
+		return E_RELEXP;
+	}
+}
+
 /*
  *	parse and evaluate string s
+ *	the relocation of the result is kept for the relocation functions
  *	returns result if valid expression, otherwise 0 and error message
  */
 WORD eval(char *s)
 {
 	register int err;
-	WORD result;
+	val_t result;
 
+	chk_reloc();
+	last_rel.rel_seg = SEG_ABS;
+	last_rel.rel_kind = R_WORD;
+	last_rel.rel_ext = NULL;
+	eval_err = TRUE;
 	if (s == NULL || *s == '\0') {
 		asmerr(E_MISOPE);
 		return 0;
 	}
-	result = 0;
+	result.v = 0;
 	scan_pos = s;
 	if ((err = get_token()) != E_OK || (err = expr(&result)) != E_OK) {
 		asmerr(err);
@@ -622,8 +714,75 @@ WORD eval(char *s)
 	} else if (tok_type != T_EMPTY) {	/* leftovers, error out */
 		asmerr(E_INVEXP);
 		return 0;
-	} else
-		return result;
+	} else {
+		last_rel = result.r;
+		rel_pend = (last_rel.rel_seg != SEG_ABS);
+		eval_err = FALSE;
+		return result.v;
+	}
+}
+
+/*
+ *	returns the segment of the last eval() result, which must
+ *	be a word not relative to an external symbol
+ */
+int get_rel_seg(void)
+{
+	rel_pend = FALSE;
+	if (last_rel.rel_seg == SEG_EXT || last_rel.rel_kind != R_WORD) {
+		asmerr(E_RELEXP);
+		return SEG_ABS;
+	}
+	return last_rel.rel_seg;
+}
+
+/*
+ *	error, if the last eval() result was relocatable and not used
+ *	by a function which knows how to relocate it
+ */
+void chk_reloc(void)
+{
+	if (rel_pend) {
+		rel_pend = FALSE;
+		asmerr(E_RELEXP);
+	}
+}
+
+/*
+ *	relocate the last eval() result, which was stored as word
+ *	(size 2) or byte (size 1) at offset off of the opcodes
+ */
+void reloc_ops(WORD off, int size)
+{
+	reloc_t r;
+
+	if (!rel_pend)
+		return;
+	rel_pend = FALSE;
+	r = last_rel;
+	if (size == 2 ? r.rel_kind != R_WORD : r.rel_kind == R_WORD)
+		asmerr(E_RELEXP);
+	else
+		obj_reloc(off, &r);
+}
+
+/*
+ *	evaluate string s as target of a relative jump, which
+ *	must be in the segment of the program counter
+ *	returns the displacement to the next instruction as BYTE
+ */
+BYTE eval_disp(char *s)
+{
+	register WORD w;
+
+	w = eval(s);
+	rel_pend = FALSE;
+	if (!eval_err && (last_rel.rel_seg != get_seg()
+			  || last_rel.rel_kind != R_WORD)) {
+		asmerr(E_RELEXP);
+		return 0;
+	}
+	return chk_sbyte(w - get_pc() - 2);
 }
 
 /*
@@ -8,6 +8,7 @@
 #define Z80ANUM_INC
 
 #include "z80asm.h"
+#include "z80aobj.h"
 
 extern BYTE ctype[256];
 
@@ -37,6 +38,10 @@ extern void init_ctype(void);
 extern void set_radix(int r);
 extern int get_radix(void);
 extern WORD eval(char *s);
+extern int get_rel_seg(void);
+extern void chk_reloc(void);
+extern void reloc_ops(WORD off, int size);
+extern BYTE eval_disp(char *s);
 extern BYTE chk_byte(WORD w);
 extern BYTE chk_sbyte(WORD w);
 
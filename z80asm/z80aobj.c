@@ -6,6 +6,21 @@
 
 /*
  *	module for output functions to object files
+ *
+ *	the relocatable object file is a text file with one record per line,
+ *	segments are A (absolute), C (code), D (data), and X (external),
+ *	all numbers are hexadecimal:
+ *
+ *	Z80REL 1 file			header with format version
+ *	T seg addr bytes		bytes at addr of segment seg
+ *	R seg addr kind base off [name]	relocation of the value at addr,
+ *					kind is W (word), L (low byte),
+ *					or H (high byte), base is the
+ *					segment or X for external symbol name
+ *	P seg addr name			public symbol
+ *	X name				external symbol
+ *	S seg size			size of code or data segment
+ *	E seg addr			execution start address
  */
 
 #include <stddef.h>
@@ -21,6 +36,7 @@ static void cary_byte(BYTE b);
 
 static void eof_hex(WORD addr);
 static void flush_hex(void);
+static void rel_text(void);
 static void hex_record(BYTE rec_type);
 static char *btoh(BYTE b, char *p);
 static BYTE chksum(BYTE rec_type);
@@ -43,6 +59,8 @@ static const char *objfn;		/* object filename */
 static FILE *objfp;			/* file pointer for object code */
 static WORD load_addr;			/* load address of program */
 static WORD start_addr;			/* execution start addr of program */
+static int  start_seg;			/* segment of start address */
+static int  start_flag;			/* start address was set */
 static WORD curr_addr;			/* current logical file address */
 static WORD eof_addr;			/* address at binary/C end of file */
 static WORD hex_addr;			/* current address in HEX record */
@@ -54,6 +72,17 @@ static int  hexlen;			/* HEX record length */
 static int  carylen;			/* C array bytes per line */
 static int  nofill_flag;		/* don't fill up object code flag */
 
+static int  rel_seg;			/* current segment in REL file */
+static WORD seg_size[SEG_EXT];		/* sizes of segments in REL file */
+static int  fix_cnt;			/* relocations of current opcodes */
+static struct {
+	WORD off;			/* offset in opcodes */
+	reloc_t rel;			/* relocation */
+} fix_buf[OPCARRAY];
+
+static const char seg_chr[] = "ACDX";	/* segment names in REL file */
+static const char kind_chr[] = "WLH";	/* relocation kinds in REL file */
+
 static BYTE hex_buf[MAXHEX];		/* buffer for one HEX record */
 static char hex_out[MAXHEX * 2 + 13];	/* ASCII buffer for one HEX record */
 
@@ -64,7 +93,8 @@ static const struct {
 	{ OBJEXTBIN, WRITEB },	/* OBJ_BIN */
 	{ OBJEXTBIN, WRITEB },	/* OBJ_MOS */
 	{ OBJEXTHEX, WRITEA },	/* OBJ_HEX */
-	{ OBJEXTCARY, WRITEA }	/* OBJ_CARY */
+	{ OBJEXTCARY, WRITEA },	/* OBJ_CARY */
+	{ OBJEXTREL, WRITEA }	/* OBJ_REL */
 };
 
 /*
@@ -139,6 +169,10 @@ void obj_header(const char *fn)
 		nl_size = after_nl - before_nl;
 		eof_addr = load_addr;
 		break;
+	case OBJ_REL:
+		if (fprintf(objfp, "Z80REL 1 %s\n", fn) < 0)
+			fatal(F_OBJFILE, objfn);
+		break;
 	default:
 		fatal(F_INTERN, "invalid obj_fmt for function obj_header");
 		break;
@@ -181,6 +215,15 @@ void obj_end(void)
 				fatal(F_OBJFILE, objfn);
 		}
 		break;
+	case OBJ_REL:
+		flush_hex();
+		if (fprintf(objfp, "S C %04X\nS D %04X\n",
+			    seg_size[SEG_CODE], seg_size[SEG_DATA]) < 0)
+			fatal(F_OBJFILE, objfn);
+		if (start_flag && fprintf(objfp, "E %c %04X\n",
+					  seg_chr[start_seg], start_addr) < 0)
+			fatal(F_OBJFILE, objfn);
+		break;
 	default:
 		fatal(F_INTERN, "invalid obj_fmt for function obj_end");
 		break;
@@ -188,11 +231,13 @@ void obj_end(void)
 }
 
 /*
- *	set execution start address of program
+ *	set execution start address of program in segment seg
  */
-void obj_start_addr(WORD addr)
+void obj_start_addr(int seg, WORD addr)
 {
+	start_seg = seg;
 	start_addr = addr;
+	start_flag = TRUE;
 }
 
 /*
@@ -216,15 +261,61 @@ void obj_org(WORD addr)
 	curr_addr = addr;
 }
 
+/*
+ *	switch REL file to segment seg at logical address addr
+ */
+void obj_seg(int seg, WORD addr)
+{
+	if (obj_fmt == OBJ_REL && seg != rel_seg) {
+		flush_hex();
+		rel_seg = seg;
+	}
+	curr_addr = addr;
+}
+
+/*
+ *	add relocation rp for the value at offset off of the opcodes
+ *	written next with obj_writeb()
+ */
+void obj_reloc(WORD off, const reloc_t *rp)
+{
+	if (obj_fmt != OBJ_REL)
+		return;
+	fix_buf[fix_cnt].off = off;
+	fix_buf[fix_cnt].rel = *rp;
+	fix_cnt++;
+}
+
+/*
+ *	write public symbol name at addr of segment seg into REL file
+ */
+void obj_public(const char *name, int seg, WORD addr)
+{
+	if (fprintf(objfp, "P %c %04X %s\n", seg_chr[seg], addr, name) < 0)
+		fatal(F_OBJFILE, objfn);
+}
+
+/*
+ *	write external symbol name into REL file
+ */
+void obj_extern(const char *name)
+{
+	if (fprintf(objfp, "X %s\n", name) < 0)
+		fatal(F_OBJFILE, objfn);
+}
+
 /*
  *	write opcodes in ops[] into object file
  */
 void obj_writeb(const BYTE *ops, WORD op_cnt)
 {
 	register int i;
+	register const reloc_t *rp;
 
-	if (op_cnt == 0)
+	if (op_cnt == 0) {
+		fix_cnt = 0;
 		return;
+	}
 	switch (obj_fmt) {
 	case OBJ_BIN:
 	case OBJ_MOS:
@@ -245,6 +336,21 @@ void obj_writeb(const BYTE *ops, WORD op_cnt)
 		if (curr_addr > eof_addr)
 			eof_addr = curr_addr;
 		break;
+	case OBJ_REL:
+		for (i = 0; i < fix_cnt; i++) {
+			rp = &fix_buf[i].rel;
+			if (fprintf(objfp, "R %c %04X %c %c %04X%s%s\n",
+				    seg_chr[rel_seg],
+				    (WORD) (curr_addr + fix_buf[i].off),
+				    kind_chr[rp->rel_kind],
+				    seg_chr[rp->rel_seg], rp->rel_off,
+				    rp->rel_ext != NULL ? " " : "",
+				    rp->rel_ext != NULL ? rp->rel_ext : "")
+			    < 0)
+				fatal(F_OBJFILE, objfn);
+		}
+		fix_cnt = 0;
+		/* fall through */
 	case OBJ_HEX:
 		if (hex_addr + hex_cnt != curr_addr)
 			flush_hex();
@@ -254,6 +360,8 @@ void obj_writeb(const BYTE *ops, WORD op_cnt)
 			hex_buf[hex_cnt++] = ops[i++];
 			curr_addr++;
 		}
+		if (obj_fmt == OBJ_REL && curr_addr > seg_size[rel_seg])
+			seg_size[rel_seg] = curr_addr;
 		break;
 	default:
 		fatal(F_INTERN, "invalid obj_fmt for function obj_writeb");
@@ -267,6 +375,8 @@ void obj_writeb(const BYTE *ops, WORD op_cnt)
 void obj_fill(WORD count)
 {
 	curr_addr += count;
+	if (obj_fmt == OBJ_REL && curr_addr > seg_size[rel_seg])
+		seg_size[rel_seg] = curr_addr;
 }
 
 /*
@@ -298,6 +408,7 @@ void obj_fill_value(WORD count, WORD value)
 			eof_addr = curr_addr;
 		break;
 	case OBJ_HEX:
+	case OBJ_REL:
 		if (hex_addr + hex_cnt != curr_addr)
 			flush_hex();
 		while (count-- > 0) {
@@ -306,6 +417,8 @@ void obj_fill_value(WORD count, WORD value)
 			hex_buf[hex_cnt++] = value;
 			curr_addr++;
 		}
+		if (obj_fmt == OBJ_REL && curr_addr > seg_size[rel_seg])
+			seg_size[rel_seg] = curr_addr;
 		break;
 	default:
 		fatal(F_INTERN, "invalid obj_fmt for function obj_fill_value");
@@ -425,17 +538,45 @@ static void eof_hex(WORD addr)
 }
 
 /*
- *	create a HEX data record in ASCII and write into object file
+ *	create a HEX data record or a REL text record in ASCII
+ *	and write into object file
  */
 static void flush_hex(void)
 {
 	if (hex_cnt != 0) {
-		hex_record(HEX_DATA);
+		if (obj_fmt == OBJ_REL)
+			rel_text();
+		else
+			hex_record(HEX_DATA);
 		hex_cnt = 0;
 	}
 	hex_addr = curr_addr;
 }
 
+/*
+ *	write a REL text record in ASCII into object file
+ */
+static void rel_text(void)
+{
+	register int i;
+	register char *p;
+
+	p = hex_out;
+	*p++ = 'T';
+	*p++ = ' ';
+	*p++ = seg_chr[rel_seg];
+	*p++ = ' ';
+	p = btoh(hex_addr >> 8, p);
+	p = btoh(hex_addr & 0xff, p);
+	*p++ = ' ';
+	for (i = 0; i < hex_cnt; i++)
+		p = btoh(hex_buf[i], p);
+	*p++ = '\n';
+	*p = '\0';
+	if (fputs(hex_out, objfp) == EOF)
+		fatal(F_OBJFILE, objfn);
+}
+
 /*
  *	write a HEX record in ASCII and write into object file
  */
@@ -18,6 +18,24 @@
 #define OBJ_MOS		1	/* Mostek binary file */
 #define OBJ_HEX		2	/* Intel HEX file */
 #define OBJ_CARY	3	/* C initialized array */
+#define OBJ_REL		4	/* relocatable object file */
+
+/*
+ *	definition of relocation kinds
+ */
+#define R_WORD		0	/* 16-bit value */
+#define R_LOW		1	/* low byte of value */
+#define R_HIGH		2	/* high byte of value */
+
+/*
+ *	structure type relocation of a value
+ */
+typedef struct reloc {
+	int rel_seg;		/* segment, or SEG_EXT */
+	int rel_kind;		/* relocation kind */
+	WORD rel_off;		/* offset to segment or external symbol */
+	const char *rel_ext;	/* name of external symbol */
+} reloc_t;
 
 extern void obj_set_options(int fmt, int hexl, int caryl, int nofill);
 extern const char *obj_file_ext(void);
@@ -25,9 +43,13 @@ extern void obj_open_file(const char *fn);
 extern void obj_close_file(void);
 extern void obj_header(const char *fn);
 extern void obj_end(void);
-extern void obj_start_addr(WORD addr);
+extern void obj_start_addr(int seg, WORD addr);
 extern void obj_load_addr(WORD addr);
 extern void obj_org(WORD addr);
+extern void obj_seg(int seg, WORD addr);
+extern void obj_reloc(WORD off, const reloc_t *rp);
+extern void obj_public(const char *name, int seg, WORD addr);
+extern void obj_extern(const char *name);
 extern void obj_writeb(const BYTE *ops, WORD op_cnt);
 extern void obj_fill(WORD count);
 extern void obj_fill_value(WORD count, WORD value);
@@ -13,14 +13,13 @@
 #include <string.h>
 
 #include "z80asm.h"
+#include "z80akwd.h"
 #include "z80alst.h"
 #include "z80amfun.h"
 #include "z80apfun.h"
 #include "z80arfun.h"
 #include "z80aopc.h"
 
-static int opccmp(const void *p1, const void *p2);
-
 /*
  *	structure operand table
  */
@@ -52,6 +51,7 @@ static opc_t opctab_psd[] = {
 	{ "ASEG",	op_glob,	 3, 0, A_NONE,	OP_NOLBL | OP_NOOPR },
 	{ "ASET",	op_dl,		 0, 0, A_SET,	OP_SET		    },
 	{ "COND",	op_cond,	 5, 0, A_NONE,	OP_COND		    },
+	{ "CSEG",	op_glob,	 4, 0, A_NONE,	OP_NOLBL | OP_NOOPR },
 	{ "DB",		op_db,		 1, 0, A_STD,	0		    },
 	{ "DC",		op_db,		 2, 0, A_STD,	0		    },
 	{ "DEFB",	op_db,		 1, 0, A_STD,	0		    },
@@ -63,6 +63,7 @@ static opc_t opctab_psd[] = {
 	{ "DEFW",	op_dw,		 0, 0, A_STD,	0		    },
 	{ "DEFZ",	op_db,		 4, 0, A_STD,	0		    },
 	{ "DS",		op_ds,		 0, 0, A_DS,	OP_DS		    },
+	{ "DSEG",	op_glob,	 5, 0, A_NONE,	OP_NOLBL | OP_NOOPR },
 	{ "DW",		op_dw,		 0, 0, A_STD,	0		    },
 	{ "EJECT",	op_misc,	 1, 0, A_NONE,	OP_NOLBL | OP_NOOPR },
 	{ "ELSE",	op_cond,	98, 0, A_NONE,	OP_COND  | OP_NOOPR },
@@ -188,7 +189,6 @@ static int no_opc_z80 = sizeof(opctab_z80) / sizeof(opc_t);
 
 /*
  *	table with reserved Z80 register and flag operand words
- *	must be sorted in ascending order!
  */
 static ope_t opetab_z80[] = {
 	{ "(BC)",	REGIBC,	0	  },
@@ -318,7 +318,6 @@ static int no_opc_8080 = sizeof(opctab_8080) / sizeof(opc_t);
 
 /*
  *	table with reserved 8080 register and flag operand words
- *	must be sorted in ascending order!
  */
 static ope_t opetab_8080[] = {
 	{ "A",		REGA,	0 },
@@ -335,20 +334,26 @@ static ope_t opetab_8080[] = {
 static int no_ope_8080 = sizeof(opetab_8080) / sizeof(ope_t);
 
 static int curr_instrset;	/* current instructions set */
-static opc_t **opctab;		/* current sorted operations table */
-static int no_opcodes;		/* current of operations */
-static ope_t *opetab;		/* current sorted register/flags table */
-static int no_operands;		/* current number of register/flags */
+static kwd_t *opctab;		/* current operations lookup table */
+static kwd_t *opetab;		/* current register/flags lookup table */
+static kwd_t opckwd[2];		/* operations lookup tables per set */
+static kwd_t opekwd[2];		/* register/flags lookup tables per set */
 
 /*
- *	build sorted table opctab for instruction set is
+ *	select lookup tables opctab and opetab for instruction set is,
+ *	they are built on first use and contain the pseudo ops too,
+ *	undocumented op-codes and operands are included, so that the
+ *	tables don't depend on option -u and can be built before the
+ *	jobs in batch mode are started
  */
 void instrset(int is)
 {
-	register opc_t *p, **q;
-	register int i;
+	register int i, n;
+	register kwd_t *kp;
 	opc_t *opc;
-	int nopc;
+	ope_t *ope;
+	const void **ents;
+	int nopc, nope;
 
 	if (is == curr_instrset)
 		return;
@@ -356,96 +361,67 @@ void instrset(int is)
 	case INSTR_Z80:
 		opc = opctab_z80;
 		nopc = no_opc_z80;
-		opetab = opetab_z80;
-		no_operands = no_ope_z80;
+		ope = opetab_z80;
+		nope = no_ope_z80;
 		break;
 	case INSTR_8080:
 		opc = opctab_8080;
 		nopc = no_opc_8080;
-		opetab = opetab_8080;
-		no_operands = no_ope_8080;
+		ope = opetab_8080;
+		nope = no_ope_8080;
 		break;
 	default:
 		fatal(F_INTERN, "invalid instr. set for function opc_conf");
 		break;
 	}
-	if (opctab == NULL) {
-		i = no_opc_psd;
-		i += (no_opc_z80 > no_opc_8080 ? no_opc_z80 : no_opc_8080);
-		opctab = (opc_t **) malloc(sizeof(opc_t *) * i);
-		if (opctab == NULL)
+	opctab = kp = &opckwd[is - INSTR_Z80];
+	opetab = &opekwd[is - INSTR_Z80];
+	if (kp->kwd_slots == NULL) {
+		ents = (const void **) malloc(sizeof(void *)
+					      * (no_opc_psd + nopc));
+		if (ents == NULL)
 			fatal(F_OUTMEM, "operations table");
+		for (i = 0, n = 0; i < no_opc_psd; i++)
+			ents[n++] = &opctab_psd[i];
+		for (i = 0; i < nopc; i++)
+			ents[n++] = &opc[i];
+		kwd_build(kp, ents, n);
+		for (i = 0, n = 0; i < nope; i++)
+			ents[n++] = &ope[i];
+		kwd_build(opetab, ents, n);
+		free(ents);
 	}
-	no_opcodes = no_opc_psd + nopc;
-	q = opctab;
-	for (i = 0, p = opctab_psd; i < no_opc_psd; i++)
-		*q++ = p++;
-	for (i = 0, p = opc; i < nopc; i++)
-		*q++ = p++;
-	qsort(opctab, no_opcodes, sizeof(opc_t *), opccmp);
 	curr_instrset = is;
 }
 
 /*
- *	compares two opcodes for qsort()
- */
-static int opccmp(const void *p1, const void *p2)
-{
-	return strcmp((*(const opc_t **) p1)->op_name,
-		      (*(const opc_t **) p2)->op_name);
-}
-
-/*
- *	do binary search for op_name in sorted table opctab
+ *	search op_name in lookup table opctab
  *	returns pointer to table element, or NULL if not found
+ *	or undocumented and not allowed
  */
 opc_t *search_op(char *op_name)
 {
-	register opc_t **low, **mid;
-	register opc_t **high;
-	int cond;
+	register opc_t *p;
 
-	low = opctab;
-	high = opctab + no_opcodes - 1;
-	while (low <= high) {
-		mid = low + (high - low) / 2;
-		if ((cond = strcmp(op_name, (*mid)->op_name)) < 0)
-			high = mid - 1;
-		else if (cond > 0)
-			low = mid + 1;
-		else if (!undoc_allowed() && ((*mid)->op_flags & OP_UNDOC))
-			return NULL;
-		else
-			return *mid;
-	}
-	return NULL;
+	p = (opc_t *) kwd_find(opctab, op_name);
+	if (p != NULL && (p->op_flags & OP_UNDOC) && !undoc_allowed())
+		return NULL;
+	return p;
 }
 
 /*
- *	do binary search for operand s in sorted table opetab
+ *	search operand s in lookup table opetab
  *	returns symbol for operand, NOOPERA if empty operand,
- *	or NOREG if operand not found
+ *	or NOREG if operand not found or undocumented and not allowed
  */
 BYTE get_reg(char *s)
 {
-	register ope_t *low, *mid;
-	register ope_t *high;
-	int cond;
+	register const ope_t *p;
 
 	if (s == NULL || *s == '\0')
 		return NOOPERA;
-	low = opetab;
-	high = opetab + no_operands - 1;
-	while (low <= high) {
-		mid = low + (high - low) / 2;
-		if ((cond = strcmp(s, mid->ope_name)) < 0)
-			high = mid - 1;
-		else if (cond > 0)
-			low = mid + 1;
-		else if (!undoc_allowed() && (mid->ope_flags & OPE_UNDOC))
-			return NOREG;
-		else
-			return mid->ope_sym;
-	}
-	return NOREG;
+	if ((p = (const ope_t *) kwd_find(opetab, s)) == NULL
+	    || ((p->ope_flags & OPE_UNDOC) && !undoc_allowed()))
+		return NOREG;
+	return p->ope_sym;
 }
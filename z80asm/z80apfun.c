@@ -21,6 +21,8 @@
 #include "z80atab.h"
 #include "z80apfun.h"
 
+static int is_sym_name(char *s);
+
 static int phase_flag;		/* inside a .PHASE section flag */
 
 static int false_sect_flag;	/* in false conditional section flag */
@@ -103,6 +105,7 @@ WORD op_instrset(int pass, BYTE op_code, BYTE dummy, char *operand, BYTE *ops)
 WORD op_org(int pass, BYTE op_code, BYTE dummy, char *operand, BYTE *ops)
 {
 	register WORD n;
+	int seg;
 
 	UNUSED(dummy);
 	UNUSED(ops);
@@ -114,6 +117,9 @@ WORD op_org(int pass, BYTE op_code, BYTE dummy, char *operand, BYTE *ops)
 			return 0;
 		}
 		n = eval(operand);
+		/* ORG sets the offset in a relocatable segment */
+		if ((seg = get_rel_seg()) != SEG_ABS && seg != get_seg())
+			asmerr(E_RELEXP);
 		if (pass == 1)		/* PASS 1 */
 			obj_load_addr(n);
 		else			/* PASS 2 */
@@ -126,6 +132,8 @@ WORD op_org(int pass, BYTE op_code, BYTE dummy, char *operand, BYTE *ops)
 		else {
 			phase_flag = TRUE;
 			set_pc(PC_PHASE, eval(operand));
+			if (get_rel_seg() != SEG_ABS)
+				asmerr(E_RELEXP);
 		}
 		break;
 	case 3:				/* .DEPHASE */
@@ -172,6 +180,7 @@ WORD op_equ(int pass, BYTE dummy1, BYTE dummy2, char *operand, BYTE *ops)
 	register sym_t *sp;
 	const char *label;
 	WORD addr;
+	int seg;
 
 	UNUSED(pass);
 	UNUSED(dummy1);
@@ -180,9 +189,10 @@ WORD op_equ(int pass, BYTE dummy1, BYTE dummy2, char *operand, BYTE *ops)
 
 	label = get_label();
 	addr = eval(operand);
+	seg = get_rel_seg();
 	if ((sp = look_sym(label)) == NULL)
-		new_sym(label, addr);
-	else if (sp->sym_val != addr)
+		new_sym(label, addr)->sym_seg = seg;
+	else if (sp->sym_val != addr || sp->sym_seg != seg)
 		asmerr(E_MULSYM);
 	return 0;
 }
@@ -192,12 +202,15 @@ WORD op_equ(int pass, BYTE dummy1, BYTE dummy2, char *operand, BYTE *ops)
  */
 WORD op_dl(int pass, BYTE dummy1, BYTE dummy2, char *operand, BYTE *ops)
 {
+	register WORD n;
+
 	UNUSED(pass);
 	UNUSED(dummy1);
 	UNUSED(dummy2);
 	UNUSED(ops);
 
-	put_sym(get_label(), eval(operand));
+	n = eval(operand);
+	put_sym(get_label(), n)->sym_seg = get_rel_seg();
 	return 0;
 }
 
@@ -251,8 +264,10 @@ WORD op_db(int pass, BYTE op_code, BYTE dummy, char *operand, BYTE *ops)
 			while (*p != c || *++p == c) /* double delim? */
 				ops[i++] = *p++;
 		} else if (*p != '\0') { /* an expression */
-			if (pass == 2)
+			if (pass == 2) {
 				ops[i] = chk_byte(eval(p));
+				reloc_ops(i, 1);
+			}
 			i++;
 		}
 		p = p1;
@@ -299,6 +314,7 @@ WORD op_dw(int pass, BYTE dummy1, BYTE dummy2, char *operand, BYTE *ops)
 				n = eval(p);
 				ops[i] = n & 0xff;
 				ops[i + 1] = n >> 8;
+				reloc_ops(i, 2);
 			}
 			i += 2;
 		}
@@ -518,21 +534,63 @@ WORD op_cond(int pass, BYTE op_code, BYTE dummy, char *operand, BYTE *ops)
 }
 
 /*
- *	EXTRN, EXTERNAL, EXT, PUBLIC, ENT, ENTRY, GLOBAL, ABS, and ASEG
+ *	EXTRN, EXTERNAL, EXT, PUBLIC, ENT, ENTRY, GLOBAL, ABS, ASEG,
+ *	CSEG, and DSEG
+ *	without relocatable object file output these are ignored
  */
 WORD op_glob(int pass, BYTE op_code, BYTE dummy, char *operand, BYTE *ops)
 {
-	UNUSED(pass);
+	register char *p, *p1;
+	register sym_t *sp;
+
 	UNUSED(dummy);
-	UNUSED(operand);
 	UNUSED(ops);
 
+	if (!relocatable())
+		return 0;
 	switch (op_code) {
 	case 1:				/* EXTRN, EXTERNAL, EXT */
-		break;
 	case 2:				/* PUBLIC, ENT, ENTRY, GLOBAL */
+		if (operand[0] == '\0') {
+			asmerr(E_MISOPE);
+			break;
+		}
+		for (p = operand; p != NULL; p = p1) {
+			p1 = next_arg(p, NULL);
+			if (!is_sym_name(p)) {
+				asmerr(E_INVOPE);
+				continue;
+			}
+			if (op_code == 1) {
+				/* externals are defined in pass 1 */
+				if (pass == 2)
+					continue;
+				if ((sp = look_sym(p)) == NULL)
+					new_sym(p, 0)->sym_seg = SEG_EXT;
+				else if (sp->sym_seg != SEG_EXT)
+					asmerr(E_MULSYM);
+			} else {
+				/* publics are marked when all are defined */
+				if (pass == 1)
+					continue;
+				if ((sp = get_sym(p)) == NULL)
+					asmerr(E_UNDSYM);
+				else if (sp->sym_seg == SEG_EXT)
+					asmerr(E_INVOPE);
+				else
+					sp->sym_pubflg = TRUE;
+			}
+		}
 		break;
 	case 3:				/* ABS, ASEG */
+	case 4:				/* CSEG */
+	case 5:				/* DSEG */
+		if (phase_flag)
+			asmerr(E_PHSNST);
+		else
+			set_seg(op_code == 3 ? SEG_ABS
+					     : (op_code == 4 ? SEG_CODE
+							     : SEG_DATA));
 		break;
 	default:
 		fatal(F_INTERN, "invalid opcode for function op_glob");
@@ -541,16 +599,38 @@ WORD op_glob(int pass, BYTE op_code, BYTE dummy, char *operand, BYTE *ops)
 	return 0;
 }
 
+/*
+ *	check if string s is a valid symbol name, and trim
+ *	it to the significant length
+ */
+static int is_sym_name(char *s)
+{
+	register char *p;
+
+	if (!IS_FSYM(*s))
+		return FALSE;
+	for (p = s + 1; *p != '\0'; p++)
+		if (!IS_SYM(*p))
+			return FALSE;
+	if (p - s > get_symlen())
+		s[get_symlen()] = '\0';
+	return TRUE;
+}
+
 /*
  *	END
  */
 WORD op_end(int pass, BYTE dummy1, BYTE dummy2, char *operand, BYTE *ops)
 {
+	register WORD n;
+
 	UNUSED(dummy1);
 	UNUSED(dummy2);
 	UNUSED(ops);
 
-	if (pass == 2 && operand[0] != '\0')
-		obj_start_addr(eval(operand));
+	if (pass == 2 && operand[0] != '\0') {
+		n = eval(operand);
+		obj_start_addr(get_rel_seg(), n);
+	}
 	return 0;
 }
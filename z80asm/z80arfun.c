@@ -263,6 +263,7 @@ WORD op_jpcall(int pass, BYTE base_op, BYTE base_opc, char *operand, BYTE *ops)
 			ops[0] = base_opc + (op & OPMASK3);
 			ops[1] = n & 0xff;
 			ops[2] = n >> 8;
+			reloc_ops(1, 2);
 		}
 		break;
 	case REGIHL:			/* JP/CALL (HL) */
@@ -292,6 +293,7 @@ WORD op_jpcall(int pass, BYTE base_op, BYTE base_opc, char *operand, BYTE *ops)
 				ops[0] = base_op;
 				ops[1] = n & 0xff;
 				ops[2] = n >> 8;
+				reloc_ops(1, 2);
 			}
 		} else			/* too many operands */
 			asmerr(E_INVOPE);
@@ -326,7 +328,7 @@ WORD op_jr(int pass, BYTE base_op, BYTE base_opc, char *operand, BYTE *ops)
 		len = 2;
 		if (pass == 2) {
 			ops[0] = base_opc + (op & OPMASK3);
-			ops[1] = chk_sbyte(eval(sec) - get_pc() - 2);
+			ops[1] = eval_disp(sec);
 		}
 		break;
 	case NOREG:			/* JR n */
@@ -334,8 +336,7 @@ WORD op_jr(int pass, BYTE base_op, BYTE base_opc, char *operand, BYTE *ops)
 			len = 2;
 			if (pass == 2) {
 				ops[0] = base_op;
-				ops[1] = chk_sbyte(eval(operand)
-						   - get_pc() - 2);
+				ops[1] = eval_disp(operand);
 			}
 		} else			/* too many operands */
 			asmerr(E_INVOPE);
@@ -359,7 +360,7 @@ WORD op_djnz(int pass, BYTE base_op, BYTE dummy, char *operand, BYTE *ops)
 
 	if (pass == 2) {
 		ops[0] = base_op;
-		ops[1] = chk_sbyte(eval(operand) - get_pc() - 2);
+		ops[1] = eval_disp(operand);
 	}
 	return 2;
 }
@@ -422,6 +423,7 @@ WORD op_ld(int pass, BYTE base_op, BYTE dummy, char *operand, BYTE *ops)
 				ops[1] = 0x4b + (op & OPMASK3);
 				ops[2] = n & 0xff;
 				ops[3] = n >> 8;
+				reloc_ops(2, 2);
 			}
 		} else {		/* LD {BC,DE},nn */
 			len = 3;
@@ -430,6 +432,7 @@ WORD op_ld(int pass, BYTE base_op, BYTE dummy, char *operand, BYTE *ops)
 				ops[0] = 0x01 + (op & OPMASK3);
 				ops[1] = n & 0xff;
 				ops[2] = n >> 8;
+				reloc_ops(1, 2);
 			}
 		}
 		break;
@@ -442,6 +445,7 @@ WORD op_ld(int pass, BYTE base_op, BYTE dummy, char *operand, BYTE *ops)
 				ops[0] = 0x0a + (op & OPMASK3);
 				ops[1] = n & 0xff;
 				ops[2] = n >> 8;
+				reloc_ops(1, 2);
 			}
 		} else {		/* LD HL,nn */
 			if (pass == 2) {
@@ -449,6 +453,7 @@ WORD op_ld(int pass, BYTE base_op, BYTE dummy, char *operand, BYTE *ops)
 				ops[0] = 0x01 + (op & OPMASK3);
 				ops[1] = n & 0xff;
 				ops[2] = n >> 8;
+				reloc_ops(1, 2);
 			}
 		}
 		break;
@@ -463,6 +468,7 @@ WORD op_ld(int pass, BYTE base_op, BYTE dummy, char *operand, BYTE *ops)
 				ops[1] = 0x0a + (op & OPMASK3);
 				ops[2] = n & 0xff;
 				ops[3] = n >> 8;
+				reloc_ops(2, 2);
 			}
 		} else {		/* LD I[XY],nn */
 			if (pass == 2) {
@@ -471,6 +477,7 @@ WORD op_ld(int pass, BYTE base_op, BYTE dummy, char *operand, BYTE *ops)
 				ops[1] = 0x01 + (op & OPMASK3);
 				ops[2] = n & 0xff;
 				ops[3] = n >> 8;
+				reloc_ops(2, 2);
 			}
 		}
 		break;
@@ -601,12 +608,14 @@ static WORD ldreg(int pass, BYTE base_op, char *sec, BYTE *ops)
 				ops[0] = 0x3a;
 				ops[1] = n & 0xff;
 				ops[2] = n >> 8;
+				reloc_ops(1, 2);
 			}
 		} else {		/* LD reg,n */
 			len = 2;
 			if (pass == 2) {
 				ops[0] = base_op - 0x40 + (REGIHL & OPMASK0);
 				ops[1] = chk_byte(eval(sec));
+				reloc_ops(1, 1);
 			}
 		}
 		break;
@@ -646,6 +655,7 @@ static WORD ldixhl(int pass, BYTE base_op, char *sec, BYTE *ops)
 			ops[0] = 0xdd;
 			ops[1] = base_op - 0x40 + (REGIHL & OPMASK0);
 			ops[2] = chk_byte(eval(sec));
+			reloc_ops(2, 1);
 		}
 		break;
 	case NOOPERA:			/* missing operand */
@@ -684,6 +694,7 @@ static WORD ldiyhl(int pass, BYTE base_op, char *sec, BYTE *ops)
 			ops[0] = 0xfd;
 			ops[1] = base_op - 0x40 + (REGIHL & OPMASK0);
 			ops[2] = chk_byte(eval(sec));
+			reloc_ops(2, 1);
 		}
 		break;
 	case NOOPERA:			/* missing operand */
@@ -725,6 +736,7 @@ static WORD ldsp(int pass, char *sec, BYTE *ops)
 				ops[1] = 0x7b;
 				ops[2] = n & 0xff;
 				ops[3] = n >> 8;
+				reloc_ops(2, 2);
 			}
 		} else {		/* LD SP,nn */
 			len = 3;
@@ -733,6 +745,7 @@ static WORD ldsp(int pass, char *sec, BYTE *ops)
 				ops[0] = 0x31;
 				ops[1] = n & 0xff;
 				ops[2] = n >> 8;
+				reloc_ops(1, 2);
 			}
 		}
 		break;
@@ -770,6 +783,7 @@ static WORD ldihl(int pass, BYTE base_op, char *sec, BYTE *ops)
 		if (pass == 2) {
 			ops[0] = base_op - 0x40 + (REGIHL & OPMASK0);
 			ops[1] = chk_byte(eval(sec));
+			reloc_ops(1, 1);
 		}
 		break;
 	case NOOPERA:			/* missing operand */
@@ -823,6 +837,7 @@ static WORD ldiixy(int pass, BYTE prefix, BYTE base_op,
 				ops[2] = chk_byte(eval(&operand[2]));
 			}
 			ops[3] = chk_byte(eval(sec));
+			reloc_ops(3, 1);
 		}
 		break;
 	case NOOPERA:			/* missing operand */
@@ -852,6 +867,7 @@ static WORD ldinn(int pass, char *operand, char *sec, BYTE *ops)
 			ops[0] = 0x32;
 			ops[1] = n & 0xff;
 			ops[2] = n >> 8;
+			reloc_ops(1, 2);
 		}
 		break;
 	case REGBC:			/* LD (nn),BC */
@@ -864,6 +880,7 @@ static WORD ldinn(int pass, char *operand, char *sec, BYTE *ops)
 			ops[1] = 0x43 + (op & OPMASK3);
 			ops[2] = n & 0xff;
 			ops[3] = n >> 8;
+			reloc_ops(2, 2);
 		}
 		break;
 	case REGHL:			/* LD (nn),HL */
@@ -873,6 +890,7 @@ static WORD ldinn(int pass, char *operand, char *sec, BYTE *ops)
 			ops[0] = 0x22;
 			ops[1] = n & 0xff;
 			ops[2] = n >> 8;
+			reloc_ops(1, 2);
 		}
 		break;
 	case REGIX:			/* LD (nn),IX */
@@ -884,6 +902,7 @@ static WORD ldinn(int pass, char *operand, char *sec, BYTE *ops)
 			ops[1] = 0x22;
 			ops[2] = n & 0xff;
 			ops[3] = n >> 8;
+			reloc_ops(2, 2);
 		}
 		break;
 	case NOOPERA:			/* missing operand */
@@ -1149,6 +1168,7 @@ static WORD aluop(int pass, BYTE base_op, char *sec, BYTE *ops)
 			if (pass == 2) {
 				ops[0] = base_op + 0x40 + (REGIHL & OPMASK0);
 				ops[1] = chk_byte(eval(sec));
+				reloc_ops(1, 1);
 			}
 		}
 		break;
@@ -1591,6 +1611,7 @@ WORD op8080_imm(int pass, BYTE base_op, BYTE dummy, char *operand, BYTE *ops)
 	if (pass == 2) {
 		ops[0] = base_op;
 		ops[1] = chk_byte(eval(operand));
+		reloc_ops(1, 1);
 	}
 	return 2;
 }
@@ -1659,6 +1680,7 @@ WORD op8080_addr(int pass, BYTE base_op, BYTE dummy, char *operand, BYTE *ops)
 		ops[0] = base_op;
 		ops[1] = n & 0xff;
 		ops[2] = n >> 8;
+		reloc_ops(1, 2);
 	}
 	return 3;
 }
@@ -1688,6 +1710,7 @@ WORD op8080_mvi(int pass, BYTE base_op, BYTE dummy, char *operand, BYTE *ops)
 		if (pass == 2) {
 			ops[0] = base_op + (op & OPMASK3);
 			ops[1] = chk_byte(eval(sec));
+			reloc_ops(1, 1);
 		}
 		break;
 	case NOOPERA:			/* missing operand */
@@ -1724,6 +1747,7 @@ WORD op8080_lxi(int pass, BYTE base_op, BYTE dummy, char *operand, BYTE *ops)
 			ops[0] = base_op + (op & OPMASK3);
 			ops[1] = n & 0xff;
 			ops[2] = n >> 8;
+			reloc_ops(1, 2);
 		}
 		break;
 	case NOOPERA:			/* missing operand */
@@ -5,7 +5,8 @@
  */
 
 /*
- *	main module, handles the options and runs 2 passes over the sources
+ *	main module, handles the options and runs 2 passes over the sources,
+ *	pass 2 uses the source lines kept in memory by pass 1
  */
 
 #include <stddef.h>
@@ -17,19 +18,24 @@
 #endif
 
 #include "z80asm.h"
+#include "z80abat.h"
 #include "z80alst.h"
 #include "z80amfun.h"
 #include "z80anum.h"
 #include "z80aobj.h"
 #include "z80aopc.h"
 #include "z80apfun.h"
+#include "z80asrc.h"
 #include "z80atab.h"
 
 static void init(void);
 static void options(int argc, char *argv[]);
 static void usage(void);
 static void do_pass(int p);
-static int process_line(char *line);
+static int process_line(char *line, srcline_t *sl);
+static void get_opr(char *p, srcline_t *sl, int nopre_flag);
+static void rel_symbols(void);
+static void sym_file(void);
 static void process_file(char *fn);
 static void process_include(char *line, char *operand, int expn_flag);
 static char *get_fn(char *src, const char *ext, int replace);
@@ -39,10 +45,11 @@ static void get_operand(char *s, char *line, int nopre_flag);
 static const char *fatalmsg[] = {	/* error messages for fatal() */
 	"out of memory: %s",		/* 0 */
 	("\nz80asm version %s\n"
-	 "usage: z80asm -8 -u -v -U -e<num> -f{b|m|h|c} -x "
+	 "usage: z80asm -8 -u -v -U -e<num> -f{b|m|h|c|r} -x "
 	 "-h<num> -c<num> -m -T -p<num>\n"
-	 "              -s[n|a] -o<file> -l[<file>] "
-	 "-d<symbol>[=<expr>] ... <file> ..."), /* 1 */
+	 "              -s[n|a] -o<file> -l[<file>] -y[<file>] "
+	 "-d<symbol>[=<expr>] ... <file> ...\n"
+	 "       z80asm -B<file> | -S<socket> -j<num> <option> ..."), /* 1 */
 	"Assembly halted",		/* 2 */
 	"can't open file %s",		/* 3 */
 	"error writing object file %s",	/* 4 */
@@ -50,7 +57,10 @@ static const char *fatalmsg[] = {	/* error messages for fatal() */
 	"invalid page length: %s",	/* 6 */
 	"invalid symbol length: %s",	/* 7 */
 	"invalid C bytes per line: %s",	/* 8 */
-	"invalid HEX record length: %s"	/* 9 */
+	"invalid HEX record length: %s",	/* 9 */
+	"invalid number of jobs: %s",	/* 10 */
+	"can't create server socket %s",	/* 11 */
+	"can't start batch job: %s"	/* 12 */
 };
 
 static const char *errmsg[] = {		/* error messages for asmerr() */
@@ -80,7 +90,8 @@ static const char *errmsg[] = {		/* error messages for asmerr() */
 	"macro expansion nested too deep", /* 23 */
 	"too many local labels",	/* 24 */
 	"label address differs between passes", /* 25 */
-	"macro buffer overflow"		/* 26 */
+	"macro buffer overflow",	/* 26 */
+	"invalid relocatable expression" /* 27 */
 };
 
 static BYTE ops[OPCARRAY];		/* buffer for generated object code */
@@ -88,12 +99,16 @@ static char **infiles;			/* source filenames */
 static char *srcfn;			/* filename of current source file */
 static char *objfn;			/* object filename */
 static char *lstfn;			/* listing filename */
-static char line[MAXLINE + 2];		/* buffer for one line of source */
+static char *symfn;			/* symbol filename */
+static char line[MAXLINE + 2];		/* buffer for macro expansion line */
+static char *curr_line;			/* line being processed */
 static char label[MAXLINE + 1];		/* buffer for label */
 static char opcode[MAXLINE + 1];	/* buffer for opcode */
 static char operand[MAXLINE + 1];	/* buffer for working with operand */
 static int  list_flag;			/* flag for option -l */
+static int  sym_flag;			/* flag for option -y */
 static int  undoc_flag;			/* flag for option -u */
+static int  rel_flag;			/* flag for option -fr */
 static int  verb_flag;			/* flag for option -v */
 static int  upcase_flag;		/* flag for option -U */
 static int  mac_list_opt;		/* value of option -m */
@@ -108,13 +123,25 @@ static WORD rpc;			/* real program counter */
 static WORD pc;				/* logical program counter, normally */
 					/* equal to rpc, except when inside */
 					/* a .PHASE section */
-static FILE *srcfp;			/* file pointer for current source */
+static int  seg;			/* current segment */
+static WORD seg_pc[SEG_EXT];		/* saved program counters of segments */
 static FILE *errfp;			/* file pointer for error output */
 static unsigned long c_line;		/* current line # in current source */
 
 int main(int argc, char *argv[])
 {
 	init();
+	if (bat_mode(argc, argv))
+		return bat_main(argc, argv);
+	return assemble(argc, argv);
+}
+
+/*
+ *	assemble the sources with the options in argv
+ *	returns the number of errors
+ */
+int assemble(int argc, char *argv[])
+{
 	options(argc, argv);
 	printf("Z80/8080-Macro-Assembler  Release %s\n%s\n", RELEASE, COPYR);
 	do_pass(1);
@@ -176,6 +203,13 @@ static void options(int argc, char *argv[])
 				}
 				list_flag = TRUE;
 				break;
+			case 'y':
+				if (*(s + 1) != '\0') {
+					symfn = get_fn(++s, SYMEXT, FALSE);
+					s += (strlen(s) - 1);
+				}
+				sym_flag = TRUE;
+				break;
 			case 'T':
 				nodate_flag = TRUE;
 				break;
@@ -204,7 +238,10 @@ static void options(int argc, char *argv[])
 					obj_fmt = OBJ_HEX;
 				else if (*(s + 1) == 'c')
 					obj_fmt = OBJ_CARY;
-				else {
+				else if (*(s + 1) == 'r') {
+					obj_fmt = OBJ_REL;
+					rel_flag = TRUE;
+				} else {
 					printf("unknown option -%s\n", s);
 					usage();
 				}
@@ -318,7 +355,11 @@ static void options(int argc, char *argv[])
 			lstfn = get_fn(*infiles, LSTEXT, TRUE);
 	}
 
+	if (sym_flag && symfn == NULL)
+		symfn = get_fn(*infiles, SYMEXT, TRUE);
+
 	instrset(i8080_flag ? INSTR_8080 : INSTR_Z80);
+	src_set_options(upcase_flag);
 }
 
 /*
@@ -354,7 +395,8 @@ void asmerr(int err)
 	} else if (pass == 1) {
 		fprintf(errfp, "Error in file: %s  Line: %ld\n",
 			srcfn, c_line);
-		fputs(line, errfp);
+		if (curr_line != NULL)
+			fputs(curr_line, errfp);
 		fputc('\n', errfp);
 		fprintf(errfp, "=> %s\n", errmsg[err]);
 	} else
@@ -373,6 +415,9 @@ static void do_pass(int p)
 	pass = p;
 	set_radix(10);
 	rpc = pc = 0;
+	seg = rel_flag ? SEG_CODE : SEG_ABS;
+	for (i = 0; i < SEG_EXT; i++)
+		seg_pc[i] = 0;
 	list_active = list_flag;
 	mac_start_pass(pass);
 	if (verb_flag)
@@ -381,62 +426,93 @@ static void do_pass(int p)
 		obj_open_file(objfn);
 		if (list_flag)
 			errfp = lst_open_file(lstfn);
-	} else					/* PASS 2 */
+	} else {				/* PASS 2 */
 		obj_header(srcfn);
+		obj_seg(seg, pc);
+	}
 	for (i = 0, ip = infiles; i < nfiles; i++, ip++) {
 		if (verb_flag)
 			printf("   Read    %s\n", *ip);
 		process_file(*ip);
 	}
 	mac_end_pass(pass);
+	src_end_pass();
 	if (pass == 1) {			/* PASS 1 */
 		if (errors > 0) {
 			printf("%d error(s)\n", errors);
 			fatal(F_HALT, NULL);
 		}
 	} else {				/* PASS 2 */
+		if (rel_flag)
+			rel_symbols();
 		obj_end();
 		obj_close_file();
+		if (sym_flag)
+			sym_file();
 		printf("%d error(s)\n", errors);
 	}
 }
 
+/*
+ *	write public and external symbols into relocatable object file
+ */
+static void rel_symbols(void)
+{
+	register sym_t *sp;
+
+	for (sp = first_sym(SYM_UNSORT); sp != NULL; sp = next_sym())
+		if (sp->sym_seg == SEG_EXT)
+			obj_extern(sp->sym_name);
+		else if (sp->sym_pubflg)
+			obj_public(sp->sym_name, sp->sym_seg, sp->sym_val);
+}
+
+/*
+ *	write the symbol file, one line with hexadecimal value and name
+ *	per symbol in the order of definition, for the ICE of the simulators
+ */
+static void sym_file(void)
+{
+	register sym_t *sp;
+	FILE *fp;
+
+	if ((fp = fopen(symfn, "w")) == NULL)
+		fatal(F_FOPEN, symfn);
+	for (sp = first_sym(SYM_UNSORT); sp != NULL; sp = next_sym())
+		if (sp->sym_seg != SEG_EXT)
+			fprintf(fp, "%04X %s\n", sp->sym_val, sp->sym_name);
+	fclose(fp);
+}
+
 /*
  *	process source file fn
+ *	lines come from the source file module, which reads the file
+ *	only once, macro expansion lines are generated into line
  */
 static void process_file(char *fn)
 {
-	register char *s;
-	register int i;
 	register char *l;
+	register srcline_t *sl;
+	srcfile_t *sf;
+	unsigned long n;
 
 	c_line = 0;
 	srcfn = fn;
 	lst_set_srcfn(fn);
-	if ((srcfp = fopen(fn, READA)) == NULL)
-		fatal(F_FOPEN, fn);
+	sf = src_open(fn);
+	n = 0;
 	do {
 		l = NULL;
+		sl = NULL;
 		while (mac_get_exp_nest() > 0
 		       && (l = mac_expand(line)) == NULL)
 			;
 		if (l == NULL) {
-			if ((l = fgets(line, MAXLINE + 2, srcfp)) == NULL)
+			if ((sl = src_line(sf, n++)) == NULL)
 				break;
-			i = strlen(line) - 1;
-			if (line[i] == '\n')
-				line[i] = '\0';
-			else if (i == MAXLINE) {
-				line[i] = '\0';
-				while ((i = fgetc(srcfp)) != EOF && i != '\n')
-					;
-			}
-			if (upcase_flag)
-				for (s = l; *s; s++)
-					*s = TO_UPP(*s);
+			l = sl->sl_text;
 		}
-	} while (process_line(l));
-	fclose(srcfp);
+	} while (process_line(l, sl));
 	if (in_phase_section())
 		asmerr(E_MISDPH);
 	if (in_cond_section())
@@ -447,9 +523,12 @@ static void process_file(char *fn)
 
 /*
  *	process one line of source from line
+ *	sl is the line in the source file module, or NULL for a line
+ *	from a macro expansion, label, op-code and operand of a source
+ *	file line are only split off once and reused in the next pass
  *	returns FALSE when END encountered, otherwise TRUE
  */
-static int process_line(char *line)
+static int process_line(char *line, srcline_t *sl)
 {
 	register opc_t *op;
 	register WORD op_count;
@@ -461,6 +540,7 @@ static int process_line(char *line)
 	int new_gencode, lflag, a_mode;
 	WORD a_addr;
 
+	curr_line = line;
 	expn_flag = (mac_get_exp_nest() > 0);
 	if (!expn_flag)
 		c_line++;
@@ -474,8 +554,19 @@ static int process_line(char *line)
 		/* a line comment, nothing to do */
 		a_mode = A_NONE;
 	} else {
-		p = get_symbol(label, line, TRUE);
-		p = get_symbol(opcode, p, FALSE);
+		if (sl != NULL && sl->sl_label != NULL) {
+			strcpy(label, sl->sl_label);
+			strcpy(opcode, sl->sl_opcode);
+			p = sl->sl_opr;
+		} else {
+			p = get_symbol(label, line, TRUE);
+			p = get_symbol(opcode, p, FALSE);
+			if (sl != NULL) {
+				sl->sl_label = src_intern(label);
+				sl->sl_opcode = src_intern(opcode);
+				sl->sl_opr = p;
+			}
+		}
 		genc_lbl_flag = (gencode && label[0] != '\0');
 
 		if (mac_get_def_nest() > 0) {
@@ -495,7 +586,7 @@ static int process_line(char *line)
 			if (gencode) {
 				if (genc_lbl_flag)
 					put_label(label, pc, pass);
-				get_operand(operand, p, TRUE);
+				get_opr(p, sl, TRUE);
 				mac_call(operand);
 			} else
 				a_mode = A_NONE;
@@ -510,7 +601,7 @@ static int process_line(char *line)
 				else if (!(op->op_flags & OP_SET))
 					put_label(label, pc, pass);
 			}
-			get_operand(operand, p, op->op_flags & OP_NOPRE);
+			get_opr(p, sl, op->op_flags & OP_NOPRE);
 			/* if an operand is present and the op-code doesn't
 			   have one, error out */
 			if (operand[0] != '\0' && operand[0] != COMMENT
@@ -549,6 +640,9 @@ static int process_line(char *line)
 		}
 	}
 
+	/* error on a relocatable value that wasn't relocated */
+	chk_reloc();
+
 	new_gencode = in_true_section();
 
 	if (pass == 2) {
@@ -603,6 +697,22 @@ static int process_line(char *line)
 		return TRUE;
 }
 
+/*
+ *	get operand of the current line starting at p into operand
+ *	the preprocessed operand of a source file line is saved for reuse
+ */
+static void get_opr(char *p, srcline_t *sl, int nopre_flag)
+{
+	if (sl == NULL || nopre_flag)
+		get_operand(operand, p, nopre_flag);
+	else if (sl->sl_prep != NULL)
+		strcpy(operand, sl->sl_prep);
+	else {
+		get_operand(operand, p, FALSE);
+		sl->sl_prep = src_save(operand);
+	}
+}
+
 /*
  *	process INCLUDE and MACLIB
  */
@@ -611,7 +721,6 @@ static void process_include(char *line, char *operand, int expn_flag)
 	register char *p;
 	unsigned long inc_line;
 	char *inc_fn, *fn;
-	FILE *inc_fp;
 	static int incnest;
 
 	if (incnest >= INCNEST) {
@@ -620,7 +729,6 @@ static void process_include(char *line, char *operand, int expn_flag)
 	}
 	inc_line = c_line;
 	inc_fn = srcfn;
-	inc_fp = srcfp;
 	incnest++;
 	p = operand;
 	while (!IS_SPC(*p) && *p != COMMENT && *p != '\0')
@@ -637,7 +745,6 @@ static void process_include(char *line, char *operand, int expn_flag)
 	incnest--;
 	c_line = inc_line;
 	srcfn = inc_fn;
-	srcfp = inc_fp;
 	if (verb_flag)
 		printf("   Resume  %s\n", srcfn);
 	if (list_active && pass == 2)
@@ -687,6 +794,35 @@ char *strsave(const char *s)
 	return strcpy(p, s);
 }
 
+/*
+ *	allocate n bytes of memory, which is never freed, from larger
+ *	chunks, used for the data kept during the whole assembly
+ */
+void *perm_alloc(size_t n)
+{
+	register char *p;
+	static char *chunk_ptr;		/* free memory in current chunk */
+	static size_t chunk_free;	/* bytes free in current chunk */
+
+	/* keep everything aligned for pointers */
+	n = (n + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+	if (n > chunk_free) {
+		if (n > PERMCHUNK / 4) {
+			/* large requests get their own memory */
+			if ((p = (char *) malloc(n)) == NULL)
+				fatal(F_OUTMEM, "perm_alloc");
+			return p;
+		}
+		if ((chunk_ptr = (char *) malloc(PERMCHUNK)) == NULL)
+			fatal(F_OUTMEM, "perm_alloc");
+		chunk_free = PERMCHUNK;
+	}
+	p = chunk_ptr;
+	chunk_ptr += n;
+	chunk_free -= n;
+	return p;
+}
+
 /*
  *	get label or opcode from source line
  *	if lbl_flag is FALSE skip front white space
@@ -830,6 +966,14 @@ int undoc_allowed(void)
 	return undoc_flag;
 }
 
+/*
+ *	return relocatable object file output flag
+ */
+int relocatable(void)
+{
+	return rel_flag;
+}
+
 /*
  *	return significant characters in symbols
  */
@@ -854,6 +998,29 @@ WORD get_pc(void)
 	return pc;
 }
 
+/*
+ *	get segment of program counter, which is absolute
+ *	inside a .PHASE section
+ */
+int get_seg(void)
+{
+	return in_phase_section() ? SEG_ABS : seg;
+}
+
+/*
+ *	switch to segment s, which continues at its last address
+ */
+void set_seg(int s)
+{
+	if (s == seg)
+		return;
+	seg_pc[seg] = rpc;
+	seg = s;
+	pc = rpc = seg_pc[seg];
+	if (pass == 2)
+		obj_seg(seg, pc);
+}
+
 /*
  *	set program counter
  */
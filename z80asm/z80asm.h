@@ -26,7 +26,9 @@
 #define OBJEXTBIN	".bin"	/* filename extension object */
 #define OBJEXTHEX	".hex"	/* filename extension HEX */
 #define OBJEXTCARY	".c"	/* filename extension C initialized array */
+#define OBJEXTREL	".obj"	/* filename extension relocatable object */
 #define LSTEXT		".lis"	/* filename extension listing */
+#define SYMEXT		".sym"	/* filename extension symbol file */
 #define COMMENT		';'	/* inline comment character */
 #define LINCOM		'*'	/* comment line if in column 1 */
 #define LINOPT		'$'	/* option line if in column 1 */
@@ -37,7 +39,9 @@
 #define PLENGTH		65	/* default lines/page in listing */
 #define SYMLEN		8	/* default max. symbol length */
 #define INCNEST		10	/* max. INCLUDE nesting depth */
-#define HASHSIZE	503	/* max. entries in symbol hash array */
+#define SYMHASH		1024	/* initial size of symbol hash array,
+				   must be a power of 2 */
+#define PERMCHUNK	16384	/* size of permanent memory chunks */
 #define OPCARRAY	128	/* size of object buffer */
 #define MAXHEX		32	/* max. no bytes per HEX record */
 #define MACNEST		50	/* max. expansion nesting */
@@ -58,6 +62,9 @@
 #define F_SYMLEN	7	/* symbol length out of range */
 #define F_CARYLEN	8	/* C array bytes per line out of range */
 #define F_HEXLEN	9	/* HEX record length out of range */
+#define F_JOBS		10	/* number of jobs out of range */
+#define F_SERVER	11	/* can't create server socket */
+#define F_FORK		12	/* can't start batch job */
 
 /*
  *	definition of error numbers for error messages in listfile
@@ -91,6 +98,7 @@
 #define E_OUTLCL	24	/* too many local labels */
 #define E_LBLDIF	25	/* label address differs between passes */
 #define E_MACOVF	26	/* macro buffer overflow */
+#define E_RELEXP	27	/* invalid relocatable expression */
 
 /*
  *	definition of macro list options
@@ -106,6 +114,15 @@
 #define PC_PHASE	1	/* set logical program counter */
 #define PC_DEPHASE	2	/* reset logical to real program counter */
 
+/*
+ *	definition of segments, SEG_EXT is the base of an expression
+ *	relative to an external symbol
+ */
+#define SEG_ABS		0	/* absolute segment */
+#define SEG_CODE	1	/* code segment */
+#define SEG_DATA	2	/* data segment */
+#define SEG_EXT		3	/* external symbol */
+
 #ifndef FALSE
 #define FALSE		0
 #endif
@@ -133,16 +150,21 @@
 typedef unsigned char BYTE;
 typedef unsigned short WORD;
 
+extern int assemble(int argc, char *argv[]);
 extern void NORETURN fatal(int err, const char *arg);
 extern void asmerr(int err);
 
 extern char *strsave(const char *s);
+extern void *perm_alloc(size_t n);
 extern char *next_arg(char *p, int *str_flag);
 
 extern int undoc_allowed(void);
+extern int relocatable(void);
 extern int get_symlen(void);
 extern const char *get_label(void);
 extern WORD get_pc(void);
+extern int get_seg(void);
+extern void set_seg(int seg);
 extern void set_pc(int opt, WORD addr);
 extern void set_list_active(int flag);
 extern void set_mac_list_opt(int opt);
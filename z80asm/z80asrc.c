@@ -0,0 +1,221 @@
+/*
+ *	Z80/8080-Macro-Assembler
+ *	Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	source file module, the source files are read only once in pass 1,
+ *	their lines are kept in memory together with the label, op-code and
+ *	operand split off by the first pass, and pass 2 replays them
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "z80asm.h"
+#include "z80anum.h"
+#include "z80asrc.h"
+
+#define SRC_BLKLINES	256	/* lines per line block */
+#define SRC_HASH	256	/* initial size of interned string hash array */
+
+struct srcfile {
+	char *sf_name;			/* file name */
+	srcline_t **sf_blks;		/* blocks of lines read so far */
+	unsigned long sf_nlines;	/* number of lines read */
+	unsigned long sf_nblks;		/* size of block pointer array */
+	FILE *sf_fp;			/* file pointer while reading */
+	long sf_off;			/* file offset of next line to read */
+	int sf_eof;			/* all lines of the file are read */
+	struct srcfile *sf_next;	/* next file in list */
+};
+
+typedef struct istr {			/* interned string */
+	const char *is_str;		/* the string */
+	unsigned is_hash;		/* hash value of the string */
+	struct istr *is_next;		/* next string in hash chain */
+} istr_t;
+
+static srcline_t *src_read(srcfile_t *sf);
+
+static int upcase_flag;			/* convert lines to upper case */
+static srcfile_t *src_files;		/* list of files read */
+static istr_t **src_strs;		/* interned strings */
+static unsigned src_hsize;		/* size of hash array, power of 2 */
+static unsigned src_nstrs;		/* number of interned strings */
+
+/*
+ *	set source options
+ */
+void src_set_options(int upcase)
+{
+	upcase_flag = upcase;
+}
+
+/*
+ *	save string into source memory
+ */
+char *src_save(const char *s)
+{
+	return strcpy((char *) perm_alloc(strlen(s) + 1), s);
+}
+
+/*
+ *	double the size of the interned string hash array, so that
+ *	the chains stay short with many labels
+ */
+static void src_grow(void)
+{
+	register istr_t **new, *ip, *next;
+	register unsigned i, n;
+
+	n = src_hsize ? src_hsize * 2 : SRC_HASH;
+	if ((new = (istr_t **) calloc(n, sizeof(istr_t *))) == NULL)
+		fatal(F_OUTMEM, "source lines");
+	for (i = 0; i < src_hsize; i++)
+		for (ip = src_strs[i]; ip != NULL; ip = next) {
+			next = ip->is_next;
+			ip->is_next = new[ip->is_hash & (n - 1)];
+			new[ip->is_hash & (n - 1)] = ip;
+		}
+	free(src_strs);
+	src_strs = new;
+	src_hsize = n;
+}
+
+/*
+ *	return the single stored copy of string s
+ */
+const char *src_intern(const char *s)
+{
+	register istr_t *ip;
+	register const char *p;
+	register unsigned h;
+
+	for (h = 0, p = s; *p != '\0'; p++)
+		h = h * 31 + (BYTE) *p;
+	if (src_nstrs >= src_hsize)
+		src_grow();
+	for (ip = src_strs[h & (src_hsize - 1)]; ip != NULL; ip = ip->is_next)
+		if (ip->is_hash == h && strcmp(s, ip->is_str) == 0)
+			return ip->is_str;
+	ip = (istr_t *) perm_alloc(sizeof(istr_t));
+	ip->is_str = src_save(s);
+	ip->is_hash = h;
+	ip->is_next = src_strs[h & (src_hsize - 1)];
+	src_strs[h & (src_hsize - 1)] = ip;
+	src_nstrs++;
+	return ip->is_str;
+}
+
+/*
+ *	find source file fn, or add it to the list of files
+ *	a file not read before is opened here, so that a missing
+ *	file is reported before any of its lines are needed
+ */
+srcfile_t *src_open(const char *fn)
+{
+	register srcfile_t *sf;
+
+	for (sf = src_files; sf != NULL; sf = sf->sf_next)
+		if (strcmp(fn, sf->sf_name) == 0)
+			return sf;
+	sf = (srcfile_t *) perm_alloc(sizeof(srcfile_t));
+	sf->sf_name = src_save(fn);
+	sf->sf_blks = NULL;
+	sf->sf_nlines = sf->sf_nblks = 0;
+	sf->sf_off = 0L;
+	sf->sf_eof = FALSE;
+	if ((sf->sf_fp = fopen(fn, READA)) == NULL)
+		fatal(F_FOPEN, fn);
+	sf->sf_next = src_files;
+	src_files = sf;
+	return sf;
+}
+
+/*
+ *	read the next line of source file sf into memory
+ *	returns pointer to the line, or NULL at end of file
+ */
+static srcline_t *src_read(srcfile_t *sf)
+{
+	register char *s;
+	register int i;
+	register srcline_t *sl;
+	char line[MAXLINE + 2];
+	unsigned long n;
+
+	if (sf->sf_fp == NULL) {
+		if ((sf->sf_fp = fopen(sf->sf_name, READA)) == NULL
+		    || fseek(sf->sf_fp, sf->sf_off, SEEK_SET) != 0)
+			fatal(F_FOPEN, sf->sf_name);
+	}
+	if (fgets(line, MAXLINE + 2, sf->sf_fp) == NULL) {
+		fclose(sf->sf_fp);
+		sf->sf_fp = NULL;
+		sf->sf_eof = TRUE;
+		return NULL;
+	}
+	i = strlen(line) - 1;
+	if (line[i] == '\n')
+		line[i] = '\0';
+	else if (i == MAXLINE) {
+		line[i] = '\0';
+		while ((i = fgetc(sf->sf_fp)) != EOF && i != '\n')
+			;
+	}
+	if (upcase_flag)
+		for (s = line; *s; s++)
+			*s = TO_UPP(*s);
+
+	n = sf->sf_nlines / SRC_BLKLINES;
+	if (sf->sf_nlines % SRC_BLKLINES == 0) {
+		if (n == sf->sf_nblks) {
+			sf->sf_nblks = sf->sf_nblks ? sf->sf_nblks * 2 : 16;
+			if ((sf->sf_blks = (srcline_t **)
+			     realloc(sf->sf_blks, sizeof(srcline_t *)
+				     * sf->sf_nblks)) == NULL)
+				fatal(F_OUTMEM, "source lines");
+		}
+		if ((sf->sf_blks[n] = (srcline_t *)
+		     malloc(sizeof(srcline_t) * SRC_BLKLINES)) == NULL)
+			fatal(F_OUTMEM, "source lines");
+	}
+	sl = &sf->sf_blks[n][sf->sf_nlines++ % SRC_BLKLINES];
+	sl->sl_text = src_save(line);
+	sl->sl_label = sl->sl_opcode = NULL;
+	sl->sl_opr = sl->sl_prep = NULL;
+	return sl;
+}
+
+/*
+ *	return pointer to line n (counted from 0) of source file sf,
+ *	or NULL if the file has less lines
+ *	lines are read sequentially, so n is never beyond the next line
+ */
+srcline_t *src_line(srcfile_t *sf, unsigned long n)
+{
+	if (n < sf->sf_nlines)
+		return &sf->sf_blks[n / SRC_BLKLINES][n % SRC_BLKLINES];
+	if (sf->sf_eof)
+		return NULL;
+	return src_read(sf);
+}
+
+/*
+ *	close files which weren't read up to the end in this pass
+ *	(END statement), remembering where to continue reading
+ */
+void src_end_pass(void)
+{
+	register srcfile_t *sf;
+
+	for (sf = src_files; sf != NULL; sf = sf->sf_next)
+		if (sf->sf_fp != NULL) {
+			sf->sf_off = ftell(sf->sf_fp);
+			fclose(sf->sf_fp);
+			sf->sf_fp = NULL;
+		}
+}
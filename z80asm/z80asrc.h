@@ -0,0 +1,32 @@
+/*
+ *	Z80/8080-Macro-Assembler
+ *	Copyright (C) 2026 by the z80pack contributors
+ */
+
+#ifndef Z80ASRC_INC
+#define Z80ASRC_INC
+
+#include "z80asm.h"
+
+/*
+ *	structure type for a source line kept in memory between passes
+ *	label and opcode are NULL until the line was split the first time
+ */
+typedef struct srcline {
+	char *sl_text;		/* source line */
+	const char *sl_label;	/* label, interned */
+	const char *sl_opcode;	/* op-code, interned */
+	char *sl_opr;		/* start of operand field in sl_text */
+	char *sl_prep;		/* preprocessed operand, or NULL */
+} srcline_t;
+
+typedef struct srcfile srcfile_t;
+
+extern void src_set_options(int upcase);
+extern srcfile_t *src_open(const char *fn);
+extern srcline_t *src_line(srcfile_t *sf, unsigned long n);
+extern void src_end_pass(void);
+extern const char *src_intern(const char *s);
+extern char *src_save(const char *s);
+
+#endif /* !Z80ASRC_INC */
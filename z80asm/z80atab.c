@@ -16,16 +16,20 @@
 #include "z80alst.h"
 #include "z80atab.h"
 
-static int hash(const char *name);
+static unsigned hash(const char *name);
+static void grow_symtab(void);
 static int namecmp(const void *p1, const void *p2);
 static int valcmp(const void *p1, const void *p2);
 
-static sym_t *symtab[HASHSIZE];		/* symbol table */
+static sym_t **symtab;			/* symbol hash table, open addressing */
+static unsigned symsize;		/* size of hash table, power of 2 */
+static sym_t **symarray;		/* symbols in order of definition */
 static int symcnt;			/* number of symbols defined */
-static sym_t **symarray;		/* sorted symbol table */
-static int symsort;			/* sort mode for iterator */
-static int symidx;			/* hash table index for iterator */
-static sym_t *symptr;			/* symbol pointer for iterator */
+static int symalloc;			/* size of symarray */
+static sym_t **symsorted;		/* sorted copy of symarray */
+static int symsortalloc;		/* size of symsorted */
+static sym_t **symiter;			/* array walked by the iterator */
+static int symidx;			/* symiter index for iterator */
 static int symmax;			/* max. symbol name length observed */
 static WORD last_symval;		/* value of last used symbol */
 
@@ -36,9 +40,14 @@ static WORD last_symval;		/* value of last used symbol */
 sym_t *look_sym(const char *sym_name)
 {
 	register sym_t *sp;
+	register unsigned h, i;
 
-	for (sp = symtab[hash(sym_name)]; sp != NULL; sp = sp->sym_next)
-		if (strcmp(sym_name, sp->sym_name) == 0) {
+	if (symtab == NULL)
+		return NULL;
+	h = hash(sym_name);
+	for (i = h & (symsize - 1); (sp = symtab[i]) != NULL;
+	     i = (i + 1) & (symsize - 1))
+		if (sp->sym_hash == h && strcmp(sym_name, sp->sym_name) == 0) {
 			last_symval = sp->sym_val;
 			return sp;
 		}
@@ -68,68 +77,106 @@ WORD sym_lastval(void)
 }
 
 /*
- *	add symbol sym_name with value sym_val to symbol table symtab
+ *	add absolute symbol sym_name with value sym_val to symbol table symtab
+ *	returns pointer to the new table element
  */
-void new_sym(const char *sym_name, WORD sym_val)
+sym_t *new_sym(const char *sym_name, WORD sym_val)
 {
 	register sym_t *sp;
 	register int n;
-	register int hashval;
+	register unsigned i;
 
+	/* keep the hash table at most half full */
+	if ((unsigned) (symcnt + 1) * 2 > symsize)
+		grow_symtab();
+	if (symcnt == symalloc) {
+		symalloc = symalloc ? symalloc * 2 : SYMHASH / 2;
+		if ((symarray = (sym_t **) realloc(symarray, sizeof(sym_t *)
+						   * symalloc)) == NULL)
+			fatal(F_OUTMEM, "symbols");
+	}
 	n = strlen(sym_name);
-	sp = (sym_t *) malloc(sizeof(sym_t));
-	if (sp == NULL || (sp->sym_name = (char *) malloc(n + 1)) == NULL)
-		fatal(F_OUTMEM, "symbols");
-	strcpy(sp->sym_name, sym_name);
+	sp = (sym_t *) perm_alloc(sizeof(sym_t));
+	sp->sym_name = strcpy((char *) perm_alloc(n + 1), sym_name);
 	sp->sym_val = last_symval = sym_val;
-	hashval = hash(sym_name);
-	sp->sym_next = symtab[hashval];
-	symtab[hashval] = sp;
 	sp->sym_refflg = FALSE;
+	sp->sym_pubflg = FALSE;
+	sp->sym_seg = SEG_ABS;
+	sp->sym_hash = hash(sym_name);
+	for (i = sp->sym_hash & (symsize - 1); symtab[i] != NULL;
+	     i = (i + 1) & (symsize - 1))
+		;
+	symtab[i] = sp;
+	symarray[symcnt++] = sp;
 	if (n > symmax)
 		symmax = n;
-	symcnt++;
+	return sp;
+}
+
+/*
+ *	double the size of the hash table and rehash all symbols,
+ *	using the stored hash values
+ */
+static void grow_symtab(void)
+{
+	register sym_t *sp;
+	register unsigned i;
+	register int j;
+
+	symsize = symsize ? symsize * 2 : SYMHASH;
+	free(symtab);
+	if ((symtab = (sym_t **) calloc(symsize, sizeof(sym_t *))) == NULL)
+		fatal(F_OUTMEM, "symbols");
+	for (j = 0; j < symcnt; j++) {
+		sp = symarray[j];
+		for (i = sp->sym_hash & (symsize - 1); symtab[i] != NULL;
+		     i = (i + 1) & (symsize - 1))
+			;
+		symtab[i] = sp;
+	}
 }
 
 /*
  *	add symbol sym_name with value sym_val to symbol table symtab,
  *	or modify existing symbol with new value and set refflg
+ *	returns pointer to the table element
  */
-void put_sym(const char *sym_name, WORD sym_val)
+sym_t *put_sym(const char *sym_name, WORD sym_val)
 {
 	register sym_t *sp;
 
 	if ((sp = get_sym(sym_name)) == NULL)
-		new_sym(sym_name, sym_val);
+		sp = new_sym(sym_name, sym_val);
 	else
 		sp->sym_val = last_symval = sym_val;
+	return sp;
 }
 
 /*
- *	add label to symbol table, error if symbol already exists
- *	and differs in value
+ *	add label in the current segment to symbol table, error if symbol
+ *	already exists and differs in value
  */
 void put_label(const char *label, WORD addr, int pass)
 {
 	register sym_t *sp;
 
 	if ((sp = look_sym(label)) == NULL)
-		new_sym(label, addr);
-	else if (sp->sym_val != addr)
+		new_sym(label, addr)->sym_seg = get_seg();
+	else if (sp->sym_val != addr || sp->sym_seg != get_seg())
 		asmerr(pass == 1 ? E_MULSYM : E_LBLDIF);
 }
 
 /*
- *	calculate the hash value of the string name
+ *	calculate the hash value of the string name (FNV-1a)
  *	returns hash value
  */
-static int hash(const char *name)
+static unsigned hash(const char *name)
 {
-	register unsigned h;
+	register unsigned long h;
 
-	for (h = 0; *name != '\0';)
-		h = ((h << 5) | (h >> (sizeof(h) * 8 - 5))) ^ (BYTE) *name++;
-	return h % HASHSIZE;
+	for (h = 2166136261UL; *name != '\0';)
+		h = ((h ^ (BYTE) *name++) * 16777619UL) & 0xffffffffUL;
+	return (unsigned) h;
 }
 
 /*
@@ -142,39 +189,38 @@ int get_symmax(void)
 
 /*
  *	get first symbol for listing, sorted as specified in sort_mode
+ *	unsorted is the order of definition, sorting is done on a copy
+ *	so that symarray keeps this order
  */
 sym_t *first_sym(int sort_mode)
 {
-	register sym_t *sp;
-	register int j;
-	register int i;
-
 	if (symcnt == 0)
 		return NULL;
-	symsort = sort_mode;
 	switch (sort_mode) {
 	case SYM_UNSORT:
-		symidx = 0;
-		while ((symptr = symtab[symidx]) == NULL)
-			if (++symidx == HASHSIZE)
-				break;
-		return symptr;
+		symiter = symarray;
+		break;
 	case SYM_SORTN:
 	case SYM_SORTA:
-		symarray = (sym_t **) malloc(sizeof(sym_t *) * symcnt);
-		if (symarray == NULL)
-			fatal(F_OUTMEM, "sorting symbol table");
-		for (i = 0, j = 0; i < HASHSIZE; i++)
-			for (sp = symtab[i]; sp != NULL; sp = sp->sym_next)
-				symarray[j++] = sp;
-		qsort(symarray, symcnt, sizeof(sym_t *),
+		if (symsortalloc < symcnt) {
+			free(symsorted);
+			symsortalloc = symalloc;
+			symsorted = (sym_t **) malloc(symsortalloc
+						      * sizeof(sym_t *));
+			if (symsorted == NULL)
+				fatal(F_OUTMEM, "sorting symbols");
+		}
+		memcpy(symsorted, symarray, symcnt * sizeof(sym_t *));
+		qsort(symsorted, symcnt, sizeof(sym_t *),
 		      sort_mode == SYM_SORTN ? namecmp : valcmp);
-		symidx = 0;
-		return symarray[symidx];
+		symiter = symsorted;
+		break;
 	default:
 		fatal(F_INTERN, "unknown sort mode in first_sym");
 		break;
 	}
+	symidx = 0;
+	return symiter[symidx];
 }
 
 /*
@@ -182,18 +228,8 @@ sym_t *first_sym(int sort_mode)
  */
 sym_t *next_sym(void)
 {
-	if (symsort == SYM_UNSORT) {
-		if ((symptr = symptr->sym_next) == NULL) {
-			do {
-				if (++symidx == HASHSIZE)
-					break;
-				else
-					symptr = symtab[symidx];
-			} while (symptr == NULL);
-		}
-		return symptr;
-	} else if (++symidx < symcnt)
-		return symarray[symidx];
+	if (++symidx < symcnt)
+		return symiter[symidx];
 	return NULL;
 }
 
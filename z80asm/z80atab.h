@@ -16,15 +16,17 @@ typedef struct sym {
 	char *sym_name;		/* symbol name */
 	WORD sym_val;		/* symbol value */
 	int sym_refflg;		/* symbol reference flag */
-	struct sym *sym_next;	/* next entry */
+	int sym_pubflg;		/* symbol is public flag */
+	int sym_seg;		/* segment of symbol value */
+	unsigned sym_hash;	/* hash value of name */
 } sym_t;
 
 extern sym_t *look_sym(const char *sym_name);
 extern sym_t *get_sym(const char *sym_name);
 extern WORD sym_lastval(void);
 
-extern void new_sym(const char *sym_name, WORD sym_val);
-extern void put_sym(const char *sym_name, WORD sym_val);
+extern sym_t *new_sym(const char *sym_name, WORD sym_val);
+extern sym_t *put_sym(const char *sym_name, WORD sym_val);
 extern void put_label(const char *label, WORD addr, int pass);
 
 extern int get_symmax(void);
@@ -0,0 +1,618 @@
+/*
+ *	Z80/8080-Macro-Assembler
+ *	Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	linker for the relocatable object files written by z80asm -fr,
+ *	places the code and data segments of all modules one after the
+ *	other, resolves external symbols with the public symbols of the
+ *	modules, and writes the program with the object file module of
+ *	the assembler in one of the absolute formats
+ *
+ *	the object files are read three times, the first pass collects
+ *	the segment sizes and public symbols, the second pass loads the
+ *	text records into memory, and the third pass applies the
+ *	relocations to the loaded text
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _POSIX_C_SOURCE
+#include <unistd.h>
+#endif
+
+#include "z80asm.h"
+#include "z80aobj.h"
+
+#define LNKLINE		256	/* max. length of object file records */
+#define F_OBJFMT	10	/* invalid object file */
+
+/*
+ *	structure type for a module (object file)
+ */
+typedef struct module {
+	char *mod_fn;			/* object file name */
+	WORD mod_size[SEG_EXT];		/* sizes of segments */
+	WORD mod_base[SEG_EXT];		/* base addresses of segments */
+	struct module *mod_next;	/* next module */
+} module_t;
+
+/*
+ *	structure type for a public symbol
+ */
+typedef struct pub {
+	char *pub_name;			/* symbol name */
+	WORD pub_val;			/* value after placement */
+	int pub_seg;			/* segment of symbol */
+	WORD pub_off;			/* offset in segment */
+	module_t *pub_mod;		/* module defining the symbol */
+} pub_t;
+
+static void options(int argc, char *argv[]);
+static void usage(void);
+static void lnkerr(const char *fmt, const char *arg, const char *fn);
+static char *save(const char *s);
+static char *get_fn(const char *src, const char *ext, int replace);
+static void read_module(module_t *mp, int pass);
+static int seg_num(int c);
+static void place(void);
+static pub_t *find_pub(const char *name);
+static int pubcmp(const void *p1, const void *p2);
+static void add_pub(module_t *mp, int seg, WORD off, const char *name);
+static void load_text(module_t *mp, int seg, WORD addr, const char *s);
+static void relocate(module_t *mp, int seg, WORD addr, int kind,
+		     int base, WORD off, const char *name);
+static void write_program(void);
+static void print_map(void);
+
+static const char *fatalmsg[] = {	/* error messages for fatal() */
+	"out of memory: %s",		/* 0 */
+	("\nz80ld version %s\n"
+	 "usage: z80ld -f{b|m|h|c} -x -h<num> -c<num> -C<addr> -D<addr> "
+	 "-m -o<file> <file> ..."), /* 1 */
+	"Linking halted",		/* 2 */
+	"can't open file %s",		/* 3 */
+	"error writing object file %s",	/* 4 */
+	"internal error: %s",		/* 5 */
+	"",				/* 6 */
+	"",				/* 7 */
+	"invalid C bytes per line: %s",	/* 8 */
+	"invalid HEX record length: %s", /* 9 */
+	"invalid relocatable object file %s" /* 10 */
+};
+
+static const char seg_chr[] = "ACDX";	/* segment names in object files */
+static const char kind_chr[] = "WLH";	/* relocation kinds */
+
+static module_t *modules;		/* list of modules */
+static pub_t *pubs;			/* public symbols */
+static int npubs;			/* number of public symbols */
+static int pubsize;			/* size of pubs array */
+static char *outfn;			/* output filename */
+static int out_flag;			/* output file was created */
+static int obj_fmt;			/* output format */
+static int hexlen;			/* HEX record length */
+static int carylen;			/* C array bytes per line */
+static int nofill_flag;			/* don't fill up output flag */
+static int map_flag;			/* print link map flag */
+static int dbase_flag;			/* data base address given */
+static WORD cbase, dbase;		/* code and data base addresses */
+static unsigned long prog_end;		/* end of all segments */
+static int start_flag;			/* start address found */
+static WORD start_addr;			/* start address of program */
+static int errors;			/* error counter */
+static unsigned long lnk_line;		/* line in current object file */
+static BYTE image[65536];		/* memory image of the program */
+static BYTE used[65536];		/* memory location is loaded */
+
+int main(int argc, char *argv[])
+{
+	register module_t *mp;
+
+	options(argc, argv);
+	printf("Z80/8080-Linker  Release %s\n", RELEASE);
+	for (mp = modules; mp != NULL; mp = mp->mod_next)
+		read_module(mp, 1);
+	place();
+	for (mp = modules; mp != NULL; mp = mp->mod_next)
+		read_module(mp, 2);
+	for (mp = modules; mp != NULL; mp = mp->mod_next)
+		read_module(mp, 3);
+	if (errors == 0)
+		write_program();
+	if (map_flag)
+		print_map();
+	printf("%d error(s)\n", errors);
+	return errors;
+}
+
+/*
+ *	process options
+ */
+static void options(int argc, char *argv[])
+{
+	register char *s;
+	register module_t *mp, **mpp;
+	char *p;
+
+	obj_fmt = OBJ_HEX;
+	hexlen = MAXHEX;
+	carylen = CARYLEN;
+
+	while (--argc > 0 && (*++argv)[0] == '-')
+		for (s = argv[0] + 1; *s != '\0'; s++)
+			switch (*s) {
+			case 'o':
+				if (*++s == '\0') {
+					puts("name missing in option -o");
+					usage();
+				}
+				outfn = s;
+				s += (strlen(s) - 1);
+				break;
+			case 'f':
+				if (*(s + 1) == 'b')
+					obj_fmt = OBJ_BIN;
+				else if (*(s + 1) == 'm')
+					obj_fmt = OBJ_MOS;
+				else if (*(s + 1) == 'h')
+					obj_fmt = OBJ_HEX;
+				else if (*(s + 1) == 'c')
+					obj_fmt = OBJ_CARY;
+				else {
+					printf("unknown option -%s\n", s);
+					usage();
+				}
+				s += (strlen(s) - 1);
+				break;
+			case 'x':
+				nofill_flag = TRUE;
+				break;
+			case 'm':
+				map_flag = TRUE;
+				break;
+			case 'C':
+			case 'D':
+				if (*(s + 1) == '\0') {
+					printf("address missing in option -%c\n",
+					       *s);
+					usage();
+				}
+				if (*s == 'C')
+					cbase = strtoul(s + 1, &p, 16);
+				else {
+					dbase = strtoul(s + 1, &p, 16);
+					dbase_flag = TRUE;
+				}
+				if (*p != '\0') {
+					printf("invalid address in option -%s\n",
+					       s);
+					usage();
+				}
+				s = p - 1;
+				break;
+			case 'h':
+				if (*++s == '\0') {
+					puts("length missing in option -h");
+					usage();
+				}
+				hexlen = atoi(s);
+				if (hexlen < 1 || hexlen > MAXHEX)
+					fatal(F_HEXLEN, s);
+				s += (strlen(s) - 1);
+				break;
+			case 'c':
+				if (*++s == '\0') {
+					puts("length missing in option -c");
+					usage();
+				}
+				carylen = atoi(s);
+				if (carylen < 1 || carylen > 16)
+					fatal(F_CARYLEN, s);
+				s += (strlen(s) - 1);
+				break;
+			default:
+				printf("unknown option %c\n", *s);
+				usage();
+				break;
+			}
+	if (argc == 0) {
+		puts("no input file");
+		usage();
+	}
+
+	mpp = &modules;
+	while (argc--) {
+		if ((mp = (module_t *) calloc(1, sizeof(module_t))) == NULL)
+			fatal(F_OUTMEM, "modules");
+		mp->mod_fn = get_fn(*argv++, OBJEXTREL, FALSE);
+		*mpp = mp;
+		mpp = &mp->mod_next;
+	}
+
+	obj_set_options(obj_fmt, hexlen, carylen, nofill_flag);
+	if (outfn == NULL)
+		outfn = get_fn(modules->mod_fn, obj_file_ext(), TRUE);
+	else
+		outfn = get_fn(outfn, obj_file_ext(), FALSE);
+}
+
+/*
+ *	error in options, print usage
+ */
+static void usage(void)
+{
+	fatal(F_USAGE, RELEASE);
+}
+
+/*
+ *	print error message and abort
+ */
+void NORETURN fatal(int err, const char *arg)
+{
+	printf(fatalmsg[err], arg);
+	putchar('\n');
+	obj_close_file();
+	if (out_flag)
+		unlink(outfn);
+	exit(EXIT_FAILURE);
+}
+
+/*
+ *	print link error message with argument arg for object
+ *	file fn and increase error counter
+ */
+static void lnkerr(const char *fmt, const char *arg, const char *fn)
+{
+	fputs("Error: ", stdout);
+	printf(fmt, arg);
+	if (fn != NULL)
+		printf(" in file %s", fn);
+	putchar('\n');
+	errors++;
+}
+
+/*
+ *	save string into allocated memory
+ */
+static char *save(const char *s)
+{
+	register char *p;
+
+	if ((p = (char *) malloc(strlen(s) + 1)) == NULL)
+		fatal(F_OUTMEM, "strings");
+	return strcpy(p, s);
+}
+
+/*
+ *	return a filename created from "src" and "ext"
+ *	append "ext" if "src" has no extension
+ *	replace existing extension with "ext" if "replace" is TRUE
+ */
+static char *get_fn(const char *src, const char *ext, int replace)
+{
+	register const char *sp, *ep;
+	register char *dp;
+	int m;
+
+	if ((sp = strrchr(src, PATHSEP)) == NULL)
+		sp = src;
+	else
+		sp++;
+	if ((ep = strrchr(sp, '.')) == NULL)
+		m = strlen(src);
+	else if (replace)
+		m = ep - src;
+	else
+		return save(src);
+	if ((dp = (char *) malloc(m + strlen(ext) + 1)) == NULL)
+		fatal(F_OUTMEM, "file name");
+	strncpy(dp, src, m);
+	strcpy(dp + m, ext);
+	return dp;
+}
+
+/*
+ *	read the object file of module mp
+ *	pass 1 collects segment sizes and public symbols, pass 2
+ *	loads text, checks externals and gets the start address,
+ *	pass 3 relocates
+ */
+static void read_module(module_t *mp, int pass)
+{
+	register char *s;
+	int n;
+	FILE *fp;
+	char line[LNKLINE], name[LNKLINE];
+	char c1, c2, c3;
+	unsigned a1, a2;
+
+	if ((fp = fopen(mp->mod_fn, READA)) == NULL)
+		fatal(F_FOPEN, mp->mod_fn);
+	lnk_line = 0;
+	while (fgets(line, LNKLINE, fp) != NULL) {
+		lnk_line++;
+		if ((s = strchr(line, '\n')) != NULL)
+			*s = '\0';
+		if (lnk_line == 1) {
+			if (strncmp(line, "Z80REL 1 ", 9) != 0)
+				fatal(F_OBJFMT, mp->mod_fn);
+			continue;
+		}
+		switch (line[0]) {
+		case 'T':		/* T seg addr bytes */
+			if (sscanf(line, "T %c %x %n", &c1, &a1, &n) < 2
+			    || seg_num(c1) < 0 || seg_num(c1) == SEG_EXT)
+				fatal(F_OBJFMT, mp->mod_fn);
+			if (pass == 2)
+				load_text(mp, seg_num(c1), a1, line + n);
+			break;
+		case 'R':		/* R seg addr kind base off [name] */
+			name[0] = '\0';
+			if (sscanf(line, "R %c %x %c %c %x %s", &c1, &a1,
+				   &c2, &c3, &a2, name) < 5
+			    || seg_num(c1) < 0 || seg_num(c1) == SEG_EXT
+			    || strchr(kind_chr, c2) == NULL
+			    || seg_num(c3) < 0
+			    || (seg_num(c3) == SEG_EXT) != (name[0] != '\0'))
+				fatal(F_OBJFMT, mp->mod_fn);
+			if (pass == 3)
+				relocate(mp, seg_num(c1), a1,
+					 strchr(kind_chr, c2) - kind_chr,
+					 seg_num(c3), a2, name);
+			break;
+		case 'P':		/* P seg addr name */
+			if (sscanf(line, "P %c %x %s", &c1, &a1, name) != 3
+			    || seg_num(c1) < 0 || seg_num(c1) == SEG_EXT)
+				fatal(F_OBJFMT, mp->mod_fn);
+			if (pass == 1)
+				add_pub(mp, seg_num(c1), a1, name);
+			break;
+		case 'X':		/* X name */
+			if (sscanf(line, "X %s", name) != 1)
+				fatal(F_OBJFMT, mp->mod_fn);
+			/* pass 2, all public symbols are known */
+			if (pass == 2 && find_pub(name) == NULL)
+				lnkerr("undefined symbol %s", name,
+				       mp->mod_fn);
+			break;
+		case 'S':		/* S seg size */
+			if (sscanf(line, "S %c %x", &c1, &a1) != 2
+			    || seg_num(c1) < 0 || seg_num(c1) == SEG_EXT)
+				fatal(F_OBJFMT, mp->mod_fn);
+			if (pass == 1)
+				mp->mod_size[seg_num(c1)] = a1;
+			break;
+		case 'E':		/* E seg addr */
+			if (sscanf(line, "E %c %x", &c1, &a1) != 2
+			    || seg_num(c1) < 0 || seg_num(c1) == SEG_EXT)
+				fatal(F_OBJFMT, mp->mod_fn);
+			if (pass == 2) {
+				if (start_flag)
+					lnkerr("multiple start addresses", NULL,
+					       mp->mod_fn);
+				start_addr = mp->mod_base[seg_num(c1)] + a1;
+				start_flag = TRUE;
+			}
+			break;
+		default:
+			fatal(F_OBJFMT, mp->mod_fn);
+			break;
+		}
+	}
+	if (lnk_line == 0)
+		fatal(F_OBJFMT, mp->mod_fn);
+	fclose(fp);
+}
+
+/*
+ *	returns the segment for segment name c, or -1 if invalid
+ */
+static int seg_num(int c)
+{
+	register const char *p;
+
+	if (c == '\0' || (p = strchr(seg_chr, c)) == NULL)
+		return -1;
+	return p - seg_chr;
+}
+
+/*
+ *	place the code segments of all modules one after the other at
+ *	the code base address, followed by the data segments, then
+ *	calculate the values of the public symbols
+ */
+static void place(void)
+{
+	register module_t *mp;
+	register pub_t *pp;
+	register int i;
+	unsigned long addr;
+
+	addr = cbase;
+	for (mp = modules; mp != NULL; mp = mp->mod_next) {
+		mp->mod_base[SEG_CODE] = addr;
+		addr += mp->mod_size[SEG_CODE];
+	}
+	if (dbase_flag) {
+		if (addr > prog_end)
+			prog_end = addr;
+		addr = dbase;
+	}
+	for (mp = modules; mp != NULL; mp = mp->mod_next) {
+		mp->mod_base[SEG_DATA] = addr;
+		addr += mp->mod_size[SEG_DATA];
+	}
+	if (addr > prog_end)
+		prog_end = addr;
+	if (prog_end > 65536UL)
+		lnkerr("program doesn't fit into memory", NULL, NULL);
+
+	for (i = 0, pp = pubs; i < npubs; i++, pp++)
+		pp->pub_val = pp->pub_mod->mod_base[pp->pub_seg]
+			      + pp->pub_off;
+	qsort(pubs, npubs, sizeof(pub_t), pubcmp);
+	for (i = 1; i < npubs; i++)
+		if (strcmp(pubs[i - 1].pub_name, pubs[i].pub_name) == 0)
+			lnkerr("multiple defined symbol %s", pubs[i].pub_name,
+			       pubs[i].pub_mod->mod_fn);
+}
+
+/*
+ *	search public symbol name
+ *	returns pointer to the symbol, or NULL if not found
+ */
+static pub_t *find_pub(const char *name)
+{
+	pub_t key;
+
+	key.pub_name = (char *) name;
+	return (pub_t *) bsearch(&key, pubs, npubs, sizeof(pub_t), pubcmp);
+}
+
+/*
+ *	compares two public symbol names for qsort() and bsearch()
+ */
+static int pubcmp(const void *p1, const void *p2)
+{
+	return strcmp(((const pub_t *) p1)->pub_name,
+		      ((const pub_t *) p2)->pub_name);
+}
+
+/*
+ *	add public symbol name at offset off of segment seg in module mp
+ */
+static void add_pub(module_t *mp, int seg, WORD off, const char *name)
+{
+	register pub_t *pp;
+
+	if (npubs == pubsize) {
+		pubsize = pubsize ? pubsize * 2 : 64;
+		if ((pubs = (pub_t *) realloc(pubs, sizeof(pub_t)
+					      * pubsize)) == NULL)
+			fatal(F_OUTMEM, "public symbols");
+	}
+	pp = &pubs[npubs++];
+	pp->pub_name = save(name);
+	pp->pub_seg = seg;
+	pp->pub_off = off;
+	pp->pub_mod = mp;
+}
+
+/*
+ *	load the hex bytes in string s to addr of segment seg in module mp
+ */
+static void load_text(module_t *mp, int seg, WORD addr, const char *s)
+{
+	register WORD a;
+	unsigned b;
+	int overlap;
+	char addr_str[5];
+
+	a = mp->mod_base[seg] + addr;
+	overlap = FALSE;
+	while (*s != '\0') {
+		if (sscanf(s, "%2x", &b) != 1 || s[1] == '\0')
+			fatal(F_OBJFMT, mp->mod_fn);
+		if (used[a] && !overlap) {
+			sprintf(addr_str, "%04X", a);
+			lnkerr("overlapping code at %s", addr_str, mp->mod_fn);
+			overlap = TRUE;
+		}
+		image[a] = b;
+		used[a] = TRUE;
+		a++;
+		s += 2;
+	}
+}
+
+/*
+ *	relocate the value at addr of segment seg in module mp,
+ *	the value is off relative to segment base of the module,
+ *	or to external symbol name
+ */
+static void relocate(module_t *mp, int seg, WORD addr, int kind,
+		     int base, WORD off, const char *name)
+{
+	register pub_t *pp;
+	register WORD a, v;
+
+	a = mp->mod_base[seg] + addr;
+	if (base == SEG_EXT) {
+		/* undefined symbols were reported with the X record */
+		if ((pp = find_pub(name)) == NULL)
+			return;
+		v = pp->pub_val + off;
+	} else
+		v = mp->mod_base[base] + off;
+	switch (kind) {
+	case R_WORD:
+		image[a] = v & 0xff;
+		image[(WORD) (a + 1)] = v >> 8;
+		break;
+	case R_LOW:
+		image[a] = v & 0xff;
+		break;
+	case R_HIGH:
+		image[a] = v >> 8;
+		break;
+	default:
+		fatal(F_INTERN, "invalid relocation kind");
+		break;
+	}
+}
+
+/*
+ *	write the loaded memory image into the output file
+ */
+static void write_program(void)
+{
+	register unsigned long a, n;
+
+	obj_open_file(outfn);
+	out_flag = TRUE;
+	for (a = 0; a < 65536UL && !used[a]; a++)
+		;
+	obj_load_addr(a < 65536UL ? a : 0);
+	obj_header(modules->mod_fn);
+	while (a < 65536UL) {
+		for (n = 0; a + n < 65536UL && used[a + n] && n < 0x8000UL;
+		     n++)
+			;
+		obj_org(a);
+		obj_writeb(&image[a], n);
+		for (a += n; a < 65536UL && !used[a]; a++)
+			;
+	}
+	/* reserved space at the end of the segments fills up the
+	   output like single parameter DEFS's do in the assembler */
+	if (prog_end > 0 && prog_end < 65536UL)
+		obj_org(prog_end);
+	if (start_flag)
+		obj_start_addr(SEG_ABS, start_addr);
+	obj_end();
+	obj_close_file();
+}
+
+/*
+ *	print segment addresses of the modules and the public symbols
+ */
+static void print_map(void)
+{
+	register module_t *mp;
+	register int i;
+
+	puts("\nCode  Size  Data  Size  Module");
+	for (mp = modules; mp != NULL; mp = mp->mod_next)
+		printf("%04X  %04X  %04X  %04X  %s\n",
+		       mp->mod_base[SEG_CODE], mp->mod_size[SEG_CODE],
+		       mp->mod_base[SEG_DATA], mp->mod_size[SEG_DATA],
+		       mp->mod_fn);
+	puts("\nValue Symbol");
+	for (i = 0; i < npubs; i++)
+		printf("%04X  %s\n", pubs[i].pub_val, pubs[i].pub_name);
+	putchar('\n');
+}
@@ -754,6 +754,9 @@
 				cpu_state = ST_STOPPED;
 			} else {
 				/* else wait for INT or user interrupt */
+#ifdef WANT_REPLAY
+				if (rr_mode != RR_REPLAY)
+#endif
 				while (!int_int &&
 				       (cpu_state == ST_CONTIN_RUN)) {
 					sleep_for_ms(1);
@@ -816,11 +816,18 @@ next_opcode:
 				cpu_state = ST_STOPPED;
 			} else {
 				/* else wait for INT, NMI or user interrupt */
+#ifdef WANT_REPLAY
+				if (rr_mode != RR_REPLAY)
+#endif
 				while (!int_int && !int_nmi &&
 				       (cpu_state == ST_CONTIN_RUN)) {
 					sleep_for_ms(1);
 					R += 99;
 				}
+#ifdef WANT_REPLAY
+				if (rr_mode)
+					rr_halt();
+#endif
 			}
 #ifdef BUS_8080
 			if (int_int)
@@ -0,0 +1,523 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	This module is the backend of the log macros in log.h.
+ *
+ *	The level of each tag can be changed at runtime. The tags are
+ *	registered in a table, when a call site looks up the level of
+ *	its tag the first time, so the table lists the tags which were
+ *	used. A level set for the tag "*" applies to all tags without
+ *	an own level.
+ *
+ *	Messages of the levels info, debug and verbose are formatted by
+ *	the threads which log into a slot of a ring buffer, which is
+ *	claimed without locks, a message longer than a slot is put into
+ *	allocated memory. A writer thread adds level, time stamp and tag
+ *	and writes the messages to stderr. When the ring is full messages
+ *	are lost and the writer reports how many.
+ *
+ *	LOG(), errors and warnings are written directly by the thread
+ *	which logs, after the messages still in the ring, so that they
+ *	appear in order with the output of the machine. The number of
+ *	messages of a call site is limited to log_rate per second, the
+ *	suppressed messages are reported with the next message of the
+ *	call site.
+ */
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "log.h"
+
+#ifdef WANT_LOGGER
+
+static const char *TAG = "log";
+
+#define LOG_RING	512	/* slots in the ring buffer, power of 2 */
+#define LOG_MSGLEN	256	/* length of a message in a slot */
+#define LOG_NTAGS	64	/* max. number of tags */
+#define LOG_TAGLEN	24	/* max. length of a tag */
+#define LOG_RATE	200	/* default messages per second of a call site */
+#define LOG_POLL	2000000	/* ns the writer sleeps, if the ring is empty */
+
+typedef struct {
+	unsigned seq;		/* sequence number of the slot */
+	log_level_t level;
+	const char *tag;
+	uint32_t ts;		/* clock() when logged */
+	char *ext;		/* allocated longer message, or NULL */
+	char msg[LOG_MSGLEN];
+} log_slot_t;
+
+typedef struct {
+	char name[LOG_TAGLEN];
+	int level;		/* level set at runtime, -1 = none */
+} log_tag_t;
+
+unsigned log_gen = 1;			/* incremented when levels change */
+
+static log_slot_t ring[LOG_RING];
+static unsigned ring_head;		/* next slot claimed by a producer */
+static unsigned ring_tail;		/* next slot read by the writer */
+static unsigned ring_lost;		/* messages lost, ring was full */
+
+static log_tag_t tags[LOG_NTAGS] = { { "*", -1 } };
+static int ntags = 1;
+static unsigned log_rate = LOG_RATE;
+static pthread_mutex_t tag_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t write_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t writer;
+static bool running;			/* writer thread is running */
+static bool stop;			/* writer thread has to stop */
+
+static const char *const level_names[] = {
+	"none", "error", "warn", "info", "debug", "verbose"
+};
+static const char level_letters[] = "NEWIDV";
+#ifdef CONFIG_LOG_COLORS
+static const char *const level_colors[] = {
+	"", LOG_COLOR_E, LOG_COLOR_W, LOG_COLOR_I, LOG_COLOR_D, ""
+};
+#endif
+
+static void log_head(log_level_t level, const char *tag, uint32_t ts);
+static void log_tail(log_level_t level);
+static void log_print(const log_slot_t *s);
+static bool log_drain(void);
+static void *log_writer(void *arg);
+
+/*
+ *	find the tag in the table, with tag_mutex held
+ */
+static log_tag_t *find_tag(const char *tag)
+{
+	int i;
+
+	for (i = 0; i < ntags; i++)
+		if (!strcasecmp(tags[i].name, tag))
+			return &tags[i];
+	return NULL;
+}
+
+/*
+ *	add a tag to the table, with tag_mutex held
+ */
+static log_tag_t *add_tag(const char *tag)
+{
+	log_tag_t *t;
+
+	if ((t = find_tag(tag)) != NULL)
+		return t;
+	if (ntags == LOG_NTAGS)
+		return NULL;
+	t = &tags[ntags++];
+	strncpy(t->name, tag, LOG_TAGLEN - 1);
+	t->name[LOG_TAGLEN - 1] = '\0';
+	t->level = -1;
+	return t;
+}
+
+/*
+ *	Runtime level of tag, def is the level of the call site,
+ *	returns the generation of the levels in gen
+ */
+log_level_t _log_lookup(const char *tag, log_level_t def, unsigned *gen)
+{
+	log_tag_t *t;
+	log_level_t level = def;
+
+	pthread_mutex_lock(&tag_mutex);
+	if (tag != NULL && (t = add_tag(tag)) != NULL && t->level >= 0)
+		level = t->level;
+	else if (tags[0].level >= 0)
+		level = tags[0].level;
+	*gen = log_gen;
+	pthread_mutex_unlock(&tag_mutex);
+
+	return level;
+}
+
+/*
+ *	Set the level of tag, "*" sets it for all tags
+ *	without an own level, a level < 0 removes it
+ */
+bool log_set_level(const char *tag, log_level_t level)
+{
+	log_tag_t *t;
+
+	pthread_mutex_lock(&tag_mutex);
+	if ((t = add_tag(tag)) != NULL) {
+		t->level = level;
+		log_gen++;
+	}
+	pthread_mutex_unlock(&tag_mutex);
+
+	if (t == NULL) {
+		LOGW(TAG, "too many tags");
+		return false;
+	}
+	return true;
+}
+
+void log_set_rate(unsigned rate)
+{
+	log_rate = rate;
+}
+
+unsigned log_get_rate(void)
+{
+	return log_rate;
+}
+
+/*
+ *	Get the tag with index i and its level,
+ *	returns false if there is no such tag
+ */
+bool log_get_tag(int i, const char **tag, int *level)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&tag_mutex);
+	if (i >= 0 && i < ntags) {
+		*tag = tags[i].name;
+		*level = tags[i].level;
+		found = true;
+	}
+	pthread_mutex_unlock(&tag_mutex);
+
+	return found;
+}
+
+/*
+ *	Level with name, letter or number in s,
+ *	-1 for "default", -2 if invalid
+ */
+int log_parse_level(const char *s)
+{
+	int i;
+
+	for (i = LOG_NONE; i <= LOG_VERBOSE; i++)
+		if (!strcasecmp(s, level_names[i])
+		    || (s[0] != '\0' && s[1] == '\0'
+			&& (toupper((unsigned char) s[0]) == level_letters[i]
+			    || s[0] == '0' + i)))
+			return i;
+	if (!strcasecmp(s, "default"))
+		return -1;
+	return -2;
+}
+
+const char *log_level_name(int level)
+{
+	if (level < LOG_NONE || level > LOG_VERBOSE)
+		return "default";
+	return level_names[level];
+}
+
+/*
+ *	Set levels and rate from a list "tag=level,...,rate=n"
+ */
+bool log_config(const char *spec)
+{
+	char buf[LENCMD], *s, *v;
+	int level;
+	bool ok = true;
+
+	strncpy(buf, spec, LENCMD - 1);
+	buf[LENCMD - 1] = '\0';
+	for (s = strtok(buf, ", \t\r\n"); s != NULL;
+	     s = strtok(NULL, ", \t\r\n")) {
+		if ((v = strchr(s, '=')) == NULL || v == s) {
+			LOGE(TAG, "invalid log level setting %s", s);
+			ok = false;
+			continue;
+		}
+		*v++ = '\0';
+		if (!strcasecmp(s, "rate")) {
+			log_rate = atoi(v);
+			continue;
+		}
+		if ((level = log_parse_level(v)) < -1) {
+			LOGE(TAG, "invalid log level %s", v);
+			ok = false;
+			continue;
+		}
+		if (!log_set_level(s, level))
+			ok = false;
+	}
+	return ok;
+}
+
+/*
+ *	claim a slot of the ring, NULL if the ring is full
+ */
+static log_slot_t *ring_claim(unsigned *pos)
+{
+	log_slot_t *s;
+	unsigned p = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+	int d;
+
+	for (;;) {
+		s = &ring[p & (LOG_RING - 1)];
+		d = (int) (__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) - p);
+		if (d == 0) {
+			if (__atomic_compare_exchange_n(&ring_head, &p, p + 1,
+							true,
+							__ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				break;
+		} else if (d < 0)
+			return NULL;
+		else
+			p = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+	}
+	*pos = p;
+	return s;
+}
+
+/*
+ *	write a message directly, after the messages in the ring
+ */
+static void log_vwrite(log_level_t level, const char *tag,
+		       const char *format, va_list args)
+{
+	pthread_mutex_lock(&write_mutex);
+	log_drain();
+	log_head(level, tag, clock());
+	vfprintf(stderr, format, args);
+	log_tail(level);
+	fflush(stderr);
+	pthread_mutex_unlock(&write_mutex);
+}
+
+/*
+ *	put a message into the ring, or write it directly
+ *	if the writer thread isn't running
+ */
+static void log_vput(log_level_t level, const char *tag,
+		     const char *format, va_list args)
+{
+	log_slot_t *s;
+	unsigned pos;
+	va_list copy;
+	int n;
+
+	if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+		log_vwrite(level, tag, format, args);
+		return;
+	}
+
+	if ((s = ring_claim(&pos)) == NULL) {
+		__atomic_fetch_add(&ring_lost, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	s->level = level;
+	s->tag = tag;
+	s->ts = clock();
+	s->ext = NULL;
+	va_copy(copy, args);
+	n = vsnprintf(s->msg, LOG_MSGLEN, format, args);
+	if (n >= LOG_MSGLEN && (s->ext = (char *) malloc(n + 1)) != NULL)
+		vsnprintf(s->ext, n + 1, format, copy);
+	va_end(copy);
+	__atomic_store_n(&s->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+static void log_write(log_level_t level, const char *tag,
+		      const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	log_vwrite(level, tag, format, args);
+	va_end(args);
+}
+
+/*
+ *	Log a message of a call site, site is NULL for LOG(),
+ *	the rate limit of the site is shared by all threads
+ */
+void _log_put(log_site_t *site, log_level_t level, const char *tag,
+	      const char *format, ...)
+{
+	va_list args;
+	time_t now, sec;
+	unsigned n;
+
+	if (site != NULL && log_rate) {
+		now = time(NULL);
+		sec = __atomic_load_n(&site->sec, __ATOMIC_RELAXED);
+		if (now != sec
+		    && __atomic_compare_exchange_n(&site->sec, &sec, now,
+						   false, __ATOMIC_RELAXED,
+						   __ATOMIC_RELAXED)) {
+			__atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+			if ((n = __atomic_exchange_n(&site->suppressed, 0,
+						     __ATOMIC_RELAXED)))
+				log_write(LOG_WARN, tag,
+					  "%u messages suppressed", n);
+		}
+		if (__atomic_add_fetch(&site->count, 1, __ATOMIC_RELAXED)
+		    > log_rate) {
+			__atomic_fetch_add(&site->suppressed, 1,
+					   __ATOMIC_RELAXED);
+			return;
+		}
+	}
+
+	va_start(args, format);
+	if (level <= LOG_WARN)
+		log_vwrite(level, tag, format, args);
+	else
+		log_vput(level, tag, format, args);
+	va_end(args);
+}
+
+/*
+ *	write the prefix of a message in the format of log.h
+ */
+static void log_head(log_level_t level, const char *tag, uint32_t ts)
+{
+	if (level == LOG_NONE)
+		return;
+#ifdef CONFIG_LOG_COLORS
+	fprintf(stderr, "%s%c (%" PRIu32 ") %s: ", level_colors[level],
+		level_letters[level], ts, tag);
+#else
+	fprintf(stderr, "%c (%" PRIu32 ") %s: ", level_letters[level], ts,
+		tag);
+#endif
+}
+
+/*
+ *	write the end of a message in the format of log.h
+ */
+static void log_tail(log_level_t level)
+{
+	if (level != LOG_NONE)
+		fputs(LOG_RESET_COLOR "\r\n", stderr);
+}
+
+/*
+ *	write a message from the ring
+ */
+static void log_print(const log_slot_t *s)
+{
+	log_head(s->level, s->tag, s->ts);
+	fputs(s->ext != NULL ? s->ext : s->msg, stderr);
+	log_tail(s->level);
+}
+
+/*
+ *	write all messages in the ring, with write_mutex held,
+ *	returns false if there were none
+ */
+static bool log_drain(void)
+{
+	log_slot_t *s, tmp;
+	bool done = false;
+	unsigned lost;
+
+	for (;;) {
+		s = &ring[ring_tail & (LOG_RING - 1)];
+		if (__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE)
+		    != ring_tail + 1)
+			break;
+		log_print(s);
+		free(s->ext);
+		s->ext = NULL;
+		__atomic_store_n(&s->seq, ring_tail + LOG_RING,
+				 __ATOMIC_RELEASE);
+		ring_tail++;
+		done = true;
+	}
+
+	if ((lost = __atomic_exchange_n(&ring_lost, 0, __ATOMIC_RELAXED))) {
+		tmp.level = LOG_WARN;
+		tmp.tag = TAG;
+		tmp.ts = clock();
+		tmp.ext = NULL;
+		snprintf(tmp.msg, LOG_MSGLEN, "%u messages lost", lost);
+		log_print(&tmp);
+		done = true;
+	}
+
+	if (done)
+		fflush(stderr);
+	return done;
+}
+
+/*
+ *	thread writing the messages
+ */
+static void *log_writer(void *arg)
+{
+	struct timespec ts = { 0, LOG_POLL };
+	bool done;
+
+	UNUSED(arg);
+
+	while (!__atomic_load_n(&stop, __ATOMIC_ACQUIRE)) {
+		pthread_mutex_lock(&write_mutex);
+		done = log_drain();
+		pthread_mutex_unlock(&write_mutex);
+		if (!done)
+			nanosleep(&ts, NULL);
+	}
+
+	return NULL;
+}
+
+/*
+ *	Start the writer thread, until then and after
+ *	log_exit() the messages are written directly
+ */
+void log_init(void)
+{
+	unsigned i;
+
+	if (running)
+		return;
+
+	for (i = 0; i < LOG_RING; i++)
+		ring[i].seq = i;
+	ring_head = ring_tail = 0;
+	stop = false;
+
+	if (pthread_create(&writer, NULL, log_writer, NULL)) {
+		LOGW(TAG, "can't create writer thread, logging directly");
+		return;
+	}
+	__atomic_store_n(&running, true, __ATOMIC_RELEASE);
+	atexit(log_exit);
+}
+
+/*
+ *	Write the remaining messages and stop the writer thread
+ */
+void log_exit(void)
+{
+	if (!running)
+		return;
+
+	__atomic_store_n(&running, false, __ATOMIC_RELEASE);
+	__atomic_store_n(&stop, true, __ATOMIC_RELEASE);
+	pthread_join(writer, NULL);
+	pthread_mutex_lock(&write_mutex);
+	log_drain();
+	pthread_mutex_unlock(&write_mutex);
+}
+
+#endif /* WANT_LOGGER */
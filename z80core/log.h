@@ -13,6 +13,7 @@
  *
  * History:
  * 12-JUL-2018	1.0	Initial Release
+ * 16-OCT-2026	1.1	Runtime levels per tag and asynchronous output
  *
  */
 
@@ -20,9 +21,13 @@
 #define LOG_INC
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <time.h>
+
+#include "sim.h"
+
 #define CONFIG_LOG_COLORS
 #define LOG_DEFAULT_LEVEL   LOG_INFO
 
@@ -35,6 +40,58 @@ typedef enum {
     LOG_VERBOSE     /* Bigger chunks of debugging information, or frequent messages which can potentially flood the output. */
 } log_level_t;
 
+#ifdef WANT_LOGGER
+
+/*
+ * With WANT_LOGGER the level of a file set with LOG_LOCAL_LEVEL is only
+ * the default, it can be changed for each tag at runtime. Every call
+ * site caches the level of its tag, until the levels are changed, so
+ * a disabled message costs two compares. Info, debug and verbose
+ * messages are put into a ring buffer, a thread writes them to stderr,
+ * LOG(), errors and warnings are written directly. Call sites compiled
+ * in are limited with LOG_MAX_LEVEL.
+ */
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL	LOG_VERBOSE
+#endif
+
+typedef struct log_site {
+    unsigned gen;           /* log_gen when the level was looked up */
+    log_level_t level;      /* runtime level of the tag */
+    time_t sec;             /* second of the rate limit, atomic */
+    unsigned count;         /* messages in this second, atomic */
+    unsigned suppressed;    /* messages dropped by the rate limit, atomic */
+} log_site_t;
+
+extern unsigned log_gen;
+
+extern void log_init(void);
+extern void log_exit(void);
+extern bool log_config(const char *spec);
+extern bool log_set_level(const char *tag, log_level_t level);
+extern void log_set_rate(unsigned rate);
+extern unsigned log_get_rate(void);
+extern bool log_get_tag(int i, const char **tag, int *level);
+extern int log_parse_level(const char *s);
+extern const char *log_level_name(int level);
+
+extern log_level_t _log_lookup(const char *tag, log_level_t def, unsigned *gen);
+extern void _log_put(log_site_t *site, log_level_t level, const char *tag,
+                     const char *format, ...) __attribute__ ((format (printf, 4, 5)));
+
+#define _LOG_SITE(lvl, tag, format, ...)  do { \
+        static log_site_t _log_site; \
+        if (LOG_MAX_LEVEL >= (lvl)) { \
+            if (_log_site.gen != log_gen) \
+                _log_site.level = _log_lookup(tag, LOG_LOCAL_LEVEL, \
+                                              &_log_site.gen); \
+            if (_log_site.level >= (lvl)) \
+                _log_put(&_log_site, lvl, tag, format, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+#else /* !WANT_LOGGER */
+
 /* inline vararg functions don't compile with gcc <= 7.3 */
 #ifdef __GNUC__
 static void _log_write(log_level_t level, const char* tag, const char* format, ...) __attribute__ ((format (printf, 3, 4)));
@@ -57,6 +114,8 @@ static inline uint32_t _log_timestamp(void) {
     return clock();
 }
 
+#endif /* !WANT_LOGGER */
+
 #ifdef CONFIG_LOG_COLORS
 #define LOG_COLOR_BLACK   "30"
 #define LOG_COLOR_RED     "31"
@@ -88,6 +147,14 @@ static inline uint32_t _log_timestamp(void) {
 #define LOG_LOCAL_LEVEL  ((log_level_t) LOG_DEFAULT_LEVEL)
 #endif
 
+#ifdef WANT_LOGGER
+#define LOG( tag, format, ... )  _log_put(NULL, LOG_NONE, tag, format, ##__VA_ARGS__)
+#define LOGE( tag, format, ... )  _LOG_SITE(LOG_ERROR,   tag, format, ##__VA_ARGS__)
+#define LOGW( tag, format, ... )  _LOG_SITE(LOG_WARN,    tag, format, ##__VA_ARGS__)
+#define LOGI( tag, format, ... )  _LOG_SITE(LOG_INFO,    tag, format, ##__VA_ARGS__)
+#define LOGD( tag, format, ... )  _LOG_SITE(LOG_DEBUG,   tag, format, ##__VA_ARGS__)
+#define LOGV( tag, format, ... )  _LOG_SITE(LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+#else /* !WANT_LOGGER */
 #define LOG( tag, format, ... )  _log_write(LOG_NONE, NULL, format, ##__VA_ARGS__)
 #define LOGE( tag, format, ... )  do { if (LOG_LOCAL_LEVEL >= LOG_ERROR)   { _log_write(LOG_ERROR,   tag, _LOG_FORMAT(E, format), _log_timestamp(), tag, ##__VA_ARGS__); } } while (0)
 #define LOGW( tag, format, ... )  do { if (LOG_LOCAL_LEVEL >= LOG_WARN)    { _log_write(LOG_WARN,    tag, _LOG_FORMAT(W, format), _log_timestamp(), tag, ##__VA_ARGS__); } } while (0)
@@ -95,4 +162,6 @@ static inline uint32_t _log_timestamp(void) {
 #define LOGD( tag, format, ... )  do { if (LOG_LOCAL_LEVEL >= LOG_DEBUG)   { _log_write(LOG_DEBUG,   tag, _LOG_FORMAT(D, format), _log_timestamp(), tag, ##__VA_ARGS__); } } while (0)
 #define LOGV( tag, format, ... )  do { if (LOG_LOCAL_LEVEL >= LOG_VERBOSE) { _log_write(LOG_VERBOSE, tag, _LOG_FORMAT(V, format), _log_timestamp(), tag, ##__VA_ARGS__); } } while (0)
 
+#endif /* !WANT_LOGGER */
+
 #endif /* !LOG_INC */
@@ -16,6 +16,21 @@
 #ifdef WANT_ICE
 #include "simice.h"
 #endif
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_COVER
+#include "simcov.h"
+#endif
+#ifdef WANT_REPLAY
+#include "simreplay.h"
+#endif
+#ifdef WANT_REVERSE
+#include "simrev.h"
+#endif
+#ifdef WANT_JIT
+#include "simjit.h"
+#endif
 
 #ifdef FRONTPANEL
 #include "frontpanel.h"
@@ -420,6 +435,12 @@ void cpu_8080(void)
 
 #ifdef WANT_ICE
 
+#ifdef WANT_REVERSE
+		/* checkpoints of the history, stop when re-executing it */
+		if (rev_flag && T >= rev_next && rev_check())
+			continue;
+#endif
+
 #ifdef HISIZE
 		/* write history */
 		his[h_next].h_cpu = I8080;
@@ -446,6 +467,11 @@ void cpu_8080(void)
 
 #endif /* WANT_ICE */
 
+#ifdef WANT_TRACE
+		if (tr_flag)
+			trace_inst();
+#endif
+
 		/* CPU DMA bus request handling */
 		if (bus_mode) {
 
@@ -492,12 +518,21 @@ void cpu_8080(void)
 			}
 		}
 
+#ifdef WANT_REPLAY
+		if (rr_mode == RR_REPLAY)
+			rr_sync();
+#endif
+
 		/* CPU interrupt handling */
 		if (int_int) {
 			if (IFF != 3)
 				goto leave;
 			if (int_protection)	/* protect first instruction */
 				goto leave;	/* after EI */
+#ifdef WANT_REPLAY
+			if (!rr_accept(RR_INT))
+				goto leave;
+#endif
 
 			IFF = 0;
 
@@ -582,10 +617,22 @@ void cpu_8080(void)
 		}
 	leave:
 
+#ifdef WANT_JIT
+					/* run a translated block */
+		if (!jit_flag || !jit_run(I8080, op_sim)) {
+#endif
+
 #ifdef BUS_8080
 		/* M1 opcode fetch */
 		cpu_bus = CPU_WO | CPU_M1 | CPU_MEMR;
 #endif
+#ifdef WANT_COVER
+		if (cv_flag)
+			cv_acc = CV_EXEC;	/* next read is the op-code */
+#endif
+#ifdef WANT_METRICS
+		cpu_inst++;
+#endif
 
 		int_protection = false;
 #ifndef ALT_I8080
@@ -594,6 +641,10 @@ void cpu_8080(void)
 #include "alt8080.h"
 #endif
 
+#ifdef WANT_JIT
+		}
+#endif
+
 #ifdef WANT_ICE
 
 #ifdef WANT_TIM
@@ -606,7 +657,7 @@ void cpu_8080(void)
 #endif
 
 #ifdef WANT_HB
-		if (hb_trig) {
+		if (hb_trig && hb_check()) {
 			cpu_error = OPHALT;
 			cpu_state = ST_STOPPED;
 		}
@@ -704,6 +755,9 @@ static int op_hlt(void)			/* HLT */
 			cpu_state = ST_STOPPED;
 		} else {
 			/* else wait for INT or user interrupt */
+#ifdef WANT_REPLAY
+			if (rr_mode != RR_REPLAY)
+#endif
 			while (!int_int && (cpu_state == ST_CONTIN_RUN)) {
 				sleep_for_ms(1);
 			}
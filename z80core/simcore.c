@@ -25,6 +25,15 @@
 #include "simz80.h"
 #endif
 #include "simcore.h"
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_REPLAY
+#include "simreplay.h"
+#endif
+#ifdef WANT_JIT
+#include "simjit.h"
+#endif
 
 #ifdef FRONTPANEL
 #include "frontpanel.h"
@@ -115,6 +124,9 @@ void switch_cpu(int new_cpu)
  */
 void run_cpu(void)
 {
+#ifdef WANT_JIT
+	jit_flush();	/* memory may have been changed by the ICE or a loader */
+#endif
 	cpu_state = ST_CONTIN_RUN;
 	cpu_error = NONE;
 	while (true) {
@@ -261,10 +273,24 @@ BYTE io_in(BYTE addrl, BYTE addrh)
 #endif
 
 	io_port = addrl;
+#ifdef WANT_HB
+	if (hb_flag && (hb_pmap[addrl] & HB_IN))
+		hb_hit(addrl, HB_IN);
+#endif
 	if (port_in[addrl]) {
 		t = get_clock_us();
-		io_data = (*port_in[addrl])();
-		io_time += get_clock_us() - t;
+#ifdef WANT_REPLAY
+		if (rr_mode)
+			io_data = rr_in(addrl);
+		else
+#endif
+			io_data = (*port_in[addrl])();
+		t = get_clock_us() - t;
+		io_time += t;
+#ifdef WANT_METRICS
+		port_stats[addrl].in++;
+		port_stats[addrl].in_us += t;
+#endif
 	} else {
 		if (i_flag) {
 			cpu_error = IOTRAPIN;
@@ -272,6 +298,10 @@ BYTE io_in(BYTE addrl, BYTE addrh)
 		}
 		io_data = IO_DATA_UNUSED;
 	}
+#ifdef WANT_TRACE
+	if (tr_flag)
+		trace_io(TR_IN, addrl, io_data);
+#endif
 
 #ifdef BUS_8080
 	cpu_bus = CPU_WO | CPU_INP;
@@ -322,6 +352,14 @@ void io_out(BYTE addrl, BYTE addrh, BYTE data)
 
 	io_port = addrl;
 	io_data = data;
+#ifdef WANT_HB
+	if (hb_flag && (hb_pmap[addrl] & HB_OUT))
+		hb_hit(addrl, HB_OUT);
+#endif
+#ifdef WANT_TRACE
+	if (tr_flag)
+		trace_io(TR_OUT, addrl, data);
+#endif
 
 	LOGD(TAG, "output %02x to port %02x", io_data, io_port);
 
@@ -329,8 +367,19 @@ void io_out(BYTE addrl, BYTE addrh, BYTE data)
 
 	if (port_out[addrl]) {
 		t = get_clock_us();
-		(*port_out[addrl])(data);
-		io_time += get_clock_us() - t;
+#ifdef WANT_REVERSE
+		/* the history is re-executed without the devices */
+		if (rr_hist && rr_mode == RR_REPLAY)
+			rr_out();
+		else
+#endif
+			(*port_out[addrl])(data);
+		t = get_clock_us() - t;
+		io_time += t;
+#ifdef WANT_METRICS
+		port_stats[addrl].out++;
+		port_stats[addrl].out_us += t;
+#endif
 	} else {
 		if (i_flag) {
 			cpu_error = IOTRAPOUT;
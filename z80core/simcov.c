@@ -0,0 +1,163 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	This module records which memory addresses were executed, read
+ *	and written by the CPU, with flags for each address of every
+ *	memory bank. The flags are merged into a coverage file, so that
+ *	the coverage of many runs adds up. The tool z80cov maps them to
+ *	the lines of z80asm listings and exports lcov reports.
+ *
+ *	The CPU sets cv_acc to CV_EXEC before the op-code fetch, so the
+ *	first byte of each instruction is marked as executed, all other
+ *	reads including the operands as read.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simcov.h"
+
+#ifdef WANT_COVER
+
+#include "log.h"
+static const char *TAG = "cover";
+
+bool cv_flag;				/* coverage is recorded */
+BYTE cv_acc = CV_READ;			/* flag for the next memory read */
+BYTE *cv_map[CV_NBANKS];		/* access flags of each bank */
+
+static const char *cv_fn;		/* coverage file */
+
+static bool cover_alloc(void);
+
+/*
+ *	Start recording coverage, the flags already in the file
+ *	are added, so the file collects the coverage of many runs
+ */
+bool cover_open(const char *fn)
+{
+	FILE *fp;
+
+	if (!cover_alloc())
+		return false;
+	if ((fp = fopen(fn, "rb")) != NULL) {
+		fclose(fp);
+		if (!cover_merge(fn))
+			return false;
+	}
+	cv_fn = fn;
+	cv_acc = CV_READ;
+	cv_flag = true;
+	return true;
+}
+
+/*
+ *	Stop recording and write the coverage file
+ */
+void cover_close(void)
+{
+	if (cv_fn == NULL)
+		return;
+	cv_flag = false;
+	(void) cover_save(cv_fn);
+	cv_fn = NULL;
+}
+
+/*
+ *	Add the flags of a coverage file
+ */
+bool cover_merge(const char *fn)
+{
+	FILE *fp;
+	char magic[8];
+	BYTE *buf;
+	int bank;
+	register int i;
+
+	if (!cover_alloc())
+		return false;
+	if ((fp = fopen(fn, "rb")) == NULL) {
+		LOGE(TAG, "can't open file %s", fn);
+		return false;
+	}
+	if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, CV_MAGIC, 8)) {
+		LOGE(TAG, "%s is not a coverage file", fn);
+		fclose(fp);
+		return false;
+	}
+	if ((buf = (BYTE *) malloc(65536)) == NULL) {
+		LOGE(TAG, "can't allocate memory");
+		fclose(fp);
+		return false;
+	}
+	while ((bank = getc(fp)) != EOF) {
+		if (bank >= CV_NBANKS || fread(buf, 1, 65536, fp) != 65536) {
+			LOGE(TAG, "%s is not a coverage file", fn);
+			break;
+		}
+		for (i = 0; i < 65536; i++)
+			cv_map[bank][i] |= buf[i];
+	}
+	free(buf);
+	fclose(fp);
+	return bank == EOF;
+}
+
+/*
+ *	Write the flags into a coverage file, banks without
+ *	any accesses are left out
+ */
+bool cover_save(const char *fn)
+{
+	FILE *fp;
+	int bank;
+	register int i;
+
+	if ((fp = fopen(fn, "wb")) == NULL) {
+		LOGE(TAG, "can't create file %s", fn);
+		return false;
+	}
+	fwrite(CV_MAGIC, 1, 8, fp);
+	for (bank = 0; bank < CV_NBANKS; bank++) {
+		for (i = 0; i < 65536; i++)
+			if (cv_map[bank][i])
+				break;
+		if (i == 65536)
+			continue;
+		putc(bank, fp);
+		fwrite(cv_map[bank], 1, 65536, fp);
+	}
+	if (fclose(fp)) {
+		LOGE(TAG, "error writing coverage file %s", fn);
+		return false;
+	}
+	return true;
+}
+
+/*
+ *	allocate the flags of all banks
+ */
+static bool cover_alloc(void)
+{
+	BYTE *p;
+	int bank;
+
+	if (cv_map[0] != NULL)
+		return true;
+	if ((p = (BYTE *) calloc(CV_NBANKS, 65536)) == NULL) {
+		LOGE(TAG, "can't allocate memory");
+		return false;
+	}
+	for (bank = 0; bank < CV_NBANKS; bank++)
+		cv_map[bank] = p + bank * 65536;
+	return true;
+}
+
+#endif /* WANT_COVER */
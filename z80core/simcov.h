@@ -0,0 +1,57 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+#ifndef SIMCOV_INC
+#define SIMCOV_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+/*
+ *	Format of a coverage file:
+ *
+ *	The file starts with the 8 bytes CV_MAGIC, followed by one
+ *	record for each bank with accesses, the bank number as one
+ *	byte and the access flags of the 65536 addresses of the bank.
+ */
+
+#define CV_MAGIC	"Z80COV01"
+
+#define CV_EXEC		0x01	/* first op-code byte executed */
+#define CV_READ		0x02	/* read by the CPU */
+#define CV_WRITE	0x04	/* written by the CPU */
+
+#define CV_NBANKS	16	/* max. number of memory banks */
+
+#ifdef WANT_COVER
+
+extern bool	cv_flag;
+extern BYTE	cv_acc;
+extern BYTE	*cv_map[CV_NBANKS];
+
+extern bool cover_open(const char *fn);
+extern void cover_close(void);
+extern bool cover_merge(const char *fn);
+extern bool cover_save(const char *fn);
+
+/*
+ * called by memrdr(), the first read after the CPU set cv_acc
+ * to CV_EXEC is the op-code fetch
+ */
+static inline void cover_read(int bank, WORD addr)
+{
+	cv_map[bank][addr] |= cv_acc;
+	cv_acc = CV_READ;
+}
+
+static inline void cover_write(int bank, WORD addr)
+{
+	cv_map[bank][addr] |= CV_WRITE;
+}
+
+#endif /* WANT_COVER */
+
+#endif /* !SIMCOV_INC */
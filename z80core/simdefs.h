@@ -38,6 +38,18 @@
 #endif
 #if (defined(ALT_I8080) || defined(ALT_Z80)) && !defined(UNDOC_INST)
 #error "UNDOC_INST required for alternate simulators"
+#endif
+#if defined(WANT_REVERSE) \
+    && (!defined(WANT_ICE) || !defined(WANT_HB) || !defined(WANT_REPLAY))
+#error "WANT_REVERSE requires WANT_ICE, WANT_HB and WANT_REPLAY"
+#endif
+#if defined(WANT_METRICS) && !defined(HAS_NETSERVER)
+#error "WANT_METRICS requires HAS_NETSERVER"
+#endif
+#if defined(WANT_JIT) \
+    && (!defined(__x86_64__) || defined(_WIN32) || defined(ALT_Z80) \
+	|| defined(ALT_I8080))
+#undef WANT_JIT	/* translator generates x86-64 System V code */
 #endif
 
 				/* bit definitions of CPU flags */
@@ -106,6 +118,13 @@ typedef struct port_flags {
 } port_flags_t;
 #endif
 
+#ifdef WANT_METRICS
+typedef struct port_stats {
+	uint64_t in, out;	/* number of accesses */
+	uint64_t in_us, out_us;	/* time spent in the device functions */
+} port_stats_t;
+#endif
+
 /*
  *	macro for declaring unused function parameters
  */
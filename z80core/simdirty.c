@@ -0,0 +1,134 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	This module tracks writes into memory ranges watched by
+ *	memory mapped video devices, so that they only have to
+ *	render and transmit the parts of the frame buffer which
+ *	were changed since the last frame.
+ *
+ *	The memory write functions call dirty_mark() for every
+ *	written address. Each watcher has its own array of line
+ *	flags, which is set by the CPU thread and collected and
+ *	cleared by the video thread. Both only store whole bytes,
+ *	so no locking is needed: a write racing with the collection
+ *	is either seen in this or in the next frame.
+ */
+
+#include <string.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simdirty.h"
+
+BYTE dirty_map[DIRTY_LINES];		/* bit n set: line watched by n */
+BYTE dirty_bits[DIRTY_MAX][DIRTY_LINES]; /* line written since collected */
+
+static bool used[DIRTY_MAX];
+static WORD start_line[DIRTY_MAX];
+static int num_lines[DIRTY_MAX];
+
+/*
+ *	allocate a watcher, returns -1 if none is available
+ */
+int dirty_alloc(void)
+{
+	int id;
+
+	for (id = 0; id < DIRTY_MAX; id++)
+		if (!used[id]) {
+			used[id] = true;
+			num_lines[id] = 0;
+			return id;
+		}
+	return -1;
+}
+
+/*
+ *	release a watcher
+ */
+void dirty_free(int id)
+{
+	if (id < 0 || id >= DIRTY_MAX)
+		return;
+	dirty_range(id, 0, 0);
+	used[id] = false;
+}
+
+/*
+ *	set the memory range watched, everything in it is dirty
+ */
+void dirty_range(int id, WORD start, unsigned size)
+{
+	register int i, l;
+	BYTE m;
+
+	if (id < 0 || id >= DIRTY_MAX)
+		return;
+	m = 1 << id;
+
+	for (i = 0, l = start_line[id]; i < num_lines[id]; i++)
+		dirty_map[(l + i) & (DIRTY_LINES - 1)] &= ~m;
+
+	start_line[id] = start >> DIRTY_SHIFT;
+	num_lines[id] = size ? (((start & ((1 << DIRTY_SHIFT) - 1)) +
+				size - 1) >> DIRTY_SHIFT) + 1 : 0;
+
+	for (i = 0, l = start_line[id]; i < num_lines[id]; i++)
+		dirty_map[(l + i) & (DIRTY_LINES - 1)] |= m;
+
+	dirty_all(id);
+}
+
+/*
+ *	mark the whole range of a watcher dirty
+ */
+void dirty_all(int id)
+{
+	register int i, l;
+
+	if (id < 0 || id >= DIRTY_MAX)
+		return;
+
+	for (i = 0, l = start_line[id]; i < num_lines[id]; i++)
+		dirty_bits[id][(l + i) & (DIRTY_LINES - 1)] = 1;
+}
+
+/*
+ *	mark everything dirty, used when memory mappings change
+ *	without writes, e.g. by bank switching
+ */
+void dirty_touch(void)
+{
+	register int id;
+
+	for (id = 0; id < DIRTY_MAX; id++)
+		if (used[id])
+			dirty_all(id);
+}
+
+/*
+ *	copy the line flags of a watcher into snap and clear them,
+ *	returns true if any line was written
+ */
+bool dirty_collect(int id, BYTE *snap)
+{
+	register int i, l;
+	register BYTE *p;
+	bool any = false;
+
+	if (id < 0 || id >= DIRTY_MAX)
+		return false;
+
+	p = dirty_bits[id];
+	for (i = 0, l = start_line[id]; i < num_lines[id]; i++) {
+		if ((snap[i] = p[(l + i) & (DIRTY_LINES - 1)]) != 0) {
+			p[(l + i) & (DIRTY_LINES - 1)] = 0;
+			any = true;
+		}
+	}
+	return any;
+}
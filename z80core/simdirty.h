@@ -0,0 +1,72 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+#ifndef SIMDIRTY_INC
+#define SIMDIRTY_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#define DIRTY_SHIFT	4	/* track writes in 16 byte lines */
+#define DIRTY_LINES	(65536 >> DIRTY_SHIFT)
+#define DIRTY_MAX	4	/* max. number of watched memory ranges */
+
+extern BYTE dirty_map[DIRTY_LINES];
+extern BYTE dirty_bits[DIRTY_MAX][DIRTY_LINES];
+
+extern int dirty_alloc(void);
+extern void dirty_free(int id);
+extern void dirty_range(int id, WORD start, unsigned size);
+extern void dirty_all(int id);
+extern void dirty_touch(void);
+extern bool dirty_collect(int id, BYTE *snap);
+
+/*
+ * called for every memory write, costs one table lookup for
+ * addresses not in a watched range
+ */
+static inline void dirty_mark(WORD addr)
+{
+	register int line = addr >> DIRTY_SHIFT;
+	register BYTE m = dirty_map[line];
+	register int i;
+
+	if (m)
+		for (i = 0; m && i < DIRTY_MAX; i++, m >>= 1)
+			if (m & 1)
+				dirty_bits[i][line] = 1;
+}
+
+/*
+ * called for block writes of len bytes at addr, which must not
+ * wrap around
+ */
+static inline void dirty_mark_block(WORD addr, unsigned len)
+{
+	register unsigned a, e = (unsigned) addr + len;
+
+	for (a = addr & ~((1 << DIRTY_SHIFT) - 1); a < e; a += 1 << DIRTY_SHIFT)
+		dirty_mark(a);
+}
+
+/*
+ * check a snapshot from dirty_collect() for writes into
+ * len bytes at addr, base is the start of the watched range
+ */
+static inline bool dirty_check(const BYTE *snap, WORD base, WORD addr,
+			       unsigned len)
+{
+	register int l = (addr >> DIRTY_SHIFT) - (base >> DIRTY_SHIFT);
+	register int e = ((addr + len - 1) >> DIRTY_SHIFT) -
+			 (base >> DIRTY_SHIFT);
+
+	for (; l <= e; l++)
+		if (snap[l])
+			return true;
+	return false;
+}
+
+#endif /* !SIMDIRTY_INC */
@@ -95,6 +95,16 @@ BYTE fp_led_output = 0xff;	/* inverted IMSAI/Cromemco programmed output */
 port_flags_t port_flags[256];	/* port access flags */
 #endif
 
+/*
+ *	Counters for the metrics of the web frontend
+ */
+#ifdef WANT_METRICS
+uint64_t cpu_inst;		/* executed instructions */
+uint64_t disk_rd_sec;		/* disk sectors read */
+uint64_t disk_wr_sec;		/* disk sectors written */
+port_stats_t port_stats[256];	/* I/O port accesses */
+#endif
+
 /*
  *	Flags to control operation of simulation
  */
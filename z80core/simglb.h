@@ -75,6 +75,12 @@ extern BYTE 	fp_led_output;
 extern port_flags_t port_flags[256];
 #endif
 
+#ifdef WANT_METRICS
+extern uint64_t	cpu_inst;
+extern uint64_t	disk_rd_sec, disk_wr_sec;
+extern port_stats_t port_stats[256];
+#endif
+
 extern bool	s_flag, l_flag, x_flag, i_flag, u_flag, r_flag, c_flag;
 extern int	m_value, f_value;
 #ifdef HAS_CONFIG
@@ -12,6 +12,7 @@
  */
 
 #include <ctype.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -27,13 +28,34 @@
 
 #ifndef BAREMETAL
 #include <signal.h>
+#include <unistd.h>
 #include <sys/time.h>
+#include <sys/wait.h>
 #include "simfun.h"
 #include "simint.h"
 #endif
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_REVERSE
+#include "simrev.h"
+#endif
+#ifdef WANT_LOGGER
+#include "log.h"
+#endif
 
 #ifdef WANT_ICE
 
+#ifndef BAREMETAL
+/*
+ *	Symbol imported from the assembler
+ */
+typedef struct symbol {
+	WORD sym_addr;		/* value of symbol */
+	char *sym_name;		/* name of symbol */
+} symbol_t;
+#endif
+
 /*
  *	Variables for history memory
  */
@@ -65,10 +87,38 @@ WORD t_end = 65535;		/* end address for measurement */
  *	Variables for hardware breakpoint
  */
 #ifdef WANT_HB
-bool hb_flag;			/* hardware breakpoint enabled flag */
-WORD hb_addr;			/* address of hardware breakpoint */
-int hb_mode;			/* access mode of hardware breakpoint */
+bool hb_flag;			/* hardware breakpoints enabled flag */
 int hb_trig;			/* hardware breakpoint triggered flag */
+int hb_nhits;			/* number of recorded accesses */
+WORD hb_haddr[HB_MAXHITS];	/* addresses of triggering accesses */
+BYTE hb_hmode[HB_MAXHITS];	/* access modes of triggering accesses */
+BYTE hb_map[65536];		/* access modes to break on per address */
+BYTE hb_pmap[256];		/* access modes to break on per port */
+
+/*
+ *	Hardware breakpoints are kept in a list, the access modes of all
+ *	breakpoints are merged into hb_map and hb_pmap, which are checked
+ *	by the memory and I/O functions. They record every access of an
+ *	instruction with hb_hit(), and after the instruction the list is
+ *	searched for all breakpoints of each access, to check the pass
+ *	count and condition.
+ */
+typedef struct hardbreak {	/* structure of a hardware breakpoint */
+	WORD	hb_addr;	/* address or port */
+	int	hb_mode;	/* access modes */
+	int	hb_pass;	/* no. of pass to break */
+	int	hb_passcount;	/* pass counter */
+	const struct reg_def *hb_reg; /* register of condition, or NULL */
+	int	hb_cmem;	/* condition compares memory byte */
+	WORD	hb_caddr;	/* address of memory byte */
+	int	hb_cop;		/* comparison, 0 = no condition */
+	WORD	hb_cval;	/* value to compare with */
+	char	*hb_ctext;	/* condition as entered */
+} hardbreak_t;
+
+static hardbreak_t *hard;	/* hardware breakpoints */
+static int nhard;		/* number of hardware breakpoints */
+static int nhard_alloc;		/* allocated entries */
 #endif
 
 static void do_step(void);
@@ -86,7 +136,17 @@ static void do_port(char *s);
 static void do_reg(char *s);
 static void print_head(void);
 static void print_reg(void);
+static const struct reg_def *find_reg(const char *s);
+static WORD reg_val(const struct reg_def *p);
 static void do_break(char *s);
+#ifdef WANT_HB
+static void list_hardbp(void);
+static void clear_hardbp(char *s);
+static void set_hardbp(char *s);
+static bool parse_cond(char *s, hardbreak_t *hp);
+static bool check_cond(const hardbreak_t *hp);
+static void update_hardbp(void);
+#endif
 static void do_hist(char *s);
 static void do_count(char *s);
 #if !defined (EXCLUDE_I8080) && !defined(EXCLUDE_Z80)
@@ -96,17 +156,38 @@ static void do_uflag(void);
 static void do_iflag(void);
 static void do_show(void);
 static void do_help(void);
+static bool is_addr(const char *s);
+static WORD get_addr(char *s, char **end);
+static void print_label(WORD a);
 
 #ifndef BAREMETAL
 static void do_clock(void);
 static void timeout(int sig);
 static void do_load(char *s);
+static void do_asm(char *s);
+static bool load_syms(const char *fn);
+static symbol_t *find_sym(const char *name);
+static int symcmp(const void *p1, const void *p2);
 static void do_unix(char *s);
 #endif
+#ifdef WANT_TRACE
+static void do_wtrace(char *s);
+#endif
+#ifdef WANT_REVERSE
+static void do_rev(char *s);
+#endif
+#ifdef WANT_LOGGER
+static void do_log(char *s);
+#endif
 
 static char arg[LENCMD];
 static WORD wrk_addr;
 
+#ifndef BAREMETAL
+static symbol_t *syms;		/* symbols sorted by address */
+static int nsyms;		/* number of symbols */
+#endif
+
 void (*ice_before_go)(void);
 void (*ice_after_go)(void);
 void (*ice_cust_cmd)(char *cmd, WORD *wrk_addr);
@@ -220,9 +301,27 @@ void ice_cmd_loop(int go_mode)
 		case 'r':
 			do_load(cmd + 1);
 			break;
+		case 'a':
+			do_asm(cmd + 1);
+			break;
 		case '!':
 			do_unix(cmd + 1);
 			break;
+#endif
+#ifdef WANT_TRACE
+		case 'w':
+			do_wtrace(cmd + 1);
+			break;
+#endif
+#ifdef WANT_REVERSE
+		case 'j':
+			do_rev(cmd + 1);
+			break;
+#endif
+#ifdef WANT_LOGGER
+		case 'o':
+			do_log(cmd + 1);
+			break;
 #endif
 		case 'q':
 			eoj = false;
@@ -242,11 +341,17 @@ void ice_cmd_loop(int go_mode)
  */
 static void do_step(void)
 {
+#ifdef WANT_REVERSE
+	rev_resume();
+#endif
 	install_softbp();
 	step_cpu();
 	if (cpu_error == OPHALT)
 		(void) handle_break();
 	uninstall_softbp();
+#ifdef WANT_REVERSE
+	rev_pause();
+#endif
 	report_cpu_error();
 	print_head();
 	print_reg();
@@ -269,6 +374,9 @@ static void do_trace(char *s)
 		count = atoi(s);
 	print_head();
 	print_reg();
+#ifdef WANT_REVERSE
+	rev_resume();
+#endif
 	install_softbp();
 	for (i = 0; i < count; i++) {
 		step_cpu();
@@ -277,6 +385,9 @@ static void do_trace(char *s)
 			break;
 	}
 	uninstall_softbp();
+#ifdef WANT_REVERSE
+	rev_pause();
+#endif
 	report_cpu_error();
 	wrk_addr = PC;
 }
@@ -299,10 +410,13 @@ static void do_go(char *s)
 		timeit = 1;
 		s++;
 	}
-	if (isxdigit((unsigned char) *s))
-		PC = strtol(s, NULL, 16);
+	if (is_addr(s))
+		PC = get_addr(s, NULL);
 	if (ice_before_go)
 		(*ice_before_go)();
+#ifdef WANT_REVERSE
+	rev_resume();
+#endif
 	install_softbp();
 	T0 = T;
 	start_cpu_time = cpu_time;
@@ -317,6 +431,9 @@ static void do_go(char *s)
 	stop_io_time = total_io_time;
 	stop_wait_time = total_wait_time;
 	uninstall_softbp();
+#ifdef WANT_REVERSE
+	rev_pause();
+#endif
 	if (ice_after_go)
 		(*ice_after_go)();
 	report_cpu_error();
@@ -375,21 +492,31 @@ static void uninstall_softbp(void)
  */
 static bool handle_break(void)
 {
-#ifdef SBSIZE
+#if defined(SBSIZE) || defined(WANT_HB)
 	register int i;
 #endif
 
 #ifdef WANT_HB
 	if (hb_flag && hb_trig) {
-		printf("Hardware breakpoint hit by ");
-		if (hb_trig == HB_READ)
-			printf("read");
-		else if (hb_trig == HB_WRITE)
-			printf("write");
-		else
-			printf("execute");
-		printf(" access to %04x\n", hb_addr);
+		for (i = 0; i < hb_nhits; i++) {
+			printf("Hardware breakpoint hit by ");
+			if (hb_hmode[i] == HB_READ)
+				printf("read");
+			else if (hb_hmode[i] == HB_WRITE)
+				printf("write");
+			else if (hb_hmode[i] == HB_EXEC)
+				printf("execute");
+			else if (hb_hmode[i] == HB_IN)
+				printf("input");
+			else
+				printf("output");
+			if (hb_hmode[i] & (HB_IN | HB_OUT))
+				printf(" access to port %02x\n", hb_haddr[i]);
+			else
+				printf(" access to %04x\n", hb_haddr[i]);
+		}
 		hb_trig = 0;
+		hb_nhits = 0;
 		cpu_error = NONE;
 		return true;
 	}
@@ -408,6 +535,20 @@ static bool handle_break(void)
 #endif
 	PC--;				/* substitute HALT opcode by */
 	putmem(PC, soft[i].sb_oldopc);	/* original opcode */
+#ifdef WANT_REVERSE
+	/* the HALT opcode doesn't count, so that the history
+	   is the same when it is re-executed without breakpoints */
+#ifndef EXCLUDE_Z80
+	if (cpu == Z80) {
+		T -= 4;
+		R--;
+	}
+#endif
+#ifndef EXCLUDE_I8080
+	if (cpu == I8080)
+		T -= 7;
+#endif
+#endif
 	step_cpu();			/* and execute it */
 	putmem(soft[i].sb_addr, 0x76);	/* restore HALT opcode again */
 	soft[i].sb_passcount++;		/* increment pass counter */
@@ -432,16 +573,16 @@ static void do_dump(char *s)
 
 	while (isspace((unsigned char) *s))
 		s++;
-	if (isxdigit((unsigned char) *s))
-		wrk_addr = strtol(s, &s, 16) & ~0xf;
+	if (is_addr(s))
+		wrk_addr = get_addr(s, &s) & ~0xf;
 	while (isspace((unsigned char) *s))
 		s++;
 	if (*s == ',') {
 		s++;
 		while (isspace((unsigned char) *s))
 			s++;
-		if (isxdigit((unsigned char) *s)) {
-			n = ((strtol(s, NULL, 16) & ~0xf) - wrk_addr) / 16 + 1;
+		if (is_addr(s)) {
+			n = ((get_addr(s, NULL) & ~0xf) - wrk_addr) / 16 + 1;
 			if (n <= 0)
 				n = 1;
 		}
@@ -473,19 +614,20 @@ static void do_list(char *s)
 
 	while (isspace((unsigned char) *s))
 		s++;
-	if (isxdigit((unsigned char) *s))
-		wrk_addr = strtol(s, &s, 16);
+	if (is_addr(s))
+		wrk_addr = get_addr(s, &s);
 	while (isspace((unsigned char) *s))
 		s++;
 	if (*s == ',') {
 		s++;
 		while (isspace((unsigned char) *s))
 			s++;
-		if (isxdigit((unsigned char) *s)) {
-			a = strtol(s, NULL, 16);
+		if (is_addr(s)) {
+			a = get_addr(s, NULL);
 			if (a < wrk_addr)
 				a = wrk_addr;
 			while (wrk_addr <= a) {
+				print_label(wrk_addr);
 				printf("%04x - ", (unsigned int) wrk_addr);
 				wrk_addr += disass(wrk_addr);
 			}
@@ -493,6 +635,7 @@ static void do_list(char *s)
 		}
 	}
 	for (i = 0; i < 10; i++) {
+		print_label(wrk_addr);
 		printf("%04x - ", (unsigned int) wrk_addr);
 		wrk_addr += disass(wrk_addr);
 	}
@@ -505,8 +648,8 @@ static void do_modify(char *s)
 {
 	while (isspace((unsigned char) *s))
 		s++;
-	if (isxdigit((unsigned char) *s))
-		wrk_addr = strtol(s, NULL, 16);
+	if (is_addr(s))
+		wrk_addr = get_addr(s, NULL);
 	while (true) {
 		printf("%04x = %02x : ", (unsigned int) wrk_addr,
 		       getmem(wrk_addr));
@@ -741,27 +884,60 @@ static reg_def_t const regs[] = {
 };
 static int nregs = sizeof(regs) / sizeof(reg_def_t);
 
+/*
+ *	Search the register named at the start of s
+ */
+static const reg_def_t *find_reg(const char *s)
+{
+	register int i;
+	register const reg_def_t *p;
+
+	for (i = 0, p = regs; i < nregs; i++, p++) {
+#ifndef EXCLUDE_Z80
+		if (p->z80 && cpu != Z80)
+			continue;
+#endif
+		if (strncmp(s, p->name, p->len) == 0)
+			return p;
+	}
+	return NULL;
+}
+
+/*
+ *	Get the value of register p
+ */
+static WORD reg_val(const reg_def_t *p)
+{
+	switch (p->type) {
+	case R_8:
+		return *(p->r8);
+	case R_88:
+		return (*(p->r8h) << 8) + *(p->r8l);
+	case R_16:
+		return *(p->r16);
+	case R_R:
+		return (*(p->r8h) & 0x80) | (*(p->r8l) & 0x7f);
+	case R_F:
+		return *(p->rf) & 0xff;
+	case R_M:
+		return (F & p->rm) ? 1 : 0;
+	default:
+		return 0;
+	}
+}
+
 /*
  *	Register modify
  */
 static void do_reg(char *s)
 {
-	register int i;
 	register const reg_def_t *p;
 	WORD w;
 
 	while (isspace((unsigned char) *s))
 		s++;
 	if (*s != '\0') {
-		for (i = 0, p = regs; i < nregs; i++, p++) {
-#ifndef EXCLUDE_Z80
-			if (p->z80 && cpu != Z80)
-				continue;
-#endif
-			if (strncmp(s, p->name, p->len) == 0)
-				break;
-		}
-		if (i < nregs) {
+		if ((p = find_reg(s)) != NULL) {
 			switch (p->type) {
 			case R_8:
 				printf("%s = %02x : ", p->prt, *(p->r8));
@@ -882,13 +1058,11 @@ static void print_reg(void)
  */
 static void do_break(char *s)
 {
-#if defined(SBSIZE) || defined(WANT_HB)
+#ifdef SBSIZE
 	WORD a;
 	int n;
-#ifdef SBSIZE
 	register int i;
 	int hdr_flag;
-#endif
 #endif
 
 	if (*s == 'h') {
@@ -897,73 +1071,12 @@ static void do_break(char *s)
 		puts("Please recompile with WANT_HB defined in sim.h");
 #else /* WANT_HB */
 		s++;
-		if (*s == '\n' || *s == '\0') {
-			if (hb_flag) {
-				printf("Hardware breakpoint set with ");
-				n = 0;
-				if (hb_mode & HB_READ) {
-					printf("read");
-					n = 1;
-				}
-				if (hb_mode & HB_WRITE) {
-					if (n)
-						putchar('/');
-					printf("write");
-					n = 1;
-				}
-				if (hb_mode & HB_EXEC) {
-					if (n)
-						putchar('/');
-					printf("execute");
-				}
-				printf(" access trigger to %04x\n", hb_addr);
-			} else
-				puts("No hardware breakpoint set");
-			return;
-		}
-		if (tolower((unsigned char) *s) == 'c') {
-			hb_flag = false;
-			return;
-		}
-		while (isspace((unsigned char) *s))
-			s++;
-		if (!isxdigit((unsigned char) *s)) {
-			puts("address missing");
-			return;
-		}
-		a = strtol(s, &s, 16);
-		while (isspace((unsigned char) *s))
-			s++;
-		if (*s == ',') {
-			s++;
-			while (isspace((unsigned char) *s))
-				s++;
-			n = 0;
-			if (tolower((unsigned char) *s) == 'r') {
-				n |= HB_READ;
-				s++;
-			}
-			if (tolower((unsigned char) *s) == 'w') {
-				n |= HB_WRITE;
-				s++;
-			}
-			if (tolower((unsigned char) *s) == 'x')
-				n |= HB_EXEC;
-		} else
-			n = HB_READ | HB_WRITE | HB_EXEC;
-#ifdef SBSIZE
-		if (n & HB_EXEC) {
-			for (i = 0; i < SBSIZE; i++)
-				if (soft[i].sb_pass && soft[i].sb_addr == a) {
-					puts("Software breakpoint set "
-					     "at same execute access address");
-					return;
-				}
-		}
-#endif
-		hb_addr = a;
-		hb_mode = n;
-		hb_flag = true;
+		if (*s == '\n' || *s == '\0')
+			list_hardbp();
+		else if (tolower((unsigned char) *s) == 'c')
+			clear_hardbp(s + 1);
+		else
+			set_hardbp(s);
 #endif /* WANT_HB */
 		return;
 	}
@@ -995,11 +1108,11 @@ static void do_break(char *s)
 			memset((char *) soft, 0, sizeof(softbreak_t) * SBSIZE);
 			return;
 		}
-		if (!isxdigit((unsigned char) *s)) {
+		if (!is_addr(s)) {
 			puts("address missing");
 			return;
 		}
-		a = strtol(s, NULL, 16);
+		a = get_addr(s, NULL);
 		for (i = 0; i < SBSIZE; i++) {
 			if (soft[i].sb_pass && soft[i].sb_addr == a)
 				break;
@@ -1012,11 +1125,11 @@ static void do_break(char *s)
 	}
 	while (isspace((unsigned char) *s))
 		s++;
-	if (!isxdigit((unsigned char) *s)) {
+	if (!is_addr(s)) {
 		puts("address missing");
 		return;
 	}
-	a = strtol(s, &s, 16);
+	a = get_addr(s, &s);
 	/* look for existing breakpoint */
 	for (i = 0; i < SBSIZE; i++) {
 		if (soft[i].sb_pass && soft[i].sb_addr == a)
@@ -1034,7 +1147,7 @@ static void do_break(char *s)
 		if (!soft[i].sb_pass) {
 			/* new breakpoint */
 #ifdef WANT_HB
-			if (hb_flag && (hb_mode & HB_EXEC) && hb_addr == a) {
+			if (hb_map[a] & HB_EXEC) {
 				puts("Hardware execute access breakpoint set "
 				     "at same address");
 				return;
@@ -1063,6 +1176,379 @@ static void do_break(char *s)
 #endif /* SBSIZE */
 }
 
+#ifdef WANT_HB
+
+/*
+ *	Show hardware breakpoints
+ */
+static void list_hardbp(void)
+{
+	register int i;
+	register hardbreak_t *hp;
+
+	if (nhard == 0) {
+		puts("No hardware breakpoints set");
+		return;
+	}
+	puts("Addr Mode Pass  Counter Condition");
+	for (i = 0, hp = hard; i < nhard; i++, hp++) {
+		if (hp->hb_mode & (HB_IN | HB_OUT))
+			printf("  %02x %c%c   ", hp->hb_addr,
+			       (hp->hb_mode & HB_IN) ? 'i' : '-',
+			       (hp->hb_mode & HB_OUT) ? 'o' : '-');
+		else
+			printf("%04x %c%c%c  ", hp->hb_addr,
+			       (hp->hb_mode & HB_READ) ? 'r' : '-',
+			       (hp->hb_mode & HB_WRITE) ? 'w' : '-',
+			       (hp->hb_mode & HB_EXEC) ? 'x' : '-');
+		printf("%05d %05d   %s\n", hp->hb_pass, hp->hb_passcount,
+		       hp->hb_cop ? hp->hb_ctext : "");
+	}
+}
+
+/*
+ *	Clear the hardware breakpoint at the address in s, a port
+ *	breakpoint if the access mode i or o follows, or all if no
+ *	address is given
+ */
+static void clear_hardbp(char *s)
+{
+	register int i;
+	WORD a;
+	bool port;
+
+	while (isspace((unsigned char) *s))
+		s++;
+	if (*s == '\0') {
+		while (nhard > 0)
+			free(hard[--nhard].hb_ctext);
+	} else {
+		if (!is_addr(s)) {
+			puts("address missing");
+			return;
+		}
+		a = get_addr(s, &s);
+		while (isspace((unsigned char) *s))
+			s++;
+		port = false;
+		if (*s == ',') {
+			s++;
+			while (isspace((unsigned char) *s))
+				s++;
+			switch (tolower((unsigned char) *s)) {
+			case 'i':
+			case 'o':
+				port = true;
+				break;
+			case 'r':
+			case 'w':
+			case 'x':
+				break;
+			default:
+				puts("invalid access mode");
+				return;
+			}
+		}
+		for (i = 0; i < nhard; i++)
+			if (hard[i].hb_addr == a
+			    && !(hard[i].hb_mode & (HB_IN | HB_OUT)) == !port)
+				break;
+		if (i == nhard) {
+			if (port)
+				printf("No hardware breakpoint at port %02x\n",
+				       a);
+			else
+				printf("No hardware breakpoint at address "
+				       "%04x\n", a);
+			return;
+		}
+		free(hard[i].hb_ctext);
+		hard[i] = hard[--nhard];
+	}
+	update_hardbp();
+}
+
+/*
+ *	Set a hardware breakpoint: address[,accmode[,pass[,condition]]]
+ *	accmode is any of r, w, x for memory accesses, or i, o for
+ *	input and output of the port address, the default is rwx
+ */
+static void set_hardbp(char *s)
+{
+	register int i;
+	register hardbreak_t *hp;
+	hardbreak_t hb;
+
+	memset(&hb, 0, sizeof(hb));
+	while (isspace((unsigned char) *s))
+		s++;
+	if (!is_addr(s)) {
+		puts("address missing");
+		return;
+	}
+	hb.hb_addr = get_addr(s, &s);
+	while (isspace((unsigned char) *s))
+		s++;
+	if (*s == ',') {
+		s++;
+		while (isspace((unsigned char) *s))
+			s++;
+		for (; *s != ',' && *s != '\0'
+		       && !isspace((unsigned char) *s); s++)
+			switch (tolower((unsigned char) *s)) {
+			case 'r':
+				hb.hb_mode |= HB_READ;
+				break;
+			case 'w':
+				hb.hb_mode |= HB_WRITE;
+				break;
+			case 'x':
+				hb.hb_mode |= HB_EXEC;
+				break;
+			case 'i':
+				hb.hb_mode |= HB_IN;
+				break;
+			case 'o':
+				hb.hb_mode |= HB_OUT;
+				break;
+			default:
+				printf("invalid access mode %c\n", *s);
+				return;
+			}
+		while (isspace((unsigned char) *s))
+			s++;
+	}
+	if (hb.hb_mode == 0)
+		hb.hb_mode = HB_READ | HB_WRITE | HB_EXEC;
+	if ((hb.hb_mode & (HB_IN | HB_OUT))
+	    && (hb.hb_mode & (HB_READ | HB_WRITE | HB_EXEC))) {
+		puts("memory and port access modes can't be mixed");
+		return;
+	}
+	if ((hb.hb_mode & (HB_IN | HB_OUT)) && hb.hb_addr > 0xff) {
+		puts("invalid port");
+		return;
+	}
+	hb.hb_pass = 1;
+	if (*s == ',') {
+		s++;
+		while (isspace((unsigned char) *s))
+			s++;
+		if (isdigit((unsigned char) *s)) {
+			hb.hb_pass = strtol(s, &s, 10);
+			if (hb.hb_pass <= 0)
+				hb.hb_pass = 1;
+		}
+		while (isspace((unsigned char) *s))
+			s++;
+		if (*s == ',' && !parse_cond(s + 1, &hb))
+			return;
+	}
+#ifdef SBSIZE
+	if (hb.hb_mode & HB_EXEC) {
+		for (i = 0; i < SBSIZE; i++)
+			if (soft[i].sb_pass && soft[i].sb_addr == hb.hb_addr) {
+				puts("Software breakpoint set "
+				     "at same execute access address");
+				free(hb.hb_ctext);
+				return;
+			}
+	}
+#endif
+	/* replace an existing breakpoint for the same address or port */
+	for (i = 0, hp = hard; i < nhard; i++, hp++)
+		if (hp->hb_addr == hb.hb_addr
+		    && !(hp->hb_mode & (HB_IN | HB_OUT))
+		    == !(hb.hb_mode & (HB_IN | HB_OUT)))
+			break;
+	if (i < nhard)
+		free(hp->hb_ctext);
+	else {
+		if (nhard == nhard_alloc) {
+			i = nhard_alloc ? nhard_alloc * 2 : 16;
+			hp = (hardbreak_t *) realloc(hard,
+						     sizeof(hardbreak_t) * i);
+			if (hp == NULL) {
+				puts("can't allocate memory for breakpoint");
+				free(hb.hb_ctext);
+				return;
+			}
+			hard = hp;
+			nhard_alloc = i;
+		}
+		hp = &hard[nhard++];
+	}
+	*hp = hb;
+	update_hardbp();
+}
+
+/*
+ *	Parse the condition of a hardware breakpoint "operand op value":
+ *	operand is a register, or (address) or (register pair) for a
+ *	memory byte, op one of = != < > <= >=, and value a hexadecimal
+ *	number or .symbol
+ */
+static bool parse_cond(char *s, hardbreak_t *hp)
+{
+	register char *p;
+	const reg_def_t *rp;
+
+	while (isspace((unsigned char) *s))
+		s++;
+	for (p = s; *p != '\0'; p++)
+		*p = tolower((unsigned char) *p);
+	while (p > s && isspace((unsigned char) *(p - 1)))
+		*--p = '\0';
+	if ((hp->hb_ctext = strdup(s)) == NULL) {
+		puts("can't allocate memory for condition");
+		return false;
+	}
+	if (*s == '(') {
+		hp->hb_cmem = 1;
+		s++;
+		if ((rp = find_reg(s)) != NULL && s[(int) rp->len] == ')'
+		    && (rp->type == R_88 || rp->type == R_16)) {
+			hp->hb_reg = rp;
+			s += rp->len;
+		} else if (is_addr(s))
+			hp->hb_caddr = get_addr(s, &s);
+		else
+			goto error;
+		if (*s++ != ')')
+			goto error;
+	} else if ((rp = find_reg(s)) != NULL) {
+		hp->hb_reg = rp;
+		s += rp->len;
+	} else
+		goto error;
+	while (isspace((unsigned char) *s))
+		s++;
+	if (*s == '=') {
+		hp->hb_cop = '=';
+		s += (s[1] == '=') ? 2 : 1;
+	} else if (*s == '!' && s[1] == '=') {
+		hp->hb_cop = '#';
+		s += 2;
+	} else if (*s == '<' || *s == '>') {
+		if (s[1] == '=')
+			hp->hb_cop = (*s == '<') ? 'l' : 'g';
+		else
+			hp->hb_cop = *s;
+		s += (s[1] == '=') ? 2 : 1;
+	} else
+		goto error;
+	while (isspace((unsigned char) *s))
+		s++;
+	if (!is_addr(s))
+		goto error;
+	hp->hb_cval = get_addr(s, &s);
+	while (isspace((unsigned char) *s))
+		s++;
+	if (*s == '\0')
+		return true;
+error:
+	printf("invalid condition %s\n", hp->hb_ctext);
+	free(hp->hb_ctext);
+	hp->hb_ctext = NULL;
+	hp->hb_cop = 0;
+	return false;
+}
+
+/*
+ *	Evaluate the condition of hardware breakpoint hp
+ */
+static bool check_cond(const hardbreak_t *hp)
+{
+	register WORD v;
+
+	if (hp->hb_cmem)
+		v = getmem(hp->hb_reg ? reg_val(hp->hb_reg) : hp->hb_caddr);
+	else
+		v = reg_val(hp->hb_reg);
+	switch (hp->hb_cop) {
+	case '=':
+		return v == hp->hb_cval;
+	case '#':
+		return v != hp->hb_cval;
+	case '<':
+		return v < hp->hb_cval;
+	case '>':
+		return v > hp->hb_cval;
+	case 'l':
+		return v <= hp->hb_cval;
+	case 'g':
+		return v >= hp->hb_cval;
+	default:
+		return true;
+	}
+}
+
+/*
+ *	Merge the access modes of all hardware breakpoints
+ *	into the access bitmaps
+ */
+static void update_hardbp(void)
+{
+	register int i;
+	register hardbreak_t *hp;
+
+	memset(hb_map, 0, sizeof(hb_map));
+	memset(hb_pmap, 0, sizeof(hb_pmap));
+	for (i = 0, hp = hard; i < nhard; i++, hp++)
+		if (hp->hb_mode & (HB_IN | HB_OUT))
+			hb_pmap[hp->hb_addr] |= hp->hb_mode;
+		else
+			hb_map[hp->hb_addr] |= hp->hb_mode;
+	hb_flag = (nhard > 0);
+	hb_trig = 0;
+	hb_nhits = 0;
+}
+
+/*
+ *	This function is called from the CPU emulation after an
+ *	instruction triggered a hardware breakpoint. Pass count and
+ *	condition are checked here, so the emulation only stops when
+ *	the breakpoint is really hit.
+ *
+ *	Output:	false continue, hb_trig is reset
+ *		true stop the CPU emulation
+ */
+bool hb_check(void)
+{
+	register int i, j, n;
+	register hardbreak_t *hp;
+	bool hit;
+
+#ifdef WANT_REVERSE
+	if (rev_scan)
+		return rev_hit();
+#endif
+	/* every breakpoint of every access counts its pass, only the
+	   accesses which stop the CPU are kept for handle_break() */
+	for (j = n = 0; j < hb_nhits; j++) {
+		hit = false;
+		for (i = 0, hp = hard; i < nhard; i++, hp++) {
+			if (hp->hb_addr != hb_haddr[j]
+			    || !(hp->hb_mode & hb_hmode[j])
+			    || (hp->hb_cop && !check_cond(hp))
+			    || ++hp->hb_passcount < hp->hb_pass)
+				continue;
+			hp->hb_passcount = 0;
+			hit = true;
+		}
+		if (hit) {
+			hb_haddr[n] = hb_haddr[j];
+			hb_hmode[n++] = hb_hmode[j];
+		}
+	}
+	hb_nhits = n;
+	if (n == 0)
+		hb_trig = 0;
+	return n > 0;
+}
+
+#endif /* WANT_HB */
+
 /*
  *	History
  */
@@ -1155,18 +1641,18 @@ static void do_count(char *s)
 		       t_flag ? "on " : "off", t_states_e - t_states_s);
 		return;
 	}
-	if (!isxdigit((unsigned char) *s)) {
+	if (!is_addr(s)) {
 		puts("start missing");
 		return;
 	}
-	start = strtol(s, &s, 16);
+	start = get_addr(s, &s);
 	while (isspace((unsigned char) *s))
 		s++;
 	if (*s == ',') {
 		s++;
 		while (isspace((unsigned char) *s))
 			s++;
-		if (!isxdigit((unsigned char) *s)) {
+		if (!is_addr(s)) {
 			puts("stop missing");
 			return;
 		}
@@ -1175,7 +1661,7 @@ static void do_count(char *s)
 		return;
 	}
 	t_start = start;
-	t_end = strtol(s, NULL, 16);
+	t_end = get_addr(s, NULL);
 	t_states_s = t_states_e = T;
 	t_flag = false;
 #endif
@@ -1312,9 +1798,10 @@ static void do_help(void)
 	puts("b address[,pass]          set software breakpoint");
 	puts("b                         show software breakpoints");
 	puts("bc [address]              clear software breakpoint(s)");
-	puts("bh address[,accmode]      set hardware breakpoint");
-	puts("bh                        show hardware breakpoint");
-	puts("bhc                       clear hardware breakpoint");
+	puts("bh address[,accmode[,pass[,condition]]]");
+	puts("                          set hardware breakpoint");
+	puts("bh                        show hardware breakpoints");
+	puts("bhc [address[,accmode]]   clear hardware breakpoint(s)");
 	puts("h [address]               show history");
 	puts("hc                        clear history");
 	puts("z start,stop              set trigger addr for t-state count");
@@ -1329,13 +1816,102 @@ static void do_help(void)
 #ifndef BAREMETAL
 	puts("c                         measure clock frequency");
 	puts("r filename[,address]      read object into memory");
+	puts("a filename[,options]      assemble source into memory");
+	puts("                          and use its symbols as .name");
 	puts("! command                 execute external command");
+#endif
+#ifdef WANT_TRACE
+	puts("w filename[,from,to][,bank=n][,io]");
+	puts("                          write execution trace into file");
+	puts("w                         stop writing execution trace");
+#endif
+#ifdef WANT_REVERSE
+	puts("jr [interval][,kbytes]    record history for reverse execution");
+	puts("j                         show history");
+	puts("jb [count]                step back");
+	puts("jw address                run back to last write to address");
+	puts("jt [T-state]              go to T-state in history");
+	puts("jc                        stop recording history");
+#endif
+#ifdef WANT_LOGGER
+	puts("o [tag=level,...]         show/set log levels");
 #endif
 	if (ice_cust_help)
 		(*ice_cust_help)();
 	puts("q                         quit");
 }
 
+/*
+ *	Check if s starts with an address, a hexadecimal number or
+ *	the name of a known symbol preceded by a dot
+ */
+static bool is_addr(const char *s)
+{
+#ifndef BAREMETAL
+	char name[LENCMD];
+	int i;
+
+	if (*s == '.') {
+		for (i = 0, s++; *s != ',' && *s != '\0'
+				 && !isspace((unsigned char) *s); i++, s++)
+			name[i] = *s;
+		name[i] = '\0';
+		if (find_sym(name) != NULL)
+			return true;
+		printf("unknown symbol %s\n", name);
+		return false;
+	}
+#endif
+	return isxdigit((unsigned char) *s);
+}
+
+/*
+ *	Get the address at s, which was checked with is_addr(),
+ *	if end isn't NULL, it is set behind the address
+ */
+static WORD get_addr(char *s, char **end)
+{
+#ifndef BAREMETAL
+	char name[LENCMD];
+	int i;
+
+	if (*s == '.') {
+		for (i = 0, s++; *s != ',' && *s != '\0'
+				 && !isspace((unsigned char) *s); i++, s++)
+			name[i] = *s;
+		name[i] = '\0';
+		if (end != NULL)
+			*end = s;
+		return find_sym(name)->sym_addr;
+	}
+#endif
+	return strtol(s, end, 16);
+}
+
+/*
+ *	Print the names of the symbols with value a as labels
+ */
+static void print_label(WORD a)
+{
+#ifndef BAREMETAL
+	register int lo, hi, mid;
+
+	lo = 0;
+	hi = nsyms;
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (syms[mid].sym_addr < a)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (; lo < nsyms && syms[lo].sym_addr == a; lo++)
+		printf("%s:\n", syms[lo].sym_name);
+#else
+	UNUSED(a);
+#endif
+}
+
 #ifndef BAREMETAL
 
 /*
@@ -1449,6 +2025,318 @@ static void do_load(char *s)
 		wrk_addr = PC;
 }
 
+/*
+ *	Assemble a source file with z80asm (or the assembler in the
+ *	environment variable Z80ASM) into memory of the emulated CPU,
+ *	the symbols of the program are imported for use as addresses
+ *
+ *	The assembler is started directly without a shell, the file name
+ *	and each of the options separated by white space are passed as
+ *	one argument, so no shell meta characters are interpreted.
+ */
+static void do_asm(char *s)
+{
+	static char fn[MAX_LFN];
+	static char opts[LENCMD];
+	static char optfh[] = "-fh";
+#ifndef EXCLUDE_I8080
+	static char opt8[] = "-8";
+#endif
+	char tmp[] = "/tmp/z80iceXXXXXX";
+	char hexfn[sizeof(tmp) + 4], symfn[sizeof(tmp) + 4];
+	char hexopt[sizeof(hexfn) + 2], symopt[sizeof(symfn) + 2];
+	char *argv[LENCMD / 2 + 8];
+	char *pfn = fn, *p;
+	const char *as;
+	int fd, status, argc;
+	pid_t pid;
+
+	while (isspace((unsigned char) *s))
+		s++;
+	while (*s != ',' && *s != '\n' && *s != '\0')
+		*pfn++ = *s++;
+	*pfn = '\0';
+	opts[0] = '\0';
+	if (*s == ',')
+		strncpy(opts, s + 1, LENCMD - 1);
+	opts[LENCMD - 1] = '\0';
+	if (fn[0] == '\0') {
+		puts("no source file given");
+		return;
+	}
+	if ((fd = mkstemp(tmp)) == -1) {
+		perror("temporary file");
+		return;
+	}
+	close(fd);
+	sprintf(hexfn, "%s.hex", tmp);
+	sprintf(symfn, "%s.sym", tmp);
+	sprintf(hexopt, "-o%s", hexfn);
+	sprintf(symopt, "-y%s", symfn);
+	if ((as = getenv("Z80ASM")) == NULL || *as == '\0')
+		as = "z80asm";
+	argc = 0;
+	argv[argc++] = (char *) as;
+#ifndef EXCLUDE_I8080
+	if (cpu == I8080)
+		argv[argc++] = opt8;
+#endif
+	argv[argc++] = optfh;
+	argv[argc++] = hexopt;
+	argv[argc++] = symopt;
+	for (p = strtok(opts, " \t\n"); p != NULL; p = strtok(NULL, " \t\n"))
+		argv[argc++] = p;
+	argv[argc++] = fn;
+	argv[argc] = NULL;
+	fflush(stdout);
+	int_off();
+	status = -1;
+	if ((pid = fork()) == 0) {
+		execvp(as, argv);
+		perror(as);
+		_exit(127);
+	} else if (pid > 0) {
+		while (waitpid(pid, &status, 0) == -1 && errno == EINTR)
+			;
+	} else
+		perror("fork");
+	int_on();
+	if (status == 0) {
+		if (load_file(hexfn, 0, 0)) {
+			wrk_addr = PC;
+			if (load_syms(symfn))
+				printf("%d symbols imported\n", nsyms);
+		}
+	} else
+		puts("assembly failed, nothing loaded");
+	unlink(hexfn);
+	unlink(symfn);
+	unlink(tmp);
+}
+
+/*
+ *	Read the symbol file fn written by z80asm option -y,
+ *	it replaces the symbols of the previous assembly
+ */
+static bool load_syms(const char *fn)
+{
+	FILE *fp;
+	char line[LENCMD], name[LENCMD];
+	unsigned addr;
+	int n;
+
+	if ((fp = fopen(fn, "r")) == NULL) {
+		printf("can't open file %s\n", fn);
+		return false;
+	}
+	while (nsyms > 0)
+		free(syms[--nsyms].sym_name);
+	free(syms);
+	syms = NULL;
+	n = 0;
+	while (fgets(line, LENCMD, fp) != NULL) {
+		if (sscanf(line, "%x %s", &addr, name) != 2)
+			continue;
+		if (nsyms == n) {
+			n = n ? n * 2 : 256;
+			syms = (symbol_t *) realloc(syms, sizeof(symbol_t) * n);
+			if (syms == NULL) {
+				puts("can't allocate memory for symbols");
+				nsyms = 0;
+				fclose(fp);
+				return false;
+			}
+		}
+		syms[nsyms].sym_addr = addr;
+		syms[nsyms++].sym_name = strdup(name);
+	}
+	fclose(fp);
+	qsort(syms, nsyms, sizeof(symbol_t), symcmp);
+	return true;
+}
+
+/*
+ *	Search symbol name, upper and lower case are not distinguished
+ */
+static symbol_t *find_sym(const char *name)
+{
+	register int i;
+	register const char *p, *q;
+
+	for (i = 0; i < nsyms; i++) {
+		for (p = name, q = syms[i].sym_name;
+		     *p != '\0' && toupper((unsigned char) *p)
+				  == toupper((unsigned char) *q); p++, q++)
+			;
+		if (*p == '\0' && *q == '\0')
+			return &syms[i];
+	}
+	return NULL;
+}
+
+/*
+ *	Compare symbols by address for qsort()
+ */
+static int symcmp(const void *p1, const void *p2)
+{
+	WORD a1 = ((const symbol_t *) p1)->sym_addr;
+	WORD a2 = ((const symbol_t *) p2)->sym_addr;
+
+	return a1 < a2 ? -1 : a1 > a2 ? 1 : 0;
+}
+
+#ifdef WANT_TRACE
+/*
+ *	Start or stop recording an execution trace, the addresses
+ *	of the PC range may be symbols, the bank is decimal
+ */
+static void do_wtrace(char *s)
+{
+	char spec[MAX_LFN + 16];
+	register char *p = spec;
+	int n = 0;
+
+	while (isspace((unsigned char) *s))
+		s++;
+	if (*s == '\0' || *s == '\n') {
+		if (tr_flag) {
+			trace_close();
+			puts("Execution trace stopped");
+		} else
+			puts("No execution trace recorded");
+		return;
+	}
+	while (*s != ',' && *s != '\n' && *s != '\0'
+	       && p < spec + MAX_LFN - 1)
+		*p++ = *s++;
+	while (*s == ',' && n++ < 4) {
+		s++;
+		while (isspace((unsigned char) *s))
+			s++;
+		if (tolower((unsigned char) s[0]) == 'i'
+		    && tolower((unsigned char) s[1]) == 'o') {
+			strcpy(p, ",io");
+			p += 3;
+			s += 2;
+		} else if ((!strncmp(s, "bank=", 5) || !strncmp(s, "BANK=", 5))
+			   && isdigit((unsigned char) s[5])) {
+			p += sprintf(p, ",bank=%d", (int) strtol(s + 5, &s,
+								 10));
+		} else if (is_addr(s))
+			p += sprintf(p, ",%04x", get_addr(s, &s));
+		else
+			break;
+		while (isspace((unsigned char) *s))
+			s++;
+	}
+	*p = '\0';
+	if (*s != '\0' && *s != '\n') {
+		puts("invalid trace options");
+		return;
+	}
+	if (trace_open(spec))
+		printf("Writing execution trace into %s\n", spec);
+}
+#endif
+
+#ifdef WANT_REVERSE
+/*
+ *	Reverse execution with the recorded history
+ */
+static void do_rev(char *s)
+{
+	unsigned long long ival = 0;
+	unsigned long kb = 0;
+	int count;
+
+	switch (tolower((unsigned char) *s)) {
+	case 'r':
+		s++;
+		while (isspace((unsigned char) *s))
+			s++;
+		if (isdigit((unsigned char) *s))
+			ival = strtoull(s, &s, 10);
+		if (*s == ',')
+			kb = strtoul(s + 1, &s, 10);
+		if (rev_start((Tstates_t) ival, (unsigned) kb))
+			rev_show();
+		return;
+	case 'c':
+		rev_stop();
+		puts("History stopped");
+		return;
+	case 'b':
+		s++;
+		while (isspace((unsigned char) *s))
+			s++;
+		count = (*s == '\0' || *s == '\n') ? 1 : atoi(s);
+		if (count <= 0) {
+			puts("invalid count");
+			return;
+		}
+		(void) rev_back((unsigned) count);
+		break;
+	case 'w':
+		s++;
+		while (isspace((unsigned char) *s))
+			s++;
+		if (!is_addr(s)) {
+			puts("address missing");
+			return;
+		}
+		(void) rev_write(get_addr(s, NULL));
+		break;
+	case 't':
+		s++;
+		while (isspace((unsigned char) *s))
+			s++;
+		(void) rev_goto(isdigit((unsigned char) *s) ?
+				(Tstates_t) strtoull(s, NULL, 10) :
+				(Tstates_t) -1);
+		break;
+	case '\0':
+	case '\n':
+		rev_show();
+		return;
+	default:
+		puts("what??");
+		return;
+	}
+	if (!rev_flag)
+		return;
+	print_head();
+	print_reg();
+	(void) disass(PC);
+	wrk_addr = PC;
+}
+#endif
+
+#ifdef WANT_LOGGER
+/*
+ *	Show or set the log levels of the tags
+ */
+static void do_log(char *s)
+{
+	const char *tag;
+	int i, level;
+
+	while (isspace((unsigned char) *s))
+		s++;
+	if (*s != '\0' && *s != '\n') {
+		(void) log_config(s);
+		return;
+	}
+	if (log_get_rate())
+		printf("Max. %u messages per second of a call site\n",
+		       log_get_rate());
+	else
+		puts("No rate limit");
+	puts("Tag                     Level");
+	for (i = 0; log_get_tag(i, &tag, &level); i++)
+		printf("%-23s %s\n", tag, log_level_name(level));
+}
+#endif
+
 /*
  *	Call system function from simulator
  */
@@ -55,10 +55,33 @@ extern WORD	t_start, t_end;
 #define HB_READ		1	/* read memory */
 #define HB_WRITE	2	/* write memory */
 #define HB_EXEC		4	/* execute (op-code fetch) */
+#define HB_IN		8	/* input from port */
+#define HB_OUT		16	/* output to port */
+
+#define HB_MAXHITS	16	/* max. accesses recorded per instruction */
 
 extern bool	hb_flag;
-extern int	hb_mode, hb_trig;
-extern WORD	hb_addr;
+extern int	hb_trig;
+extern int	hb_nhits;
+extern WORD	hb_haddr[HB_MAXHITS];
+extern BYTE	hb_hmode[HB_MAXHITS];
+extern BYTE	hb_map[65536];
+extern BYTE	hb_pmap[256];
+
+extern bool	hb_check(void);
+
+/*
+ *	Record an access to addr with access mode mode, which
+ *	is watched by a hardware breakpoint
+ */
+static inline void hb_hit(WORD addr, int mode)
+{
+	hb_trig |= mode;
+	if (hb_nhits < HB_MAXHITS) {
+		hb_haddr[hb_nhits] = addr;
+		hb_hmode[hb_nhits++] = mode;
+	}
+}
 #endif
 
 extern void (*ice_before_go)(void);
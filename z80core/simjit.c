@@ -0,0 +1,1719 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	This module implements a dynamic binary translator, which
+ *	translates blocks of Z80 or 8080 instructions into x86-64 host
+ *	code.
+ *
+ *	A block starts at an address which was executed JIT_HOT times
+ *	and ends with a jump, call, return, I/O instruction, HALT or EI.
+ *	The common instructions are translated into host code, the
+ *	registers A, B, C, D, E, H, L and F are kept in callee saved host
+ *	registers while the block runs and only written back when needed.
+ *	Flags which are overwritten by a following instruction of the
+ *	block before they are used aren't computed at all, the others
+ *	are taken from the host flags with LAHF and SETO. All other
+ *	instructions call the function of the interpreter.
+ *
+ *	Memory is accessed through memrdr() and memwrt() of the machine,
+ *	I/O through the functions of the interpreter. memwrt() calls
+ *	jit_write(), which drops the blocks translated from the written
+ *	address, the running block is left after the instruction.
+ *
+ *	Exits of a block to a fixed address jump directly into the block
+ *	translated there, after the first time the exit was taken. The
+ *	chained block returns to the CPU core when an interrupt or a stop
+ *	is pending, translated code was written or JIT_MAXT T-states have
+ *	passed, so interrupts are accepted and the T-states are accounted
+ *	between blocks. The CPU cores only run blocks while nothing
+ *	watches the single instructions, the ICE, trace, coverage, replay
+ *	and the front panel use the interpreter.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simmem.h"
+#include "simjit.h"
+#ifdef WANT_ICE
+#include "simice.h"
+#endif
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_COVER
+#include "simcov.h"
+#endif
+#ifdef WANT_REPLAY
+#include "simreplay.h"
+#endif
+#ifdef WANT_REVERSE
+#include "simrev.h"
+#endif
+
+#ifdef WANT_JIT
+
+#include <cpuid.h>
+#include <sys/mman.h>
+
+#include "log.h"
+static const char *TAG = "jit";
+
+#ifndef JIT_BANK
+#define JIT_BANK(addr)	0	/* memory bank of code at addr */
+#endif
+#ifndef JIT_MAP
+#define JIT_MAP		0	/* memory mapping, changed only by I/O */
+#endif
+
+#define JIT_CODESIZE	(8 * 1024 * 1024) /* size of the code buffer */
+#define JIT_BLKCODE	(32 * 1024)	/* max. size of the code of a block */
+#define JIT_MAXBLK	32768		/* max. number of translated blocks */
+
+#ifndef EXCLUDE_Z80
+#define IS_Z80	(jit_type == Z80)
+#else
+#define IS_Z80	false
+#endif
+
+bool jit_flag = true;			/* translator is enabled */
+bool jit_stop;				/* translated code was written */
+uint16_t jit_map[65536];		/* number of blocks using the address */
+
+typedef struct jblock {
+	struct jblock *next;	/* next block at the same address */
+	WORD	start;		/* address of the first instruction */
+	WORD	len;		/* number of bytes translated */
+	int	bank;		/* memory bank of the code */
+	int	(*code)(void);	/* host code, returns executed instructions */
+	BYTE	*chain;		/* entry of the exits of other blocks */
+	BYTE	*dead;		/* leaves the block, after it was dropped */
+} jblock_t;
+
+typedef struct jinst {
+	WORD	pc;		/* address of the instruction */
+	BYTE	len;		/* length in bytes */
+	BYTE	op;		/* op-code */
+	BYTE	fr, fw;		/* flags read and written */
+	bool	native;		/* translated into host code */
+	bool	end;		/* ends the block */
+	bool	exit;		/* block may be left after it */
+	bool	live;		/* flags written are used */
+} jinst_t;
+
+typedef struct stub {		/* code which leaves the block */
+	BYTE	*at[3];		/* jumps to the stub */
+	int	nat;
+	int	nst;		/* dirty registers to write back */
+	BYTE	st_g[8], st_h[8];
+	int	t, r;		/* T-states and R increments not added */
+	int	pc;		/* new PC, -1 if already set */
+	int	n;		/* number of executed instructions */
+} stub_t;
+
+static BYTE *jit_buf;			/* code buffer */
+static BYTE *cp;			/* next free byte of the code buffer */
+static jblock_t jit_blk[JIT_MAXBLK];	/* translated blocks */
+static jblock_t *jit_free;		/* unused blocks */
+static int jit_nblk;			/* number of blocks used */
+static jblock_t *jit_at[65536];		/* blocks starting at an address */
+static BYTE jit_hot[65536];		/* executions of untranslated code */
+static int jit_type;			/* CPU type of the translated code */
+static jit_op_t **jit_ops;		/* instruction functions of the CPU */
+
+static jinst_t jin[JIT_MAXINST];	/* instructions of the block */
+static stub_t stubs[JIT_MAXINST * 2];	/* exits of the block */
+static int nstub;
+static int tpend;			/* T-states not yet added to T */
+static int rpend;			/* R increments not yet added to R */
+
+static Tstates_t jit_tlim;		/* T-states to leave chained blocks */
+static int jit_mapcur;			/* memory mapping of the running code */
+#ifdef WANT_METRICS
+static int jit_ninst;			/* instructions of chained blocks */
+#endif
+static BYTE *jit_link;			/* exit to link with the next block */
+static BYTE *jit_pend;			/* exit to link when PC is translated */
+static WORD jit_pendpc;
+
+/*
+ *	Memory access for the translated code, which can't inline
+ *	the functions of the machine
+ */
+static BYTE j_rd(WORD addr)
+{
+	return memrdr(addr);
+}
+
+static void j_wr(WORD addr, BYTE data)
+{
+	memwrt(addr, data);
+}
+
+static WORD j_rd16(WORD addr)
+{
+	register WORD i;
+
+	i = memrdr(addr++);
+	i += memrdr(addr) << 8;
+	return i;
+}
+
+static void j_wr16(WORD addr, WORD data)
+{
+	memwrt(addr++, data);
+	memwrt(addr, data >> 8);
+}
+
+static void j_push(WORD data)
+{
+	memwrt(--SP, data >> 8);
+	memwrt(--SP, data);
+}
+
+static WORD j_pop(void)
+{
+	register WORD i;
+
+	i = memrdr(SP++);
+	i += memrdr(SP++) << 8;
+	return i;
+}
+
+/* called through pointers, which are in reach of the base register */
+static BYTE (*const fn_rd)(WORD) = j_rd;
+static void (*const fn_wr)(WORD, BYTE) = j_wr;
+static WORD (*const fn_rd16)(WORD) = j_rd16;
+static void (*const fn_wr16)(WORD, WORD) = j_wr16;
+static void (*const fn_push)(WORD) = j_push;
+static WORD (*const fn_pop)(void) = j_pop;
+
+/*
+ *	x86-64 code generation
+ *
+ *	R15 holds the address of A, all variables of the simulator
+ *	are addressed relative to it.
+ */
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+       R8, R9, R10, R11, R12, R13, R14, R15 };
+
+#define JAE	0x3		/* condition codes of Jcc */
+#define JE	0x4
+#define JNE	0x5
+
+#define LINK_MAP 17		/* a chained exit has the PC and the memory
+				   mapping it was linked for, and then */
+#define LINK_JMP 28		/* the rel32 of the jump */
+
+static intptr_t base;			/* address in R15 */
+
+static int32_t disp(const void *p)
+{
+	return (int32_t) ((intptr_t) p - base);
+}
+
+static bool reach(const void *p)
+{
+	intptr_t d = (intptr_t) p - base;
+
+	return d >= INT32_MIN && d <= INT32_MAX;
+}
+
+static void e8(unsigned v)
+{
+	*cp++ = v;
+}
+
+static void e16(unsigned v)
+{
+	e8(v);
+	e8(v >> 8);
+}
+
+static void e32(uint32_t v)
+{
+	e16(v);
+	e16(v >> 16);
+}
+
+static void e64(uint64_t v)
+{
+	e32(v);
+	e32(v >> 32);
+}
+
+/* prefixes and op-code, w is the operand size */
+static void opc(int w, int rex, bool byte_regs, unsigned op)
+{
+	if (w == 16)
+		e8(0x66);
+	if (w == 64)
+		rex |= 8;
+	if (rex || byte_regs)
+		e8(0x40 | rex);
+	if (op > 0xff)
+		e8(op >> 8);
+	e8(op);
+}
+
+/* op-code with register operands, reg may be an op-code extension */
+static void x_rr(int w, unsigned op, int reg, int rm)
+{
+	opc(w, ((reg & 8) >> 1) | ((rm & 8) >> 3),
+	    w == 8 && (reg >= 4 || rm >= 4), op);
+	e8(0xc0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/* op-code with a register and a variable of the simulator */
+static void x_rm(int w, unsigned op, int reg, const void *p)
+{
+	opc(w, 1 | ((reg & 8) >> 1), false, op);
+	e8(0x80 | ((reg & 7) << 3) | 7);
+	e32(disp(p));
+}
+
+static void movzx8(int d, int s)	/* movzx r32, r8 */
+{
+	opc(32, ((d & 8) >> 1) | ((s & 8) >> 3), s >= 4, 0x0fb6);
+	e8(0xc0 | ((d & 7) << 3) | (s & 7));
+}
+
+static void mov_rr(int d, int s)	/* mov r32, r32 */
+{
+	if (d != s)
+		x_rr(32, 0x89, s, d);
+}
+
+static void mov_ri(int r, uint32_t v)	/* mov r32, imm32 */
+{
+	if (r & 8)
+		e8(0x41);
+	e8(0xb8 + (r & 7));
+	e32(v);
+}
+
+/* op r, imm of group 1: 0 add, 1 or, 2 adc, 3 sbb, 4 and, 5 sub, 6 xor,
+   7 cmp */
+static void alu_ri(int w, int n, int r, int v)
+{
+	if (w == 8) {
+		x_rr(8, 0x80, n, r);
+		e8(v);
+	} else if (v >= -128 && v <= 127) {
+		x_rr(w, 0x83, n, r);
+		e8(v);
+	} else {
+		x_rr(w, 0x81, n, r);
+		e32(v);
+	}
+}
+
+static void alu_mi(int w, int n, const void *p, int v)
+{
+	if (w == 8) {
+		x_rm(8, 0x80, n, p);
+		e8(v);
+	} else if (v >= -128 && v <= 127) {
+		x_rm(w, 0x83, n, p);
+		e8(v);
+	} else {
+		x_rm(w, 0x81, n, p);
+		if (w == 16)
+			e16(v);
+		else
+			e32(v);
+	}
+}
+
+static void shift_ri(int n, int r, int v) /* 4 shl, 5 shr r32, imm */
+{
+	x_rr(32, 0xc1, n, r);
+	e8(v);
+}
+
+static void call(const void *p)		/* call [p] */
+{
+	x_rm(32, 0xff, 2, p);
+}
+
+static BYTE *jcc(int cc)		/* jcc rel32, returns the rel32 */
+{
+	e8(0x0f);
+	e8(0x80 + cc);
+	cp += 4;
+	return cp - 4;
+}
+
+static void patch(BYTE *at, BYTE *to)
+{
+	int32_t rel = (int32_t) (to - (at + 4));
+
+	memcpy(at, &rel, 4);
+}
+
+static BYTE *jmp(void)			/* jmp rel32, returns the rel32 */
+{
+	e8(0xe9);
+	cp += 4;
+	return cp - 4;
+}
+
+static void set_pc(WORD pc)		/* mov word [PC], imm16 */
+{
+	x_rm(16, 0xc7, 0, &PC);
+	e16(pc);
+}
+
+static void prologue(void)
+{
+	e8(0x53);			/* push rbx */
+	e8(0x55);			/* push rbp */
+	e16(0x5441);			/* push r12 */
+	e16(0x5541);			/* push r13 */
+	e16(0x5641);			/* push r14 */
+	e16(0x5741);			/* push r15 */
+	e32(0x08ec8348);		/* sub rsp, 8 */
+	e16(0xbf49);			/* mov r15, base */
+	e64(base);
+}
+
+static void epilogue(int n)
+{
+	mov_ri(RAX, n);
+	e32(0x08c48348);		/* add rsp, 8 */
+	e16(0x5f41);			/* pop r15 */
+	e16(0x5e41);			/* pop r14 */
+	e16(0x5d41);			/* pop r13 */
+	e16(0x5c41);			/* pop r12 */
+	e8(0x5d);			/* pop rbp */
+	e8(0x5b);			/* pop rbx */
+	e8(0xc3);			/* ret */
+}
+
+/*
+ *	Guest registers in host registers
+ */
+enum { GA, GB, GC, GD, GE, GH, GL, GF, NGREG };
+
+static void *const g_var[NGREG] = { &A, &B, &C, &D, &E, &H, &L, &F };
+static const int r_guest[8] = { GB, GC, GD, GE, GH, GL, -1, GA };
+static const int rp_hi[4] = { GB, GD, GH, GA };
+static const int rp_lo[4] = { GC, GE, GL, GF };
+static const int pool[] = { RBX, RBP, R12, R13, R14 };
+#define NPOOL	((int) (sizeof(pool) / sizeof(pool[0])))
+
+static int g_host[NGREG];		/* host register, -1 if none */
+static bool g_dirty[NGREG];		/* host register was changed */
+static int h_guest[16];			/* guest register, -1 if none */
+static unsigned h_age[16];		/* last use of the host register */
+static unsigned age;
+static unsigned pinned;			/* used by current instruction */
+
+static void store(int g, int h)
+{
+	if (g == GF)
+		x_rm(32, 0x89, h, &F);
+	else
+		x_rm(8, 0x88, h, g_var[g]);
+}
+
+/* host register of guest register g, loaded with its value if load */
+static int reg(int g, bool load)
+{
+	register int h = g_host[g], i, o;
+
+	if (h < 0) {
+		for (i = 0; i < NPOOL; i++) {
+			if (h_guest[pool[i]] < 0) {
+				h = pool[i];
+				break;
+			}
+			if (!(pinned & (1 << pool[i]))
+			    && (h < 0 || h_age[pool[i]] < h_age[h]))
+				h = pool[i];
+		}
+		if ((o = h_guest[h]) >= 0) {
+			if (g_dirty[o])
+				store(o, h);
+			g_host[o] = -1;
+			g_dirty[o] = false;
+		}
+		g_host[g] = h;
+		h_guest[h] = g;
+		g_dirty[g] = false;
+		if (load) {
+			if (g == GF)
+				x_rm(32, 0x8b, h, &F);
+			else
+				x_rm(32, 0x0fb6, h, g_var[g]);
+		}
+	}
+	h_age[h] = ++age;
+	pinned |= 1 << h;
+	return h;
+}
+
+/* write back all changed registers */
+static void spill(void)
+{
+	register int g;
+
+	for (g = 0; g < NGREG; g++)
+		if (g_dirty[g]) {
+			store(g, g_host[g]);
+			g_dirty[g] = false;
+		}
+}
+
+/* the simulator variables were changed, drop the host registers */
+static void forget(void)
+{
+	register int i;
+
+	for (i = 0; i < NGREG; i++) {
+		g_host[i] = -1;
+		g_dirty[i] = false;
+	}
+	for (i = 0; i < 16; i++)
+		h_guest[i] = -1;
+}
+
+/* register pair into host register r */
+static void pair_get(int rp, int r)
+{
+	register int h, l;
+
+	if (rp == 3) {
+		x_rm(32, 0x0fb7, r, &SP);	/* movzx r, word [SP] */
+		return;
+	}
+	h = reg(rp_hi[rp], true);
+	l = reg(rp_lo[rp], true);
+	mov_rr(r, h);
+	shift_ri(4, r, 8);
+	x_rr(32, 0x09, l, r);			/* or r, l */
+}
+
+/* host register r into register pair */
+static void pair_set(int rp, int r)
+{
+	register int h, l;
+
+	if (rp == 3) {
+		x_rm(16, 0x89, r, &SP);		/* mov word [SP], r */
+		return;
+	}
+	h = reg(rp_hi[rp], false);
+	l = reg(rp_lo[rp], false);
+	movzx8(l, r);
+	mov_rr(h, r);
+	shift_ri(5, h, 8);
+	g_dirty[rp_hi[rp]] = g_dirty[rp_lo[rp]] = true;
+}
+
+/* add the pending T-states and R increments */
+static void flush_tr(int t, int r)
+{
+	if (t)
+		alu_mi(64, 0, &T, t);
+#ifndef EXCLUDE_Z80
+	if (IS_Z80 && (r & 0xff))
+		alu_mi(8, 0, &R, r & 0xff);
+#else
+	UNUSED(r);
+#endif
+}
+
+/* stub leaving the block, with the state at the current instruction */
+static stub_t *new_stub(int pc, int n)
+{
+	register stub_t *s = &stubs[nstub++];
+	register int g;
+
+	s->nat = 0;
+	s->nst = 0;
+	for (g = 0; g < NGREG; g++)
+		if (g_dirty[g]) {
+			s->st_g[s->nst] = g;
+			s->st_h[s->nst++] = g_host[g];
+		}
+	s->t = tpend;
+	s->r = rpend;
+	s->pc = pc;
+	s->n = n;
+	return s;
+}
+
+static void emit_stubs(void)
+{
+	register stub_t *s;
+	register int i;
+
+	for (s = stubs; s < &stubs[nstub]; s++) {
+		for (i = 0; i < s->nat; i++)
+			patch(s->at[i], cp);
+		for (i = 0; i < s->nst; i++)
+			store(s->st_g[i], s->st_h[i]);
+		flush_tr(s->t, s->r);
+		if (s->pc >= 0)
+			set_pc(s->pc);
+		epilogue(s->n);
+	}
+}
+
+/*
+ *	Leave the block after n instructions, pc < 0 if PC was set.
+ *	The exit jumps to the block which was linked to it by jit_run(),
+ *	if it was linked for the PC and the memory mapping, else it
+ *	returns -1 with jit_link set to the exit.
+ */
+static void emit_exit(int pc, int t, int n)
+{
+	BYTE *lea, *p1, *p2;
+
+	spill();
+	flush_tr(tpend + t, rpend);
+	if (pc >= 0)
+		set_pc(pc);
+#ifdef WANT_METRICS
+	alu_mi(32, 0, &jit_ninst, n);
+#else
+	UNUSED(n);
+#endif
+	e16(0x8d48);			/* lea rax, [rip + link] */
+	e8(0x05);
+	cp += 4;
+	lea = cp - 4;
+	x_rm(64, 0x89, RAX, &jit_link);
+	x_rm(32, 0x0fb7, RAX, &PC);	/* movzx eax, word [PC] */
+	e8(0x3d);			/* cmp eax, imm32 */
+	e32(0x7fffffff);		/* not linked yet */
+	patch(lea, cp - 4);
+	p1 = jcc(JNE);
+	alu_mi(32, 7, &jit_mapcur, 0x7fffffff);
+	p2 = jcc(JNE);
+	patch(jmp(), cp);
+	patch(p1, cp);
+	patch(p2, cp);
+	epilogue(-1);
+}
+
+/* entry of chained exits, returns to the CPU core when needed */
+static void emit_chain(BYTE **stop)
+{
+	register int i = 0;
+
+	alu_mi(8, 7, &jit_stop, 0);
+	stop[i++] = jcc(JNE);
+	alu_mi(8, 7, &cpu_state, ST_CONTIN_RUN);
+	stop[i++] = jcc(JNE);
+	alu_mi(8, 7, &int_int, 0);
+	stop[i++] = jcc(JNE);
+	alu_mi(8, 7, &int_nmi, 0);
+	stop[i++] = jcc(JNE);
+	x_rm(64, 0x8b, RAX, &T);	/* mov rax, [T] */
+	x_rm(64, 0x3b, RAX, &jit_tlim);	/* cmp rax, [jit_tlim] */
+	stop[i] = jcc(JAE);
+}
+
+/* leave the block when translated code was written */
+static void emit_check(int k)
+{
+	register stub_t *s;
+
+	alu_mi(8, 7, &jit_stop, 0);
+	s = new_stub(jin[k].pc + jin[k].len, k + 1);
+	s->at[s->nat++] = jcc(JNE);
+}
+
+/*
+ *	Flags from the host flags, ah_mask selects the bits of the host
+ *	flags, ov adds the overflow flag as P/V, set are bits to set and
+ *	keep the bits of F which aren't changed
+ */
+static void flags_z80(int ah_mask, bool ov, int set, int keep)
+{
+	register int f;
+
+	e8(0x9f);				/* lahf */
+	if (ov)
+		x_rr(8, 0x0f90, 0, RCX);	/* seto cl */
+	e8(0x0f);				/* movzx eax, ah */
+	e8(0xb6);
+	e8(0xc4);
+	alu_ri(32, 4, RAX, ah_mask);
+	if (ov) {
+		movzx8(RCX, RCX);
+		shift_ri(4, RCX, 2);
+		x_rr(32, 0x09, RCX, RAX);	/* or eax, ecx */
+	}
+	if (set)
+		alu_ri(32, 1, RAX, set);
+	f = reg(GF, true);
+	alu_ri(32, 4, f, keep);
+	x_rr(32, 0x09, RAX, f);			/* or f, eax */
+	g_dirty[GF] = true;
+}
+
+/* 8080 flags, inv_h inverts the host AF, the H of ANA is in EDX */
+static void flags_8080(int ah_mask, bool inv_h, bool h_edx, int keep)
+{
+	register int f;
+
+	e8(0x9f);				/* lahf */
+	e8(0x0f);				/* movzx eax, ah */
+	e8(0xb6);
+	e8(0xc4);
+	if (inv_h)
+		alu_ri(32, 6, RAX, H_FLAG);
+	alu_ri(32, 4, RAX, ah_mask);
+	if (h_edx)
+		x_rr(32, 0x09, RDX, RAX);	/* or eax, edx */
+	f = reg(GF, true);
+	alu_ri(32, 4, f, keep);
+	x_rr(32, 0x09, RAX, f);			/* or f, eax */
+	g_dirty[GF] = true;
+}
+
+/* jump taken if condition cc (NZ, Z, NC, C, PO, PE, P, M) is true */
+static BYTE *emit_cond(int cc)
+{
+	static const BYTE mask[4] = { Z_FLAG, C_FLAG, P_FLAG, S_FLAG };
+	register int f;
+
+	f = reg(GF, true);
+	spill();
+	x_rr(8, 0xf6, 0, f);			/* test f8, mask */
+	e8(mask[cc >> 1]);
+	return jcc((cc & 1) ? JNE : JE);
+}
+
+/* group 1 op-codes of the ADD, ADC, SUB, SBC, AND, XOR, OR, CP */
+static const int alu_x86[8] = { 0, 2, 5, 3, 4, 6, 1, 7 };
+
+/* ALU op with register src, -1 for (HL) or -2 for immediate n */
+static void emit_alu(int k, int aop, int src, BYTE n)
+{
+	register int a, s = -1, f;
+	bool live = jin[k].live;
+
+	if (src == -1) {
+		pair_get(2, RDI);
+		call(&fn_rd);
+		s = RAX;
+	} else if (src >= 0)
+		s = reg(src, true);
+	a = reg(GA, true);
+	if (aop == 1 || aop == 3) {
+		f = reg(GF, true);
+		x_rr(32, 0x0fba, 4, f);		/* bt f, 0 */
+		e8(0);
+	}
+#if !defined(EXCLUDE_I8080) && !defined(AMD8080)
+	if (!IS_Z80 && aop == 4 && live) {
+		/* H of ANA is the OR of bit 3 of both operands */
+		mov_rr(RDX, a);
+		if (s >= 0)
+			x_rr(32, 0x09, s, RDX);
+		else
+			alu_ri(32, 1, RDX, n);
+		alu_ri(32, 4, RDX, 8);
+		shift_ri(4, RDX, 1);
+	}
+#endif
+	if (s >= 0)
+		x_rr(8, alu_x86[aop] << 3, s, a);
+	else
+		alu_ri(8, alu_x86[aop], a, n);
+	if (aop != 7)
+		g_dirty[GA] = true;
+	if (!live)
+		return;
+	if (IS_Z80) {
+		switch (aop) {
+		case 0:				/* ADD, ADC */
+		case 1:
+			flags_z80(0xd1, true, 0, 0x28);
+			break;
+		case 2:				/* SUB, SBC, CP */
+		case 3:
+		case 7:
+			flags_z80(0xd1, true, N_FLAG, 0x28);
+			break;
+		case 4:				/* AND */
+			flags_z80(0xc4, false, H_FLAG, 0x28);
+			break;
+		default:			/* XOR, OR */
+			flags_z80(0xc4, false, 0, 0x28);
+			break;
+		}
+	} else {
+		switch (aop) {
+		case 0:				/* ADD, ADC */
+		case 1:
+			flags_8080(0xd5, false, false, 0x2a);
+			break;
+		case 2:				/* SUB, SBB, CMP */
+		case 3:
+		case 7:
+			flags_8080(0xd5, true, false, 0x2a);
+			break;
+		case 4:				/* ANA */
+#ifndef AMD8080
+			flags_8080(0xc4, false, true, 0x2a);
+#else
+			flags_8080(0xc4, false, false, 0x2a);
+#endif
+			break;
+		default:			/* XRA, ORA */
+			flags_8080(0xc4, false, false, 0x2a);
+			break;
+		}
+	}
+}
+
+/*
+ *	Decoding of the instructions
+ */
+
+/* length of 8080 and unprefixed Z80 instructions */
+static int op_len(BYTE op)
+{
+	switch (op & 0xc7) {
+	case 0x06:			/* LD r,n */
+	case 0xc6:			/* ALU n */
+		return 2;
+	case 0x01:			/* LD rr,nn or ADD HL,rr */
+		return (op & 0x08) ? 1 : 3;
+	case 0x02:			/* LD (nn),HL/A, LD HL/A,(nn) */
+		return (op & 0x20) ? 3 : 1;
+	case 0xc2:			/* JP cc,nn */
+	case 0xc4:			/* CALL cc,nn */
+		return 3;
+	default:
+		break;
+	}
+	switch (op) {
+	case 0xc3:			/* JP nn */
+	case 0xcd:			/* CALL nn */
+		return 3;
+	case 0xd3:			/* OUT (n),A */
+	case 0xdb:			/* IN A,(n) */
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+#ifndef EXCLUDE_Z80
+/* length and end of DD/FD prefixed instructions */
+static int xy_len(BYTE op, bool *end)
+{
+	*end = (op == 0xe9);		/* JP (IX) */
+	switch (op) {
+	case 0xcb:			/* DD CB d op */
+	case 0x36:			/* LD (IX+d),n */
+	case 0x21:			/* LD IX,nn */
+	case 0x22:			/* LD (nn),IX */
+	case 0x2a:			/* LD IX,(nn) */
+		return 4;
+	case 0x26:			/* LD IXH,n */
+	case 0x2e:			/* LD IXL,n */
+	case 0x34:			/* INC (IX+d) */
+	case 0x35:			/* DEC (IX+d) */
+		return 3;
+	default:
+		break;
+	}
+	if ((op >= 0x40 && op <= 0xbf && (op & 0x07) == 0x06 && op != 0x76)
+	    || (op >= 0x70 && op <= 0x77 && op != 0x76))
+		return 3;		/* (IX+d) operand */
+	return 2;
+}
+
+/* length and end of ED prefixed instructions */
+static int ed_len(BYTE op, bool *end)
+{
+	*end = (op >= 0x40 && op <= 0x7f
+		&& ((op & 0x07) <= 1		/* IN r,(C), OUT (C),r */
+		    || (op & 0x07) == 5))	/* RETN, RETI */
+	       || (op >= 0xa2 && (op & 0x06) == 0x02); /* block I/O */
+	if ((op & 0xc7) == 0x43)	/* LD (nn),rr, LD rr,(nn) */
+		return 4;
+	return 2;
+}
+#endif
+
+/* T-states of the instructions translated without jumps */
+static int t_native(BYTE op)
+{
+	bool z = IS_Z80;
+
+	if (op >= 0x40 && op <= 0x7f)
+		return ((op & 0x07) == 6 || (op & 0x38) == 0x30) ? 7
+							       : (z ? 4 : 5);
+	if (op >= 0x80 && op <= 0xbf)
+		return ((op & 0x07) == 6) ? 7 : 4;
+	switch (op & 0xc7) {
+	case 0x01:			/* LD rr,nn / ADD HL,rr */
+		return (op & 0x08) ? (z ? 11 : 10) : 10;
+	case 0x02:
+		switch (op) {
+		case 0x22:		/* LD (nn),HL */
+		case 0x2a:		/* LD HL,(nn) */
+			return 16;
+		case 0x32:		/* LD (nn),A */
+		case 0x3a:		/* LD A,(nn) */
+			return 13;
+		default:		/* LD (rr),A, LD A,(rr) */
+			return 7;
+		}
+	case 0x03:			/* INC rr, DEC rr */
+		return z ? 6 : 5;
+	case 0x04:			/* INC r, DEC r */
+	case 0x05:
+		return z ? 4 : 5;
+	case 0x06:			/* LD r,n */
+		return (op == 0x36) ? 10 : 7;
+	case 0xc6:			/* ALU n */
+		return 7;
+	case 0xc1:			/* POP rr */
+		return 10;
+	case 0xc5:			/* PUSH rr */
+		return 11;
+	default:
+		break;
+	}
+	switch (op) {
+	case 0xf9:			/* LD SP,HL */
+		return z ? 6 : 5;
+	default:			/* NOP, CPL, SCF, CCF, EX DE,HL, DI */
+		return 4;
+	}
+}
+
+/* decode instruction at pc, false if it wraps around */
+static bool decode(WORD pc, jinst_t *in)
+{
+	register BYTE op = getmem(pc);
+	register int len;
+	bool end = false, native = true;
+	BYTE fr = 0, fw = 0;
+
+	len = op_len(op);
+
+	if (op >= 0x40 && op <= 0x7f) {
+		if (op == 0x76) {		/* HALT */
+			native = false;
+			end = true;
+		}
+	} else if (op >= 0x80 && op <= 0xbf) {
+		fw = IS_Z80 ? 0xd7 : 0xd5;
+		if ((op & 0xe8) == 0x88)	/* ADC, SBC */
+			fr = C_FLAG;
+	} else if ((op & 0xc7) == 0x04 || (op & 0xc7) == 0x05) {
+		if (op == 0x34 || op == 0x35)	/* INC (HL), DEC (HL) */
+			native = false;
+		else
+			fw = IS_Z80 ? 0xd6 : 0xd4;
+	} else if ((op & 0xc7) == 0xc6) {	/* ALU n */
+		fw = IS_Z80 ? 0xd7 : 0xd5;
+		if (op == 0xce || op == 0xde)	/* ADC, SBC */
+			fr = C_FLAG;
+	} else if ((op & 0xcf) == 0x09) {	/* ADD HL,rr */
+		fw = IS_Z80 ? 0x13 : C_FLAG;
+	} else if ((op & 0xc7) == 0xc0 || (op & 0xc7) == 0xc2
+		   || (op & 0xc7) == 0xc4 || (op & 0xc7) == 0xc7) {
+		end = true;			/* RET/JP/CALL cc, RST */
+	} else {
+		switch (op) {
+		case 0x00:			/* NOP */
+		case 0x01:			/* LD rr,nn */
+		case 0x11:
+		case 0x21:
+		case 0x31:
+		case 0x02:			/* LD (rr),A */
+		case 0x12:
+		case 0x0a:			/* LD A,(rr) */
+		case 0x1a:
+		case 0x03:			/* INC rr */
+		case 0x13:
+		case 0x23:
+		case 0x33:
+		case 0x0b:			/* DEC rr */
+		case 0x1b:
+		case 0x2b:
+		case 0x3b:
+		case 0x06:			/* LD r,n */
+		case 0x0e:
+		case 0x16:
+		case 0x1e:
+		case 0x26:
+		case 0x2e:
+		case 0x36:
+		case 0x3e:
+		case 0x22:			/* LD (nn),HL */
+		case 0x2a:			/* LD HL,(nn) */
+		case 0x32:			/* LD (nn),A */
+		case 0x3a:			/* LD A,(nn) */
+		case 0xc1:			/* POP rr */
+		case 0xd1:
+		case 0xe1:
+		case 0xc5:			/* PUSH rr */
+		case 0xd5:
+		case 0xe5:
+		case 0xf5:
+		case 0xeb:			/* EX DE,HL */
+		case 0xf9:			/* LD SP,HL */
+		case 0xf3:			/* DI */
+			break;
+		case 0xf1:			/* POP AF */
+			fw = 0xff;
+			break;
+		case 0x2f:			/* CPL */
+			fw = IS_Z80 ? (H_FLAG | N_FLAG) : 0;
+			break;
+		case 0x07:			/* RLCA, RRCA */
+		case 0x0f:
+			fw = IS_Z80 ? (H_FLAG | N_FLAG | C_FLAG) : C_FLAG;
+			break;
+		case 0x17:			/* RLA, RRA */
+		case 0x1f:
+			fr = C_FLAG;
+			fw = IS_Z80 ? (H_FLAG | N_FLAG | C_FLAG) : C_FLAG;
+			break;
+		case 0x37:			/* SCF */
+			fw = IS_Z80 ? (H_FLAG | N_FLAG | C_FLAG) : C_FLAG;
+			break;
+		case 0x3f:			/* CCF */
+			fr = C_FLAG;
+			fw = IS_Z80 ? (H_FLAG | N_FLAG | C_FLAG) : C_FLAG;
+			break;
+		case 0xc3:			/* JP nn */
+		case 0xc9:			/* RET */
+		case 0xcd:			/* CALL nn */
+		case 0xe9:			/* JP (HL) */
+			end = true;
+			break;
+		case 0xd3:			/* OUT (n),A */
+		case 0xdb:			/* IN A,(n) */
+		case 0xfb:			/* EI */
+			native = false;
+			end = true;
+			break;
+		default:
+			native = false;
+			break;
+		}
+	}
+
+#ifndef EXCLUDE_Z80
+	if (IS_Z80) {
+		switch (op) {
+		case 0x10:			/* DJNZ */
+		case 0x18:			/* JR */
+		case 0x20:			/* JR cc */
+		case 0x28:
+		case 0x30:
+		case 0x38:
+			len = 2;
+			native = true;
+			end = true;
+			break;
+		case 0xcb:
+			len = 2;
+			break;
+		case 0xdd:
+		case 0xfd:
+			len = xy_len(getmem(pc + 1), &end);
+			break;
+		case 0xed:
+			len = ed_len(getmem(pc + 1), &end);
+			break;
+		default:
+			break;
+		}
+	} else
+#endif
+	{
+		switch (op) {
+		case 0xcb:			/* undocumented JMP */
+		case 0xdd:			/* undocumented CALL */
+		case 0xed:
+		case 0xfd:
+			len = 3;
+			end = true;
+			break;
+		case 0xd9:			/* undocumented RET */
+			end = true;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (pc + len > 0x10000)
+		return false;
+	in->pc = pc;
+	in->len = len;
+	in->op = op;
+	in->fr = native ? fr : 0xff;
+	in->fw = native ? fw : 0;
+	in->native = native;
+	in->end = end;
+	/* a write into the block or a handler may leave it */
+	in->exit = end || !native || op == 0x02 || op == 0x12 || op == 0x22
+		   || op == 0x32 || op == 0x36 || (op >= 0x70 && op <= 0x77)
+		   || (op & 0xcf) == 0xc5;
+	return true;
+}
+
+/*
+ *	Translation of an instruction
+ */
+static void emit_native(int k)
+{
+	register jinst_t *in = &jin[k];
+	WORD pc = in->pc, next = pc + in->len;
+	BYTE op = in->op, n = getmem(pc + 1);
+	WORD nn = n | (getmem(pc + 2) << 8);
+	register int r, s, rp = (op >> 4) & 3;
+	BYTE *p;
+
+	rpend++;
+	tpend += in->end ? 0 : t_native(op);
+
+	if (op >= 0x40 && op <= 0x7f) {		/* LD r,r' */
+		if ((op & 0x07) == 6) {
+			pair_get(2, RDI);
+			call(&fn_rd);
+			r = reg(r_guest[(op >> 3) & 7], false);
+			movzx8(r, RAX);
+			g_dirty[r_guest[(op >> 3) & 7]] = true;
+		} else if ((op & 0x38) == 0x30) {
+			pair_get(2, RDI);
+			mov_rr(RSI, reg(r_guest[op & 7], true));
+			call(&fn_wr);
+			emit_check(k);
+		} else if (((op >> 3) & 7) != (op & 7)) {
+			s = reg(r_guest[op & 7], true);
+			r = reg(r_guest[(op >> 3) & 7], false);
+			mov_rr(r, s);
+			g_dirty[r_guest[(op >> 3) & 7]] = true;
+		}
+		return;
+	}
+	if (op >= 0x80 && op <= 0xbf) {		/* ALU r */
+		emit_alu(k, (op >> 3) & 7, r_guest[op & 7], 0);
+		return;
+	}
+	if ((op & 0xc7) == 0xc6) {		/* ALU n */
+		emit_alu(k, (op >> 3) & 7, -2, n);
+		return;
+	}
+	if ((op & 0xc7) == 0x04 || (op & 0xc7) == 0x05) { /* INC r, DEC r */
+		r = reg(r_guest[(op >> 3) & 7], true);
+		x_rr(8, 0xfe, op & 1, r);
+		g_dirty[r_guest[(op >> 3) & 7]] = true;
+		if (!in->live)
+			return;
+		if (IS_Z80)
+			flags_z80(0xd0, true, (op & 1) ? N_FLAG : 0, 0x29);
+		else
+			flags_8080(0xd4, op & 1, false, 0x2b);
+		return;
+	}
+	if ((op & 0xc7) == 0x06) {		/* LD r,n */
+		if (op == 0x36) {
+			pair_get(2, RDI);
+			mov_ri(RSI, n);
+			call(&fn_wr);
+			emit_check(k);
+		} else {
+			r = reg(r_guest[(op >> 3) & 7], false);
+			mov_ri(r, n);
+			g_dirty[r_guest[(op >> 3) & 7]] = true;
+		}
+		return;
+	}
+	if ((op & 0xc7) == 0xc0) {		/* RET cc */
+		p = emit_cond((op >> 3) & 7);
+		emit_exit(next, 5, k + 1);
+		patch(p, cp);
+		call(&fn_pop);
+		x_rm(16, 0x89, RAX, &PC);
+		emit_exit(-1, 11, k + 1);
+		return;
+	}
+	if ((op & 0xc7) == 0xc2) {		/* JP cc,nn */
+		p = emit_cond((op >> 3) & 7);
+		emit_exit(next, 10, k + 1);
+		patch(p, cp);
+		emit_exit(nn, 10, k + 1);
+		return;
+	}
+	if ((op & 0xc7) == 0xc4) {		/* CALL cc,nn */
+		p = emit_cond((op >> 3) & 7);
+		emit_exit(next, IS_Z80 ? 10 : 11, k + 1);
+		patch(p, cp);
+		mov_ri(RDI, next);
+		call(&fn_push);
+		emit_exit(nn, 17, k + 1);
+		return;
+	}
+	if ((op & 0xc7) == 0xc7) {		/* RST n */
+		spill();
+		mov_ri(RDI, next);
+		call(&fn_push);
+		emit_exit(op & 0x38, 11, k + 1);
+		return;
+	}
+	if ((op & 0xcf) == 0x09) {		/* ADD HL,rr */
+		if (rp == 3) {
+			pair_get(3, RCX);
+			mov_rr(RDX, RCX);
+			shift_ri(5, RDX, 8);
+			s = RCX;
+			r = RDX;
+		} else {
+			s = reg(rp_lo[rp], true);
+			r = reg(rp_hi[rp], true);
+		}
+		x_rr(8, 0x00, s, reg(GL, true));	/* add l, lo */
+		x_rr(8, 0x10, r, reg(GH, true));	/* adc h, hi */
+		g_dirty[GL] = g_dirty[GH] = true;
+		if (!in->live)
+			return;
+		if (IS_Z80)
+			flags_z80(0x11, false, 0, 0xec);
+		else
+			flags_8080(C_FLAG, false, false, 0xfe);
+		return;
+	}
+	if ((op & 0xcf) == 0xc1) {		/* POP rr */
+		call(&fn_pop);
+		if (rp == 3) {
+			r = reg(GF, false);
+			movzx8(r, RAX);
+			if (!IS_Z80) {
+				alu_ri(32, 4, r, ~(Y_FLAG | X_FLAG));
+				alu_ri(32, 1, r, N_FLAG);
+			}
+			r = reg(GA, false);
+			mov_rr(r, RAX);
+			shift_ri(5, r, 8);
+			g_dirty[GA] = g_dirty[GF] = true;
+		} else
+			pair_set(rp, RAX);
+		return;
+	}
+	if ((op & 0xcf) == 0xc5) {		/* PUSH rr */
+		if (rp == 3) {
+			mov_rr(RDI, reg(GA, true));
+			shift_ri(4, RDI, 8);
+			x_rr(32, 0x09, reg(GF, true), RDI);
+		} else
+			pair_get(rp, RDI);
+		call(&fn_push);
+		emit_check(k);
+		return;
+	}
+	switch (op) {
+	case 0x00:				/* NOP */
+		break;
+	case 0x01:				/* LD rr,nn */
+	case 0x11:
+	case 0x21:
+		r = reg(rp_lo[rp], false);
+		mov_ri(r, n);
+		r = reg(rp_hi[rp], false);
+		mov_ri(r, nn >> 8);
+		g_dirty[rp_lo[rp]] = g_dirty[rp_hi[rp]] = true;
+		break;
+	case 0x31:				/* LD SP,nn */
+		x_rm(16, 0xc7, 0, &SP);
+		e16(nn);
+		break;
+	case 0x02:				/* LD (rr),A */
+	case 0x12:
+		pair_get(rp, RDI);
+		mov_rr(RSI, reg(GA, true));
+		call(&fn_wr);
+		emit_check(k);
+		break;
+	case 0x0a:				/* LD A,(rr) */
+	case 0x1a:
+		pair_get(rp, RDI);
+		call(&fn_rd);
+		r = reg(GA, false);
+		movzx8(r, RAX);
+		g_dirty[GA] = true;
+		break;
+	case 0x03:				/* INC rr */
+	case 0x13:
+	case 0x23:
+		r = reg(rp_lo[rp], true);
+		s = reg(rp_hi[rp], true);
+		alu_ri(8, 0, r, 1);
+		alu_ri(8, 2, s, 0);
+		g_dirty[rp_lo[rp]] = g_dirty[rp_hi[rp]] = true;
+		break;
+	case 0x0b:				/* DEC rr */
+	case 0x1b:
+	case 0x2b:
+		r = reg(rp_lo[rp], true);
+		s = reg(rp_hi[rp], true);
+		alu_ri(8, 5, r, 1);
+		alu_ri(8, 3, s, 0);
+		g_dirty[rp_lo[rp]] = g_dirty[rp_hi[rp]] = true;
+		break;
+	case 0x33:				/* INC SP */
+		alu_mi(16, 0, &SP, 1);
+		break;
+	case 0x3b:				/* DEC SP */
+		alu_mi(16, 5, &SP, 1);
+		break;
+	case 0x22:				/* LD (nn),HL */
+		pair_get(2, RSI);
+		mov_ri(RDI, nn);
+		call(&fn_wr16);
+		emit_check(k);
+		break;
+	case 0x2a:				/* LD HL,(nn) */
+		mov_ri(RDI, nn);
+		call(&fn_rd16);
+		pair_set(2, RAX);
+		break;
+	case 0x32:				/* LD (nn),A */
+		mov_ri(RDI, nn);
+		mov_rr(RSI, reg(GA, true));
+		call(&fn_wr);
+		emit_check(k);
+		break;
+	case 0x3a:				/* LD A,(nn) */
+		mov_ri(RDI, nn);
+		call(&fn_rd);
+		r = reg(GA, false);
+		movzx8(r, RAX);
+		g_dirty[GA] = true;
+		break;
+	case 0x07:				/* RLCA, RRCA, RLA, RRA */
+	case 0x0f:
+	case 0x17:
+	case 0x1f:
+		r = reg(GA, true);
+		if (op & 0x10) {
+			s = reg(GF, true);
+			x_rr(32, 0x0fba, 4, s);		/* bt f, 0 */
+			e8(0);
+		}
+		x_rr(8, 0xd0, (op >> 3) & 3, r);	/* rol/ror/rcl/rcr a, 1 */
+		g_dirty[GA] = true;
+		if (!in->live)
+			break;
+		x_rr(8, 0x0f92, 0, RCX);		/* setc cl */
+		movzx8(RCX, RCX);
+		s = reg(GF, true);
+		alu_ri(32, 4, s, IS_Z80 ? ~(H_FLAG | N_FLAG | C_FLAG) : ~C_FLAG);
+		x_rr(32, 0x09, RCX, s);			/* or f, ecx */
+		g_dirty[GF] = true;
+		break;
+	case 0x2f:				/* CPL */
+		r = reg(GA, true);
+		alu_ri(8, 6, r, 0xff);
+		g_dirty[GA] = true;
+		if (IS_Z80) {
+			r = reg(GF, true);
+			alu_ri(32, 1, r, H_FLAG | N_FLAG);
+			g_dirty[GF] = true;
+		}
+		break;
+	case 0x37:				/* SCF */
+		r = reg(GF, true);
+		if (IS_Z80)
+			alu_ri(32, 4, r, ~(H_FLAG | N_FLAG));
+		alu_ri(32, 1, r, C_FLAG);
+		g_dirty[GF] = true;
+		break;
+	case 0x3f:				/* CCF */
+		r = reg(GF, true);
+		if (IS_Z80) {
+			/* H gets the old carry */
+			mov_rr(RCX, r);
+			alu_ri(32, 4, RCX, C_FLAG);
+			shift_ri(4, RCX, 4);
+			alu_ri(32, 4, r, ~(H_FLAG | N_FLAG));
+			x_rr(32, 0x09, RCX, r);		/* or f, ecx */
+		}
+		alu_ri(32, 6, r, C_FLAG);
+		g_dirty[GF] = true;
+		break;
+	case 0xc3:				/* JP nn */
+		emit_exit(nn, 10, k + 1);
+		break;
+	case 0xc9:				/* RET */
+		call(&fn_pop);
+		x_rm(16, 0x89, RAX, &PC);
+		emit_exit(-1, 10, k + 1);
+		break;
+	case 0xcd:				/* CALL nn */
+		mov_ri(RDI, next);
+		call(&fn_push);
+		emit_exit(nn, 17, k + 1);
+		break;
+	case 0xe9:				/* JP (HL) */
+		pair_get(2, RAX);
+		x_rm(16, 0x89, RAX, &PC);
+		emit_exit(-1, IS_Z80 ? 4 : 5, k + 1);
+		break;
+	case 0xeb:				/* EX DE,HL */
+		reg(GD, true);
+		reg(GE, true);
+		reg(GH, true);
+		reg(GL, true);
+		r = g_host[GD];
+		g_host[GD] = g_host[GH];
+		g_host[GH] = r;
+		r = g_host[GE];
+		g_host[GE] = g_host[GL];
+		g_host[GL] = r;
+		h_guest[g_host[GD]] = GD;
+		h_guest[g_host[GE]] = GE;
+		h_guest[g_host[GH]] = GH;
+		h_guest[g_host[GL]] = GL;
+		g_dirty[GD] = g_dirty[GE] = g_dirty[GH] = g_dirty[GL] = true;
+		break;
+	case 0xf9:				/* LD SP,HL */
+		pair_get(2, RAX);
+		x_rm(16, 0x89, RAX, &SP);
+		break;
+	case 0xf3:				/* DI */
+		x_rm(8, 0xc6, 0, &IFF);
+		e8(0);
+		break;
+#ifndef EXCLUDE_Z80
+	case 0x10:				/* DJNZ */
+		r = reg(GB, true);
+		alu_ri(8, 5, r, 1);
+		g_dirty[GB] = true;
+		spill();
+		p = jcc(JNE);
+		emit_exit(next, 5, k + 1);
+		patch(p, cp);
+		emit_exit((WORD) (next + (SBYTE) n), 13, k + 1);
+		break;
+	case 0x18:				/* JR */
+		emit_exit((WORD) (next + (SBYTE) n), 12, k + 1);
+		break;
+	case 0x20:				/* JR cc */
+	case 0x28:
+	case 0x30:
+	case 0x38:
+		p = emit_cond((op >> 3) & 3);
+		emit_exit(next, 7, k + 1);
+		patch(p, cp);
+		emit_exit((WORD) (next + (SBYTE) n), 12, k + 1);
+		break;
+#endif
+	default:
+		break;
+	}
+}
+
+/* call the function of the interpreter */
+static void emit_call(int k)
+{
+	register jinst_t *in = &jin[k];
+	register stub_t *s;
+
+	spill();
+	set_pc(in->pc + 1);
+	flush_tr(tpend, rpend + 1);
+	tpend = rpend = 0;
+	call(&jit_ops[in->op]);
+	x_rr(32, 0x89, RAX, RAX);		/* mov eax, eax */
+	x_rm(64, 0x01, RAX, &T);		/* add [T], rax */
+	forget();
+	if (in->end) {
+		epilogue(k + 1);
+		return;
+	}
+	/* leave if the CPU stopped, jumped or wrote translated code */
+	s = new_stub(-1, k + 1);
+	alu_mi(8, 7, &cpu_state, ST_CONTIN_RUN);
+	s->at[s->nat++] = jcc(JNE);
+	alu_mi(16, 7, &PC, (WORD) (in->pc + in->len));
+	s->at[s->nat++] = jcc(JNE);
+	alu_mi(8, 7, &jit_stop, 0);
+	s->at[s->nat++] = jcc(JNE);
+}
+
+/*
+ *	Translate the block at PC
+ */
+static jblock_t *translate(void)
+{
+	register jblock_t *b;
+	register int n, k;
+	int live;
+	WORD pc = PC;
+	BYTE *code, *chain, *body, *stop[5];
+
+	if (jit_free == NULL || cp + JIT_BLKCODE > jit_buf + JIT_CODESIZE)
+		jit_flush();
+
+	for (n = 0; n < JIT_MAXINST; ) {
+		if (!decode(pc, &jin[n]) || pc + jin[n].len - PC > JIT_MAXLEN)
+			break;
+		pc += jin[n++].len;
+		if (jin[n - 1].end)
+			break;
+#ifdef WANT_TIM
+		if (pc == t_start)	/* runtime measurement starts there */
+			break;
+#endif
+	}
+	if (n == 0)
+		return NULL;
+
+	/* flags which are overwritten before they are used */
+	live = 0xff;
+	for (k = n - 1; k >= 0; k--) {
+		if (jin[k].exit)
+			live = 0xff;
+		jin[k].live = (jin[k].fw & live) != 0;
+		live = (live & ~jin[k].fw) | jin[k].fr;
+	}
+
+	code = cp;
+	nstub = 0;
+	tpend = rpend = 0;
+	age = 0;
+	forget();
+	prologue();
+	body = jmp();
+	chain = cp;
+	emit_chain(stop);
+	patch(body, cp);
+	for (k = 0; k < n; k++) {
+		pinned = 0;
+		if (jin[k].native)
+			emit_native(k);
+		else
+			emit_call(k);
+	}
+	if (!jin[n - 1].end)
+		emit_exit(pc, 0, n);
+	emit_stubs();
+	for (k = 0; k < 5; k++)
+		patch(stop[k], cp);
+	epilogue(0);
+
+	b = jit_free;
+	jit_free = b->next;
+	jit_nblk++;
+	b->start = PC;
+	b->len = pc - PC;
+	b->bank = JIT_BANK(PC);
+	b->code = (int (*)(void)) code;
+	b->chain = chain;
+	b->dead = cp;
+	epilogue(-1);
+	b->next = jit_at[PC];
+	jit_at[PC] = b;
+	for (k = 0; k < b->len; k++)
+		jit_map[(WORD) (PC + k)]++;
+	return b;
+}
+
+static bool jit_init(void)
+{
+	unsigned int a, b, c, d;
+
+	base = (intptr_t) &A;
+	if (!reach(&F) || !reach(&B) || !reach(&C) || !reach(&D)
+	    || !reach(&E) || !reach(&H) || !reach(&L) || !reach(&PC)
+	    || !reach(&SP) || !reach(&T) || !reach(&IFF) || !reach(&cpu_state)
+#ifndef EXCLUDE_Z80
+	    || !reach(&R)
+#endif
+	    || !reach(&int_int) || !reach(&int_nmi) || !reach(&jit_stop)
+	    || !reach(&jit_tlim) || !reach(&jit_mapcur) || !reach(&jit_link)
+#ifdef WANT_METRICS
+	    || !reach(&jit_ninst)
+#endif
+	    || !reach(&fn_rd) || !reach(&fn_pop)) {
+		LOGW(TAG, "simulator variables out of reach, translator off");
+		return false;
+	}
+	if (!__get_cpuid(0x80000001, &a, &b, &c, &d) || !(c & 1)) {
+		LOGW(TAG, "host CPU has no LAHF, translator off");
+		return false;
+	}
+	jit_buf = mmap(NULL, JIT_CODESIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+		       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (jit_buf == MAP_FAILED) {
+		jit_buf = NULL;
+		LOGW(TAG, "can't allocate executable memory, translator off");
+		return false;
+	}
+	return true;
+}
+
+/*
+ *	Drop all translated blocks, the memory could have been changed
+ *	without memwrt()
+ */
+void jit_flush(void)
+{
+	register int i;
+
+	if (!jit_flag)
+		return;
+	if (jit_buf == NULL && !jit_init()) {
+		jit_flag = false;
+		return;
+	}
+
+	if (jit_nblk) {
+		memset(jit_at, 0, sizeof(jit_at));
+		memset(jit_map, 0, sizeof(jit_map));
+	}
+	for (i = 0; i < JIT_MAXBLK - 1; i++)
+		jit_blk[i].next = &jit_blk[i + 1];
+	jit_blk[JIT_MAXBLK - 1].next = NULL;
+	jit_free = jit_blk;
+	jit_nblk = 0;
+	cp = jit_buf;
+	jit_pend = NULL;
+	jit_stop = true;
+}
+
+/*
+ *	Drop the blocks which were translated from addr
+ */
+void jit_invalidate(WORD addr)
+{
+	register jblock_t *b, **pb;
+	register int a, i, lo;
+
+	lo = addr - (JIT_MAXLEN - 1);
+	if (lo < 0)
+		lo = 0;
+	for (a = addr; a >= lo; a--) {
+		pb = &jit_at[a];
+		while ((b = *pb) != NULL) {
+			if (addr < b->start + b->len) {
+				*pb = b->next;
+				for (i = 0; i < b->len; i++)
+					jit_map[(WORD) (b->start + i)]--;
+				/* exits linked to the block return */
+				b->chain[0] = 0xe9;	/* jmp rel32 */
+				patch(b->chain + 1, b->dead);
+				b->next = jit_free;
+				jit_free = b;
+				jit_nblk--;
+				/* don't translate changing code at once */
+				jit_hot[a] = 0;
+			} else
+				pb = &b->next;
+		}
+	}
+	jit_stop = true;
+}
+
+/*
+ *	Run the block at PC, false if the interpreter has to execute
+ *	the next instruction
+ */
+bool jit_run(int type, jit_op_t **ops)
+{
+	register jblock_t *b;
+	register int bank, n;
+	int32_t i;
+
+	if (cpu_state != ST_CONTIN_RUN || int_protection || bus_mode
+	    || jit_buf == NULL
+#ifdef FRONTPANEL
+	    || F_flag
+#endif
+#ifdef WANT_TRACE
+	    || tr_flag
+#endif
+#ifdef WANT_COVER
+	    || cv_flag
+#endif
+#ifdef WANT_REPLAY
+	    || rr_mode != RR_OFF
+#endif
+#ifdef WANT_REVERSE
+	    || rev_flag
+#endif
+#ifdef WANT_HB
+	    || hb_flag
+#endif
+#ifdef WANT_TIM
+	    || t_flag
+#endif
+	   )
+		return false;
+
+	if (type != jit_type || ops != jit_ops) {
+		if (!reach(&ops[0]) || !reach(&ops[255]))
+			return false;
+		jit_flush();
+		jit_type = type;
+		jit_ops = ops;
+	}
+
+	bank = JIT_BANK(PC);
+	for (b = jit_at[PC]; b != NULL && b->bank != bank; b = b->next)
+		;
+	if (b == NULL) {
+		if (++jit_hot[PC] < JIT_HOT)
+			return false;
+		jit_hot[PC] = 0;
+		if ((b = translate()) == NULL)
+			return false;
+	}
+
+	/* link the exit of the last block, which returned for it */
+	jit_mapcur = JIT_MAP;
+	if (jit_pend != NULL && jit_pendpc == PC
+#ifdef WANT_TIM
+	    && PC != t_start
+#endif
+	   ) {
+		i = PC;
+		memcpy(jit_pend, &i, 4);
+		memcpy(jit_pend + LINK_MAP, &jit_mapcur, 4);
+		patch(jit_pend + LINK_JMP, b->chain);
+	}
+	jit_pend = NULL;
+
+	jit_stop = false;
+	jit_tlim = T + JIT_MAXT;
+#ifdef WANT_METRICS
+	jit_ninst = 0;
+#endif
+	n = (*b->code)();
+	if (n < 0) {
+		jit_pend = jit_link;
+		jit_pendpc = PC;
+		n = 0;
+	}
+#ifdef WANT_METRICS
+	cpu_inst += n + jit_ninst;
+#endif
+	return true;
+}
+
+#endif /* WANT_JIT */
@@ -0,0 +1,42 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+#ifndef SIMJIT_INC
+#define SIMJIT_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#ifdef WANT_JIT
+
+#define JIT_HOT		8	/* executions before a block is translated */
+#define JIT_MAXINST	64	/* max. number of instructions in a block */
+#define JIT_MAXLEN	256	/* max. number of bytes in a block */
+#define JIT_MAXT	1000	/* max. T-states of chained blocks */
+
+typedef int (jit_op_t)(void);	/* instruction function of a CPU core */
+
+extern bool	jit_flag;	/* translator is enabled */
+extern bool	jit_stop;	/* translated code was written */
+extern uint16_t	jit_map[65536];	/* number of blocks using the address */
+
+extern void jit_flush(void);
+extern bool jit_run(int type, jit_op_t **ops);
+extern void jit_invalidate(WORD addr);
+
+/*
+ * called for every memory write, costs one table lookup for
+ * addresses which weren't translated
+ */
+static inline void jit_write(WORD addr)
+{
+	if (jit_map[addr])
+		jit_invalidate(addr);
+}
+
+#endif /* WANT_JIT */
+
+#endif /* !SIMJIT_INC */
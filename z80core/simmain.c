@@ -40,6 +40,21 @@
 #ifdef INFOPANEL
 #include "simpanel.h"
 #endif
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_COVER
+#include "simcov.h"
+#endif
+#ifdef WANT_REPLAY
+#include "simreplay.h"
+#endif
+#ifdef WANT_JIT
+#include "simjit.h"
+#endif
+#ifdef WANT_LOGGER
+#include "log.h"
+#endif
 
 static void save_core(void);
 static bool load_core(void);
@@ -52,6 +67,20 @@ int main(int argc, char *argv[])
 {
 	register char *s, *p;
 	char *pn = basename(argv[0]);
+#ifdef WANT_TRACE
+	char *tspec = NULL;
+#endif
+#ifdef WANT_COVER
+	char *cvfn = NULL;
+#endif
+#ifdef WANT_REPLAY
+	char *rrfn = NULL;
+	int rrmode = RR_OFF;
+#endif
+#ifdef WANT_LOGGER
+	char *lspec = NULL;
+#endif
+	unsigned seed;
 #ifdef CONFDIR
 	struct stat sbuf;
 #endif
@@ -254,6 +283,69 @@ int main(int argc, char *argv[])
 				p_flag = !p_flag;
 				break;
 #endif
+#ifdef WANT_JIT
+			case 'j':	/* toggle binary translator */
+				jit_flag = !jit_flag;
+				break;
+#endif
+#ifdef WANT_TRACE
+			case 't':	/* record execution trace */
+				s++;
+				if (*s == '\0') {
+					if (argc <= 1)
+						goto usage;
+					argc--;
+					argv++;
+					s = argv[0];
+				}
+				tspec = s;
+				s += strlen(s) - 1;
+				break;
+#endif
+#ifdef WANT_COVER
+			case 'C':	/* record code coverage */
+				s++;
+				if (*s == '\0') {
+					if (argc <= 1)
+						goto usage;
+					argc--;
+					argv++;
+					s = argv[0];
+				}
+				cvfn = s;
+				s += strlen(s) - 1;
+				break;
+#endif
+#ifdef WANT_REPLAY
+			case 'e':	/* record external events */
+			case 'E':	/* replay external events */
+				rrmode = (*s == 'e') ? RR_RECORD : RR_REPLAY;
+				s++;
+				if (*s == '\0') {
+					if (argc <= 1)
+						goto usage;
+					argc--;
+					argv++;
+					s = argv[0];
+				}
+				rrfn = s;
+				s += strlen(s) - 1;
+				break;
+#endif
+#ifdef WANT_LOGGER
+			case 'L':	/* set log levels */
+				s++;
+				if (*s == '\0') {
+					if (argc <= 1)
+						goto usage;
+					argc--;
+					argv++;
+					s = argv[0];
+				}
+				lspec = s;
+				s += strlen(s) - 1;
+				break;
+#endif
 
 			case '?':
 			case 'h':
@@ -294,6 +386,21 @@ usage:
 #endif
 #ifdef HAS_NETSERVER
 				fputs(" -n", stdout);
+#endif
+#ifdef WANT_TRACE
+				fputs(" -t tracefile", stdout);
+#endif
+#ifdef WANT_COVER
+				fputs(" -C covfile", stdout);
+#endif
+#ifdef WANT_REPLAY
+				fputs(" -e|-E logfile", stdout);
+#endif
+#ifdef WANT_JIT
+				fputs(" -j", stdout);
+#endif
+#ifdef WANT_LOGGER
+				fputs(" -L tag=level,...", stdout);
 #endif
 				fputs("\n\n", stdout);
 #ifndef EXCLUDE_Z80
@@ -348,6 +455,26 @@ usage:
 #endif
 #ifdef INFOPANEL
 				puts("\t-p = toggle introspection panel");
+#endif
+#ifdef WANT_TRACE
+				puts("\t-t = record execution trace into "
+				     "tracefile[,from,to][,bank=n][,io]");
+#endif
+#ifdef WANT_COVER
+				puts("\t-C = add code coverage to covfile");
+#endif
+#ifdef WANT_REPLAY
+				puts("\t-e = record inputs and interrupts "
+				     "into logfile");
+				puts("\t-E = replay inputs and interrupts "
+				     "from logfile");
+#endif
+#ifdef WANT_JIT
+				puts("\t-j = toggle translation into host code");
+#endif
+#ifdef WANT_LOGGER
+				puts("\t-L = set log levels of tags, "
+				     "tag * for all tags");
 #endif
 				return EXIT_FAILURE;
 			}
@@ -424,8 +551,19 @@ puts(" #####    ###     #####    ###            #####    ###   #     #");
 	}
 #endif
 
-	/* seed random generator */
-	srand(get_clock_us());
+#ifdef WANT_LOGGER
+	log_init();		/* start writing log messages */
+	if (lspec != NULL && !log_config(lspec))
+		return EXIT_FAILURE;
+#endif
+
+	/* seed random generator, the seed is kept in a replay log */
+	seed = get_clock_us();
+#ifdef WANT_REPLAY
+	if (rrfn != NULL && !rr_open(rrfn, rrmode, &seed))
+		return EXIT_FAILURE;
+#endif
+	srand(seed);
 
 	config();		/* read system configuration */
 	init_cpu();		/* initialize CPU */
@@ -439,6 +577,15 @@ puts(" #####    ###     #####    ###            #####    ###   #     #");
 			return EXIT_FAILURE;
 	}
 
+#ifdef WANT_TRACE
+	if (tspec != NULL && !trace_open(tspec))
+		return EXIT_FAILURE;
+#endif
+#ifdef WANT_COVER
+	if (cvfn != NULL && !cover_open(cvfn))
+		return EXIT_FAILURE;
+#endif
+
 	int_on();		/* initialize UNIX interrupts */
 	init_io();		/* initialize I/O devices */
 #ifdef INFOPANEL
@@ -448,6 +595,16 @@ puts(" #####    ###     #####    ###            #####    ###   #     #");
 
 	mon();			/* run system */
 
+#ifdef WANT_TRACE
+	trace_close();		/* write rest of execution trace */
+#endif
+#ifdef WANT_COVER
+	cover_close();		/* write code coverage */
+#endif
+#ifdef WANT_REPLAY
+	rr_close();		/* close replay log */
+#endif
+
 	if (s_flag)		/* save core */
 		save_core();
 
@@ -457,6 +614,9 @@ puts(" #####    ###     #####    ###            #####    ###   #     #");
 #endif
 	exit_io();		/* stop I/O devices */
 	int_off();		/* stop UNIX interrupts */
+#ifdef WANT_LOGGER
+	log_exit();		/* write remaining log messages */
+#endif
 
 	return EXIT_SUCCESS;
 }
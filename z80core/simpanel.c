@@ -1423,7 +1423,8 @@ static win_funcs_t panel_funcs = {
 	open_display,
 	close_display,
 	process_event,
-	update_display
+	update_display,
+	60
 };
 
 #else /* !WANT_SDL */
@@ -0,0 +1,474 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	This module records all inputs of a run, which don't come from
+ *	the emulated machine itself, into a log and feeds them back in
+ *	a later run, so that the same instructions are executed again.
+ *
+ *	Recorded are the seed of the random generator, which initializes
+ *	registers and memory, all reads from ports with a device, the
+ *	interrupts accepted by the CPU, and the refresh register after
+ *	a HALT, which counts the time waited for an interrupt. Each event
+ *	has the T-state counter, at which it happened.
+ *
+ *	In a replay the devices aren't asked for input, the data comes
+ *	from the log, and interrupts are only accepted at the T-states
+ *	in the log, so interrupts of the devices don't matter. When the
+ *	run differs from the log the replay is stopped with a message,
+ *	and the simulation continues with the devices.
+ *
+ *	For reverse execution in the ICE the log is kept in a temporary
+ *	file as history. Then also memory writes of devices are recorded,
+ *	because when the CPU re-executes the history output isn't sent
+ *	to the devices again. When the end of the history is reached, the
+ *	recording continues.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simio.h"
+#include "simreplay.h"
+#ifdef WANT_REVERSE
+#include "simmem.h"
+#endif
+
+#ifdef WANT_REPLAY
+
+#include "log.h"
+static const char *TAG = "replay";
+
+int rr_mode;				/* record or replay mode */
+#ifdef WANT_REVERSE
+bool rr_hist;				/* log is the history in the ICE */
+bool rr_lost;				/* history diverged */
+Tstates_t rr_tend;			/* T-states of end of history */
+#endif
+
+static FILE *rr_fp;			/* log file */
+static Tstates_t rr_t;			/* T-states of last event */
+static bool rr_in_last;			/* last event was an input */
+static BYTE rr_port, rr_data;		/* port and data of last input */
+static Tstates_t rr_dt;			/* T-states since event before */
+static uint64_t rr_rep;			/* repetitions of last input */
+
+static struct {				/* next event of the replay */
+	int tag;
+	Tstates_t t;
+	BYTE port, data;
+	int int_data;
+	WORD addr;
+} next;
+
+static void rr_put(int tag);
+static void rr_flush(void);
+static void rr_varint(uint64_t v);
+static uint64_t rr_get_varint(void);
+static void rr_read(void);
+static void rr_diverged(const char *what);
+#ifdef WANT_REVERSE
+static void rr_live(void);
+#endif
+
+/*
+ *	Open a log for recording or replay in mode, when recording
+ *	the seed is written into the log, else read from it
+ */
+bool rr_open(const char *fn, int mode, unsigned *seed)
+{
+	char magic[8];
+	int i, c;
+
+	if ((rr_fp = fopen(fn, mode == RR_RECORD ? "wb" : "rb")) == NULL) {
+		LOGE(TAG, "can't open file %s", fn);
+		return false;
+	}
+	if (mode == RR_RECORD) {
+		fwrite(RR_MAGIC, 1, 8, rr_fp);
+		for (i = 0; i < 4; i++)
+			putc((*seed >> (i * 8)) & 0xff, rr_fp);
+	} else {
+		if (fread(magic, 1, 8, rr_fp) != 8
+		    || memcmp(magic, RR_MAGIC, 8)) {
+			LOGE(TAG, "%s is not a replay log", fn);
+			fclose(rr_fp);
+			return false;
+		}
+		*seed = 0;
+		for (i = 0; i < 4; i++) {
+			if ((c = getc(rr_fp)) == EOF) {
+				LOGE(TAG, "%s is not a replay log", fn);
+				fclose(rr_fp);
+				return false;
+			}
+			*seed |= (unsigned) c << (i * 8);
+		}
+	}
+	rr_t = T;
+	rr_in_last = false;
+	rr_rep = 0;
+	rr_mode = mode;
+	if (mode == RR_REPLAY)
+		rr_read();
+	return true;
+}
+
+/*
+ *	Stop recording or replay
+ */
+void rr_close(void)
+{
+	if (rr_mode == RR_OFF)
+		return;
+	if (rr_mode == RR_RECORD)
+		rr_put(RR_END);
+	rr_mode = RR_OFF;
+#ifdef WANT_REVERSE
+	rr_hist = false;
+#endif
+	if (fclose(rr_fp))
+		LOGE(TAG, "error writing replay log");
+}
+
+/*
+ *	Input from port, called instead of the device function
+ */
+BYTE rr_in(BYTE port)
+{
+	BYTE data;
+
+	if (rr_mode == RR_REPLAY) {
+		if (next.tag == RR_IN && next.t == T && next.port == port) {
+			data = next.data;
+			rr_read();
+			return data;
+		}
+		rr_diverged("input");
+		return (*port_in[port])();
+	}
+
+	/* polling loops repeat the same input, which is counted only */
+	data = (*port_in[port])();
+	if (rr_in_last && port == rr_port && data == rr_data
+	    && T - rr_t == rr_dt) {
+		rr_rep++;
+		rr_t = T;
+		return data;
+	}
+	rr_put(RR_IN);
+	putc(port, rr_fp);
+	putc(data, rr_fp);
+	rr_in_last = true;
+	rr_port = port;
+	rr_data = data;
+	return data;
+}
+
+/*
+ *	The CPU accepts an interrupt of type RR_INT or RR_NMI,
+ *	returns false if it isn't the next event of the replay
+ */
+bool rr_interrupt(int type)
+{
+	if (rr_mode == RR_REPLAY) {
+		if (next.tag != type || next.t != T)
+			return false;
+		if (type == RR_INT)
+			int_data = next.int_data;
+		rr_read();
+		return true;
+	}
+
+	rr_put(type);
+	if (type == RR_INT)
+		rr_varint(int_data + 1);
+	return true;
+}
+
+/*
+ *	Called by the CPU before interrupts are checked when replaying,
+ *	sets the interrupts of the next event
+ */
+void rr_sync(void)
+{
+#ifdef WANT_REVERSE
+	if (rr_hist) {
+		rr_out();
+		if (next.tag == RR_END) {
+			/* no more events until the end of the history */
+			if (T >= rr_tend)
+				rr_live();
+			else {
+				int_int = false;
+#ifndef EXCLUDE_Z80
+				int_nmi = false;
+#endif
+			}
+			return;
+		}
+	}
+#endif
+	if (next.t < T) {
+		if (next.tag == RR_END) {
+			LOG(TAG, "Replay finished at T-state %" PRIu64 "\r\n",
+			    T);
+			rr_close();
+		} else
+			rr_diverged("event missed");
+		return;
+	}
+	int_int = (next.tag == RR_INT && next.t == T);
+#ifndef EXCLUDE_Z80
+	int_nmi = (next.tag == RR_NMI && next.t == T);
+#endif
+}
+
+/*
+ *	End of a HALT, the refresh register counts the time waited
+ *	for an interrupt, so it is recorded
+ */
+void rr_halt(void)
+{
+#ifndef EXCLUDE_Z80
+	if (rr_mode == RR_REPLAY) {
+		if (next.tag == RR_HALT && next.t == T) {
+			R = next.data;
+			rr_read();
+		} else
+			rr_diverged("HALT");
+		return;
+	}
+
+	rr_put(RR_HALT);
+	putc(R, rr_fp);
+#endif
+}
+
+#ifdef WANT_REVERSE
+
+/*
+ *	Start recording the history for reverse execution
+ */
+bool rr_hist_open(void)
+{
+	if ((rr_fp = tmpfile()) == NULL) {
+		LOGE(TAG, "can't create history file");
+		return false;
+	}
+	rr_t = T;
+	rr_in_last = false;
+	rr_rep = 0;
+	rr_hist = true;
+	rr_lost = false;
+	rr_mode = RR_RECORD;
+	return true;
+}
+
+/*
+ *	Get the current position in the history, when recording
+ */
+void rr_mark(rr_pos_t *p)
+{
+	rr_flush();
+	rr_in_last = false;
+	p->off = ftell(rr_fp);
+	p->t = rr_t;
+}
+
+/*
+ *	Replay the history from a position got with rr_mark(),
+ *	when recording the current T-states are the end of the history
+ */
+void rr_seek(const rr_pos_t *p)
+{
+	if (rr_mode == RR_RECORD) {
+		rr_flush();
+		rr_in_last = false;
+		rr_tend = T;
+	}
+	fseek(rr_fp, p->off, SEEK_SET);
+	rr_t = p->t;
+	rr_rep = 0;
+	rr_mode = RR_REPLAY;
+	rr_read();
+}
+
+/*
+ *	Size of the history in bytes
+ */
+long rr_size(void)
+{
+	long pos, size;
+
+	pos = ftell(rr_fp);
+	fseek(rr_fp, 0L, SEEK_END);
+	size = ftell(rr_fp);
+	fseek(rr_fp, pos, SEEK_SET);
+	return size;
+}
+
+/*
+ *	Memory write of a device, when recording the history
+ */
+void rr_dma(WORD addr, BYTE data)
+{
+	rr_put(RR_DMA);
+	putc(addr & 0xff, rr_fp);
+	putc(addr >> 8, rr_fp);
+	putc(data, rr_fp);
+}
+
+/*
+ *	Output when re-executing the history, instead of calling
+ *	the device the memory writes it made are done
+ */
+void rr_out(void)
+{
+	while (next.tag == RR_DMA && next.t == T) {
+		dma_write(next.addr, next.data);
+		rr_read();
+	}
+}
+
+/*
+ *	Continue recording at the end of the history
+ */
+static void rr_live(void)
+{
+	fseek(rr_fp, 0L, SEEK_END);
+	rr_in_last = false;
+	rr_rep = 0;
+	rr_mode = RR_RECORD;
+}
+
+#endif /* WANT_REVERSE */
+
+/*
+ *	write tag and T-states of an event, after the repetitions
+ *	of the last input
+ */
+static void rr_put(int tag)
+{
+	rr_flush();
+	putc(tag, rr_fp);
+	if (tag == RR_END)
+		return;
+	rr_dt = T - rr_t;
+	rr_varint(rr_dt);
+	rr_t = T;
+	rr_in_last = false;
+}
+
+/*
+ *	write the repetitions of the last input
+ */
+static void rr_flush(void)
+{
+	if (rr_rep) {
+		putc(RR_REPEAT, rr_fp);
+		rr_varint(rr_rep);
+		rr_rep = 0;
+	}
+}
+
+static void rr_varint(uint64_t v)
+{
+	while (v >= 0x80) {
+		putc((v & 0x7f) | 0x80, rr_fp);
+		v >>= 7;
+	}
+	putc((int) v, rr_fp);
+}
+
+static uint64_t rr_get_varint(void)
+{
+	uint64_t v = 0;
+	int c, shift = 0;
+
+	while ((c = getc(rr_fp)) != EOF) {
+		v |= (uint64_t) (c & 0x7f) << shift;
+		if (!(c & 0x80))
+			break;
+		shift += 7;
+	}
+	return v;
+}
+
+/*
+ *	read the next event of the replay
+ */
+static void rr_read(void)
+{
+	int c;
+
+	if (rr_rep == 0 && (c = getc(rr_fp)) == RR_REPEAT)
+		rr_rep = rr_get_varint();
+	else if (rr_rep == 0)
+		ungetc(c, rr_fp);
+	if (rr_rep) {
+		/* next repetition of the last input */
+		rr_rep--;
+		next.t = rr_t += rr_dt;
+		return;
+	}
+
+	if ((c = getc(rr_fp)) == EOF || c == RR_END) {
+		next.tag = RR_END;
+		next.t = 0;
+		return;
+	}
+	next.tag = c;
+	rr_dt = rr_get_varint();
+	next.t = rr_t += rr_dt;
+	switch (c) {
+	case RR_IN:
+		next.port = getc(rr_fp);
+		next.data = getc(rr_fp);
+		break;
+	case RR_INT:
+		next.int_data = (int) rr_get_varint() - 1;
+		break;
+	case RR_NMI:
+		break;
+	case RR_HALT:
+		next.data = getc(rr_fp);
+		break;
+	case RR_DMA:
+		next.addr = getc(rr_fp);
+		next.addr |= getc(rr_fp) << 8;
+		next.data = getc(rr_fp);
+		break;
+	default:
+		LOGE(TAG, "invalid event %d in replay log", c);
+		next.tag = RR_END;
+		next.t = 0;
+		break;
+	}
+}
+
+/*
+ *	the run differs from the log, continue with the devices
+ */
+static void rr_diverged(const char *what)
+{
+	LOGE(TAG, "replay diverged at T-state %" PRIu64 " (%s)", T, what);
+#ifdef WANT_REVERSE
+	if (rr_hist) {
+		/* continue recording, the history is started again */
+		rr_lost = true;
+		rr_live();
+		return;
+	}
+#endif
+	rr_close();
+}
+
+#endif /* WANT_REPLAY */
@@ -0,0 +1,87 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+#ifndef SIMREPLAY_INC
+#define SIMREPLAY_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+/*
+ *	Format of a replay log:
+ *
+ *	The file starts with the 8 bytes RR_MAGIC and the seed of the
+ *	random generator as 32-bit little endian word. Then follow the
+ *	events, a tag byte and the difference of the T-states to the
+ *	last event as varint:
+ *
+ *	RR_IN		input, port and data byte
+ *	RR_INT		maskable interrupt, varint of int_data + 1
+ *	RR_NMI		non-maskable interrupt
+ *	RR_HALT		end of HALT, refresh register R
+ *	RR_REPEAT	varint with the number of repetitions of the
+ *			last input with the same T-state difference
+ *	RR_DMA		memory write of a device, address and data byte,
+ *			only in the history for reverse execution
+ */
+
+#define RR_MAGIC	"Z80RPL01"
+
+#define RR_END		0	/* end of log */
+#define RR_IN		1	/* input from a port */
+#define RR_INT		2	/* maskable interrupt accepted */
+#define RR_NMI		3	/* non-maskable interrupt accepted */
+#define RR_HALT		4	/* end of HALT */
+#define RR_REPEAT	5	/* repetitions of last input */
+#define RR_DMA		6	/* memory write of a device */
+
+				/* modes */
+#define RR_OFF		0	/* no recording or replay */
+#define RR_RECORD	1	/* record events */
+#define RR_REPLAY	2	/* replay events */
+
+#ifdef WANT_REPLAY
+
+#ifdef WANT_REVERSE
+typedef struct rr_pos {		/* position in the history */
+	long	off;		/* offset in the log */
+	Tstates_t t;		/* T-states of the event before */
+} rr_pos_t;
+#endif
+
+extern int	rr_mode;
+#ifdef WANT_REVERSE
+extern bool	rr_hist, rr_lost;
+extern Tstates_t rr_tend;
+#endif
+
+extern bool rr_open(const char *fn, int mode, unsigned *seed);
+extern void rr_close(void);
+extern BYTE rr_in(BYTE port);
+extern bool rr_interrupt(int type);
+extern void rr_sync(void);
+extern void rr_halt(void);
+#ifdef WANT_REVERSE
+extern bool rr_hist_open(void);
+extern void rr_mark(rr_pos_t *p);
+extern void rr_seek(const rr_pos_t *p);
+extern long rr_size(void);
+extern void rr_dma(WORD addr, BYTE data);
+extern void rr_out(void);
+#endif
+
+/*
+ * called when the CPU accepts an interrupt, returns false if the
+ * interrupt has to be ignored, because it isn't in the replay log
+ */
+static inline bool rr_accept(int type)
+{
+	return rr_mode == RR_OFF || rr_interrupt(type);
+}
+
+#endif /* WANT_REPLAY */
+
+#endif /* !SIMREPLAY_INC */
@@ -0,0 +1,707 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	This module implements reverse execution for the ICE.
+ *
+ *	While the history is recorded, a checkpoint with the CPU registers
+ *	and the memory is taken every interval T-states. Memory is kept
+ *	in pages, a page which didn't change since the checkpoint before
+ *	is shared with it, so a checkpoint only costs the pages written
+ *	in its interval. All inputs, interrupts and memory writes of
+ *	devices are recorded in the history log of simreplay.c.
+ *
+ *	To go back in time the latest checkpoint before the wanted
+ *	T-state is restored and the CPU re-executes the history from it,
+ *	with the inputs taken from the log and without sending output
+ *	to the devices. When the CPU runs forward past the end of the
+ *	history, recording continues with the devices.
+ *
+ *	When the machine state is changed in the ICE, the history
+ *	doesn't lead to it anymore and is started again.
+ *
+ *	The memory write functions mark the written pages in rev_pages,
+ *	so checkpoints and the check for changes in the ICE only compare
+ *	and copy the pages written since the checkpoint before, or since
+ *	the CPU stopped.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simcore.h"
+#include "simmem.h"
+#include "simport.h"
+#include "simice.h"
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#include "simreplay.h"
+#include "simrev.h"
+
+#ifdef WANT_REVERSE
+
+#include "log.h"
+static const char *TAG = "reverse";
+
+#define PAGE_SIZE	(1 << REV_SHIFT)
+
+typedef struct page {		/* memory page shared by checkpoints */
+	int	ref;		/* number of checkpoints using it */
+	BYTE	data[PAGE_SIZE];
+} page_t;
+
+typedef struct regs {		/* CPU state */
+	int	cpu;
+	BYTE	a, b, c, d, e, h, l;
+	int	f;
+	WORD	pc, sp;
+	BYTE	iff;
+#ifndef EXCLUDE_Z80
+	BYTE	a_, b_, c_, d_, e_, h_, l_;
+	int	f_;
+	WORD	ix, iy;
+	BYTE	i, r, r_;
+	int	int_mode;
+#endif
+	bool	int_protection;
+	Tstates_t t;
+} regs_t;
+
+typedef struct checkpoint {
+	regs_t	regs;
+	rr_pos_t pos;		/* position in the history log */
+	page_t	*pages[REV_PAGES];
+} checkpoint_t;
+
+bool rev_flag;				/* history is recorded */
+bool rev_scan;				/* searching the history for a write */
+Tstates_t rev_next;			/* T-states of next call to rev_check() */
+BYTE rev_pages[REV_PAGES];		/* REV_CP and REV_ICE per page */
+
+static checkpoint_t **cps;		/* checkpoints, oldest first */
+static int ncps, ncps_alloc;
+static Tstates_t interval;		/* T-states between checkpoints */
+static size_t budget, used;		/* memory for checkpoints */
+
+static bool stopping;			/* stop the CPU at stop_t */
+static Tstates_t stop_t;
+static bool every;			/* called for every instruction */
+static Tstates_t last_t;		/* T-states of current instruction */
+static Tstates_t *ring;			/* T-states of last instructions */
+static unsigned ring_n, ring_pos, ring_cnt;
+static bool found;			/* write found by search */
+static Tstates_t found_t;
+
+static Tstates_t cost_t;		/* cost of last backward step */
+static uint64_t cost_us;
+
+static regs_t seen_regs;		/* machine state in the ICE */
+static BYTE seen[65536];
+
+static void checkpoint(void);
+static void drop(void);
+static void restore(const checkpoint_t *cp);
+static void restart(void);
+static void schedule(void);
+static void run_until(Tstates_t t);
+static int find(Tstates_t t, bool before);
+static bool begin_op(void);
+static void end_op(void);
+static void save_regs(regs_t *r);
+static void load_regs(const regs_t *r);
+
+/*
+ *	Called by the CPU before an instruction, when T reached rev_next,
+ *	takes checkpoints, and stops the CPU when re-executing the history
+ *
+ *	Output:	true stop the CPU
+ */
+bool rev_check(void)
+{
+	if (stopping && T >= stop_t) {
+		cpu_state = ST_STOPPED;
+		return true;
+	}
+	if (every) {
+		last_t = T;
+		if (ring_n) {
+			ring[ring_pos] = T;
+			if (++ring_pos == ring_n)
+				ring_pos = 0;
+			ring_cnt++;
+		}
+		return false;
+	}
+	if (rr_lost)
+		restart();
+	else if (rr_mode == RR_RECORD
+		 && (ncps == 0 || T >= cps[ncps - 1]->regs.t + interval))
+		checkpoint();
+	schedule();
+	return false;
+}
+
+/*
+ *	Called from hb_check() when the searched address was written
+ */
+bool rev_hit(void)
+{
+	found = true;
+	found_t = last_t;
+	hb_trig = 0;
+	hb_nhits = 0;
+	return false;
+}
+
+/*
+ *	Start recording the history, or change the interval of the
+ *	checkpoints and the memory budget in KB, 0 keeps the default
+ */
+bool rev_start(Tstates_t ival, unsigned kb)
+{
+	interval = ival ? ival : REV_INTERVAL;
+	budget = (size_t) (kb ? kb : REV_BUDGET) << 10;
+	if (rev_flag) {
+		while (used > budget && ncps > 1)
+			drop();
+		schedule();
+		return true;
+	}
+	if (rr_mode != RR_OFF) {
+		puts("Not possible while recording or replaying a log");
+		return false;
+	}
+	if (!rr_hist_open())
+		return false;
+	rev_flag = true;
+	memset(rev_pages, REV_CP | REV_ICE, sizeof(rev_pages));
+	checkpoint();
+	schedule();
+	rev_pause();
+	return true;
+}
+
+/*
+ *	Stop recording the history, if in the past, first run
+ *	to the end of the history
+ */
+void rev_stop(void)
+{
+	if (!rev_flag)
+		return;
+	if (rr_mode == RR_REPLAY)
+		run_until(rr_tend);
+	while (ncps > 0)
+		drop();
+	free(cps);
+	cps = NULL;
+	ncps_alloc = 0;
+	rr_close();
+	rev_flag = false;
+}
+
+/*
+ *	Show the state of the history
+ */
+void rev_show(void)
+{
+	if (!rev_flag) {
+		puts("No history recorded");
+		return;
+	}
+	printf("History from T-state %" PRIu64 " to %" PRIu64
+	       ", now at %" PRIu64 "\n", cps[0]->regs.t,
+	       rr_mode == RR_REPLAY ? rr_tend : T, T);
+	printf("%d checkpoints every %" PRIu64 " T-states, "
+	       "%zu of %zu KB memory used\n", ncps, interval,
+	       used >> 10, budget >> 10);
+	printf("Log of inputs has %ld bytes\n", rr_size());
+	printf("Last backward step re-executed %" PRIu64 " T-states in %"
+	       PRIu64 " ms\n", cost_t, cost_us / 1000);
+}
+
+/*
+ *	Called by the ICE before the CPU runs, starts the history
+ *	again when the machine state was changed, only the pages
+ *	written since the CPU stopped are compared
+ */
+void rev_resume(void)
+{
+	regs_t r;
+	register int i, j;
+	WORD a;
+
+	if (!rev_flag)
+		return;
+	save_regs(&r);
+	if (memcmp(&r, &seen_regs, sizeof(r)))
+		goto changed;
+	for (i = 0; i < REV_PAGES; i++) {
+		if (!(rev_pages[i] & REV_ICE))
+			continue;
+		a = i << REV_SHIFT;
+		for (j = 0; j < PAGE_SIZE; j++)
+			if (getmem(a + j) != seen[a + j])
+				goto changed;
+	}
+	return;
+
+changed:
+	restart();
+	rev_pause();
+}
+
+/*
+ *	Called by the ICE after the CPU stopped, remembers the
+ *	machine state, only the pages written since the CPU
+ *	stopped the last time are copied
+ */
+void rev_pause(void)
+{
+	register int i, j;
+	WORD a;
+
+	if (!rev_flag)
+		return;
+	if (rr_lost)
+		restart();
+	save_regs(&seen_regs);
+	for (i = 0; i < REV_PAGES; i++) {
+		if (!(rev_pages[i] & REV_ICE))
+			continue;
+		a = i << REV_SHIFT;
+		for (j = 0; j < PAGE_SIZE; j++)
+			seen[a + j] = getmem(a + j);
+		rev_pages[i] &= ~REV_ICE;
+	}
+}
+
+/*
+ *	Step back n instructions
+ */
+bool rev_back(unsigned n)
+{
+	Tstates_t now, target;
+	int k;
+
+	if (!begin_op())
+		return false;
+	now = T;
+	if ((k = find(now, true)) < 0) {
+		puts("Beginning of history reached");
+		return false;
+	}
+	if ((ring = (Tstates_t *) malloc(n * sizeof(Tstates_t))) == NULL) {
+		puts("can't allocate memory");
+		return false;
+	}
+	ring_n = n;
+
+	/* re-execute until the last n instructions are known */
+	while (true) {
+		restore(cps[k]);
+		ring_pos = ring_cnt = 0;
+		every = true;
+		run_until(now);
+		every = false;
+		if (ring_cnt >= n || k == 0)
+			break;
+		k--;
+	}
+	if (ring_cnt >= n)
+		target = ring[ring_pos];
+	else {
+		target = cps[0]->regs.t;
+		puts("Beginning of history reached");
+	}
+	free(ring);
+	ring = NULL;
+	ring_n = 0;
+
+	restore(cps[find(target, false)]);
+	run_until(target);
+	end_op();
+	return true;
+}
+
+/*
+ *	Run back to the last instruction, which wrote to addr
+ */
+bool rev_write(WORD addr)
+{
+	static BYTE map[65536], pmap[256];
+	Tstates_t now, end;
+	int k;
+
+	if (!begin_op())
+		return false;
+	now = T;
+	if ((k = find(now, true)) < 0) {
+		puts("Beginning of history reached");
+		return false;
+	}
+
+	/* use the hardware breakpoints to watch the address */
+	memcpy(map, hb_map, sizeof(map));
+	memcpy(pmap, hb_pmap, sizeof(pmap));
+	memset(hb_map, 0, sizeof(hb_map));
+	memset(hb_pmap, 0, sizeof(hb_pmap));
+	hb_map[addr] = HB_WRITE;
+	hb_trig = 0;
+	hb_nhits = 0;
+	rev_scan = true;
+
+	/* search the intervals between the checkpoints backwards */
+	found = false;
+	for (end = now; k >= 0; k--) {
+		restore(cps[k]);
+		every = true;
+		run_until(end);
+		every = false;
+		if (found)
+			break;
+		end = cps[k]->regs.t;
+	}
+
+	rev_scan = false;
+	memcpy(hb_map, map, sizeof(map));
+	memcpy(hb_pmap, pmap, sizeof(pmap));
+	hb_trig = 0;
+	hb_nhits = 0;
+
+	if (found) {
+		restore(cps[find(found_t, false)]);
+		run_until(found_t);
+	} else {
+		restore(cps[find(now, false)]);
+		run_until(now);
+		printf("No write to %04x in history\n", addr);
+	}
+	end_op();
+	return found;
+}
+
+/*
+ *	Go to T-state t in the history
+ */
+bool rev_goto(Tstates_t t)
+{
+	Tstates_t end;
+	int k;
+
+	if (!begin_op())
+		return false;
+	end = (rr_mode == RR_REPLAY) ? rr_tend : T;
+	if (t > end)
+		t = end;
+	if (t < cps[0]->regs.t) {
+		puts("T-state is before the beginning of history");
+		return false;
+	}
+	k = find(t, false);
+	if (T > t || cps[k]->regs.t > T)
+		restore(cps[k]);
+	run_until(t);
+	end_op();
+	return true;
+}
+
+/*
+ *	Take a checkpoint, pages which are the same as in the
+ *	checkpoint before are shared with it
+ */
+static void checkpoint(void)
+{
+	checkpoint_t *cp, *prev;
+	BYTE buf[PAGE_SIZE];
+	register int i, j;
+	WORD a;
+
+	if (ncps == ncps_alloc) {
+		i = ncps_alloc ? ncps_alloc * 2 : 64;
+		if ((cps = (checkpoint_t **) realloc(cps, i * sizeof(*cps)))
+		    == NULL) {
+			LOGE(TAG, "can't allocate memory for checkpoints");
+			exit(EXIT_FAILURE);
+		}
+		ncps_alloc = i;
+	}
+	if ((cp = (checkpoint_t *) malloc(sizeof(checkpoint_t))) == NULL) {
+		LOGE(TAG, "can't allocate memory for checkpoint");
+		return;
+	}
+	save_regs(&cp->regs);
+	rr_mark(&cp->pos);
+	prev = ncps ? cps[ncps - 1] : NULL;
+
+	for (i = 0; i < REV_PAGES; i++) {
+		/* pages not written since the checkpoint before are shared */
+		if (prev && !(rev_pages[i] & REV_CP)) {
+			cp->pages[i] = prev->pages[i];
+			cp->pages[i]->ref++;
+			continue;
+		}
+		rev_pages[i] &= ~REV_CP;
+		a = i << REV_SHIFT;
+		for (j = 0; j < PAGE_SIZE; j++)
+			buf[j] = getmem(a + j);
+#ifdef SBSIZE
+		/* keep the op-codes under software breakpoints */
+		for (j = 0; j < SBSIZE; j++)
+			if (soft[j].sb_pass
+			    && (soft[j].sb_addr >> REV_SHIFT) == i
+			    && buf[soft[j].sb_addr & (PAGE_SIZE - 1)] == 0x76)
+				buf[soft[j].sb_addr & (PAGE_SIZE - 1)] =
+					soft[j].sb_oldopc;
+#endif
+		if (prev && !memcmp(prev->pages[i]->data, buf, PAGE_SIZE)) {
+			cp->pages[i] = prev->pages[i];
+			cp->pages[i]->ref++;
+			continue;
+		}
+		if ((cp->pages[i] = (page_t *) malloc(sizeof(page_t)))
+		    == NULL) {
+			LOGE(TAG, "can't allocate memory for checkpoint");
+			exit(EXIT_FAILURE);
+		}
+		cp->pages[i]->ref = 1;
+		memcpy(cp->pages[i]->data, buf, PAGE_SIZE);
+		used += sizeof(page_t);
+	}
+	used += sizeof(checkpoint_t);
+	cps[ncps++] = cp;
+
+	/* the oldest checkpoints are dropped to stay in the budget */
+	while (used > budget && ncps > 1)
+		drop();
+}
+
+/*
+ *	Drop the oldest checkpoint
+ */
+static void drop(void)
+{
+	checkpoint_t *cp = cps[0];
+	register int i;
+
+	for (i = 0; i < REV_PAGES; i++)
+		if (--cp->pages[i]->ref == 0) {
+			free(cp->pages[i]);
+			used -= sizeof(page_t);
+		}
+	free(cp);
+	used -= sizeof(checkpoint_t);
+	memmove(cps, cps + 1, --ncps * sizeof(*cps));
+}
+
+/*
+ *	Restore the machine state of a checkpoint, the CPU continues
+ *	with the history from there
+ */
+static void restore(const checkpoint_t *cp)
+{
+	register int i, j;
+	register const BYTE *p;
+	WORD a;
+
+	rr_seek(&cp->pos);
+	load_regs(&cp->regs);
+	for (i = 0; i < REV_PAGES; i++) {
+		a = i << REV_SHIFT;
+		p = cp->pages[i]->data;
+		for (j = 0; j < PAGE_SIZE; j++)
+			if (getmem(a + j) != p[j])
+				putmem(a + j, p[j]);
+	}
+	int_int = false;
+#ifndef EXCLUDE_Z80
+	int_nmi = false;
+#endif
+	int_data = -1;
+	hb_trig = 0;
+	hb_nhits = 0;
+}
+
+/*
+ *	Start the history again at the current machine state
+ */
+static void restart(void)
+{
+	while (ncps > 0)
+		drop();
+	rr_close();
+	if (!rr_hist_open()) {
+		rev_flag = false;
+		return;
+	}
+	memset(rev_pages, REV_CP | REV_ICE, sizeof(rev_pages));
+	checkpoint();
+	schedule();
+	LOG(TAG, "History restarted at T-state %" PRIu64 "\r\n", T);
+}
+
+/*
+ *	Set the T-states of the next call to rev_check()
+ */
+static void schedule(void)
+{
+	if (every)
+		rev_next = 0;
+	else if (rr_mode == RR_REPLAY && T < rr_tend)
+		rev_next = rr_tend;
+	else if (ncps > 0)
+		rev_next = cps[ncps - 1]->regs.t + interval;
+	else
+		rev_next = T;
+	if (stopping && stop_t < rev_next)
+		rev_next = stop_t;
+}
+
+/*
+ *	Re-execute the history until T-state t, without breakpoints
+ *	and as fast as possible
+ */
+static void run_until(Tstates_t t)
+{
+	Tstates_t start = T, t0;
+	bool save_needed = cpu_needed, save_hb = hb_flag;
+#ifdef WANT_TRACE
+	bool save_tr = tr_flag;
+
+	tr_flag = false;
+#endif
+	cpu_needed = true;
+	hb_flag = rev_scan;
+	stopping = true;
+	stop_t = t;
+	schedule();
+	while (T < t) {
+		t0 = T;
+		run_cpu();
+		if (T == t0)
+			break;
+	}
+	cost_t += T - start;
+	stopping = false;
+	schedule();
+	cpu_needed = save_needed;
+	hb_flag = save_hb;
+#ifdef WANT_TRACE
+	tr_flag = save_tr;
+#endif
+}
+
+/*
+ *	Find the latest checkpoint at T-state t, or before it
+ *
+ *	Output:	index of the checkpoint, -1 = none
+ */
+static int find(Tstates_t t, bool before)
+{
+	register int i;
+
+	for (i = ncps - 1; i >= 0; i--)
+		if (cps[i]->regs.t < t || (!before && cps[i]->regs.t == t))
+			break;
+	return i;
+}
+
+static bool begin_op(void)
+{
+	if (!rev_flag) {
+		puts("No history recorded");
+		return false;
+	}
+	rev_resume();
+	cost_t = 0;
+	cost_us = get_clock_us();
+	return true;
+}
+
+static void end_op(void)
+{
+	cost_us = get_clock_us() - cost_us;
+	printf("%" PRIu64 " T-states re-executed in %" PRIu64 " ms\n",
+	       cost_t, cost_us / 1000);
+	rev_pause();
+}
+
+static void save_regs(regs_t *r)
+{
+	memset(r, 0, sizeof(*r));
+	r->cpu = cpu;
+	r->a = A;
+	r->b = B;
+	r->c = C;
+	r->d = D;
+	r->e = E;
+	r->h = H;
+	r->l = L;
+	r->f = F;
+	r->pc = PC;
+	r->sp = SP;
+	r->iff = IFF;
+#ifndef EXCLUDE_Z80
+	r->a_ = A_;
+	r->b_ = B_;
+	r->c_ = C_;
+	r->d_ = D_;
+	r->e_ = E_;
+	r->h_ = H_;
+	r->l_ = L_;
+	r->f_ = F_;
+	r->ix = IX;
+	r->iy = IY;
+	r->i = I;
+	r->r = R;
+	r->r_ = R_;
+	r->int_mode = int_mode;
+#endif
+	r->int_protection = int_protection;
+	r->t = T;
+}
+
+static void load_regs(const regs_t *r)
+{
+	cpu = r->cpu;
+	A = r->a;
+	B = r->b;
+	C = r->c;
+	D = r->d;
+	E = r->e;
+	H = r->h;
+	L = r->l;
+	F = r->f;
+	PC = r->pc;
+	SP = r->sp;
+	IFF = r->iff;
+#ifndef EXCLUDE_Z80
+	A_ = r->a_;
+	B_ = r->b_;
+	C_ = r->c_;
+	D_ = r->d_;
+	E_ = r->e_;
+	H_ = r->h_;
+	L_ = r->l_;
+	F_ = r->f_;
+	IX = r->ix;
+	IY = r->iy;
+	I = r->i;
+	R = r->r;
+	R_ = r->r_;
+	int_mode = r->int_mode;
+#endif
+	int_protection = r->int_protection;
+	T = r->t;
+}
+
+#endif /* WANT_REVERSE */
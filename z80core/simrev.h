@@ -0,0 +1,51 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+#ifndef SIMREV_INC
+#define SIMREV_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+#ifdef WANT_REVERSE
+
+#define REV_INTERVAL	1000000	/* default T-states between checkpoints */
+#define REV_BUDGET	16384	/* default memory for checkpoints in KB */
+
+#define REV_SHIFT	8	/* checkpoints keep 256 byte pages */
+#define REV_PAGES	(65536 >> REV_SHIFT)
+				/* bits in rev_pages */
+#define REV_CP		1	/* written since the last checkpoint */
+#define REV_ICE		2	/* written since the CPU stopped */
+
+extern bool	rev_flag;	/* history is recorded */
+extern bool	rev_scan;	/* searching the history for a write */
+extern Tstates_t rev_next;	/* T-states of next call to rev_check() */
+extern BYTE	rev_pages[REV_PAGES]; /* pages written */
+
+extern bool rev_check(void);
+extern bool rev_hit(void);
+extern bool rev_start(Tstates_t interval, unsigned budget);
+extern void rev_stop(void);
+extern void rev_show(void);
+extern void rev_resume(void);
+extern void rev_pause(void);
+extern bool rev_back(unsigned n);
+extern bool rev_write(WORD addr);
+extern bool rev_goto(Tstates_t t);
+
+/*
+ * called for every memory write, so that only the written pages
+ * are compared for checkpoints and changes in the ICE
+ */
+static inline void rev_mark(WORD addr)
+{
+	rev_pages[addr >> REV_SHIFT] = REV_CP | REV_ICE;
+}
+
+#endif /* WANT_REVERSE */
+
+#endif /* !SIMREV_INC */
@@ -8,6 +8,11 @@
 
 /*
  *	This module contains the SDL2 integration for the simulator.
+ *
+ *	The main loop is a frame scheduler: every window is drawn at its
+ *	own frame rate, in between the loop sleeps in SDL_WaitEventTimeout()
+ *	until the next window is due or an event arrives. Requests from the
+ *	simulator thread wake the loop with an user event.
  */
 
 #include <stdio.h>
@@ -19,6 +24,7 @@
 #include "simdefs.h"
 #include "simsdl.h"
 #include "simmain.h"
+#include "simport.h"
 
 #ifdef FRONTPANEL
 #include <SDL_image.h>
@@ -26,6 +32,7 @@
 #endif
 
 #define MAX_WINDOWS 5
+#define MAX_WAIT    1000	/* max. wait for events in ms */
 
 static int sim_thread_func(void *data);
 
@@ -39,6 +46,8 @@ typedef struct window {
 	bool is_new;
 	bool quit;
 	win_funcs_t *funcs;
+	uint64_t next;		/* time of next frame in us */
+	uint64_t tick;		/* time of next seconds tick in us */
 } window_t;
 
 int sdl_num_joysticks = 0;
@@ -52,13 +61,98 @@ BYTE sdl_joystick_1_buttons = 0;
 static window_t win[MAX_WINDOWS];
 static bool sim_finished;	/* simulator thread finished flag */
 
+/* wake up the main loop, can be called from any thread */
+static void wakeup(void)
+{
+	SDL_Event event;
+
+	SDL_zero(event);
+	event.type = SDL_USEREVENT;
+	SDL_PushEvent(&event);
+}
+
+/* process an event, returns true if the application should quit */
+static bool process_event(SDL_Event *event)
+{
+	bool quit = false;
+	int i;
+
+	switch(event->type) {
+	case SDL_JOYAXISMOTION:
+		switch(event->jdevice.which) {
+			case 0:
+				switch(event->jaxis.axis) {
+					case 0:
+						sdl_joystick_0_x_axis = event->jaxis.value;
+						break;
+					case 1:
+						sdl_joystick_0_y_axis = event->jaxis.value;
+						break;
+					default:;
+				}
+				break;
+			case 1:
+				switch(event->jaxis.axis) {
+					case 0:
+						sdl_joystick_1_x_axis = event->jaxis.value;
+						break;
+					case 1:
+						sdl_joystick_1_y_axis = event->jaxis.value;
+						break;
+					default:;
+				}
+				break;
+			default:;
+		}
+		break;
+	case SDL_JOYHATMOTION:
+		break;
+	case SDL_JOYBUTTONDOWN:
+		switch(event->jdevice.which) {
+			case 0:
+				sdl_joystick_0_buttons |= 1 << event->jbutton.button;
+				break;
+			case 1:
+				sdl_joystick_1_buttons |= 1 << event->jbutton.button;
+				break;
+			default:;
+		}	
+		break;
+	case SDL_JOYBUTTONUP:
+		switch(event->jdevice.which) {
+			case 0:
+				sdl_joystick_0_buttons &= ~(1 << event->jbutton.button);
+				break;
+			case 1:
+				sdl_joystick_1_buttons &= ~(1 << event->jbutton.button);
+				break;
+			default:;
+		}	
+		break;
+	case SDL_JOYDEVICEADDED:
+		break;
+	case SDL_JOYDEVICEREMOVED:
+		break;
+	case SDL_QUIT:
+		quit = true;
+		break;
+	default:;
+	}
+
+	for (i = 0; i < MAX_WINDOWS; i++)
+		if (win[i].in_use && !win[i].is_new)
+			(*win[i].funcs->event)(event);
+
+	return quit;
+}
+
 int main(int argc, char *argv[])
 {
 	SDL_Event event;
-	bool quit = false, tick;
+	bool quit = false, tick, events;
 	SDL_Thread *sim_thread;
-	uint64_t t1, t2;
-	int i, status;
+	uint64_t now, due;
+	int i, status, timeout;
 	args_t args = {argc, argv};
 
 	SDL_SetHint(SDL_HINT_JOYSTICK_ALLOW_BACKGROUND_EVENTS, "1");
@@ -103,97 +197,56 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
-	tick = true;
-	t1 = SDL_GetTicks64() + 1000;
+	timeout = 0;
 	while (!quit) {
-		/* process event queue */
-		while (SDL_PollEvent(&event) != 0) {
-			switch(event.type) {
-			case SDL_JOYAXISMOTION:
-				switch(event.jdevice.which) {
-					case 0:
-						switch(event.jaxis.axis) {
-							case 0:
-								sdl_joystick_0_x_axis = event.jaxis.value;
-								break;
-							case 1:
-								sdl_joystick_0_y_axis = event.jaxis.value;
-								break;
-							default:;
-						}
-						break;
-					case 1:
-						switch(event.jaxis.axis) {
-							case 0:
-								sdl_joystick_1_x_axis = event.jaxis.value;
-								break;
-							case 1:
-								sdl_joystick_1_y_axis = event.jaxis.value;
-								break;
-							default:;
-						}
-						break;
-					default:;
-				}
-				break;
-			case SDL_JOYHATMOTION:
-				break;
-			case SDL_JOYBUTTONDOWN:
-				switch(event.jdevice.which) {
-					case 0:
-						sdl_joystick_0_buttons |= 1 << event.jbutton.button;
-						break;
-					case 1:
-						sdl_joystick_1_buttons |= 1 << event.jbutton.button;
-						break;
-					default:;
-				}	
-				break;
-			case SDL_JOYBUTTONUP:
-				switch(event.jdevice.which) {
-					case 0:
-						sdl_joystick_0_buttons &= ~(1 << event.jbutton.button);
-						break;
-					case 1:
-						sdl_joystick_1_buttons &= ~(1 << event.jbutton.button);
-						break;
-					default:;
-				}	
-				break;
-			case SDL_JOYDEVICEADDED:
-				break;
-			case SDL_JOYDEVICEREMOVED:
-				break;
-			case SDL_QUIT:
-				quit = true;
-				break;
-			default:;
-			}
-
-			for (i = 0; i < MAX_WINDOWS; i++)
-				if (win[i].in_use)
-					(*win[i].funcs->event)(&event);
+		/* wait for events until the next window is due */
+		if ((events = SDL_WaitEventTimeout(&event, timeout))) {
+			do {
+				if (process_event(&event))
+					quit = true;
+			} while (SDL_PollEvent(&event) != 0);
 		}
 
-		/* open/close/draw windows */
+		/* open/close windows and draw the ones which are due */
+		now = get_clock_us();
+		due = now + MAX_WAIT * 1000;
 		for (i = 0; i < MAX_WINDOWS; i++)
 			if (win[i].in_use) {
 				if (win[i].quit) {
 					(*win[i].funcs->close)();
 					win[i].in_use = false;
-				} else {
-					if (win[i].is_new) {
-						(*win[i].funcs->open)();
-						win[i].is_new = false;
-					}
+					continue;
+				}
+				if (win[i].is_new) {
+					(*win[i].funcs->open)();
+					win[i].is_new = false;
+					win[i].next = now;
+					win[i].tick = now;
+				}
+				if (now >= win[i].next
+				    || (win[i].funcs->fps == 0 && events)) {
+					/* update seconds tick */
+					if ((tick = (now >= win[i].tick)))
+						win[i].tick = now + 1000000;
 					(*win[i].funcs->draw)(tick);
+					if (win[i].funcs->fps > 0) {
+						win[i].next += 1000000 /
+							win[i].funcs->fps;
+						/* don't try to catch up missed frames */
+						if (win[i].next < now)
+							win[i].next = now;
+					} else
+						/* only after events and
+						   with the seconds tick */
+						win[i].next = win[i].tick;
 				}
+				if (win[i].next < due)
+					due = win[i].next;
 			}
 
-		/* update seconds tick */
-		t2 = SDL_GetTicks64();
-		if ((tick = (t2 >= t1)))
-			t1 = t2 + 1000;
+		/* time to wait for the next frame, rounded up to ms */
+		now = get_clock_us();
+		timeout = (due > now) ? (int) ((due - now + 999) / 1000) : 0;
 
 		if (sim_finished)
 			quit = true;
@@ -226,6 +279,7 @@ int simsdl_create(win_funcs_t *funcs)
 			win[i].quit = false;
 			win[i].funcs = funcs;
 			win[i].in_use = true;
+			wakeup();
 			break;
 		}
 
@@ -240,8 +294,10 @@ int simsdl_create(win_funcs_t *funcs)
 /* this is called from the simulator thread */
 void simsdl_destroy(int i)
 {
-	if (i >= 0 && i < MAX_WINDOWS)
+	if (i >= 0 && i < MAX_WINDOWS) {
 		win[i].quit = true;
+		wakeup();
+	}
 }
 
 /* this thread runs the simulator */
@@ -252,6 +308,7 @@ static int sim_thread_func(void *data)
 
 	status = sim_main(args->argc, args->argv);
 	sim_finished = true;
+	wakeup();
 
 	return status;
 }
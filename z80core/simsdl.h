@@ -17,6 +17,7 @@ typedef struct win_funcs {
 	void (*close)(void);
 	void (*event)(SDL_Event *e);
 	void (*draw)(bool tick);
+	int fps;		/* target frame rate, 0 = only after events */
 } win_funcs_t;
 
 extern int simsdl_create(win_funcs_t *funcs);
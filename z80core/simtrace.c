@@ -0,0 +1,483 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	This module records an execution trace into a file, which can
+ *	be examined afterwards with the z80trace tool.
+ *
+ *	The CPU thread only appends small delta encoded records to a
+ *	block buffer in memory. Full blocks are handed to a writer
+ *	thread, which compresses and writes them, while the CPU fills
+ *	the next buffer. If the writer falls behind, the CPU waits for
+ *	a free buffer, so no records are lost.
+ *
+ *	Instructions and memory writes can be restricted to an address
+ *	range of the PC and to the memory bank of the PC, or only I/O
+ *	can be recorded. Machines with banked memory define MEM_BANK()
+ *	in simmem.h and pass the bank of memory writes to trace_write().
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simmem.h"
+#include "simtrace.h"
+
+#ifdef WANT_TRACE
+
+#include "log.h"
+static const char *TAG = "trace";
+
+#ifdef MEM_BANK
+#define TR_BANKED	true	/* machine has banked memory */
+#else
+#define TR_BANKED	false
+#define MEM_BANK(addr)	0
+#endif
+
+#define TR_NBUF		4	/* number of block buffers */
+#define TR_HBITS	12	/* bits of the compressor hash */
+
+bool tr_flag;				/* trace is recorded */
+
+static FILE *tr_fp;			/* trace file */
+static bool tr_io;			/* record I/O only */
+static WORD tr_from, tr_to;		/* PC range of instructions */
+static int tr_bankf;			/* bank of instructions, -1 all */
+static int tr_bank;			/* bank of the last record */
+static bool tr_inrange;			/* last instruction in range */
+static int tr_cpu;			/* CPU of last instruction */
+static WORD tr_pc;			/* PC of last instruction */
+static WORD tr_waddr;			/* address of last memory write */
+static WORD tr_regs[TR_NREGS];		/* registers of last instruction */
+static BYTE tr_code[65536];		/* op-code bytes in trace */
+
+static BYTE *tr_buf[TR_NBUF];		/* block buffers */
+static int tr_len[TR_NBUF];		/* length of records in buffers */
+static int tr_fill;			/* buffer filled by the CPU */
+static int tr_queued;			/* buffers waiting for the writer */
+static bool tr_stop;			/* writer thread has to stop */
+static BYTE *tr_ptr, *tr_lim;		/* fill pointer and limit */
+static BYTE *tr_pack_buf;		/* compressed block */
+static int tr_hash[1 << TR_HBITS];	/* compressor hash table */
+static bool tr_err;			/* write error */
+
+static pthread_t tr_thread;
+static pthread_mutex_t tr_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tr_cond_full = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t tr_cond_free = PTHREAD_COND_INITIALIZER;
+
+static void *tr_writer(void *arg);
+static void tr_submit(void);
+static int tr_pack(const BYTE *src, int n, BYTE *dst);
+static BYTE *tr_pack_len(BYTE *p, int n);
+static void tr_put32(BYTE *p, unsigned v);
+
+/*
+ *	append an unsigned varint to the current block
+ */
+static inline void tr_varint(unsigned v)
+{
+	while (v >= 0x80) {
+		*tr_ptr++ = (v & 0x7f) | 0x80;
+		v >>= 7;
+	}
+	*tr_ptr++ = v;
+}
+
+/*
+ *	append the zigzag encoded signed 16-bit difference d
+ */
+static inline void tr_delta(WORD d)
+{
+	int16_t s = (int16_t) d;
+
+	tr_varint(s < 0 ? ((unsigned) -s << 1) - 1 : (unsigned) s << 1);
+}
+
+/*
+ *	append a bank record, if the bank differs from the last one
+ */
+static inline void tr_setbank(int bank)
+{
+	if (bank != tr_bank) {
+		*tr_ptr++ = TR_BANK;
+		*tr_ptr++ = bank;
+		tr_bank = bank;
+	}
+}
+
+/*
+ *	Start recording a trace, spec is the filename optionally
+ *	followed by ",from,to" with the hexadecimal PC range,
+ *	",bank=n" with the memory bank of the PC and/or ",io" to
+ *	only record I/O
+ */
+bool trace_open(const char *spec)
+{
+	char fn[MAX_LFN];
+	char *s, *t, *e;
+	int i, naddr = 0;
+
+	if (tr_flag)
+		trace_close();
+
+	strncpy(fn, spec, MAX_LFN - 1);
+	fn[MAX_LFN - 1] = '\0';
+	tr_io = false;
+	tr_from = 0;
+	tr_to = 0xffff;
+	tr_bankf = -1;
+	if ((s = strchr(fn, ',')) != NULL) {
+		*s++ = '\0';
+		for (t = strtok(s, ","); t != NULL; t = strtok(NULL, ",")) {
+			while (*t == ' ')
+				t++;
+			if (!strcmp(t, "io") || !strcmp(t, "IO"))
+				tr_io = true;
+			else if (!strncmp(t, "bank=", 5)
+				 || !strncmp(t, "BANK=", 5)) {
+				tr_bankf = strtol(t + 5, &e, 10);
+				if (e == t + 5 || *e != '\0' || tr_bankf < 0
+				    || tr_bankf > 255) {
+					LOGE(TAG, "invalid bank %s", t + 5);
+					return false;
+				}
+			} else if (naddr == 0) {
+				tr_from = strtol(t, NULL, 16);
+				naddr++;
+			} else
+				tr_to = strtol(t, NULL, 16);
+		}
+	}
+	if (fn[0] == '\0') {
+		LOGE(TAG, "no trace file given");
+		return false;
+	}
+
+	if ((tr_fp = fopen(fn, "wb")) == NULL) {
+		LOGE(TAG, "can't open file %s", fn);
+		return false;
+	}
+	for (i = 0; i < TR_NBUF; i++)
+		if (tr_buf[i] == NULL
+		    && (tr_buf[i] = (BYTE *) malloc(TR_BLKSIZE)) == NULL) {
+			LOGE(TAG, "out of memory");
+			fclose(tr_fp);
+			return false;
+		}
+	if (tr_pack_buf == NULL && (tr_pack_buf = (BYTE *)
+				    malloc(TR_BLKSIZE + TR_BLKSIZE / 255
+					   + 16)) == NULL) {
+		LOGE(TAG, "out of memory");
+		fclose(tr_fp);
+		return false;
+	}
+	fwrite(TR_MAGIC, 1, 8, tr_fp);
+
+	/* the reader starts with zeroed memory and registers */
+	memset(tr_code, 0, sizeof(tr_code));
+	memset(tr_regs, 0, sizeof(tr_regs));
+	tr_cpu = -1;
+	tr_pc = 0;
+	tr_waddr = 0;
+	tr_bank = TR_BANKED ? -1 : 0;
+	tr_inrange = false;
+	tr_err = false;
+
+	tr_fill = tr_queued = 0;
+	tr_stop = false;
+	tr_ptr = tr_buf[0];
+	tr_lim = tr_buf[0] + TR_BLKSIZE - TR_MAXREC;
+	if (pthread_create(&tr_thread, NULL, tr_writer, NULL)) {
+		LOGE(TAG, "can't create writer thread");
+		fclose(tr_fp);
+		return false;
+	}
+
+	tr_flag = true;
+	return true;
+}
+
+/*
+ *	Stop recording, write the remaining records, and close the file
+ */
+void trace_close(void)
+{
+	if (!tr_flag)
+		return;
+	tr_flag = false;
+
+	tr_submit();
+	pthread_mutex_lock(&tr_mutex);
+	tr_stop = true;
+	pthread_cond_signal(&tr_cond_full);
+	pthread_mutex_unlock(&tr_mutex);
+	pthread_join(tr_thread, NULL);
+
+	if (fclose(tr_fp) || tr_err)
+		LOGE(TAG, "error writing trace file");
+	tr_fp = NULL;
+}
+
+/*
+ *	Record the instruction at PC before it is executed,
+ *	called from the CPU loop when tr_flag is set
+ */
+void trace_inst(void)
+{
+	register int i;
+	register unsigned mask;
+	register BYTE tag;
+	WORD regs[TR_NREGS];
+	BYTE *p;
+	int bank = MEM_BANK(PC);
+
+	tr_inrange = (PC >= tr_from && PC <= tr_to
+		      && (tr_bankf < 0 || bank == tr_bankf));
+	if (tr_io || !tr_inrange)
+		return;
+
+	if (tr_ptr > tr_lim)
+		tr_submit();
+	tr_setbank(bank);
+
+	if (cpu != tr_cpu) {
+		*tr_ptr++ = TR_CPU;
+		*tr_ptr++ = cpu;
+		tr_cpu = cpu;
+	}
+
+	regs[0] = (A << 8) + F;
+	regs[1] = (B << 8) + C;
+	regs[2] = (D << 8) + E;
+	regs[3] = (H << 8) + L;
+	regs[4] = SP;
+#ifndef EXCLUDE_Z80
+	regs[5] = IX;
+	regs[6] = IY;
+	regs[7] = (A_ << 8) + F_;
+	regs[8] = (B_ << 8) + C_;
+	regs[9] = (D_ << 8) + E_;
+	regs[10] = (H_ << 8) + L_;
+	regs[11] = (I << 8) + IFF;
+#else
+	for (i = 5; i < 11; i++)
+		regs[i] = 0;
+	regs[11] = IFF;
+#endif
+	mask = 0;
+	for (i = 0; i < TR_NREGS; i++)
+		if (regs[i] != tr_regs[i])
+			mask |= 1U << i;
+
+	p = tr_ptr++;
+	tag = TR_INST;
+	tr_delta(PC - tr_pc);
+	tr_pc = PC;
+	for (i = 0; i < 4; i++)
+		if (tr_code[(WORD) (PC + i)] != getmem(PC + i))
+			break;
+	if (i < 4) {
+		tag |= TR_OPC;
+		for (i = 0; i < 4; i++)
+			*tr_ptr++ = tr_code[(WORD) (PC + i)] = getmem(PC + i);
+	}
+	if (mask) {
+		tag |= TR_REGS;
+		tr_varint(mask);
+		for (i = 0; i < TR_NREGS; i++)
+			if (mask & (1U << i)) {
+				*tr_ptr++ = regs[i] & 0xff;
+				*tr_ptr++ = regs[i] >> 8;
+				tr_regs[i] = regs[i];
+			}
+	}
+	*p = tag;
+}
+
+/*
+ *	Record a memory write of the current instruction into bank
+ */
+void trace_write(int bank, WORD addr, BYTE data)
+{
+	if (tr_io || !tr_inrange)
+		return;
+
+	if (tr_ptr > tr_lim)
+		tr_submit();
+	tr_setbank(bank);
+	*tr_ptr++ = TR_WRITE;
+	tr_delta(addr - tr_waddr);
+	*tr_ptr++ = data;
+	tr_waddr = addr;
+}
+
+/*
+ *	Record an input or output, tag is TR_IN or TR_OUT
+ */
+void trace_io(int tag, BYTE port, BYTE data)
+{
+	if (!tr_io && !tr_inrange)
+		return;
+
+	if (tr_ptr > tr_lim)
+		tr_submit();
+	*tr_ptr++ = tag;
+	*tr_ptr++ = port;
+	*tr_ptr++ = data;
+}
+
+/*
+ *	hand the current block to the writer thread and continue
+ *	with the next buffer, wait if all buffers are in use
+ */
+static void tr_submit(void)
+{
+	tr_len[tr_fill] = tr_ptr - tr_buf[tr_fill];
+	if (tr_len[tr_fill] == 0)
+		return;
+
+	pthread_mutex_lock(&tr_mutex);
+	while (tr_queued == TR_NBUF - 1)
+		pthread_cond_wait(&tr_cond_free, &tr_mutex);
+	tr_queued++;
+	tr_fill = (tr_fill + 1) % TR_NBUF;
+	pthread_cond_signal(&tr_cond_full);
+	pthread_mutex_unlock(&tr_mutex);
+
+	tr_ptr = tr_buf[tr_fill];
+	tr_lim = tr_ptr + TR_BLKSIZE - TR_MAXREC;
+}
+
+/*
+ *	writer thread, compresses and writes the queued blocks
+ */
+static void *tr_writer(void *arg)
+{
+	int n, len, clen;
+	BYTE hdr[8];
+
+	UNUSED(arg);
+
+	for (;;) {
+		pthread_mutex_lock(&tr_mutex);
+		while (tr_queued == 0 && !tr_stop)
+			pthread_cond_wait(&tr_cond_full, &tr_mutex);
+		if (tr_queued == 0) {
+			pthread_mutex_unlock(&tr_mutex);
+			break;
+		}
+		n = (tr_fill - tr_queued + TR_NBUF) % TR_NBUF;
+		pthread_mutex_unlock(&tr_mutex);
+
+		len = tr_len[n];
+		clen = tr_pack(tr_buf[n], len, tr_pack_buf);
+		tr_put32(hdr, len);
+		if (clen < len) {
+			tr_put32(hdr + 4, clen);
+			if (fwrite(hdr, 1, 8, tr_fp) != 8
+			    || fwrite(tr_pack_buf, 1, clen, tr_fp)
+			    != (size_t) clen)
+				tr_err = true;
+		} else {
+			tr_put32(hdr + 4, 0);
+			if (fwrite(hdr, 1, 8, tr_fp) != 8
+			    || fwrite(tr_buf[n], 1, len, tr_fp)
+			    != (size_t) len)
+				tr_err = true;
+		}
+
+		pthread_mutex_lock(&tr_mutex);
+		tr_queued--;
+		pthread_cond_signal(&tr_cond_free);
+		pthread_mutex_unlock(&tr_mutex);
+	}
+
+	return NULL;
+}
+
+/*
+ *	LZ77 compression of n bytes from src into dst, a sequence is a
+ *	token with the number of literals in the upper and the match
+ *	length - 4 in the lower nibble, a nibble of 15 is continued with
+ *	bytes added until one is not 255, then follow the literals, the
+ *	16-bit little endian offset of the match, and the continuation
+ *	of the match length, the last sequence has literals only
+ *	returns the length of the compressed data
+ */
+static int tr_pack(const BYTE *src, int n, BYTE *dst)
+{
+	register int i, r, h;
+	int anchor, len;
+	BYTE *p = dst, *tok;
+
+	memset(tr_hash, 0xff, sizeof(tr_hash));
+	i = anchor = 0;
+	while (i + 4 <= n) {
+		h = ((src[i] | (src[i + 1] << 8) | (src[i + 2] << 16) |
+		      ((unsigned) src[i + 3] << 24)) * 2654435761U)
+		    >> (32 - TR_HBITS);
+		r = tr_hash[h];
+		tr_hash[h] = i;
+		if (r < 0 || i - r > 65535 || memcmp(src + r, src + i, 4)) {
+			i++;
+			continue;
+		}
+		for (len = 4; i + len < n && src[r + len] == src[i + len];
+		     len++)
+			;
+		tok = p++;
+		*tok = ((i - anchor < 15 ? i - anchor : 15) << 4) |
+		       (len - 4 < 15 ? len - 4 : 15);
+		p = tr_pack_len(p, i - anchor);
+		memcpy(p, src + anchor, i - anchor);
+		p += i - anchor;
+		*p++ = (i - r) & 0xff;
+		*p++ = (i - r) >> 8;
+		p = tr_pack_len(p, len - 4);
+		i += len;
+		anchor = i;
+	}
+	tok = p++;
+	*tok = (n - anchor < 15 ? n - anchor : 15) << 4;
+	p = tr_pack_len(p, n - anchor);
+	memcpy(p, src + anchor, n - anchor);
+	p += n - anchor;
+
+	return p - dst;
+}
+
+/*
+ *	append the continuation bytes of a length n to p
+ */
+static BYTE *tr_pack_len(BYTE *p, int n)
+{
+	if (n >= 15) {
+		for (n -= 15; n >= 255; n -= 255)
+			*p++ = 255;
+		*p++ = n;
+	}
+	return p;
+}
+
+/*
+ *	store v as 32-bit little endian word at p
+ */
+static void tr_put32(BYTE *p, unsigned v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+	p[2] = (v >> 16) & 0xff;
+	p[3] = (v >> 24) & 0xff;
+}
+
+#endif /* WANT_TRACE */
@@ -0,0 +1,73 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+#ifndef SIMTRACE_INC
+#define SIMTRACE_INC
+
+#include "sim.h"
+#include "simdefs.h"
+
+/*
+ *	Format of a trace file:
+ *
+ *	The file starts with the 8 bytes TR_MAGIC, followed by blocks.
+ *	A block has a header of two 32-bit little endian words, the
+ *	length of the records in the block and the length of the
+ *	compressed data following the header, or 0 if the records
+ *	are stored uncompressed.
+ *
+ *	The records of all blocks form one stream, the first byte of
+ *	a record is the tag:
+ *
+ *	TR_INST|flags	instruction, PC as varint of the zigzag encoded
+ *			difference to the PC of the last instruction,
+ *			with TR_OPC the 4 bytes at PC follow, with TR_REGS
+ *			a varint with the mask of changed registers and
+ *			the new values as 16-bit little endian words
+ *	TR_WRITE	memory write, address as varint of the zigzag
+ *			encoded difference to the last write address,
+ *			and the data byte
+ *	TR_IN		input, port and data byte
+ *	TR_OUT		output, port and data byte
+ *	TR_CPU		CPU type, Z80 or I8080
+ *	TR_BANK		memory bank of the following instructions and
+ *			writes, only from machines with banked memory,
+ *			before the first record and when the bank changes
+ *
+ *	The op-code bytes at PC are only recorded when they differ
+ *	from the ones recorded last for this address.
+ */
+
+#define TR_MAGIC	"Z80TRC01"
+
+#define TR_WRITE	0x01	/* memory write record */
+#define TR_IN		0x02	/* input record */
+#define TR_OUT		0x03	/* output record */
+#define TR_CPU		0x04	/* CPU type record */
+#define TR_BANK		0x05	/* memory bank record */
+#define TR_INST		0x80	/* instruction record */
+#define TR_OPC		0x01	/* op-code bytes follow */
+#define TR_REGS		0x02	/* changed registers follow */
+
+#define TR_NREGS	12	/* registers in the mask */
+				/* AF BC DE HL SP IX IY AF' BC' DE' HL' IFF */
+
+#define TR_BLKSIZE	65536	/* max. length of the records in a block */
+#define TR_MAXREC	64	/* max. length of one record */
+
+#ifdef WANT_TRACE
+
+extern bool	tr_flag;
+
+extern bool trace_open(const char *spec);
+extern void trace_close(void);
+extern void trace_inst(void);
+extern void trace_write(int bank, WORD addr, BYTE data);
+extern void trace_io(int tag, BYTE port, BYTE data);
+
+#endif /* WANT_TRACE */
+
+#endif /* !SIMTRACE_INC */
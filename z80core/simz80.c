@@ -20,6 +20,21 @@
 #ifdef WANT_ICE
 #include "simice.h"
 #endif
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_COVER
+#include "simcov.h"
+#endif
+#ifdef WANT_REPLAY
+#include "simreplay.h"
+#endif
+#ifdef WANT_REVERSE
+#include "simrev.h"
+#endif
+#ifdef WANT_JIT
+#include "simjit.h"
+#endif
 
 #ifdef FRONTPANEL
 #include "frontpanel.h"
@@ -405,6 +420,12 @@ void cpu_z80(void)
 
 #ifdef WANT_ICE
 
+#ifdef WANT_REVERSE
+		/* checkpoints of the history, stop when re-executing it */
+		if (rev_flag && T >= rev_next && rev_check())
+			continue;
+#endif
+
 #ifdef HISIZE
 		/* write history */
 		his[h_next].h_cpu = Z80;
@@ -433,6 +454,11 @@ void cpu_z80(void)
 
 #endif /* WANT_ICE */
 
+#ifdef WANT_TRACE
+		if (tr_flag)
+			trace_inst();
+#endif
+
 		/* CPU DMA bus request handling */
 		if (bus_mode) {
 
@@ -479,8 +505,17 @@ void cpu_z80(void)
 			}
 		}
 
+#ifdef WANT_REPLAY
+		if (rr_mode == RR_REPLAY)
+			rr_sync();
+#endif
+
 		/* CPU interrupt handling */
-		if (int_nmi) {		/* non-maskable interrupt */
+		if (int_nmi		/* non-maskable interrupt */
+#ifdef WANT_REPLAY
+		    && rr_accept(RR_NMI)
+#endif
+		   ) {
 			IFF = (IFF << 1) & 3;
 			memwrt(--SP, PC >> 8);
 			memwrt(--SP, PC);
@@ -495,6 +530,10 @@ void cpu_z80(void)
 				goto leave;
 			if (int_protection)	/* protect first instruction */
 				goto leave;	/* after EI */
+#ifdef WANT_REPLAY
+			if (!rr_accept(RR_INT))
+				goto leave;
+#endif
 
 			IFF = 0;
 
@@ -598,10 +637,22 @@ void cpu_z80(void)
 		}
 	leave:
 
+#ifdef WANT_JIT
+					/* run a translated block */
+		if (!jit_flag || !jit_run(Z80, op_sim)) {
+#endif
+
 #ifdef BUS_8080
 		/* M1 opcode fetch */
 		cpu_bus = CPU_WO | CPU_M1 | CPU_MEMR;
 #endif
+#ifdef WANT_COVER
+		if (cv_flag)
+			cv_acc = CV_EXEC;	/* next read is the op-code */
+#endif
+#ifdef WANT_METRICS
+		cpu_inst++;
+#endif
 
 		R++;			/* increment refresh register */
 
@@ -612,6 +663,10 @@ void cpu_z80(void)
 #include "altz80.h"
 #endif
 
+#ifdef WANT_JIT
+		}
+#endif
+
 #ifdef WANT_ICE
 
 #ifdef WANT_TIM
@@ -624,7 +679,7 @@ void cpu_z80(void)
 #endif
 
 #ifdef WANT_HB
-		if (hb_trig) {
+		if (hb_trig && hb_check()) {
 			cpu_error = OPHALT;
 			cpu_state = ST_STOPPED;
 		}
@@ -713,11 +768,18 @@ static int op_halt(void)		/* HALT */
 			cpu_state = ST_STOPPED;
 		} else {
 			/* else wait for INT, NMI or user interrupt */
+#ifdef WANT_REPLAY
+			if (rr_mode != RR_REPLAY)
+#endif
 			while (!int_int && !int_nmi &&
 			       (cpu_state == ST_CONTIN_RUN)) {
 				sleep_for_ms(1);
 				R += 99;
 			}
+#ifdef WANT_REPLAY
+			if (rr_mode)
+				rr_halt();
+#endif
 		}
 #ifdef BUS_8080
 		if (int_int)
@@ -12,6 +12,13 @@
  * 15-AUG-2017 don't use macros, use inline functions that coerce appropriate
  * 04-NOV-2019 add functions for direct memory access
  * 14-DEC-2024 added hardware breakpoint support
+ * 16-OCT-2026 hardware breakpoints use per address access bitmaps
+ * 16-OCT-2026 record memory writes into the execution trace
+ * 16-OCT-2026 record memory writes of devices into the history
+ * 16-OCT-2026 record memory accesses for code coverage
+ * 16-OCT-2026 memory writes drop translated code
+ * 16-OCT-2026 mark the pages written for the history
+ * 16-OCT-2026 pass the memory bank to the execution trace
  */
 
 #ifndef SIMMEM_INC
@@ -22,6 +29,19 @@
 #ifdef WANT_ICE
 #include "simice.h"
 #endif
+#ifdef WANT_TRACE
+#include "simtrace.h"
+#endif
+#ifdef WANT_COVER
+#include "simcov.h"
+#endif
+#ifdef WANT_REVERSE
+#include "simreplay.h"
+#include "simrev.h"
+#endif
+#ifdef WANT_JIT
+#include "simjit.h"
+#endif
 
 #ifdef BUS_8080
 #include "simglb.h"
@@ -41,10 +61,24 @@ static inline void memwrt(WORD addr, BYTE data)
 #endif
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr && (hb_mode & HB_WRITE))
-		hb_trig = HB_WRITE;
+	if (hb_flag && (hb_map[addr] & HB_WRITE))
+		hb_hit(addr, HB_WRITE);
+#endif
+#ifdef WANT_TRACE
+	if (tr_flag)
+		trace_write(0, addr, data);
+#endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_write(0, addr);
 #endif
 	memory[addr] = data;
+#ifdef WANT_REVERSE
+	rev_mark(addr);
+#endif
+#ifdef WANT_JIT
+	jit_write(addr);
+#endif
 }
 
 static inline BYTE memrdr(WORD addr)
@@ -52,16 +86,20 @@ static inline BYTE memrdr(WORD addr)
 	register BYTE data;
 
 #ifdef WANT_HB
-	if (hb_flag && hb_addr == addr) {
+	if (hb_flag && hb_map[addr]) {
 		if (cpu_bus & CPU_M1) {
-			if (hb_mode & HB_EXEC)
-				hb_trig = HB_EXEC;
+			if (hb_map[addr] & HB_EXEC)
+				hb_hit(addr, HB_EXEC);
 		} else {
-			if (hb_mode & HB_READ)
-				hb_trig = HB_READ;
+			if (hb_map[addr] & HB_READ)
+				hb_hit(addr, HB_READ);
 		}
 	}
 #endif
+#ifdef WANT_COVER
+	if (cv_flag)
+		cover_read(0, addr);
+#endif
 
 	data = memory[addr];
 
@@ -78,7 +116,17 @@ static inline BYTE memrdr(WORD addr)
  */
 static inline void dma_write(WORD addr, BYTE data)
 {
+#ifdef WANT_REVERSE
+	if (rr_hist && rr_mode == RR_RECORD)
+		rr_dma(addr, data);
+#endif
 	memory[addr] = data;
+#ifdef WANT_REVERSE
+	rev_mark(addr);
+#endif
+#ifdef WANT_JIT
+	jit_write(addr);
+#endif
 }
 
 static inline BYTE dma_read(WORD addr)
@@ -92,6 +140,12 @@ static inline BYTE dma_read(WORD addr)
 static inline void putmem(WORD addr, BYTE data)
 {
 	memory[addr] = data;
+#ifdef WANT_REVERSE
+	rev_mark(addr);
+#endif
+#ifdef WANT_JIT
+	jit_write(addr);
+#endif
 }
 
 static inline BYTE getmem(WORD addr)
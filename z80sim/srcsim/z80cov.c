@@ -0,0 +1,294 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	This program merges coverage files recorded by the simulators
+ *	with option -C, and maps the coverage to the lines of z80asm
+ *	listings. The report is written in the lcov tracefile format,
+ *	with the listing as source file, so that it can be processed
+ *	with genhtml and other lcov tools.
+ *
+ *	A listing line with object code counts as executed, when the
+ *	first byte was executed. Lines with data pseudo-ops are left
+ *	out, as well as lines with code that was only read as data.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simcov.h"
+
+#define MAXLIST	32			/* max. number of listings */
+#define LINELEN	256			/* max. length of listing lines */
+
+static BYTE *map[CV_NBANKS];		/* merged access flags */
+
+static const char *const dataops[] = {
+	"DB", "DC", "DEFB", "DEFC", "DEFM", "DEFT", "DEFW", "DEFZ", "DW",
+	NULL
+};
+
+static bool merge(const char *fn);
+static bool save(const char *fn);
+static bool report(const char *spec);
+static int code_line(const char *s, WORD *addr, int *nbytes);
+static void summary(void);
+
+int main(int argc, char *argv[])
+{
+	char *s, *ofn = NULL, *lst[MAXLIST];
+	int i, nlst = 0;
+	char opt;
+	BYTE *p;
+
+	while (--argc > 0 && (*++argv)[0] == '-')
+		for (s = argv[0] + 1; *s != '\0'; s++)
+			switch (*s) {
+			case 'o':	/* write merged coverage file */
+			case 'l':	/* report for listing */
+				opt = *s++;
+				if (*s == '\0') {
+					if (argc <= 1)
+						goto usage;
+					argc--;
+					argv++;
+					s = argv[0];
+				}
+				if (opt == 'o')
+					ofn = s;
+				else if (nlst < MAXLIST)
+					lst[nlst++] = s;
+				else {
+					puts("too many listings");
+					return EXIT_FAILURE;
+				}
+				s += strlen(s) - 1;
+				break;
+			default:
+				printf("invalid option %c\n", *s);
+				goto usage;
+			}
+	if (argc < 1) {
+usage:
+		puts("usage:\tz80cov -o outfile -l listing[,bank] "
+		     "covfile ...\n");
+		puts("\t-o = write merged coverage into outfile");
+		puts("\t-l = write lcov report for z80asm listing, "
+		     "with code in bank");
+		return EXIT_FAILURE;
+	}
+
+	if ((p = (BYTE *) calloc(CV_NBANKS, 65536)) == NULL) {
+		puts("can't allocate memory");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < CV_NBANKS; i++)
+		map[i] = p + i * 65536;
+
+	for (; argc > 0; argc--, argv++)
+		if (!merge(argv[0]))
+			return EXIT_FAILURE;
+	if (ofn != NULL && !save(ofn))
+		return EXIT_FAILURE;
+	for (i = 0; i < nlst; i++)
+		if (!report(lst[i]))
+			return EXIT_FAILURE;
+	if (ofn == NULL && nlst == 0)
+		summary();
+
+	free(p);
+	return EXIT_SUCCESS;
+}
+
+/*
+ *	add the flags of a coverage file
+ */
+static bool merge(const char *fn)
+{
+	FILE *fp;
+	BYTE magic[8], *buf;
+	int bank;
+	register int i;
+
+	if ((fp = fopen(fn, "rb")) == NULL) {
+		printf("can't open file %s\n", fn);
+		return false;
+	}
+	if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, CV_MAGIC, 8)) {
+		printf("%s is not a coverage file\n", fn);
+		fclose(fp);
+		return false;
+	}
+	if ((buf = (BYTE *) malloc(65536)) == NULL) {
+		puts("can't allocate memory");
+		fclose(fp);
+		return false;
+	}
+	while ((bank = getc(fp)) != EOF) {
+		if (bank >= CV_NBANKS || fread(buf, 1, 65536, fp) != 65536) {
+			printf("%s is not a coverage file\n", fn);
+			break;
+		}
+		for (i = 0; i < 65536; i++)
+			map[bank][i] |= buf[i];
+	}
+	free(buf);
+	fclose(fp);
+	return bank == EOF;
+}
+
+/*
+ *	write the merged flags, like the simulators do
+ */
+static bool save(const char *fn)
+{
+	FILE *fp;
+	int bank;
+	register int i;
+
+	if ((fp = fopen(fn, "wb")) == NULL) {
+		printf("can't create file %s\n", fn);
+		return false;
+	}
+	fwrite(CV_MAGIC, 1, 8, fp);
+	for (bank = 0; bank < CV_NBANKS; bank++) {
+		for (i = 0; i < 65536; i++)
+			if (map[bank][i])
+				break;
+		if (i == 65536)
+			continue;
+		putc(bank, fp);
+		fwrite(map[bank], 1, 65536, fp);
+	}
+	if (fclose(fp)) {
+		printf("error writing file %s\n", fn);
+		return false;
+	}
+	return true;
+}
+
+/*
+ *	write the lcov record for the listing in spec "listing[,bank]"
+ */
+static bool report(const char *spec)
+{
+	FILE *fp;
+	char fn[LINELEN], line[LINELEN];
+	const char *s;
+	unsigned long n, found = 0, hit = 0;
+	int bank = 0, nbytes, i, acc, exec, c;
+	WORD addr;
+
+	if ((s = strrchr(spec, ',')) != NULL) {
+		bank = atoi(s + 1);
+		if (bank < 0 || bank >= CV_NBANKS) {
+			printf("invalid bank %d\n", bank);
+			return false;
+		}
+		n = s - spec;
+	} else
+		n = strlen(spec);
+	if (n >= LINELEN) {
+		printf("invalid listing %s\n", spec);
+		return false;
+	}
+	memcpy(fn, spec, n);
+	fn[n] = '\0';
+	if ((fp = fopen(fn, "r")) == NULL) {
+		printf("can't open file %s\n", fn);
+		return false;
+	}
+
+	printf("TN:\nSF:%s\n", fn);
+	n = 0;
+	while (fgets(line, LINELEN, fp) != NULL) {
+		n++;
+		if (strchr(line, '\n') == NULL)	/* skip rest of long line */
+			while ((c = getc(fp)) != EOF && c != '\n')
+				;
+		if (!code_line(line, &addr, &nbytes))
+			continue;
+		acc = 0;
+		for (i = 0; i < nbytes; i++)
+			acc |= map[bank][(WORD) (addr + i)];
+		exec = (map[bank][addr] & CV_EXEC) ? 1 : 0;
+		if (!exec && (acc & CV_READ))
+			continue;	/* code only read as data */
+		found++;
+		hit += exec;
+		printf("DA:%lu,%d\n", n, exec);
+	}
+	printf("LF:%lu\nLH:%lu\nend_of_record\n", found, hit);
+	fclose(fp);
+	return true;
+}
+
+/*
+ *	check if a listing line has object code of an instruction,
+ *	the layout is "LOC  OBJECT CODE  LINE  STMT SOURCE CODE"
+ */
+static int code_line(const char *s, WORD *addr, int *nbytes)
+{
+	char op[8];
+	const char *p;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		if (!isxdigit((unsigned char) s[i]))
+			return 0;
+	if (s[4] != ' ' || s[5] != ' ' || !isxdigit((unsigned char) s[6])
+	    || !isxdigit((unsigned char) s[7]) || strlen(s) <= 32)
+		return 0;	/* no object code or continuation line */
+	*addr = (WORD) strtoul(s, NULL, 16);
+	for (i = 0; i < 4 && isxdigit((unsigned char) s[6 + i * 3]); i++)
+		;
+	*nbytes = i;
+
+	/* skip label and get the op-code */
+	p = s + 32;
+	if (!isspace((unsigned char) *p))
+		while (*p != '\0' && !isspace((unsigned char) *p))
+			p++;
+	while (isspace((unsigned char) *p))
+		p++;
+	for (i = 0; i < 7 && (isalnum((unsigned char) *p) || *p == '.'); i++)
+		op[i] = toupper((unsigned char) *p++);
+	op[i] = '\0';
+	for (i = 0; dataops[i] != NULL; i++)
+		if (!strcmp(op, dataops[i]))
+			return 0;
+	return 1;
+}
+
+/*
+ *	print the number of addresses executed, read and written
+ */
+static void summary(void)
+{
+	unsigned long nexec, nread, nwrite;
+	int bank;
+	register int i;
+
+	for (bank = 0; bank < CV_NBANKS; bank++) {
+		nexec = nread = nwrite = 0;
+		for (i = 0; i < 65536; i++) {
+			if (map[bank][i] & CV_EXEC)
+				nexec++;
+			if (map[bank][i] & CV_READ)
+				nread++;
+			if (map[bank][i] & CV_WRITE)
+				nwrite++;
+		}
+		if (nexec + nread + nwrite == 0)
+			continue;
+		printf("bank %2d: %5lu executed, %5lu read, %5lu written\n",
+		       bank, nexec, nread, nwrite);
+	}
+}
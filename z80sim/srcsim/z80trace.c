@@ -0,0 +1,315 @@
+/*
+ * Z80SIM  -  a Z80-CPU simulator
+ *
+ * Copyright (C) 2026 by the z80pack contributors
+ */
+
+/*
+ *	This program prints an execution trace recorded by the simulators
+ *	with option -t or the ICE command w. The instructions are shown
+ *	with the disassembler of the ICE, which reads the op-codes from
+ *	a memory image built from the op-code bytes in the trace.
+ *
+ *	The registers changed by an instruction are printed before the
+ *	next one, memory writes and I/O after the instruction. Traces
+ *	of machines with banked memory show the bank in front of the
+ *	addresses.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "simdefs.h"
+#include "simglb.h"
+#include "simmem.h"
+#include "simdis.h"
+#include "simtrace.h"
+
+int cpu = DEF_CPU;			/* CPU of the instructions */
+BYTE memory[65536];			/* op-codes recorded in the trace */
+
+static const char *const rnames[TR_NREGS] = {
+	"AF", "BC", "DE", "HL", "SP", "IX", "IY",
+	"AF'", "BC'", "DE'", "HL'", "IFF"
+};
+
+static bool s_opt;			/* print statistics only */
+static WORD pc, waddr;
+static int bank = -1;			/* memory bank, -1 if not banked */
+static unsigned long ninst, nwrite, nio, nblk;
+static unsigned long long rawsize, filesize;
+
+static int expand(const BYTE *src, int n, BYTE *dst, int max);
+static bool records(const BYTE *p, const BYTE *end);
+static unsigned get32(const BYTE *p);
+
+int main(int argc, char *argv[])
+{
+	FILE *fp;
+	BYTE hdr[8];
+	BYTE *raw, *packed;
+	unsigned len, clen;
+	int n;
+	char *s;
+
+	while (--argc > 0 && (*++argv)[0] == '-')
+		for (s = argv[0] + 1; *s != '\0'; s++)
+			switch (*s) {
+			case 's':	/* statistics only */
+				s_opt = true;
+				break;
+			default:
+				printf("invalid option %c\n", *s);
+				goto usage;
+			}
+	if (argc != 1) {
+usage:
+		puts("usage:\tz80trace -s tracefile\n");
+		puts("\t-s = print statistics only");
+		return EXIT_FAILURE;
+	}
+
+	if ((fp = fopen(argv[0], "rb")) == NULL) {
+		printf("can't open file %s\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (fread(hdr, 1, 8, fp) != 8 || memcmp(hdr, TR_MAGIC, 8)) {
+		printf("%s is not a trace file\n", argv[0]);
+		fclose(fp);
+		return EXIT_FAILURE;
+	}
+	if ((raw = (BYTE *) malloc(TR_BLKSIZE)) == NULL
+	    || (packed = (BYTE *) malloc(TR_BLKSIZE)) == NULL) {
+		puts("out of memory");
+		fclose(fp);
+		return EXIT_FAILURE;
+	}
+
+	filesize = 8;
+	while (fread(hdr, 1, 8, fp) == 8) {
+		len = get32(hdr);
+		clen = get32(hdr + 4);
+		if (len > TR_BLKSIZE || clen >= len) {
+			printf("invalid block %lu\n", nblk);
+			break;
+		}
+		if (clen == 0) {
+			if (fread(raw, 1, len, fp) != len)
+				break;
+			n = len;
+		} else {
+			if (fread(packed, 1, clen, fp) != clen)
+				break;
+			n = expand(packed, clen, raw, TR_BLKSIZE);
+			if (n != (int) len) {
+				printf("corrupted block %lu\n", nblk);
+				break;
+			}
+		}
+		nblk++;
+		rawsize += len;
+		filesize += 8 + (clen ? clen : len);
+		if (!records(raw, raw + n)) {
+			printf("invalid record in block %lu\n", nblk - 1);
+			break;
+		}
+	}
+	fclose(fp);
+
+	if (s_opt) {
+		printf("%lu instructions, %lu memory writes, %lu I/O\n",
+		       ninst, nwrite, nio);
+		printf("%lu blocks, %llu bytes of records, %llu bytes in "
+		       "file\n", nblk, rawsize, filesize);
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ *	get an unsigned varint at *pp
+ */
+static unsigned varint(const BYTE **pp, const BYTE *end)
+{
+	const BYTE *p = *pp;
+	unsigned v = 0;
+	int shift = 0;
+
+	while (p < end && (*p & 0x80) && shift < 28) {
+		v |= (unsigned) (*p++ & 0x7f) << shift;
+		shift += 7;
+	}
+	if (p < end)
+		v |= (unsigned) *p++ << shift;
+	*pp = p;
+	return v;
+}
+
+/*
+ *	get a zigzag encoded 16-bit difference at *pp
+ */
+static WORD delta(const BYTE **pp, const BYTE *end)
+{
+	unsigned v = varint(pp, end);
+
+	return (v & 1) ? (WORD) -(int) ((v + 1) >> 1) : (WORD) (v >> 1);
+}
+
+/*
+ *	decode and print the records from p to end
+ */
+static bool records(const BYTE *p, const BYTE *end)
+{
+	register int i;
+	unsigned mask;
+	const char *sep;
+	WORD w;
+	BYTE tag;
+
+	while (p < end) {
+		tag = *p++;
+		if (tag & TR_INST) {
+			pc += delta(&p, end);
+			if (tag & TR_OPC) {
+				if (end - p < 4)
+					return false;
+				for (i = 0; i < 4; i++)
+					memory[(WORD) (pc + i)] = *p++;
+			}
+			if (tag & TR_REGS) {
+				mask = varint(&p, end);
+				sep = "\t";
+				for (i = 0; i < TR_NREGS; i++) {
+					if (!(mask & (1U << i)))
+						continue;
+					if (end - p < 2)
+						return false;
+					w = p[0] | (p[1] << 8);
+					p += 2;
+					if (s_opt)
+						continue;
+					if (i == TR_NREGS - 1 && cpu == Z80)
+						printf("%sI=%02X IFF=%d", sep,
+						       w >> 8, w & 3);
+					else if (i == TR_NREGS - 1)
+						printf("%sIFF=%d", sep, w & 3);
+					else
+						printf("%s%s=%04X", sep,
+						       rnames[i], w);
+					sep = " ";
+				}
+				if (!s_opt)
+					putchar('\n');
+			}
+			ninst++;
+			if (!s_opt) {
+				if (bank >= 0)
+					printf("%d:", bank);
+				printf("%04X: ", pc);
+				(void) disass(pc);
+			}
+			continue;
+		}
+		switch (tag) {
+		case TR_WRITE:
+			waddr += delta(&p, end);
+			if (p >= end)
+				return false;
+			if (!s_opt && bank >= 0)
+				printf("\t(%d:%04X) <- %02X\n", bank, waddr,
+				       *p);
+			else if (!s_opt)
+				printf("\t(%04X) <- %02X\n", waddr, *p);
+			p++;
+			nwrite++;
+			break;
+		case TR_IN:
+		case TR_OUT:
+			if (end - p < 2)
+				return false;
+			if (!s_opt) {
+				if (tag == TR_IN)
+					printf("\tin  port %02X -> %02X\n",
+					       p[0], p[1]);
+				else
+					printf("\tout port %02X <- %02X\n",
+					       p[0], p[1]);
+			}
+			p += 2;
+			nio++;
+			break;
+		case TR_CPU:
+			if (p >= end)
+				return false;
+			cpu = *p++;
+			if (cpu != Z80 && cpu != I8080)
+				return false;
+			break;
+		case TR_BANK:
+			if (p >= end)
+				return false;
+			bank = *p++;
+			break;
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ *	expand n bytes of compressed data at src into dst,
+ *	see tr_pack() in simtrace.c for the format
+ *	returns the length of the expanded data or -1
+ */
+static int expand(const BYTE *src, int n, BYTE *dst, int max)
+{
+	const BYTE *ip = src, *end = src + n;
+	BYTE *op = dst;
+	int tok, lit, len, off, c;
+
+	while (ip < end) {
+		tok = *ip++;
+		lit = tok >> 4;
+		if (lit == 15)
+			do {
+				if (ip >= end)
+					return -1;
+				lit += c = *ip++;
+			} while (c == 255);
+		if (lit > end - ip || lit > max - (op - dst))
+			return -1;
+		memcpy(op, ip, lit);
+		op += lit;
+		ip += lit;
+		if (ip >= end)
+			break;
+		if (end - ip < 2)
+			return -1;
+		off = ip[0] | (ip[1] << 8);
+		ip += 2;
+		len = (tok & 15) + 4;
+		if ((tok & 15) == 15)
+			do {
+				if (ip >= end)
+					return -1;
+				len += c = *ip++;
+			} while (c == 255);
+		if (off == 0 || off > op - dst || len > max - (op - dst))
+			return -1;
+		while (len-- > 0) {
+			*op = *(op - off);
+			op++;
+		}
+	}
+	return op - dst;
+}
+
+/*
+ *	get 32-bit little endian word at p
+ */
+static unsigned get32(const BYTE *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned) p[3] << 24);
+}